@@ -582,6 +582,13 @@ struct starpu_conf
 	 */
 	unsigned driver_spinning_backoff_max;
 
+	/**
+	   Maximum time in µs that an idle worker spins, waiting for a task,
+	   before going to sleep. Workers only spin when tasks usually
+	   arrive within that time. 0 disables spinning. (default = \c 20)
+	 */
+	unsigned driver_idle_spin_max;
+
 	/**
 	   Specify if CUDA workers should do only fast allocations
 	   when running the datawizard progress of
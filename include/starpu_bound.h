@@ -35,6 +35,21 @@ extern "C" {
 */
 void starpu_bound_start(int deps, int prio);
 
+/**
+   Start recording tasks with dependencies like starpu_bound_start(1, 0),
+   but write the Linear Programming system in the lp format on \p output
+   as tasks get submitted, instead of keeping them in memory. This allows
+   to record very large task graphs. Since expressing that tasks do not
+   overlap on a worker would need constraints for each pair of tasks, the
+   system only expresses that the execution time is at least the load of
+   each worker, which gives a lower (less tight) bound. The system is
+   completed by starpu_bound_stop(), \p output must not be closed before.
+   starpu_bound_print_lp(), starpu_bound_print_dot(),
+   starpu_bound_print_mps(), starpu_bound_print() and
+   starpu_bound_compute() are not supported in that mode.
+*/
+void starpu_bound_start_stream(FILE *output);
+
 /**
    Stop recording tasks
 */
@@ -172,6 +172,27 @@ extern struct starpu_disk_ops starpu_disk_unistd_ops;
 */
 extern struct starpu_disk_ops starpu_disk_unistd_o_direct_ops;
 
+/**
+   Use the unistd library (write, read...) to read/write on disk, storing
+   all allocations in a few big files, so as to avoid creating one file
+   per allocation.
+*/
+extern struct starpu_disk_ops starpu_disk_unistd_slab_ops;
+
+/**
+   Use the unistd library (write, read...) to read/write on disk, and
+   the Linux io_uring interface for asynchronous transfers. Requests are
+   submitted to the kernel by batches, and their completion is polled
+   without any additional thread.
+
+   <strong>Warning: It creates one file per allocation !</strong>
+
+   Only available on Linux systems with io_uring headers.
+*/
+#ifdef STARPU_HAVE_IO_URING
+extern struct starpu_disk_ops starpu_disk_unistd_uring_ops;
+#endif
+
 /**
    Use the leveldb created by Google. More information at https://code.google.com/p/leveldb/
    Do not support asynchronous transfers.
@@ -112,6 +112,19 @@ struct starpu_fxt_options
 	   of dumped codelets.
 	*/
 	long dumped_codelets_count;
+
+	/**
+	   Number of threads used to convert the trace. 1 means that the input
+	   files are decoded by the calling thread. Otherwise, which is the
+	   default, they are decoded by background threads while the outputs
+	   are generated.
+	*/
+	unsigned nthreads;
+
+	/**
+	   Path of the binary version of the states file (see starpu_trace_bin_stats)
+	*/
+	char *states_bin_path;
 };
 
 void starpu_fxt_options_init(struct starpu_fxt_options *options);
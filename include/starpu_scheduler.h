@@ -201,6 +201,17 @@ struct starpu_sched_policy
 	const char *policy_description;
 
 	enum starpu_worker_collection_type worker_type;
+
+	/**
+	   Optional field. Insert \p ntasks tasks into the scheduler at
+	   once, which all belong to the same scheduling context. This
+	   is called instead of starpu_sched_policy::push_task for the
+	   tasks which become ready during a starpu_task_submit_array()
+	   call, and has the same requirements. If this returns -1,
+	   none of the tasks was pushed, and they are pushed again one
+	   by one.
+	*/
+	int (*push_tasks)(struct starpu_task **tasks, unsigned ntasks);
 };
 
 /**
@@ -1712,6 +1712,19 @@ static inline int starpu_task_submit_line(struct starpu_task *task, const char *
 #define starpu_task_submit(task) starpu_task_submit_line((task), __FILE__, __LINE__)
 #endif
 
+/**
+   Submit the \p ntasks tasks of the array \p tasks to StarPU, in the
+   array order. This is equivalent to calling starpu_task_submit() on
+   each of them, but the submission bookkeeping is shared by the whole
+   array, and the tasks which are ready are pushed to the scheduler
+   together once the whole array is submitted, with a single call to
+   starpu_sched_policy::push_tasks when the scheduler provides it.
+   In case of success, this function returns 0. Otherwise, it returns
+   the error of the first task which could not be submitted, the tasks
+   before it were submitted, and the tasks after it were not.
+*/
+int starpu_task_submit_array(struct starpu_task **tasks, unsigned ntasks) STARPU_WARN_UNUSED_RESULT;
+
 /**
    Submit \p task to StarPU with dependency bypass.
 
@@ -353,6 +353,31 @@ module fstarpu_mpi_mod
                         type(c_ptr), value, intent(in) :: rarg
                 end function fstarpu_mpi_gather_detached
 
+                ! int starpu_mpi_bcast_detached(starpu_data_handle_t *data_handles, int count, int root, MPI_Comm comm, void (*callback)(void *), void *arg);
+                function fstarpu_mpi_bcast_detached (dhs, cnt, root, mpi_comm, callback, arg) bind(C)
+                        use iso_c_binding
+                        implicit none
+                        integer(c_int) :: fstarpu_mpi_bcast_detached
+                        type(c_ptr), intent(in) :: dhs(*)
+                        integer(c_int), value, intent(in) :: cnt
+                        integer(c_int), value, intent(in) :: root
+                        integer(c_int), value, intent(in) :: mpi_comm
+                        type(c_funptr), value, intent(in) :: callback
+                        type(c_ptr), value, intent(in) :: arg
+                end function fstarpu_mpi_bcast_detached
+
+                ! int starpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int count, MPI_Comm comm, void (*callback)(void *), void *arg);
+                function fstarpu_mpi_allgather_detached (dhs, cnt, mpi_comm, callback, arg) bind(C)
+                        use iso_c_binding
+                        implicit none
+                        integer(c_int) :: fstarpu_mpi_allgather_detached
+                        type(c_ptr), intent(in) :: dhs(*)
+                        integer(c_int), value, intent(in) :: cnt
+                        integer(c_int), value, intent(in) :: mpi_comm
+                        type(c_funptr), value, intent(in) :: callback
+                        type(c_ptr), value, intent(in) :: arg
+                end function fstarpu_mpi_allgather_detached
+
 
                 ! int starpu_mpi_isend_detached_unlock_tag(starpu_data_handle_t data_handle, int dest, starpu_mpi_tag_t data_tag, MPI_Comm comm, starpu_tag_t tag);
                 function fstarpu_mpi_isend_detached_unlock_tag (dh, dst, data_tag, mpi_comm, starpu_tag) bind(C)
@@ -493,6 +493,26 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data, int dest);
  */
 void starpu_mpi_cached_send_clear(starpu_data_handle_t data);
 
+/**
+   Statistics on the reception cache of the current node, see
+   starpu_mpi_cache_get_stats()
+*/
+struct starpu_mpi_cache_stats
+{
+	unsigned long hits;	/**< Number of times a data was found in the reception cache */
+	unsigned long misses;	/**< Number of times a data had to be received */
+	unsigned long evictions;	/**< Number of data evicted from the reception cache to fit in its budget */
+	size_t size;		/**< Amount of data currently in the reception cache, only computed when the cache is bounded */
+	size_t limit;		/**< Budget of the reception cache (see \ref STARPU_MPI_CACHE_LIMIT), 0 if it is not bounded */
+};
+
+/**
+   Fill \p stats with the statistics of the reception cache of the
+   current node. All fields are 0 if the cache mechanism is disabled
+   (see \ref STARPU_MPI_CACHE).
+*/
+void starpu_mpi_cache_get_stats(struct starpu_mpi_cache_stats *stats);
+
 /** @} */
 
 /**
@@ -849,6 +869,30 @@ int starpu_mpi_scatter_detached(starpu_data_handle_t *data_handles, int count, i
 */
 int starpu_mpi_gather_detached(starpu_data_handle_t *data_handles, int count, int root, MPI_Comm comm, void (*scallback)(void *), void *sarg, void (*rcallback)(void *), void *rarg);
 
+/**
+   Broadcast data from the process \p root to all the processes of the
+   communicator. Each data of the array \p data_handles is sent by the
+   process \p root along a binomial tree, or a chain (see \ref
+   STARPU_MPI_BCAST_TREE), so that each process receives it from its
+   parent in the tree and forwards it to its children. All the
+   processes must have valid data handles registered with the same
+   tags. The communications are detached and ordered with the tasks
+   accessing the data thanks to sequential consistency. On completion
+   of the communications of the local process, the \p callback function
+   is called with the argument \p arg.
+*/
+int starpu_mpi_bcast_detached(starpu_data_handle_t *data_handles, int count, int root, MPI_Comm comm, void (*callback)(void *), void *arg);
+
+/**
+   Gather all the data of the array \p data_handles on all the processes
+   of the communicator. Each data is broadcast from the process owning
+   it, as with starpu_mpi_bcast_detached(). All the processes must have
+   valid data handles. On completion of the communications of the local
+   process, the \p callback function is called with the argument \p
+   arg.
+*/
+int starpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int count, MPI_Comm comm, void (*callback)(void *), void *arg);
+
 /** @} */
 
 /**
@@ -0,0 +1,286 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdlib.h>
+#include <starpu_mpi.h>
+#include <starpu_mpi_private.h>
+#include <starpu_mpi_datatype.h>
+#include <mpi/starpu_mpi_aggregate.h>
+#include <mpi/starpu_mpi_mpi_backend.h>
+#include <mpi/starpu_mpi_mpi.h>
+#include <common/uthash.h>
+
+#ifdef STARPU_USE_MPI_MPI
+
+/* An aggregated message is made of the envelope of each message followed by
+ * its data, padded so that the next envelope is aligned */
+#define _STARPU_MPI_AGGREGATE_ALIGN(size) (((size) + 7) & ~(starpu_ssize_t) 7)
+
+/** Message being aggregated for a node */
+struct _starpu_mpi_aggregate
+{
+	UT_hash_handle hh;
+	struct _starpu_mpi_node node;
+	char *buffer;
+	starpu_ssize_t size;
+	starpu_ssize_t allocated;
+	/** When the first message was packed */
+	double start;
+};
+
+/** Aggregated message being sent */
+LIST_TYPE(_starpu_mpi_aggregate_sent,
+	struct _starpu_mpi_envelope envelope;
+	char *buffer;
+	MPI_Request requests[2];
+);
+
+/** Maximum size of an aggregated message, 0 if aggregation is disabled */
+static starpu_ssize_t _starpu_mpi_aggregate_max_size;
+/** How long to wait for more messages before sending an aggregated message, in us */
+static double _starpu_mpi_aggregate_delay;
+
+static struct _starpu_mpi_aggregate *_starpu_mpi_aggregate_hashmap;
+static int _starpu_mpi_aggregate_count;
+static struct _starpu_mpi_aggregate_sent_list _starpu_mpi_aggregate_sent;
+
+void _starpu_mpi_aggregate_init(void)
+{
+	_starpu_mpi_aggregate_max_size = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_SIZE", 0);
+	_starpu_mpi_aggregate_delay = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_DELAY", 0);
+#ifdef STARPU_SIMGRID
+	if (_starpu_mpi_aggregate_max_size > 0)
+	{
+		_STARPU_DISP("Warning: aggregation of MPI messages is not supported with simgrid, this will be disabled\n");
+		_starpu_mpi_aggregate_max_size = 0;
+	}
+#endif
+	if (_starpu_mpi_aggregate_max_size < 0)
+		_starpu_mpi_aggregate_max_size = 0;
+	_starpu_mpi_aggregate_hashmap = NULL;
+	_starpu_mpi_aggregate_count = 0;
+	_starpu_mpi_aggregate_sent_list_init(&_starpu_mpi_aggregate_sent);
+}
+
+void _starpu_mpi_aggregate_shutdown(void)
+{
+	struct _starpu_mpi_aggregate *aggregate=NULL, *tmp=NULL;
+
+	STARPU_ASSERT(_starpu_mpi_aggregate_sent_list_empty(&_starpu_mpi_aggregate_sent));
+	HASH_ITER(hh, _starpu_mpi_aggregate_hashmap, aggregate, tmp)
+	{
+		STARPU_ASSERT(aggregate->size == 0);
+		HASH_DEL(_starpu_mpi_aggregate_hashmap, aggregate);
+		free(aggregate->buffer);
+		free(aggregate);
+	}
+}
+
+int _starpu_mpi_aggregate_eligible(struct _starpu_mpi_req *req)
+{
+	size_t size;
+
+	if (_starpu_mpi_aggregate_max_size == 0)
+		return 0;
+	if (req->request_type != SEND_REQ || req->sync || req->func != _starpu_mpi_isend_size_func)
+		return 0;
+	size = starpu_data_get_size(req->data_handle);
+	return size > 0 && (starpu_ssize_t) (sizeof(struct _starpu_mpi_envelope) + size) <= _starpu_mpi_aggregate_max_size;
+}
+
+static struct _starpu_mpi_aggregate *_starpu_mpi_aggregate_get(struct _starpu_mpi_node *node)
+{
+	struct _starpu_mpi_aggregate *aggregate;
+	struct _starpu_mpi_node key;
+
+	/* The structure may have padding */
+	memset(&key, 0, sizeof(key));
+	key.comm = node->comm;
+	key.rank = node->rank;
+
+	HASH_FIND(hh, _starpu_mpi_aggregate_hashmap, &key, sizeof(key), aggregate);
+	if (aggregate == NULL)
+	{
+		_STARPU_MPI_CALLOC(aggregate, 1, sizeof(*aggregate));
+		aggregate->node = key;
+		HASH_ADD(hh, _starpu_mpi_aggregate_hashmap, node, sizeof(aggregate->node), aggregate);
+	}
+	return aggregate;
+}
+
+static void _starpu_mpi_aggregate_send(struct _starpu_mpi_aggregate *aggregate)
+{
+	struct _starpu_mpi_aggregate_sent *sent = _starpu_mpi_aggregate_sent_new();
+	int ret;
+
+	memset(&sent->envelope, 0, sizeof(sent->envelope));
+	sent->envelope.mode = _STARPU_MPI_ENVELOPE_AGGREGATE;
+	sent->envelope.size = aggregate->size;
+	sent->buffer = aggregate->buffer;
+
+	_STARPU_MPI_DEBUG(20, "Sending %ld bytes of aggregated messages to node %d\n", (long) aggregate->size, aggregate->node.rank);
+	_STARPU_MPI_COMM_TO_DEBUG(&sent->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, sent->envelope.data_tag, aggregate->node.comm);
+	ret = MPI_Isend(&sent->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, aggregate->node.comm, &sent->requests[0]);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending envelope, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	ret = MPI_Isend(sent->buffer, aggregate->size, MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_DATA, aggregate->node.comm, &sent->requests[1]);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	_starpu_mpi_aggregate_sent_list_push_back(&_starpu_mpi_aggregate_sent, sent);
+
+	aggregate->buffer = NULL;
+	aggregate->size = 0;
+	aggregate->allocated = 0;
+	_starpu_mpi_aggregate_count--;
+}
+
+void _starpu_mpi_aggregate_flush_node(struct _starpu_mpi_node *node)
+{
+	if (_starpu_mpi_aggregate_count == 0)
+		return;
+
+	struct _starpu_mpi_aggregate *aggregate = _starpu_mpi_aggregate_get(node);
+	if (aggregate->size)
+		_starpu_mpi_aggregate_send(aggregate);
+}
+
+/* Make room for a message of \p size bytes, and return where to pack it */
+static char *_starpu_mpi_aggregate_reserve(struct _starpu_mpi_aggregate *aggregate, starpu_ssize_t size)
+{
+	starpu_ssize_t needed = sizeof(struct _starpu_mpi_envelope) + _STARPU_MPI_AGGREGATE_ALIGN(size);
+
+	if (aggregate->size && aggregate->size + needed > _starpu_mpi_aggregate_max_size)
+		/* It does not fit, send what we have */
+		_starpu_mpi_aggregate_send(aggregate);
+
+	if (aggregate->size + needed > aggregate->allocated)
+	{
+		starpu_ssize_t allocated = aggregate->size + needed;
+		if (allocated < _starpu_mpi_aggregate_max_size)
+			allocated = _starpu_mpi_aggregate_max_size;
+		_STARPU_MPI_REALLOC(aggregate->buffer, allocated);
+		aggregate->allocated = allocated;
+	}
+
+	if (aggregate->size == 0)
+	{
+		aggregate->start = starpu_timing_now();
+		_starpu_mpi_aggregate_count++;
+	}
+
+	return aggregate->buffer + aggregate->size + sizeof(struct _starpu_mpi_envelope);
+}
+
+void _starpu_mpi_aggregate_add(struct _starpu_mpi_req *req)
+{
+	struct _starpu_mpi_aggregate *aggregate = _starpu_mpi_aggregate_get(&req->node_tag.node);
+	struct _starpu_mpi_envelope envelope;
+	char *payload;
+
+	memset(&envelope, 0, sizeof(envelope));
+	envelope.mode = _STARPU_MPI_ENVELOPE_DATA;
+	envelope.data_tag = req->node_tag.data_tag;
+
+	_starpu_mpi_datatype_allocate(req->data_handle, req);
+	if (req->registered_datatype == 1)
+	{
+		int size, position = 0, ret;
+
+		req->count = 1;
+		req->ptr = starpu_data_handle_to_pointer(req->data_handle, req->node);
+		MPI_Pack_size(1, req->datatype, req->node_tag.node.comm, &size);
+		payload = _starpu_mpi_aggregate_reserve(aggregate, size);
+		ret = MPI_Pack(req->ptr, 1, req->datatype, payload, size, &position, req->node_tag.node.comm);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Pack returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		envelope.size = position;
+	}
+	else
+	{
+		starpu_data_pack_node(req->data_handle, req->node, &req->ptr, &req->count);
+		payload = _starpu_mpi_aggregate_reserve(aggregate, req->count);
+		memcpy(payload, req->ptr, req->count);
+		envelope.size = req->count;
+	}
+
+	_STARPU_MPI_DEBUG(20, "Aggregating %ld bytes with tag %"PRIi64" to node %d\n", (long) envelope.size, envelope.data_tag, aggregate->node.rank);
+	memcpy(aggregate->buffer + aggregate->size, &envelope, sizeof(envelope));
+	aggregate->size += sizeof(envelope) + _STARPU_MPI_AGGREGATE_ALIGN(envelope.size);
+
+	if (aggregate->size >= _starpu_mpi_aggregate_max_size)
+		_starpu_mpi_aggregate_send(aggregate);
+}
+
+void _starpu_mpi_aggregate_progress(void)
+{
+	struct _starpu_mpi_aggregate_sent *sent, *next;
+
+	if (_starpu_mpi_aggregate_count)
+	{
+		struct _starpu_mpi_aggregate *aggregate=NULL, *tmp=NULL;
+		double now = starpu_timing_now();
+
+		HASH_ITER(hh, _starpu_mpi_aggregate_hashmap, aggregate, tmp)
+		{
+			if (aggregate->size && now - aggregate->start >= _starpu_mpi_aggregate_delay)
+				_starpu_mpi_aggregate_send(aggregate);
+		}
+	}
+
+	for (sent = _starpu_mpi_aggregate_sent_list_begin(&_starpu_mpi_aggregate_sent);
+	     sent != _starpu_mpi_aggregate_sent_list_end(&_starpu_mpi_aggregate_sent);
+	     sent = next)
+	{
+		int flag, ret;
+
+		next = _starpu_mpi_aggregate_sent_list_next(sent);
+		ret = MPI_Testall(2, sent->requests, &flag, MPI_STATUSES_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Testall returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		if (flag)
+		{
+			_starpu_mpi_aggregate_sent_list_erase(&_starpu_mpi_aggregate_sent, sent);
+			free(sent->buffer);
+			_starpu_mpi_aggregate_sent_delete(sent);
+		}
+	}
+}
+
+int _starpu_mpi_aggregate_pending(void)
+{
+	return _starpu_mpi_aggregate_count || !_starpu_mpi_aggregate_sent_list_empty(&_starpu_mpi_aggregate_sent);
+}
+
+char *_starpu_mpi_aggregate_recv(struct _starpu_mpi_envelope *envelope, int source, MPI_Comm comm)
+{
+	char *buffer;
+	int ret;
+
+	_STARPU_MPI_DEBUG(20, "Receiving %ld bytes of aggregated messages from node %d\n", (long) envelope->size, source);
+	_STARPU_MPI_MALLOC(buffer, envelope->size);
+	/* The sender has sent the data right after the envelope, and the data
+	 * of the previous envelopes are already being received */
+	ret = MPI_Recv(buffer, envelope->size, MPI_BYTE, source, _STARPU_MPI_TAG_DATA, comm, MPI_STATUS_IGNORE);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Recv returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	return buffer;
+}
+
+struct _starpu_mpi_envelope *_starpu_mpi_aggregate_next(char *buffer, starpu_ssize_t *offset, char **payload)
+{
+	struct _starpu_mpi_envelope *envelope = (struct _starpu_mpi_envelope *) (buffer + *offset);
+
+	*payload = (char *) (envelope + 1);
+	*offset += sizeof(*envelope) + _STARPU_MPI_AGGREGATE_ALIGN(envelope->size);
+	return envelope;
+}
+
+#endif /* STARPU_USE_MPI_MPI */
@@ -0,0 +1,80 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __STARPU_MPI_AGGREGATE_H__
+#define __STARPU_MPI_AGGREGATE_H__
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <common/config.h>
+#include <starpu_mpi_private.h>
+
+/** @file */
+
+#ifdef STARPU_USE_MPI_MPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Aggregation of small messages (see STARPU_MPI_AGGREGATE_SIZE): the
+ * envelopes and the data of the small non-synchronous send requests to the
+ * same node are packed into a single message, announced by an envelope of
+ * mode _STARPU_MPI_ENVELOPE_AGGREGATE. All these functions are only called
+ * by the progression thread.
+ */
+
+struct _starpu_mpi_envelope;
+
+void _starpu_mpi_aggregate_init(void);
+void _starpu_mpi_aggregate_shutdown(void);
+
+/** Whether the data of \p req can be packed with other messages */
+int _starpu_mpi_aggregate_eligible(struct _starpu_mpi_req *req);
+
+/** Pack the envelope and the data of \p req into the message being
+ * aggregated for its destination. The data of the request is not needed any
+ * more on return. */
+void _starpu_mpi_aggregate_add(struct _starpu_mpi_req *req);
+
+/** Send the message being aggregated for \p node, if any, so that the
+ * messages which will be sent to it afterwards do not overtake it */
+void _starpu_mpi_aggregate_flush_node(struct _starpu_mpi_node *node);
+
+/** Send the messages which have been aggregated for long enough (see
+ * STARPU_MPI_AGGREGATE_DELAY), and test the completion of the sent ones */
+void _starpu_mpi_aggregate_progress(void);
+
+/** Whether there are aggregated messages not sent or not completed yet */
+int _starpu_mpi_aggregate_pending(void);
+
+/** Receive the aggregated message announced by \p envelope, to be
+ * unpacked with _starpu_mpi_aggregate_next() and freed with free() */
+char *_starpu_mpi_aggregate_recv(struct _starpu_mpi_envelope *envelope, int source, MPI_Comm comm);
+
+/** Get the envelope at \p offset in the aggregated message \p buffer, and
+ * its data in \p payload, and move \p offset to the next envelope */
+struct _starpu_mpi_envelope *_starpu_mpi_aggregate_next(char *buffer, starpu_ssize_t *offset, char **payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STARPU_USE_MPI_MPI */
+#endif /* __STARPU_MPI_AGGREGATE_H__ */
@@ -32,6 +32,7 @@
 #include <mpi/starpu_mpi_sync_data.h>
 #include <mpi/starpu_mpi_early_data.h>
 #include <mpi/starpu_mpi_early_request.h>
+#include <mpi/starpu_mpi_aggregate.h>
 #include <starpu_mpi_select_node.h>
 #include <mpi/starpu_mpi_tag.h>
 #include <mpi/starpu_mpi_comm.h>
@@ -58,6 +59,12 @@ static unsigned nready_process;
 /* Number of send requests to submit to MPI at the same time */
 static unsigned ndetached_send;
 
+/* Size from which data is sent in fragments, 0 to never fragment data */
+static starpu_ssize_t chunk_threshold;
+
+/* Size of the fragments */
+static starpu_ssize_t chunk_size;
+
 /* Force allocation of early data */
 static int early_data_force_allocate;
 
@@ -283,6 +290,7 @@ void _starpu_mpi_submit_ready_request(void *arg)
 					_starpu_mpi_req_list_push_front(&ready_recv_requests, req);
 					_STARPU_MPI_INC_READY_REQUESTS(+1);
 					/* Throw away the dumb request that was only used to know that we got the envelope */
+					req->backend->envelope = sync_req->backend->envelope;
 					_starpu_mpi_request_destroy(sync_req);
 				}
 				else
@@ -384,6 +392,89 @@ void _starpu_mpi_simgrid_wait_req(MPI_Request *request, MPI_Status *status, star
 /*                                                      */
 /********************************************************/
 
+/* Whether the data described by \p datatype is contiguous, starting at \p lb */
+static int _starpu_mpi_datatype_contiguous(MPI_Datatype datatype, starpu_ssize_t size, MPI_Aint *lb)
+{
+	MPI_Aint extent;
+	int type_size;
+
+	MPI_Type_size(datatype, &type_size);
+	MPI_Type_get_true_extent(datatype, lb, &extent);
+	return type_size == size && extent == size;
+}
+
+/* Decide whether the data of the send request \p req will be sent in
+ * fragments, which needs the data to be contiguous */
+static void _starpu_mpi_isend_set_chunks(struct _starpu_mpi_req *req)
+{
+#ifndef STARPU_SIMGRID
+	starpu_ssize_t size = req->backend->envelope->size;
+	MPI_Aint lb;
+
+	if (chunk_threshold == 0 || size < chunk_threshold || size <= chunk_size)
+		return;
+	if (req->registered_datatype == 1 && !_starpu_mpi_datatype_contiguous(req->datatype, size, &lb))
+		return;
+	req->backend->envelope->chunk_size = chunk_size;
+#else
+	(void)req;
+#endif
+}
+
+/* Keep the envelope of data sent in fragments, so that the receive request
+ * posts a request for each of them */
+static void _starpu_mpi_irecv_set_chunks(struct _starpu_mpi_req *req, struct _starpu_mpi_envelope *envelope)
+{
+	if (envelope->chunk_size)
+	{
+		_STARPU_MPI_MALLOC(req->backend->envelope, sizeof(struct _starpu_mpi_envelope));
+		*req->backend->envelope = *envelope;
+	}
+}
+
+/* Post the requests sending or receiving the fragments of the data of \p req.
+ * Only the completion of the last one is tested, the others are waited for on
+ * termination. */
+static void _starpu_mpi_post_chunks(struct _starpu_mpi_req *req, int mpi_tag)
+{
+	starpu_ssize_t size = req->backend->envelope->size;
+	starpu_ssize_t chunk = req->backend->envelope->chunk_size;
+	char *buffer = req->ptr;
+	int i, n = (size + chunk - 1) / chunk;
+
+	if (req->registered_datatype == 1)
+	{
+		MPI_Aint lb;
+		if (_starpu_mpi_datatype_contiguous(req->datatype, size, &lb))
+			buffer += lb;
+		else
+		{
+			/* The data is not contiguous here, receive it packed */
+			STARPU_ASSERT(req->request_type == RECV_REQ);
+			_STARPU_MPI_MALLOC(req->backend->chunk_buffer, size);
+			buffer = req->backend->chunk_buffer;
+		}
+	}
+
+	_STARPU_MPI_DEBUG(20, "%s %ld bytes in %d fragments with tag %"PRIi64" %s node %d\n", req->request_type == RECV_REQ ? "Receiving" : "Sending", (long) size, n, req->node_tag.data_tag, req->request_type == RECV_REQ ? "from" : "to", req->node_tag.node.rank);
+	req->backend->nchunks = n;
+	_STARPU_MPI_MALLOC(req->backend->chunk_requests, n * sizeof(MPI_Request));
+	for (i = 0; i < n; i++)
+	{
+		starpu_ssize_t offset = i * chunk;
+		int count = size - offset < chunk ? size - offset : chunk;
+		MPI_Request *request = i == n-1 ? &req->backend->data_request : &req->backend->chunk_requests[i];
+
+		if (req->request_type == RECV_REQ)
+			req->ret = MPI_Irecv(buffer + offset, count, MPI_BYTE, req->node_tag.node.rank, mpi_tag, req->node_tag.node.comm, request);
+		else if (req->sync)
+			req->ret = MPI_Issend(buffer + offset, count, MPI_BYTE, req->node_tag.node.rank, mpi_tag, req->node_tag.node.comm, request);
+		else
+			req->ret = MPI_Isend(buffer + offset, count, MPI_BYTE, req->node_tag.node.rank, mpi_tag, req->node_tag.node.comm, request);
+		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "posting fragment %d of %d returning %s", i, n, _starpu_mpi_get_mpi_error_code(req->ret));
+	}
+}
+
 static void _starpu_mpi_isend_data_func(struct _starpu_mpi_req *req)
 {
 	_STARPU_MPI_LOG_IN();
@@ -394,7 +485,11 @@ static void _starpu_mpi_isend_data_func(struct _starpu_mpi_req *req)
 
 	_STARPU_MPI_TRACE_ISEND_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag, 0);
 
-	if (req->sync == 0)
+	if (req->backend->envelope && req->backend->envelope->chunk_size)
+	{
+		_starpu_mpi_post_chunks(req, req->sync ? _STARPU_MPI_TAG_SYNC_DATA : _STARPU_MPI_TAG_DATA);
+	}
+	else if (req->sync == 0)
 	{
 		_STARPU_MPI_COMM_TO_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
 		req->ret = MPI_Isend(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
@@ -443,6 +538,7 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 
 		MPI_Type_size(req->datatype, &size);
 		req->backend->envelope->size = (starpu_ssize_t)req->count * size;
+		_starpu_mpi_isend_set_chunks(req);
 		_STARPU_MPI_DEBUG(20, "Post MPI isend count (%ld) datatype_size %ld request to %d\n",req->count,starpu_data_get_size(req->data_handle), req->node_tag.node.rank);
 		_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 		ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
@@ -460,6 +556,7 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 			// We already know the size of the data, let's send it to overlap with the packing of the data
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (first call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
 			req->count = req->backend->envelope->size;
+			_starpu_mpi_isend_set_chunks(req);
 			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 			STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending size, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
@@ -470,6 +567,8 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 		if (req->backend->envelope->size == -1)
 		{
 			// We know the size now, let's send it
+			req->backend->envelope->size = req->count;
+			_starpu_mpi_isend_set_chunks(req);
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (second call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
 			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
@@ -495,6 +594,38 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 	}
 }
 
+/* The data of the request is packed with other small messages to the same node,
+ * see mpi/starpu_mpi_aggregate.h. The request is completed as soon as its data
+ * has been copied */
+static void _starpu_mpi_isend_aggregate_func(struct _starpu_mpi_req *req)
+{
+	_STARPU_MPI_LOG_IN();
+
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag, 0);
+
+	_starpu_mpi_aggregate_add(req);
+	_starpu_mpi_comm_amounts_inc(req->node_tag.node.comm, req->node_tag.node.rank, req->datatype, req->count);
+
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_END(_STARPU_MPI_FUT_POINT_TO_POINT_SEND, req, 0);
+
+	/* There is no MPI request to wait for, MPI_Wait and MPI_Test return immediately */
+	req->backend->data_request = MPI_REQUEST_NULL;
+	req->backend->size_req = MPI_REQUEST_NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&req->backend->req_mutex);
+	req->submitted = 1;
+	STARPU_PTHREAD_COND_BROADCAST(&req->backend->req_cond);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
+
+	if (req->detached)
+	{
+		_starpu_mpi_handle_request_termination(req);
+		_starpu_mpi_request_destroy(req);
+	}
+
+	_STARPU_MPI_LOG_OUT();
+}
+
 /********************************************************/
 /*							*/
 /*  receive functionalities				*/
@@ -523,7 +654,11 @@ void _starpu_mpi_irecv_size_func(struct _starpu_mpi_req *req)
 		_envelope = NULL;
 	}
 
-	if (req->sync)
+	if (req->backend->envelope && req->backend->envelope->chunk_size)
+	{
+		_starpu_mpi_post_chunks(req, req->sync ? _STARPU_MPI_TAG_SYNC_DATA : _STARPU_MPI_TAG_DATA);
+	}
+	else if (req->sync)
 	{
 		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
 		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.node.comm, &req->backend->data_request);
@@ -859,6 +994,15 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 			  req, _starpu_mpi_request_type(req->request_type), req->node_tag.data_tag, req->node_tag.node.rank, req->data_handle, req->ptr,
 			  req->datatype_name, (int)req->count, req->registered_datatype, req->backend->internal_req);
 
+	if (req->backend->chunk_requests)
+	{
+		/* The last fragment has completed, the others most probably too */
+		int ret = MPI_Waitall(req->backend->nchunks - 1, req->backend->chunk_requests, MPI_STATUSES_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Waitall returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		free(req->backend->chunk_requests);
+		req->backend->chunk_requests = NULL;
+	}
+
 	if (req->backend->internal_req)
 	{
 		_starpu_mpi_early_data_delete(req->backend->early_data_handle);
@@ -899,6 +1043,13 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 			}
 			else
 			{
+				if (req->backend->chunk_buffer)
+				{
+					int position = 0;
+					MPI_Unpack(req->backend->chunk_buffer, req->backend->envelope->size, &position, req->ptr, 1, req->datatype, req->node_tag.node.comm);
+					free(req->backend->chunk_buffer);
+					req->backend->chunk_buffer = NULL;
+				}
 				_starpu_mpi_datatype_free(req->data_handle, &req->datatype);
 			}
 		}
@@ -1199,6 +1350,8 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	while (!(early_data_handle->req->posted))
 		STARPU_PTHREAD_COND_WAIT(&(early_data_handle->req->backend->posted_cond), &progress_mutex);
 
+	_starpu_mpi_irecv_set_chunks(early_data_handle->req, envelope);
+
 	// Handle the request immediatly to make sure the mpi_irecv is
 	// posted before receiving an other envelope
 	_starpu_mpi_req_list_erase(&ready_recv_requests, early_data_handle->req);
@@ -1208,6 +1361,102 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 }
 
+/* Receive the messages aggregated by the sender, see mpi/starpu_mpi_aggregate.h.
+ * The data of each message is either given to the matching application request,
+ * or kept as early data. Must be called with progress_mutex held. */
+static void _starpu_mpi_receive_aggregate(struct _starpu_mpi_envelope *aggregate_envelope, MPI_Status status, MPI_Comm comm)
+{
+	starpu_ssize_t offset = 0;
+	char *buffer;
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	buffer = _starpu_mpi_aggregate_recv(aggregate_envelope, status.MPI_SOURCE, comm);
+
+	while (offset < aggregate_envelope->size)
+	{
+		char *payload;
+		struct _starpu_mpi_envelope *envelope = _starpu_mpi_aggregate_next(buffer, &offset, &payload);
+
+		_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld) in aggregated message\n", envelope->data_tag, status.MPI_SOURCE, envelope->size);
+
+		STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, status.MPI_SOURCE, comm);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+
+		if (early_request == NULL)
+		{
+			/* Keep the data as raw memory until the application posts the receive */
+			struct _starpu_mpi_early_data_handle *early_data_handle = _starpu_mpi_early_data_create(envelope, status.MPI_SOURCE, comm);
+			struct _starpu_mpi_req *internal_req;
+
+			_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, keeping aggregated data as early data\n", envelope->data_tag, status.MPI_SOURCE);
+			early_data_handle->buffer = (void *)starpu_malloc_on_node_flags(STARPU_MAIN_RAM, envelope->size, 0);
+			memcpy(early_data_handle->buffer, payload, envelope->size);
+			early_data_handle->size = envelope->size;
+			early_data_handle->buffer_node = STARPU_MAIN_RAM;
+			starpu_variable_data_register(&early_data_handle->handle, STARPU_MAIN_RAM, (uintptr_t) early_data_handle->buffer, envelope->size);
+
+			/* The data is already there, the internal request is only
+			 * used by the application request to complete */
+			_starpu_mpi_request_init(&internal_req);
+			internal_req->request_type = RECV_REQ;
+			internal_req->data_handle = early_data_handle->handle;
+			internal_req->node_tag = early_data_handle->node_tag;
+			internal_req->detached = 1;
+			internal_req->backend->is_internal_req = 1;
+			internal_req->backend->data_request = MPI_REQUEST_NULL;
+			internal_req->submitted = 1;
+			internal_req->completed = 1;
+			early_data_handle->req = internal_req;
+
+			_starpu_mpi_early_data_add(early_data_handle);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+		}
+		else
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+			_STARPU_MPI_DEBUG(2000, "A matching application request has been found for the aggregated data with tag %"PRIi64"\n", envelope->data_tag);
+
+			_STARPU_MPI_TRACE_IRECV_SUBMIT_BEGIN(early_request->node_tag.node.rank, early_request->node_tag.data_tag);
+			early_request->sync = 0;
+			_starpu_mpi_datatype_allocate(early_request->data_handle, early_request);
+			if (early_request->registered_datatype == 1)
+			{
+				int position = 0, ret;
+				early_request->count = 1;
+				early_request->ptr = starpu_data_handle_to_pointer(early_request->data_handle, early_request->node);
+				ret = MPI_Unpack(payload, envelope->size, &position, early_request->ptr, 1, early_request->datatype, comm);
+				STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Unpack returning %s", _starpu_mpi_get_mpi_error_code(ret));
+			}
+			else
+			{
+				early_request->count = envelope->size;
+				early_request->ptr = (void *)starpu_malloc_on_node_flags(early_request->node, early_request->count, 0);
+				starpu_memory_allocate(early_request->node, early_request->count, STARPU_MEMORY_OVERFLOW);
+				STARPU_MPI_ASSERT_MSG(early_request->ptr, "cannot allocate message of size %ld\n", early_request->count);
+				memcpy(early_request->ptr, payload, early_request->count);
+			}
+			_STARPU_MPI_TRACE_IRECV_SUBMIT_END(early_request->node_tag.node.rank, early_request->node_tag.data_tag);
+
+			early_request->backend->data_request = MPI_REQUEST_NULL;
+			STARPU_PTHREAD_MUTEX_LOCK(&early_request->backend->req_mutex);
+			early_request->submitted = 1;
+			STARPU_PTHREAD_COND_BROADCAST(&early_request->backend->req_cond);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&early_request->backend->req_mutex);
+
+			if (early_request->detached)
+			{
+				_starpu_mpi_handle_request_termination(early_request);
+				_starpu_mpi_request_destroy(early_request);
+			}
+		}
+	}
+
+	free(buffer);
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+}
+
 static void *_starpu_mpi_progress_thread_func(void *arg)
 {
 	struct _starpu_mpi_argc_argv *argc_argv = (struct _starpu_mpi_argc_argv *) arg;
@@ -1273,6 +1522,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_early_data_init();
 	_starpu_mpi_sync_data_init();
 	_starpu_mpi_datatype_init();
+	_starpu_mpi_aggregate_init();
 
 	if (mpi_driver)
 		starpu_driver_init(mpi_driver);
@@ -1297,13 +1547,13 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	int mpi_driver_task_counter = 0;
 	_STARPU_MPI_TRACE_POLLING_BEGIN();
 
-	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)))// || !(_starpu_mpi_early_request_count()) || !(_starpu_mpi_sync_data_count()))
+	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)) || _starpu_mpi_aggregate_pending())// || !(_starpu_mpi_early_request_count()) || !(_starpu_mpi_sync_data_count()))
 	{
 #ifdef STARPU_SIMGRID
 		starpu_pthread_wait_reset(&_starpu_mpi_thread_wait);
 #endif
 		/* shall we block ? */
-		unsigned block = _starpu_mpi_req_list_empty(&ready_recv_requests) && _starpu_mpi_req_prio_list_empty(&ready_send_requests) && _starpu_mpi_early_request_count() == 0 && _starpu_mpi_sync_data_count() == 0 && _starpu_mpi_req_list_empty(&detached_requests);
+		unsigned block = _starpu_mpi_req_list_empty(&ready_recv_requests) && _starpu_mpi_req_prio_list_empty(&ready_send_requests) && _starpu_mpi_early_request_count() == 0 && _starpu_mpi_sync_data_count() == 0 && _starpu_mpi_req_list_empty(&detached_requests) && !_starpu_mpi_aggregate_pending();
 
 		if (block)
 		{
@@ -1368,10 +1618,23 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 			 * application submit requests in the meantime, so we
 			 * release the lock. */
 			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-			_starpu_mpi_handle_ready_request(req);
+			if (_starpu_mpi_aggregate_eligible(req))
+				_starpu_mpi_isend_aggregate_func(req);
+			else
+			{
+				if (req->request_type == SEND_REQ)
+					/* The messages aggregated so far must not be overtaken */
+					_starpu_mpi_aggregate_flush_node(&req->node_tag.node);
+				_starpu_mpi_handle_ready_request(req);
+			}
 			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 		}
 
+		/* send the aggregated messages which have waited long enough */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		_starpu_mpi_aggregate_progress();
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+
 		_STARPU_MPI_TRACE_POLLING_BEGIN();
 
 		/* If there is no currently submitted envelope_request submitted to
@@ -1413,6 +1676,10 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 					_starpu_mpi_isend_data_func(_sync_req);
 					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 				}
+				else if (envelope->mode == _STARPU_MPI_ENVELOPE_AGGREGATE)
+				{
+					_starpu_mpi_receive_aggregate(envelope, envelope_status, envelope_comm);
+				}
 				else
 				{
 					_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld)\n", envelope->data_tag, envelope_status.MPI_SOURCE, envelope->size);
@@ -1451,6 +1718,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 							new_req->sequential_consistency = 1;
 							new_req->backend->is_internal_req = 0; // ????
 							new_req->count = envelope->size;
+							_starpu_mpi_irecv_set_chunks(new_req, envelope);
 							_starpu_mpi_sync_data_add(new_req);
 							/* We have queued our sync request, we can let _starpu_mpi_submit_ready_request find it */
 							STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
@@ -1474,6 +1742,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 						_STARPU_MPI_DEBUG(2000, "Request sync %d\n", envelope->sync);
 
 						early_request->sync = envelope->sync;
+						_starpu_mpi_irecv_set_chunks(early_request, envelope);
 						_starpu_mpi_datatype_allocate(early_request->data_handle, early_request);
 						if (early_request->registered_datatype == 1)
 						{
@@ -1592,6 +1861,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_early_data_shutdown();
 	_starpu_mpi_early_request_shutdown();
 	_starpu_mpi_datatype_shutdown();
+	_starpu_mpi_aggregate_shutdown();
 	free(argc_argv);
 
 	return NULL;
@@ -1615,6 +1885,9 @@ int _starpu_mpi_progress_init(struct _starpu_mpi_argc_argv *argc_argv)
 	nready_process = starpu_getenv_number_default("STARPU_MPI_NREADY_PROCESS", 10);
 	ndetached_send = starpu_getenv_number_default("STARPU_MPI_NDETACHED_SEND", 10);
 	early_data_force_allocate = starpu_getenv_number_default("STARPU_MPI_EARLYDATA_ALLOCATE", 0);
+	chunk_threshold = starpu_getenv_number_default("STARPU_MPI_CHUNK_THRESHOLD", 0);
+	chunk_size = starpu_getenv_number_default("STARPU_MPI_CHUNK_SIZE", 4*1024*1024);
+	STARPU_ASSERT_MSG(chunk_threshold == 0 || chunk_size > 0, "STARPU_MPI_CHUNK_SIZE must be positive");
 
 #ifdef STARPU_SIMGRID
 	STARPU_PTHREAD_MUTEX_INIT(&wait_counter_mutex, NULL);
@@ -44,7 +44,10 @@ extern int _starpu_mpi_tag;
 enum _starpu_envelope_mode
 {
 	_STARPU_MPI_ENVELOPE_DATA=0,
-	_STARPU_MPI_ENVELOPE_SYNC_READY=1
+	_STARPU_MPI_ENVELOPE_SYNC_READY=1,
+	/** The data message contains the envelopes and the data of several
+	 * messages, see mpi/starpu_mpi_aggregate.h */
+	_STARPU_MPI_ENVELOPE_AGGREGATE=2
 };
 
 struct _starpu_mpi_envelope
@@ -53,6 +56,9 @@ struct _starpu_mpi_envelope
 	starpu_ssize_t size;
 	starpu_mpi_tag_t data_tag;
 	unsigned sync;
+	/** When not 0, the data is sent in fragments of this size, see
+	 * STARPU_MPI_CHUNK_THRESHOLD */
+	starpu_ssize_t chunk_size;
 };
 
 struct _starpu_mpi_req_backend
@@ -68,8 +74,18 @@ struct _starpu_mpi_req_backend
 
 	MPI_Request size_req;
 
+	/** Envelope of the data, also kept on the receiver side when the data
+	 * is sent in fragments */
 	struct _starpu_mpi_envelope* envelope;
 
+	/** When the data is sent in fragments, requests of all the
+	 * fragments but the last one, whose request is data_request */
+	MPI_Request *chunk_requests;
+	int nchunks;
+	/** Buffer receiving the fragments when they cannot be received in
+	 * place, unpacked on completion */
+	void *chunk_buffer;
+
 	unsigned is_internal_req:1;
 	unsigned to_destroy:1;
 	struct _starpu_mpi_req *internal_req;
@@ -30,13 +30,115 @@ struct _starpu_data_entry
 	starpu_data_handle_t data_handle;
 };
 
-static starpu_pthread_mutex_t _cache_mutex;
-static struct _starpu_data_entry *_cache_data = NULL;
+/* When the receive cache is bounded (see STARPU_MPI_CACHE_LIMIT), the cached
+ * data received from each node are kept in LRU order, and the least recently
+ * used ones get evicted when the budget for this node is exceeded.
+ * Since StarPU-MPI submits the same communications on both sides, each node
+ * keeps a mirror of the receive cache of the nodes it sends data to, so that
+ * it can take the same eviction decisions and send the data again when the
+ * receiver needs it again. */
+struct _starpu_mpi_cache_lru_peer;
+
+LIST_TYPE(_starpu_mpi_cache_lru,
+	starpu_data_handle_t data_handle;
+	size_t size;
+	struct _starpu_mpi_cache_lru_peer *peer;
+);
+
+struct _starpu_mpi_cache_lru_peer
+{
+	struct _starpu_mpi_cache_lru_list list;
+	size_t size;
+};
+
+/* The cache state of each data is kept in its struct _starpu_mpi_data, the
+ * table of the cached data (used to flush them all) and the lock protecting
+ * both are split in shards according to the data handle, so that threads
+ * submitting tasks on different data do not contend. Checking whether a
+ * data is already cached does not need the lock at all. */
+#define _STARPU_MPI_CACHE_NSHARDS 64
+
+struct _starpu_mpi_cache_shard
+{
+	starpu_pthread_mutex_t mutex;
+	struct _starpu_data_entry *data;
+	char padding[STARPU_CACHELINE_SIZE];
+};
+
+static struct _starpu_mpi_cache_shard _cache_shards[_STARPU_MPI_CACHE_NSHARDS];
+/* The LRU lists of the bounded cache are shared by all data, so when the
+ * cache is bounded, this lock is used instead of the shard locks */
+static starpu_pthread_mutex_t _cache_lru_mutex;
 int _starpu_cache_enabled=1;
 static MPI_Comm _starpu_cache_comm;
 static int _starpu_cache_comm_size;
+/* Budget in bytes of the receive cache for the data of each node, 0 if the
+ * cache is not bounded */
+static size_t _cache_peer_limit;
+/* Receive cache, indexed by the node which owns the data */
+static struct _starpu_mpi_cache_lru_peer *_cache_received_lru;
+/* Data evicted from the receive cache, which still have to be invalidated,
+ * once the task being submitted, which may read them, is submitted */
+static struct _starpu_mpi_cache_lru_list _cache_evicted;
+/* Mirror of the receive cache of the other nodes, indexed by destination */
+static struct _starpu_mpi_cache_lru_peer *_cache_sent_lru;
+static struct starpu_mpi_cache_stats _cache_stats;
 
 static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_received_lru_remove_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle);
+
+static inline struct _starpu_mpi_cache_shard *_starpu_mpi_cache_shard(starpu_data_handle_t data_handle)
+{
+	/* Handles are allocated with the same alignment, mix the address
+	 * bits to spread them */
+	uint64_t key = (uintptr_t) data_handle;
+	key *= 0x9e3779b97f4a7c15ULL;
+	return &_cache_shards[(key >> 32) % _STARPU_MPI_CACHE_NSHARDS];
+}
+
+static inline starpu_pthread_mutex_t *_starpu_mpi_cache_mutex(starpu_data_handle_t data_handle)
+{
+	if (_cache_peer_limit)
+		return &_cache_lru_mutex;
+	return &_starpu_mpi_cache_shard(data_handle)->mutex;
+}
+
+static void _starpu_mpi_cache_lock(starpu_data_handle_t data_handle)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(_starpu_mpi_cache_mutex(data_handle));
+}
+
+static void _starpu_mpi_cache_unlock(starpu_data_handle_t data_handle)
+{
+	STARPU_PTHREAD_MUTEX_UNLOCK(_starpu_mpi_cache_mutex(data_handle));
+}
+
+static void _starpu_mpi_cache_lock_all(void)
+{
+	int i;
+
+	if (_cache_peer_limit)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&_cache_lru_mutex);
+		return;
+	}
+	for (i = 0; i < _STARPU_MPI_CACHE_NSHARDS; i++)
+		STARPU_PTHREAD_MUTEX_LOCK(&_cache_shards[i].mutex);
+}
+
+static void _starpu_mpi_cache_unlock_all(void)
+{
+	int i;
+
+	if (_cache_peer_limit)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_lru_mutex);
+		return;
+	}
+	for (i = _STARPU_MPI_CACHE_NSHARDS - 1; i >= 0; i--)
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_shards[i].mutex);
+}
 
 int starpu_mpi_cache_is_enabled()
 {
@@ -64,6 +166,8 @@ int starpu_mpi_cache_set(int enabled)
 
 void _starpu_mpi_cache_init(MPI_Comm comm)
 {
+	int i;
+
 	_starpu_cache_enabled = starpu_getenv_number("STARPU_MPI_CACHE");
 	if (_starpu_cache_enabled == -1)
 	{
@@ -79,7 +183,47 @@ void _starpu_mpi_cache_init(MPI_Comm comm)
 	_starpu_cache_comm = comm;
 	starpu_mpi_comm_size(comm, &_starpu_cache_comm_size);
 	_starpu_mpi_cache_stats_init();
-	STARPU_PTHREAD_MUTEX_INIT(&_cache_mutex, NULL);
+	for (i = 0; i < _STARPU_MPI_CACHE_NSHARDS; i++)
+	{
+		STARPU_PTHREAD_MUTEX_INIT(&_cache_shards[i].mutex, NULL);
+		_cache_shards[i].data = NULL;
+	}
+	STARPU_PTHREAD_MUTEX_INIT(&_cache_lru_mutex, NULL);
+	memset(&_cache_stats, 0, sizeof(_cache_stats));
+
+	_cache_peer_limit = 0;
+	_cache_received_lru = NULL;
+	_cache_sent_lru = NULL;
+	starpu_ssize_t limit = starpu_getenv_number("STARPU_MPI_CACHE_LIMIT");
+	if (limit > 0 && _starpu_cache_comm_size > 1)
+	{
+		/* Split the budget evenly between the other nodes, so that
+		 * they can mirror our decisions */
+		_cache_stats.limit = (size_t) limit * 1024 * 1024;
+		_cache_peer_limit = _cache_stats.limit / (_starpu_cache_comm_size - 1);
+		_STARPU_MPI_CALLOC(_cache_received_lru, _starpu_cache_comm_size, sizeof(*_cache_received_lru));
+		_STARPU_MPI_CALLOC(_cache_sent_lru, _starpu_cache_comm_size, sizeof(*_cache_sent_lru));
+		_starpu_mpi_cache_lru_list_init(&_cache_evicted);
+		for (i = 0; i < _starpu_cache_comm_size; i++)
+		{
+			_starpu_mpi_cache_lru_list_init(&_cache_received_lru[i].list);
+			_starpu_mpi_cache_lru_list_init(&_cache_sent_lru[i].list);
+		}
+	}
+}
+
+static void _starpu_mpi_cache_lru_list_clear(struct _starpu_mpi_cache_lru_list *list, int sent, int n)
+{
+	while (!_starpu_mpi_cache_lru_list_empty(list))
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_pop_front(list);
+		struct _starpu_mpi_data *mpi_data = lru->data_handle->mpi_data;
+		if (sent)
+			mpi_data->cache_sent_lru[n] = NULL;
+		else
+			mpi_data->cache_received_lru = NULL;
+		_starpu_mpi_cache_lru_delete(lru);
+	}
 }
 
 void _starpu_mpi_cache_shutdown()
@@ -88,15 +232,38 @@ void _starpu_mpi_cache_shutdown()
 		return;
 
 	struct _starpu_data_entry *entry=NULL, *tmp=NULL;
+	int i;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
-	HASH_ITER(hh, _cache_data, entry, tmp)
+	_starpu_mpi_cache_lock_all();
+	for (i = 0; i < _STARPU_MPI_CACHE_NSHARDS; i++)
 	{
-		HASH_DEL(_cache_data, entry);
-		free(entry);
+		HASH_ITER(hh, _cache_shards[i].data, entry, tmp)
+		{
+			HASH_DEL(_cache_shards[i].data, entry);
+			free(entry);
+		}
+	}
+	if (_cache_peer_limit)
+	{
+		for (i = 0; i < _starpu_cache_comm_size; i++)
+		{
+			_starpu_mpi_cache_lru_list_clear(&_cache_received_lru[i].list, 0, i);
+			_starpu_mpi_cache_lru_list_clear(&_cache_sent_lru[i].list, 1, i);
+		}
+		_starpu_mpi_cache_lru_list_clear(&_cache_evicted, 0, 0);
+		free(_cache_received_lru);
+		free(_cache_sent_lru);
+		_cache_received_lru = NULL;
+		_cache_sent_lru = NULL;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_lru_mutex);
+		_cache_peer_limit = 0;
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
-	STARPU_PTHREAD_MUTEX_DESTROY(&_cache_mutex);
+	else
+		_starpu_mpi_cache_unlock_all();
+	for (i = 0; i < _STARPU_MPI_CACHE_NSHARDS; i++)
+		STARPU_PTHREAD_MUTEX_DESTROY(&_cache_shards[i].mutex);
+	STARPU_PTHREAD_MUTEX_DESTROY(&_cache_lru_mutex);
+	_starpu_mpi_cache_stats_display(&_cache_stats);
 	_starpu_mpi_cache_stats_shutdown();
 }
 
@@ -106,19 +273,16 @@ void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
 
 	if (_starpu_cache_enabled == 1)
 	{
-		struct _starpu_data_entry *entry;
-		STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+		_starpu_mpi_cache_lock(data_handle);
 		_starpu_mpi_cache_flush_nolock(data_handle);
-		HASH_FIND_PTR(_cache_data, &data_handle, entry);
-		if (entry != NULL)
-		{
-			HASH_DEL(_cache_data, entry);
-			free(entry);
-		}
-		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+		/* Drop a pending eviction, if any */
+		_starpu_mpi_cache_received_lru_remove_nolock(data_handle);
+		_starpu_mpi_cache_data_remove_nolock(data_handle);
+		_starpu_mpi_cache_unlock(data_handle);
 	}
 
 	free(mpi_data->cache_sent);
+	free(mpi_data->cache_sent_lru);
 }
 
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
@@ -129,7 +293,7 @@ void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_starpu_mpi_cache_lock(data_handle);
 	mpi_data->cache_received = 0;
 	mpi_data->ft_induced_cache_received = 0;
 	mpi_data->ft_induced_cache_received_count = 0;
@@ -138,40 +302,192 @@ void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
 	{
 		mpi_data->cache_sent[i] = 0;
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	mpi_data->cache_received_lru = NULL;
+	mpi_data->cache_sent_lru = NULL;
+	if (_cache_peer_limit)
+		_STARPU_MPI_CALLOC(mpi_data->cache_sent_lru, _starpu_cache_comm_size, sizeof(mpi_data->cache_sent_lru[0]));
+	_starpu_mpi_cache_unlock(data_handle);
 }
 
 static void _starpu_mpi_cache_data_add_nolock(starpu_data_handle_t data_handle)
 {
+	struct _starpu_mpi_cache_shard *shard = _starpu_mpi_cache_shard(data_handle);
 	struct _starpu_data_entry *entry;
 
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	HASH_FIND_PTR(_cache_data, &data_handle, entry);
+	HASH_FIND_PTR(shard->data, &data_handle, entry);
 	if (entry == NULL)
 	{
 		_STARPU_MPI_MALLOC(entry, sizeof(*entry));
 		entry->data_handle = data_handle;
-		HASH_ADD_PTR(_cache_data, data_handle, entry);
+		HASH_ADD_PTR(shard->data, data_handle, entry);
 	}
 }
 
 static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle)
 {
+	struct _starpu_mpi_cache_shard *shard = _starpu_mpi_cache_shard(data_handle);
 	struct _starpu_data_entry *entry;
 
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	HASH_FIND_PTR(_cache_data, &data_handle, entry);
+	HASH_FIND_PTR(shard->data, &data_handle, entry);
 	if (entry)
 	{
-		HASH_DEL(_cache_data, entry);
+		HASH_DEL(shard->data, entry);
 		free(entry);
 	}
 }
 
+/**************************************
+ * Bounded cache
+ **************************************/
+
+static struct _starpu_mpi_cache_lru *_starpu_mpi_cache_lru_add_nolock(struct _starpu_mpi_cache_lru_peer *peer, starpu_data_handle_t data_handle, struct _starpu_mpi_cache_lru *lru)
+{
+	if (lru)
+	{
+		/* It was evicted but not invalidated yet, just keep it */
+		STARPU_ASSERT(!lru->peer);
+		_starpu_mpi_cache_lru_list_erase(&_cache_evicted, lru);
+	}
+	else
+	{
+		lru = _starpu_mpi_cache_lru_new();
+		lru->data_handle = data_handle;
+	}
+	lru->size = starpu_data_get_size(data_handle);
+	lru->peer = peer;
+	_starpu_mpi_cache_lru_list_push_back(&peer->list, lru);
+	peer->size += lru->size;
+	return lru;
+}
+
+static void _starpu_mpi_cache_lru_touch_nolock(struct _starpu_mpi_cache_lru *lru)
+{
+	_starpu_mpi_cache_lru_list_erase(&lru->peer->list, lru);
+	_starpu_mpi_cache_lru_list_push_back(&lru->peer->list, lru);
+}
+
+static void _starpu_mpi_cache_lru_remove_nolock(struct _starpu_mpi_cache_lru *lru)
+{
+	struct _starpu_mpi_cache_lru_peer *peer = lru->peer;
+	if (peer)
+	{
+		_starpu_mpi_cache_lru_list_erase(&peer->list, lru);
+		peer->size -= lru->size;
+	}
+	else
+		/* The eviction is pending, the caller invalidates the data anyway */
+		_starpu_mpi_cache_lru_list_erase(&_cache_evicted, lru);
+	_starpu_mpi_cache_lru_delete(lru);
+}
+
+static void _starpu_mpi_cache_received_lru_remove_nolock(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	if (!mpi_data->cache_received_lru)
+		return;
+
+	_starpu_mpi_cache_lru_remove_nolock(mpi_data->cache_received_lru);
+	mpi_data->cache_received_lru = NULL;
+}
+
+static void _starpu_mpi_cache_sent_lru_remove_nolock(starpu_data_handle_t data_handle, int dest)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	if (!mpi_data->cache_sent_lru || !mpi_data->cache_sent_lru[dest])
+		return;
+
+	_starpu_mpi_cache_lru_remove_nolock(mpi_data->cache_sent_lru[dest]);
+	mpi_data->cache_sent_lru[dest] = NULL;
+}
+
+/* Drop the least recently used data received from \p mpi_rank until its
+ * budget is met again, but keep the data which was just received */
+static void _starpu_mpi_cache_received_evict_nolock(int mpi_rank, struct _starpu_mpi_cache_lru *keep)
+{
+	struct _starpu_mpi_cache_lru_peer *peer = &_cache_received_lru[mpi_rank];
+
+	while (peer->size > _cache_peer_limit)
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_front(&peer->list);
+		if (lru == keep)
+			break;
+
+		starpu_data_handle_t data_handle = lru->data_handle;
+		struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+		_STARPU_MPI_DEBUG(2, "Evicting data %p received from %d from the cache\n", data_handle, mpi_rank);
+		_starpu_mpi_cache_lru_list_erase(&peer->list, lru);
+		peer->size -= lru->size;
+		lru->peer = NULL;
+		/* The task being submitted may still read it, invalidate it
+		 * only after that, see _starpu_mpi_cache_invalidate_evicted */
+		_starpu_mpi_cache_lru_list_push_back(&_cache_evicted, lru);
+		mpi_data->cache_received = 0;
+		mpi_data->ft_induced_cache_received = 0;
+		mpi_data->ft_induced_cache_received_count = 0;
+		_starpu_mpi_cache_data_remove_nolock(data_handle);
+		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
+		_cache_stats.evictions++;
+	}
+}
+
+static void _starpu_mpi_cache_invalidate_evicted_nolock(void)
+{
+	if (!_cache_peer_limit)
+		return;
+
+	while (!_starpu_mpi_cache_lru_list_empty(&_cache_evicted))
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_pop_front(&_cache_evicted);
+		struct _starpu_mpi_data *mpi_data = lru->data_handle->mpi_data;
+
+		mpi_data->cache_received_lru = NULL;
+		/* This waits for the tasks which still use the cached value,
+		 * and the next task which needs it will receive it again */
+		starpu_data_invalidate_submit(lru->data_handle);
+		_starpu_mpi_cache_lru_delete(lru);
+	}
+}
+
+void _starpu_mpi_cache_invalidate_evicted(void)
+{
+	if (_starpu_cache_enabled == 0 || !_cache_peer_limit)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_lru_mutex);
+	_starpu_mpi_cache_invalidate_evicted_nolock();
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_lru_mutex);
+}
+
+/* Take the same decisions as _starpu_mpi_cache_received_evict_nolock does on
+ * node \p dest */
+static void _starpu_mpi_cache_sent_evict_nolock(int dest, struct _starpu_mpi_cache_lru *keep)
+{
+	struct _starpu_mpi_cache_lru_peer *peer = &_cache_sent_lru[dest];
+
+	while (peer->size > _cache_peer_limit)
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_front(&peer->list);
+		if (lru == keep)
+			break;
+
+		starpu_data_handle_t data_handle = lru->data_handle;
+		struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+		_STARPU_MPI_DEBUG(2, "Node %d evicted data %p from its cache, it will have to be sent again\n", dest, data_handle);
+		_starpu_mpi_cache_sent_lru_remove_nolock(data_handle, dest);
+		mpi_data->cache_sent[dest] = 0;
+	}
+}
+
 /**************************************
  * Received cache
  **************************************/
@@ -183,7 +499,7 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_starpu_mpi_cache_lock(data_handle);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	STARPU_MPI_ASSERT_MSG(mpi_rank < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", mpi_rank, _starpu_cache_comm_size);
 
@@ -197,10 +513,37 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
 		starpu_data_invalidate_submit(data_handle);
+		_starpu_mpi_cache_received_lru_remove_nolock(data_handle);
 		_starpu_mpi_cache_data_remove_nolock(data_handle);
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_unlock(data_handle);
+}
+
+/* Account a new data in the receive cache, evicting older ones if needed */
+static void _starpu_mpi_cache_received_add_nolock(starpu_data_handle_t data_handle, int mpi_rank)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	_starpu_mpi_cache_data_add_nolock(data_handle);
+	_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+	(void) STARPU_ATOMIC_ADDL(&_cache_stats.misses, 1);
+
+	if (_cache_peer_limit && mpi_rank >= 0)
+	{
+		mpi_data->cache_received_lru = _starpu_mpi_cache_lru_add_nolock(&_cache_received_lru[mpi_rank], data_handle, mpi_data->cache_received_lru);
+		_starpu_mpi_cache_received_evict_nolock(mpi_rank, mpi_data->cache_received_lru);
+	}
+}
+
+/* Note that a cached data was used again */
+static void _starpu_mpi_cache_received_hit_nolock(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	(void) STARPU_ATOMIC_ADDL(&_cache_stats.hits, 1);
+	if (mpi_data->cache_received_lru && mpi_data->cache_received_lru->peer)
+		_starpu_mpi_cache_lru_touch_nolock(mpi_data->cache_received_lru);
 }
 
 
@@ -212,20 +555,31 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return 0;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	STARPU_MPI_ASSERT_MSG(mpi_rank < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", mpi_rank, _starpu_cache_comm_size);
 
+#ifndef STARPU_USE_MPI_FT_STATS
+	/* Common case: the data is already there and there is no LRU order
+	 * to update */
+	if (!_cache_peer_limit && mpi_data->cache_received)
+	{
+		(void) STARPU_ATOMIC_ADDL(&_cache_stats.hits, 1);
+		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
+		return 1;
+	}
+#endif
+
+	_starpu_mpi_cache_lock(data_handle);
 	int already_received = mpi_data->cache_received;
 	if (already_received == 0)
 	{
 		_STARPU_MPI_DEBUG(2, "Noting that data %p has already been received by %d\n", data_handle, mpi_rank);
 		mpi_data->cache_received = 1;
-		_starpu_mpi_cache_data_add_nolock(data_handle);
-		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_received_add_nolock(data_handle, mpi_rank);
 	}
 	else
 	{
+		_starpu_mpi_cache_received_hit_nolock(data_handle);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1 && mpi_data->ft_induced_cache_received_count == 0)
 		{
@@ -236,7 +590,7 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 #endif //STARPU_USE_MPI_FT_STATS
 		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_unlock(data_handle);
 	return already_received;
 }
 
@@ -248,10 +602,21 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return 0;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	STARPU_MPI_ASSERT_MSG(mpi_rank < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", mpi_rank, _starpu_cache_comm_size);
 
+#ifndef STARPU_USE_MPI_FT_STATS
+	/* Common case: the data is already there and there is no LRU order
+	 * to update */
+	if (!_cache_peer_limit && mpi_data->cache_received)
+	{
+		(void) STARPU_ATOMIC_ADDL(&_cache_stats.hits, 1);
+		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
+		return 1;
+	}
+#endif
+
+	_starpu_mpi_cache_lock(data_handle);
 	int already_received = mpi_data->cache_received;
 	if (already_received == 0)
 	{
@@ -261,11 +626,11 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 #ifdef STARPU_USE_MPI_FT_STATS
 		_STARPU_MPI_FT_STATS_RECV_CP_DATA(starpu_data_get_size(data_handle));
 #endif
-		_starpu_mpi_cache_data_add_nolock(data_handle);
-		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_received_add_nolock(data_handle, mpi_rank);
 	}
 	else
 	{
+		_starpu_mpi_cache_received_hit_nolock(data_handle);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1)
 			_STARPU_MPI_FT_STATS_RECV_CP_CACHED_CP_DATA(starpu_data_get_size(data_handle));
@@ -274,7 +639,7 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 #endif
 		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_unlock(data_handle);
 	return already_received;
 }
 
@@ -286,10 +651,8 @@ int starpu_mpi_cached_receive(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return 0;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	already_received = mpi_data->cache_received;
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_received;
 }
 
@@ -304,7 +667,7 @@ void starpu_mpi_cached_send_clear(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_starpu_mpi_cache_lock(data_handle);
 	starpu_mpi_comm_size(mpi_data->node_tag.node.comm, &size);
 	for(n=0 ; n<size ; n++)
 	{
@@ -312,10 +675,11 @@ void starpu_mpi_cached_send_clear(starpu_data_handle_t data_handle)
 		{
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
 			mpi_data->cache_sent[n] = 0;
+			_starpu_mpi_cache_sent_lru_remove_nolock(data_handle, n);
 			_starpu_mpi_cache_data_remove_nolock(data_handle);
 		}
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_unlock(data_handle);
 }
 
 int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
@@ -327,19 +691,34 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
 
 	STARPU_MPI_ASSERT_MSG(dest < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", dest, _starpu_cache_comm_size);
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	/* Common case: the data was already sent and there is no LRU order
+	 * to update */
+	if (!_cache_peer_limit && mpi_data->cache_sent[dest])
+	{
+		_STARPU_MPI_DEBUG(2, "Do not send data %p to node %d as it has already been sent\n", data_handle, dest);
+		return 1;
+	}
+
+	_starpu_mpi_cache_lock(data_handle);
 	int already_sent = mpi_data->cache_sent[dest];
 	if (mpi_data->cache_sent[dest] == 0)
 	{
 		mpi_data->cache_sent[dest] = 1;
 		_starpu_mpi_cache_data_add_nolock(data_handle);
+		if (mpi_data->cache_sent_lru)
+		{
+			mpi_data->cache_sent_lru[dest] = _starpu_mpi_cache_lru_add_nolock(&_cache_sent_lru[dest], data_handle, NULL);
+			_starpu_mpi_cache_sent_evict_nolock(dest, mpi_data->cache_sent_lru[dest]);
+		}
 		_STARPU_MPI_DEBUG(2, "Noting that data %p has already been sent to %d\n", data_handle, dest);
 	}
 	else
 	{
+		if (mpi_data->cache_sent_lru && mpi_data->cache_sent_lru[dest])
+			_starpu_mpi_cache_lru_touch_nolock(mpi_data->cache_sent_lru[dest]);
 		_STARPU_MPI_DEBUG(2, "Do not send data %p to node %d as it has already been sent\n", data_handle, dest);
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_unlock(data_handle);
 	return already_sent;
 }
 
@@ -351,10 +730,8 @@ int starpu_mpi_cached_send(starpu_data_handle_t data_handle, int dest)
 	if (_starpu_cache_enabled == 0)
 		return 0;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_MPI_ASSERT_MSG(dest < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", dest, _starpu_cache_comm_size);
 	already_sent = mpi_data->cache_sent[dest];
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_sent;
 }
 
@@ -373,6 +750,7 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 		{
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
 			mpi_data->cache_sent[i] = 0;
+			_starpu_mpi_cache_sent_lru_remove_nolock(data_handle, i);
 			_starpu_mpi_cache_stats_dec(i, data_handle);
 		}
 	}
@@ -381,6 +759,7 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 	{
 		int mpi_rank = starpu_mpi_data_get_rank(data_handle);
 		_STARPU_MPI_DEBUG(2, "Clearing received cache for data %p\n", data_handle);
+		_starpu_mpi_cache_received_lru_remove_nolock(data_handle);
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
@@ -408,25 +787,51 @@ void starpu_mpi_cache_flush(MPI_Comm comm, starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_starpu_mpi_cache_lock(data_handle);
 	_starpu_mpi_cache_flush_and_invalidate_nolock(comm, data_handle);
 	_starpu_mpi_cache_data_remove_nolock(data_handle);
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_starpu_mpi_cache_invalidate_evicted_nolock();
+	_starpu_mpi_cache_unlock(data_handle);
 }
 
 void starpu_mpi_cache_flush_all_data(MPI_Comm comm)
 {
 	struct _starpu_data_entry *entry=NULL, *tmp=NULL;
+	int i;
 
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
-	HASH_ITER(hh, _cache_data, entry, tmp)
+	_starpu_mpi_cache_lock_all();
+	for (i = 0; i < _STARPU_MPI_CACHE_NSHARDS; i++)
 	{
-		_starpu_mpi_cache_flush_and_invalidate_nolock(comm, entry->data_handle);
-		HASH_DEL(_cache_data, entry);
-		free(entry);
+		HASH_ITER(hh, _cache_shards[i].data, entry, tmp)
+		{
+			_starpu_mpi_cache_flush_and_invalidate_nolock(comm, entry->data_handle);
+			HASH_DEL(_cache_shards[i].data, entry);
+			free(entry);
+		}
+	}
+	_starpu_mpi_cache_invalidate_evicted_nolock();
+	_starpu_mpi_cache_unlock_all();
+}
+
+void starpu_mpi_cache_get_stats(struct starpu_mpi_cache_stats *stats)
+{
+	if (_starpu_cache_enabled == 0)
+	{
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_lru_mutex);
+	*stats = _cache_stats;
+	if (_cache_peer_limit)
+	{
+		int i;
+		stats->size = 0;
+		for (i = 0; i < _starpu_cache_comm_size; i++)
+			stats->size += _cache_received_lru[i].size;
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_lru_mutex);
 }
@@ -33,6 +33,9 @@ void _starpu_mpi_cache_init(MPI_Comm comm);
 void _starpu_mpi_cache_shutdown();
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle);
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle);
+/** Invalidate the data which were evicted from the bounded receive cache
+ * while submitting the last task */
+void _starpu_mpi_cache_invalidate_evicted(void);
 
 #ifdef __cplusplus
 }
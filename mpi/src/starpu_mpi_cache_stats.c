@@ -60,3 +60,10 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 	}
 }
 
+void _starpu_mpi_cache_stats_display(struct starpu_mpi_cache_stats *stats)
+{
+	if (stats_enabled == 0)
+		return;
+
+	_STARPU_MPI_MSG("[communication cache] %lu hits, %lu misses, %lu evictions\n", stats->hits, stats->misses, stats->evictions);
+}
@@ -20,6 +20,7 @@
 #include <starpu.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include <starpu_mpi.h>
 
 /** @file */
 
@@ -32,6 +33,7 @@ void _starpu_mpi_cache_stats_init();
 void _starpu_mpi_cache_stats_shutdown();
 
 void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_handle, int count);
+void _starpu_mpi_cache_stats_display(struct starpu_mpi_cache_stats *stats);
 
 #define _starpu_mpi_cache_stats_inc(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, +1)
 #define _starpu_mpi_cache_stats_dec(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, -1)
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2011-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2011-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Thibaut Lambert
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -20,6 +20,23 @@
 #include <starpu_mpi.h>
 #include <starpu_mpi_private.h>
 
+/** Shape of the trees used to broadcast data, see STARPU_MPI_BCAST_TREE */
+enum _starpu_mpi_tree_type
+{
+	_STARPU_MPI_TREE_BINOMIAL,
+	_STARPU_MPI_TREE_CHAIN
+};
+
+/** Position of a node in a broadcast tree */
+struct _starpu_mpi_tree
+{
+	/** Node to receive the data from, -1 for the root */
+	int parent;
+	int nchildren;
+	/** Nodes to forward the data to, a binomial tree has at most one child per bit */
+	int children[sizeof(int)*8];
+};
+
 struct _callback_arg
 {
 	void (*callback)(void *);
@@ -167,3 +184,162 @@ int starpu_mpi_gather_detached(starpu_data_handle_t *data_handles, int count, in
 	}
 	return 0;
 }
+
+static
+enum _starpu_mpi_tree_type _starpu_mpi_tree_get_type(void)
+{
+	const char *tree = starpu_getenv("STARPU_MPI_BCAST_TREE");
+
+	if (tree == NULL || strcasecmp(tree, "binomial") == 0)
+		return _STARPU_MPI_TREE_BINOMIAL;
+	if (strcasecmp(tree, "chain") == 0)
+		return _STARPU_MPI_TREE_CHAIN;
+	_STARPU_MSG("Unknown broadcast tree '%s', using a binomial tree\n", tree);
+	return _STARPU_MPI_TREE_BINOMIAL;
+}
+
+/* Get the position of \p rank in the tree rooted at \p root */
+static
+void _starpu_mpi_tree_build(enum _starpu_mpi_tree_type type, int rank, int root, int size, struct _starpu_mpi_tree *tree)
+{
+	/* Rank relative to the root */
+	int vrank = (rank - root + size) % size;
+	int mask;
+
+	tree->nchildren = 0;
+
+	if (type == _STARPU_MPI_TREE_CHAIN)
+	{
+		/* Each node forwards the data to the next one, successive
+		 * broadcasts are thus pipelined along the chain */
+		tree->parent = vrank == 0 ? -1 : (rank - 1 + size) % size;
+		if (vrank + 1 < size)
+			tree->children[tree->nchildren++] = (rank + 1) % size;
+		return;
+	}
+
+	/* In a binomial tree, the parent of a node is the node without its
+	 * lowest bit set, and its children are the node plus each power of two
+	 * lower than this bit */
+	for (mask = 1; mask < size; mask <<= 1)
+		if (vrank & mask)
+			break;
+	tree->parent = vrank == 0 ? -1 : ((vrank & ~mask) + root) % size;
+	/* Send to the biggest subtrees first */
+	for (mask >>= 1; mask > 0; mask >>= 1)
+		if (vrank + mask < size)
+			tree->children[tree->nchildren++] = (vrank + mask + root) % size;
+}
+
+/* Receive \p data_handle from the parent in \p tree and forward it to the children */
+static
+int _starpu_mpi_tree_bcast(starpu_data_handle_t data_handle, struct _starpu_mpi_tree *tree, MPI_Comm comm, void (*callback_func)(void *), struct _callback_arg *callback_arg)
+{
+	starpu_mpi_tag_t data_tag = starpu_mpi_data_get_tag(data_handle);
+	int ret, i;
+
+	STARPU_ASSERT_MSG(data_tag >= 0, "Invalid tag for data handle");
+
+	if (tree->parent != -1)
+	{
+		ret = starpu_mpi_irecv_detached(data_handle, tree->parent, data_tag, comm, callback_func, callback_arg);
+		if (ret)
+			return ret;
+	}
+	/* The sends will wait for the reception thanks to sequential consistency */
+	for (i = 0; i < tree->nchildren; i++)
+	{
+		ret = starpu_mpi_isend_detached(data_handle, tree->children[i], data_tag, comm, callback_func, callback_arg);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/* Prepare the callback to be called once \p count communications have completed */
+static
+int _callback_set_count(int count, void (*callback)(void *), void *arg, void (**callback_func)(void *), struct _callback_arg **callback_arg)
+{
+	if (!callback)
+		return 0;
+	if (!count)
+	{
+		/* Nothing to wait for */
+		callback(arg);
+		return 1;
+	}
+
+	*callback_func = _callback_collective;
+	_STARPU_MPI_MALLOC(*callback_arg, sizeof(struct _callback_arg));
+	(*callback_arg)->count = count;
+	(*callback_arg)->nb = 0;
+	(*callback_arg)->callback = callback;
+	(*callback_arg)->arg = arg;
+	return 0;
+}
+
+int starpu_mpi_bcast_detached(starpu_data_handle_t *data_handles, int count, int root, MPI_Comm comm, void (*callback)(void *), void *arg)
+{
+	int rank, size;
+	int x;
+	struct _starpu_mpi_tree tree;
+	struct _callback_arg *callback_arg = NULL;
+	void (*callback_func)(void *) = NULL;
+
+	starpu_mpi_comm_rank(comm, &rank);
+	starpu_mpi_comm_size(comm, &size);
+
+	STARPU_ASSERT_MSG(root >= 0 && root < size, "Invalid root %d for a communicator of size %d", root, size);
+	_starpu_mpi_tree_build(_starpu_mpi_tree_get_type(), rank, root, size, &tree);
+
+	if (_callback_set_count(count * ((tree.parent != -1) + tree.nchildren), callback, arg, &callback_func, &callback_arg))
+		return 0;
+
+	for(x = 0; x < count ; x++)
+	{
+		int ret;
+		STARPU_ASSERT_MSG(data_handles[x], "All the nodes need a data handle to broadcast it");
+		ret = _starpu_mpi_tree_bcast(data_handles[x], &tree, comm, callback_func, callback_arg);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+int starpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int count, MPI_Comm comm, void (*callback)(void *), void *arg)
+{
+	int rank, size;
+	int x, ncomms = 0;
+	enum _starpu_mpi_tree_type type = _starpu_mpi_tree_get_type();
+	struct _starpu_mpi_tree tree;
+	struct _callback_arg *callback_arg = NULL;
+	void (*callback_func)(void *) = NULL;
+
+	starpu_mpi_comm_rank(comm, &rank);
+	starpu_mpi_comm_size(comm, &size);
+
+	/* Each data is broadcast from its owner, so that the broadcasts of the
+	 * different data use different trees */
+	for(x = 0; x < count ; x++)
+	{
+		int owner;
+		STARPU_ASSERT_MSG(data_handles[x], "All the nodes need a data handle to gather it");
+		owner = starpu_mpi_data_get_rank(data_handles[x]);
+		STARPU_ASSERT_MSG(owner >= 0 && owner < size, "Data %p has invalid owner rank %d, all the data to gather need an owner, see starpu_mpi_data_register()", data_handles[x], owner);
+		_starpu_mpi_tree_build(type, rank, owner, size, &tree);
+		ncomms += (tree.parent != -1) + tree.nchildren;
+	}
+
+	if (_callback_set_count(ncomms, callback, arg, &callback_func, &callback_arg))
+		return 0;
+
+	for(x = 0; x < count ; x++)
+	{
+		int ret;
+		_starpu_mpi_tree_build(type, rank, starpu_mpi_data_get_rank(data_handles[x]), size, &tree);
+		ret = _starpu_mpi_tree_bcast(data_handles[x], &tree, comm, callback_func, callback_arg);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
@@ -146,6 +146,16 @@ int fstarpu_mpi_gather_detached(starpu_data_handle_t *data_handles, int cnt, int
 	return starpu_mpi_gather_detached(data_handles, cnt, root, MPI_Comm_f2c(comm), scallback, sarg, rcallback, rarg);
 }
 
+int fstarpu_mpi_bcast_detached(starpu_data_handle_t *data_handles, int cnt, int root, MPI_Fint comm, void (*callback)(void *), void *arg)
+{
+	return starpu_mpi_bcast_detached(data_handles, cnt, root, MPI_Comm_f2c(comm), callback, arg);
+}
+
+int fstarpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int cnt, MPI_Fint comm, void (*callback)(void *), void *arg)
+{
+	return starpu_mpi_allgather_detached(data_handles, cnt, MPI_Comm_f2c(comm), callback, arg);
+}
+
 /* isend/irecv detached unlock tag */
 int fstarpu_mpi_isend_detached_unlock_tag(starpu_data_handle_t data_handle, int dst, starpu_mpi_tag_t data_tag, MPI_Fint comm, starpu_tag_t *starpu_tag)
 {
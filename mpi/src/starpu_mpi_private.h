@@ -208,13 +208,21 @@ struct _starpu_mpi_coop_sends
 	long pre_sync_jobid;
 };
 
+struct _starpu_mpi_cache_lru;
+
 /** Initialized in starpu_mpi_data_register_comm */
 struct _starpu_mpi_data
 {
 	int magic;
 	struct _starpu_mpi_node_tag node_tag;
 	char *cache_sent;
+	/** When the cache is bounded, position of the data in the mirror of
+	  * the receive cache of each node it was sent to */
+	struct _starpu_mpi_cache_lru **cache_sent_lru;
 	unsigned int cache_received;
+	/** When the cache is bounded, position of the data in the receive
+	  * cache */
+	struct _starpu_mpi_cache_lru *cache_received_lru;
 	unsigned int ft_induced_cache_received:1;
 	unsigned int ft_induced_cache_received_count:1;
 	unsigned int modified:1; // Whether the data has been modified since the registration.
@@ -676,6 +676,10 @@ int _starpu_mpi_task_postbuild_v(MPI_Comm comm, int xrank, int do_execute, struc
 		_starpu_mpi_clear_data_after_execution(descrs[i].handle, descrs[i].mode, me, do_execute);
 	}
 
+	/* Now that the task is submitted, we can get rid of the data evicted
+	 * from the cache */
+	_starpu_mpi_cache_invalidate_evicted();
+
 	free(descrs);
 
 	_STARPU_TRACE_TASK_MPI_POST_END();
@@ -0,0 +1,182 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 0 reads NDATA pieces of data owned by node 1, twice in a row each,
+ * while its reception cache can only hold a part of them, and check that the
+ * evicted data are received again when needed.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NDATA	8
+#define NPASSES	2
+/* 256KiB per data, so that 4 of them fit in the 1MiB budget */
+#define NX	(256*1024 / sizeof(unsigned))
+
+void func_cpu(void *descr[], void *_args)
+{
+	unsigned *sum = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	unsigned *v = (unsigned *)STARPU_VECTOR_GET_PTR(descr[1]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[1]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 1; i < nx; i++)
+		STARPU_ASSERT(v[i] == v[0]);
+	*sum += v[0];
+}
+
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_RW, STARPU_R},
+	.model = &starpu_perfmodel_nop,
+};
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int ret;
+	unsigned i, j, pass;
+	unsigned sum = 0, expected = 0;
+	unsigned *v[NDATA];
+	size_t *comm_amount;
+	starpu_data_handle_t sum_handle;
+	starpu_data_handle_t data_handles[NDATA];
+	struct starpu_mpi_cache_stats stats;
+	int result = 1;
+	char limit[16];
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	setenv("STARPU_MPI_STATS", "1", 1);
+	setenv("STARPU_MPI_CACHE", "1", 1);
+	/* The budget is split among the other nodes, give 1MiB to each */
+	snprintf(limit, sizeof(limit), "%d", size - 1);
+	setenv("STARPU_MPI_CACHE_LIMIT", limit, 1);
+
+	ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_variable_data_register(&sum_handle, rank == 0 ? STARPU_MAIN_RAM : -1, (uintptr_t)&sum, sizeof(sum));
+	starpu_mpi_data_register(sum_handle, NDATA, 0);
+
+	for (i = 0; i < NDATA; i++)
+	{
+		if (rank == 1)
+		{
+			unsigned k;
+			v[i] = malloc(NX * sizeof(unsigned));
+			for (k = 0; k < NX; k++)
+				v[i][k] = i;
+			starpu_vector_data_register(&data_handles[i], STARPU_MAIN_RAM, (uintptr_t)v[i], NX, sizeof(unsigned));
+		}
+		else
+			starpu_vector_data_register(&data_handles[i], -1, (uintptr_t)NULL, NX, sizeof(unsigned));
+		starpu_mpi_data_register(data_handles[i], i, 1);
+	}
+
+	for (pass = 0; pass < NPASSES; pass++)
+		for (i = 0; i < NDATA; i++)
+			/* The second access hits the cache */
+			for (j = 0; j < 2; j++)
+			{
+				ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet, STARPU_RW, sum_handle, STARPU_R, data_handles[i], 0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+				expected += i;
+			}
+
+	starpu_task_wait_for_all();
+
+	starpu_mpi_cache_get_stats(&stats);
+	if (rank == 0)
+	{
+		FPRINTF_MPI(stderr, "%lu hits, %lu misses, %lu evictions, %lu/%lu bytes\n", stats.hits, stats.misses, stats.evictions, (unsigned long) stats.size, (unsigned long) stats.limit);
+		/* Only 4 data fit at the same time, so every first access of
+		 * a pass is a miss */
+		result = stats.hits == NPASSES*NDATA
+			&& stats.misses == NPASSES*NDATA
+			&& stats.evictions == NPASSES*NDATA - 4
+			&& stats.size == 4*NX*sizeof(unsigned);
+	}
+
+	starpu_data_unregister(sum_handle);
+	for (i = 0; i < NDATA; i++)
+	{
+		starpu_data_unregister(data_handles[i]);
+		if (rank == 1)
+			free(v[i]);
+	}
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_amounts_retrieve(comm_amount);
+	starpu_mpi_shutdown();
+
+	if (rank == 0)
+	{
+		if (sum != expected)
+		{
+			FPRINTF_MPI(stderr, "sum is %u instead of %u\n", sum, expected);
+			result = 0;
+		}
+	}
+	else if (rank == 1)
+	{
+		/* Node 1 has to mirror the evictions of node 0 */
+		if (comm_amount[0] != NPASSES*NDATA*NX*sizeof(unsigned))
+		{
+			FPRINTF_MPI(stderr, "sent %lu bytes instead of %lu\n", (unsigned long) comm_amount[0], (unsigned long) (NPASSES*NDATA*NX*sizeof(unsigned)));
+			result = 0;
+		}
+	}
+	free(comm_amount);
+
+	MPI_Finalize();
+	return !result;
+}
+#endif
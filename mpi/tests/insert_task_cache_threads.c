@@ -0,0 +1,174 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Several threads concurrently insert tasks which read data owned by node 1
+ * into data owned by node 0, each thread on its own data, and check that each
+ * data is sent only once thanks to the communication cache.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NTHREADS	4
+#define NDATA		16
+#ifdef STARPU_QUICK_CHECK
+#define NLOOPS		4
+#else
+#define NLOOPS		32
+#endif
+
+void func_cpu(void *descr[], void *_args)
+{
+	unsigned *sum = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	unsigned *value = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	(void)_args;
+
+	*sum += *value;
+}
+
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_RW, STARPU_R},
+	.model = &starpu_perfmodel_nop,
+};
+
+static unsigned sums[NTHREADS];
+static unsigned values[NTHREADS][NDATA];
+static starpu_data_handle_t sum_handles[NTHREADS];
+static starpu_data_handle_t data_handles[NTHREADS][NDATA];
+
+static void *submit(void *arg)
+{
+	uintptr_t thread = (uintptr_t) arg;
+	unsigned i, loop;
+	int ret;
+
+	for (loop = 0; loop < NLOOPS; loop++)
+		for (i = 0; i < NDATA; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet, STARPU_RW, sum_handles[thread], STARPU_R, data_handles[thread][i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int ret;
+	unsigned i, expected = 0;
+	uintptr_t t;
+	size_t *comm_amount;
+	starpu_pthread_t threads[NTHREADS];
+	int result = 1;
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	setenv("STARPU_MPI_STATS", "1", 1);
+	setenv("STARPU_MPI_CACHE", "1", 1);
+
+	ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (t = 0; t < NTHREADS; t++)
+	{
+		sums[t] = 0;
+		starpu_variable_data_register(&sum_handles[t], rank == 0 ? STARPU_MAIN_RAM : -1, (uintptr_t)&sums[t], sizeof(sums[t]));
+		starpu_mpi_data_register(sum_handles[t], t*(NDATA+1), 0);
+		for (i = 0; i < NDATA; i++)
+		{
+			values[t][i] = t*NDATA + i;
+			expected += NLOOPS * values[t][i];
+			starpu_variable_data_register(&data_handles[t][i], rank == 1 ? STARPU_MAIN_RAM : -1, (uintptr_t)&values[t][i], sizeof(values[t][i]));
+			starpu_mpi_data_register(data_handles[t][i], t*(NDATA+1)+i+1, 1);
+		}
+	}
+
+	for (t = 0; t < NTHREADS; t++)
+		STARPU_PTHREAD_CREATE(&threads[t], NULL, submit, (void *) t);
+	for (t = 0; t < NTHREADS; t++)
+		STARPU_PTHREAD_JOIN(threads[t], NULL);
+
+	starpu_task_wait_for_all();
+
+	for (t = 0; t < NTHREADS; t++)
+	{
+		starpu_data_unregister(sum_handles[t]);
+		for (i = 0; i < NDATA; i++)
+			starpu_data_unregister(data_handles[t][i]);
+	}
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_amounts_retrieve(comm_amount);
+	starpu_mpi_shutdown();
+
+	if (rank == 0)
+	{
+		unsigned sum = 0;
+		for (t = 0; t < NTHREADS; t++)
+			sum += sums[t];
+		if (sum != expected)
+		{
+			FPRINTF_MPI(stderr, "sum is %u instead of %u\n", sum, expected);
+			result = 0;
+		}
+	}
+	else if (rank == 1)
+	{
+		if (comm_amount[0] != NTHREADS*NDATA*sizeof(unsigned))
+		{
+			FPRINTF_MPI(stderr, "sent %lu bytes instead of %lu\n", (unsigned long) comm_amount[0], (unsigned long) (NTHREADS*NDATA*sizeof(unsigned)));
+			result = 0;
+		}
+	}
+	free(comm_amount);
+
+	MPI_Finalize();
+	return !result;
+}
+#endif
@@ -0,0 +1,178 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 0 sends many small vectors to node 1, first without and then with the
+ * aggregation of small messages (STARPU_MPI_AGGREGATE_SIZE), checks the
+ * received values and displays the message rate for each size. Node 1 posts
+ * the receives of the second half of the messages only once the first half
+ * has been received, so that the aggregated messages are partly received as
+ * early data.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define MIN_SIZE	8
+#define MAX_SIZE	(64*1024)
+#ifdef STARPU_QUICK_CHECK
+#define NMAX		64
+#define TOTAL_SIZE	(1024*1024)
+#else
+#define NMAX		1000
+#define TOTAL_SIZE	(16*1024*1024)
+#endif
+#define AGGREGATE_SIZE	"262144"
+
+static int exchange(int rank, size_t size, unsigned n, double *rate)
+{
+	char **buffers;
+	starpu_data_handle_t *handles;
+	starpu_mpi_req *reqs;
+	unsigned i;
+	size_t j;
+	double start, end;
+	int ret = 0;
+
+	buffers = malloc(n * sizeof(*buffers));
+	handles = malloc(n * sizeof(*handles));
+	reqs = malloc(n * sizeof(*reqs));
+	for (i = 0; i < n; i++)
+	{
+		buffers[i] = malloc(size);
+		for (j = 0; j < size; j++)
+			buffers[i][j] = rank == 0 ? (char) (i + j) : 0;
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t) buffers[i], size, sizeof(char));
+	}
+
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	start = starpu_timing_now();
+
+	if (rank == 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			ret = starpu_mpi_isend_detached(handles[i], 1, i, MPI_COMM_WORLD, NULL, NULL);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached");
+		}
+	}
+	else
+	{
+		for (i = 0; i < n/2; i++)
+		{
+			ret = starpu_mpi_irecv(handles[i], &reqs[i], 0, i, MPI_COMM_WORLD);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+		}
+		for (i = 0; i < n/2; i++)
+			starpu_mpi_wait(&reqs[i], MPI_STATUS_IGNORE);
+		for (i = n/2; i < n; i++)
+		{
+			ret = starpu_mpi_irecv_detached(handles[i], 0, i, MPI_COMM_WORLD, NULL, NULL);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv_detached");
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		starpu_data_unregister(handles[i]);
+	end = starpu_timing_now();
+	*rate = n / ((end - start) / 1000000.);
+
+	ret = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (rank == 1)
+			for (j = 0; j < size; j++)
+				if (buffers[i][j] != (char) (i + j))
+				{
+					FPRINTF_MPI(stderr, "message %u of size %lu: value %d at %lu instead of %d\n", i, (unsigned long) size, buffers[i][j], (unsigned long) j, (char) (i + j));
+					ret = 1;
+					break;
+				}
+		free(buffers[i]);
+	}
+	free(buffers);
+	free(handles);
+	free(reqs);
+
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int ret, result = 0;
+	unsigned n[2][32];
+	double rates[2][32];
+	size_t message_size;
+	int aggregate;
+	unsigned s;
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (aggregate = 0; aggregate < 2; aggregate++)
+	{
+		setenv("STARPU_MPI_AGGREGATE_SIZE", aggregate ? AGGREGATE_SIZE : "0", 1);
+
+		ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+		for (message_size = MIN_SIZE, s = 0; message_size <= MAX_SIZE; message_size *= 2, s++)
+		{
+			n[aggregate][s] = TOTAL_SIZE / message_size < NMAX ? TOTAL_SIZE / message_size : NMAX;
+			if (rank <= 1)
+				result |= exchange(rank, message_size, n[aggregate][s], &rates[aggregate][s]);
+			else
+			{
+				/* Take part in the barriers of exchange() */
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+			}
+		}
+
+		starpu_mpi_shutdown();
+	}
+
+	if (rank == 1)
+	{
+		FPRINTF(stdout, "# size\tmessages\tmsg/s\tmsg/s aggregated\n");
+		for (message_size = MIN_SIZE, s = 0; message_size <= MAX_SIZE; message_size *= 2, s++)
+			FPRINTF(stdout, "%lu\t%u\t%.0f\t%.0f\n", (unsigned long) message_size, n[0][s], rates[0][s], rates[1][s]);
+	}
+
+	MPI_Finalize();
+	return result;
+}
+#endif
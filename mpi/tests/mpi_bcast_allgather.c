@@ -0,0 +1,163 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Broadcast data computed by a task on the last node to all the nodes, then
+ * gather on all the nodes the data computed by each node, with both the
+ * binomial and the chain trees.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NDATA	8
+
+void cpu_codelet(void *descr[], void *_args)
+{
+	int *value = (int *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	int add;
+
+	starpu_codelet_unpack_args(_args, &add);
+	*value += add;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {cpu_codelet},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+static int ncallbacks;
+
+void callback(void *arg)
+{
+	(void)arg;
+	STARPU_ATOMIC_ADD(&ncallbacks, 1);
+}
+
+static int check(int rank, int *values, int expected, const char *what, const char *tree)
+{
+	int x, ret = 0;
+
+	for(x = 0; x < NDATA; x++)
+		if (values[x] != expected + x)
+		{
+			FPRINTF_MPI(stderr, "%s with %s tree: value %d instead of %d for data %d\n", what, tree, values[x], expected + x, x);
+			ret = 1;
+		}
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, nodes, ret, x;
+	int bcast_values[NDATA];
+	int *gather_values;
+	starpu_data_handle_t bcast_handles[NDATA];
+	starpu_data_handle_t *gather_handles;
+	const char *trees[] = { "binomial", "chain" };
+	unsigned tree;
+	int root, result = 0;
+
+	ret = starpu_mpi_init_conf(&argc, &argv, 1, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &nodes);
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	root = nodes - 1;
+	gather_values = malloc(nodes * NDATA * sizeof(int));
+	gather_handles = malloc(nodes * NDATA * sizeof(starpu_data_handle_t));
+
+	for (tree = 0; tree < sizeof(trees)/sizeof(trees[0]); tree++)
+	{
+		int add = tree + 1;
+
+		setenv("STARPU_MPI_BCAST_TREE", trees[tree], 1);
+		ncallbacks = 0;
+
+		/* The root computes the data, then broadcasts it */
+		for(x = 0; x < NDATA; x++)
+		{
+			bcast_values[x] = rank == root ? x : -1;
+			starpu_variable_data_register(&bcast_handles[x], STARPU_MAIN_RAM, (uintptr_t)&bcast_values[x], sizeof(int));
+			starpu_mpi_data_register(bcast_handles[x], x, root);
+			if (rank == root)
+			{
+				ret = starpu_task_insert(&cl, STARPU_VALUE, &add, sizeof(add), STARPU_RW, bcast_handles[x], 0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			}
+		}
+		ret = starpu_mpi_bcast_detached(bcast_handles, NDATA, root, MPI_COMM_WORLD, callback, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_bcast_detached");
+
+		/* Each node computes its data, then they are gathered on all the nodes */
+		for(x = 0; x < nodes * NDATA; x++)
+		{
+			int owner = x / NDATA;
+			gather_values[x] = rank == owner ? owner * 100 + x % NDATA : -1;
+			starpu_variable_data_register(&gather_handles[x], STARPU_MAIN_RAM, (uintptr_t)&gather_values[x], sizeof(int));
+			starpu_mpi_data_register(gather_handles[x], NDATA + x, owner);
+			if (rank == owner)
+			{
+				ret = starpu_task_insert(&cl, STARPU_VALUE, &add, sizeof(add), STARPU_RW, gather_handles[x], 0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			}
+		}
+		ret = starpu_mpi_allgather_detached(gather_handles, nodes * NDATA, MPI_COMM_WORLD, callback, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_allgather_detached");
+
+		for(x = 0; x < NDATA; x++)
+			starpu_data_unregister(bcast_handles[x]);
+		for(x = 0; x < nodes * NDATA; x++)
+			starpu_data_unregister(gather_handles[x]);
+		starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+		result |= check(rank, bcast_values, add, "broadcast", trees[tree]);
+		for(x = 0; x < nodes; x++)
+			result |= check(rank, &gather_values[x * NDATA], x * 100 + add, "allgather", trees[tree]);
+		if (ncallbacks != 2)
+		{
+			FPRINTF_MPI(stderr, "%d callbacks called instead of 2 with %s tree\n", ncallbacks, trees[tree]);
+			result = 1;
+		}
+		starpu_mpi_barrier(MPI_COMM_WORLD);
+	}
+
+	free(gather_values);
+	free(gather_handles);
+
+	starpu_mpi_shutdown();
+	return result;
+}
+#endif
@@ -0,0 +1,201 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Measure the bandwidth of a ping-pong of large vectors between nodes 0 and
+ * 1, first without and then with sending them in fragments
+ * (STARPU_MPI_CHUNK_THRESHOLD). Also check that a matrix is correctly
+ * received in fragments into a non-contiguous matrix, and in synchronous
+ * mode.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define MIN_SIZE	(1024*1024)
+#ifdef STARPU_QUICK_CHECK
+#define MAX_SIZE	(8*1024*1024)
+#define NITER		2
+#else
+#define MAX_SIZE	(64*1024*1024)
+#define NITER		10
+#endif
+#define CHUNK_THRESHOLD	"2097152"
+#define CHUNK_SIZE	"1048576"
+
+#define NX		1024
+#define NY		1024
+#define LD		(NX+3)
+
+static int pingpong(int rank, size_t size, double *bandwidth)
+{
+	char *buffer;
+	starpu_data_handle_t handle;
+	double start, end;
+	unsigned iter;
+	size_t j;
+	int ret = 0;
+
+	buffer = malloc(size);
+	for (j = 0; j < size; j++)
+		buffer[j] = rank == 0 ? (char) j : 0;
+	starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) buffer, size, sizeof(char));
+
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	start = starpu_timing_now();
+	for (iter = 0; iter < NITER; iter++)
+	{
+		if (rank == 0)
+		{
+			starpu_mpi_send(handle, 1, iter, MPI_COMM_WORLD);
+			starpu_mpi_recv(handle, 1, iter, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		}
+		else
+		{
+			starpu_mpi_recv(handle, 0, iter, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			starpu_mpi_send(handle, 0, iter, MPI_COMM_WORLD);
+		}
+	}
+	end = starpu_timing_now();
+	*bandwidth = (2. * NITER * size) / (end - start);
+
+	starpu_data_unregister(handle);
+	for (j = 0; j < size; j++)
+		if (buffer[j] != (char) j)
+		{
+			FPRINTF_MPI(stderr, "vector of size %lu: value %d at %lu instead of %d\n", (unsigned long) size, buffer[j], (unsigned long) j, (char) j);
+			ret = 1;
+			break;
+		}
+	free(buffer);
+	return ret;
+}
+
+/* Node 0 sends a contiguous matrix which node 1 receives in a matrix with a
+ * bigger leading dimension, and sends back */
+static int matrix(int rank, int sync)
+{
+	int *buffer;
+	unsigned ld = rank == 0 ? NX : LD;
+	starpu_data_handle_t handle;
+	unsigned i, j;
+	int ret = 0;
+
+	buffer = calloc(ld * NY, sizeof(int));
+	if (rank == 0)
+		for (j = 0; j < NY; j++)
+			for (i = 0; i < NX; i++)
+				buffer[j*ld + i] = j*NX + i;
+	starpu_matrix_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) buffer, ld, NX, NY, sizeof(int));
+
+	if (rank == 0)
+	{
+		if (sync)
+		{
+			starpu_mpi_req req;
+			starpu_mpi_issend(handle, &req, 1, 0, MPI_COMM_WORLD);
+			starpu_mpi_wait(&req, MPI_STATUS_IGNORE);
+		}
+		else
+			starpu_mpi_isend_detached(handle, 1, 0, MPI_COMM_WORLD, NULL, NULL);
+		starpu_mpi_recv(handle, 1, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	}
+	else
+	{
+		starpu_mpi_recv(handle, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		starpu_mpi_send(handle, 0, 1, MPI_COMM_WORLD);
+	}
+	starpu_data_unregister(handle);
+
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++)
+			if (buffer[j*ld + i] != (int) (j*NX + i))
+			{
+				FPRINTF_MPI(stderr, "matrix: value %d at (%u,%u) instead of %u\n", buffer[j*ld + i], i, j, j*NX + i);
+				ret = 1;
+				goto out;
+			}
+out:
+	free(buffer);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int ret, result = 0;
+	double bandwidths[2][32];
+	size_t message_size;
+	int chunks;
+	unsigned s;
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+
+		MPI_Finalize();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (chunks = 0; chunks < 2; chunks++)
+	{
+		setenv("STARPU_MPI_CHUNK_THRESHOLD", chunks ? CHUNK_THRESHOLD : "0", 1);
+		setenv("STARPU_MPI_CHUNK_SIZE", CHUNK_SIZE, 1);
+
+		ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+		if (rank <= 1)
+		{
+			for (message_size = MIN_SIZE, s = 0; message_size <= MAX_SIZE; message_size *= 2, s++)
+				result |= pingpong(rank, message_size, &bandwidths[chunks][s]);
+			result |= matrix(rank, 0);
+			result |= matrix(rank, 1);
+		}
+		else
+		{
+			/* Take part in the barriers of pingpong() */
+			for (message_size = MIN_SIZE; message_size <= MAX_SIZE; message_size *= 2)
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+		}
+
+		starpu_mpi_shutdown();
+	}
+
+	if (rank == 0)
+	{
+		FPRINTF(stdout, "# size\tMB/s\tMB/s in fragments\n");
+		for (message_size = MIN_SIZE, s = 0; message_size <= MAX_SIZE; message_size *= 2, s++)
+			FPRINTF(stdout, "%lu\t%.1f\t%.1f\n", (unsigned long) message_size, bandwidths[0][s], bandwidths[1][s]);
+	}
+
+	MPI_Finalize();
+	return result;
+}
+#endif
@@ -149,6 +149,18 @@ int _starpu_barrier_counter_increment(struct _starpu_barrier_counter *barrier_c,
 	return 0;
 }
 
+int _starpu_barrier_counter_increment_n(struct _starpu_barrier_counter *barrier_c, unsigned n, double flops)
+{
+	struct _starpu_barrier *barrier = &barrier_c->barrier;
+	STARPU_PTHREAD_MUTEX_LOCK(&barrier->mutex);
+
+	barrier->reached_start += n;
+	barrier->reached_flops += flops;
+	STARPU_PTHREAD_COND_BROADCAST(&barrier_c->cond2);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&barrier->mutex);
+	return 0;
+}
+
 int _starpu_barrier_counter_check(struct _starpu_barrier_counter *barrier_c)
 {
 	struct _starpu_barrier *barrier = &barrier_c->barrier;
@@ -23,6 +23,23 @@
  * This is because we drop nodes lazily: when a job terminates, we just add the
  * node to the dropped list (to avoid having to take the mutex on the whole
  * graph).  The graph gets updated whenever the graph mutex becomes available.
+ *
+ * The depths and numbers of descendants of the nodes are maintained
+ * incrementally when dependencies are added, by propagating the change up to
+ * the ancestors, and stopping as soon as an ancestor is not modified.
+ *
+ * For depths, a new dependency at the bottom of the graph usually increases
+ * the depth of all its ancestors, so the propagation is given a budget, beyond
+ * which we just mark the depths as outdated, and stop maintaining them until
+ * _starpu_graph_compute_depths recomputes them all in O(|V|+|E|).
+ *
+ * For descendants, each node keeps the _STARPU_GRAPH_SKETCH smallest hashes of
+ * its descendants (a bottom-k sketch). The number of descendants is exact as
+ * long as there are less than _STARPU_GRAPH_SKETCH of them, and estimated from
+ * the largest kept hash beyond that.  A new descendant only modifies the
+ * sketch of an ancestor if its hash is among the smallest ones, whose
+ * probability decreases with the number of descendants, so the expected
+ * propagation is logarithmic in the number of ancestors.
  */
 
 #include <starpu.h>
@@ -43,6 +60,17 @@ static struct _starpu_graph_node_multilist_bottom bottom;
 /* This list contains all nodes */
 static struct _starpu_graph_node_multilist_all all;
 
+/* Number of nodes created so far, used to compute their hash */
+static uint32_t nodes_id;
+
+/* Whether depths need to be recomputed */
+static int depths_outdated;
+/* Maximum number of nodes visited when propagating a depth change */
+#define DEPTH_BUDGET 64
+/* Stack of nodes to be updated when propagating changes to ancestors */
+static struct _starpu_graph_node **stack;
+static unsigned alloc_stack;
+
 /* Protects the dropped list, always taken before graph lock */
 static starpu_pthread_mutex_t dropped_lock;
 /* This list contains all dropped nodes, i.e. the job terminated by the corresponding node is still int he graph */
@@ -131,6 +159,17 @@ static void __starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph
 		func(data, node);
 }
 
+/* Murmur3 finalizer, to spread the node identifiers over the hash space */
+static uint32_t graph_hash(uint32_t id)
+{
+	id ^= id >> 16;
+	id *= 0x85ebca6bU;
+	id ^= id >> 13;
+	id *= 0xc2b2ae35U;
+	id ^= id >> 16;
+	return id;
+}
+
 /* Add a node to the graph */
 void _starpu_graph_add_job(struct _starpu_job *job)
 {
@@ -142,6 +181,8 @@ void _starpu_graph_add_job(struct _starpu_job *job)
 
 	_starpu_graph_wrlock();
 
+	node->hash = graph_hash(nodes_id++);
+
 	/* It does not have any dependency yet, add to all lists */
 	_starpu_graph_node_multilist_push_back_top(&top, node);
 	_starpu_graph_node_multilist_push_back_bottom(&bottom, node);
@@ -171,6 +212,107 @@ static unsigned add_node(struct _starpu_graph_node *node, struct _starpu_graph_n
 	return ret;
 }
 
+/* Propagate the depth of node to its ancestors */
+static void propagate_depth(struct _starpu_graph_node *node)
+{
+	unsigned n_stack = 0, visited = 0, i;
+
+	add_node(node, &stack, &n_stack, &alloc_stack, NULL);
+	while (n_stack)
+	{
+		node = stack[--n_stack];
+		for (i = 0; i < node->n_incoming; i++)
+		{
+			struct _starpu_graph_node *prev = node->incoming[i];
+			if (!prev || prev->depth >= node->depth + 1)
+				continue;
+			if (++visited > DEPTH_BUDGET)
+			{
+				/* Too expensive, let _starpu_graph_compute_depths do it */
+				depths_outdated = 1;
+				return;
+			}
+			prev->depth = node->depth + 1;
+			add_node(prev, &stack, &n_stack, &alloc_stack, NULL);
+		}
+	}
+}
+
+/* Merge the hash of node and its sketch into the sketch of prev, return whether it changed */
+static int merge_sketch(struct _starpu_graph_node *prev, struct _starpu_graph_node *node)
+{
+	uint32_t from[_STARPU_GRAPH_SKETCH+1], merged[_STARPU_GRAPH_SKETCH];
+	unsigned n_from = 0, n = 0, i = 0, j = 0;
+	int changed = 0;
+
+	/* Fast path: nothing from node can enter the full sketch of prev */
+	if (prev->sketch_n == _STARPU_GRAPH_SKETCH)
+	{
+		uint32_t max = prev->sketch[_STARPU_GRAPH_SKETCH-1];
+		if (node->hash >= max && (!node->sketch_n || node->sketch[0] >= max))
+			return 0;
+	}
+
+	/* Descendants of prev brought by node: node itself and its descendants */
+	for (j = 0; j < node->sketch_n && node->sketch[j] < node->hash; j++)
+		from[n_from++] = node->sketch[j];
+	from[n_from++] = node->hash;
+	for (; j < node->sketch_n; j++)
+		if (node->sketch[j] != node->hash)
+			from[n_from++] = node->sketch[j];
+
+	/* Merge with the sketch of prev, keeping the smallest distinct hashes */
+	j = 0;
+	while (n < _STARPU_GRAPH_SKETCH && (i < prev->sketch_n || j < n_from))
+	{
+		if (j == n_from || (i < prev->sketch_n && prev->sketch[i] < from[j]))
+			merged[n++] = prev->sketch[i++];
+		else if (i < prev->sketch_n && prev->sketch[i] == from[j])
+		{
+			merged[n++] = prev->sketch[i++];
+			j++;
+		}
+		else
+		{
+			merged[n++] = from[j++];
+			changed = 1;
+		}
+	}
+
+	if (changed)
+	{
+		memcpy(prev->sketch, merged, n * sizeof(*merged));
+		prev->sketch_n = n;
+		if (n < _STARPU_GRAPH_SKETCH)
+			prev->descendants = n;
+		else
+		{
+			/* The k-th smallest of d uniform hashes is about k/d of the range */
+			double estimate = (_STARPU_GRAPH_SKETCH - 1) * 4294967296. / ((double) merged[n-1] + 1.);
+			prev->descendants = estimate < UINT_MAX ? (unsigned) estimate : UINT_MAX;
+		}
+	}
+	return changed;
+}
+
+/* Propagate the descendants of node to its ancestors */
+static void propagate_descendants(struct _starpu_graph_node *node)
+{
+	unsigned n_stack = 0, i;
+
+	add_node(node, &stack, &n_stack, &alloc_stack, NULL);
+	while (n_stack)
+	{
+		node = stack[--n_stack];
+		for (i = 0; i < node->n_incoming; i++)
+		{
+			struct _starpu_graph_node *prev = node->incoming[i];
+			if (prev && merge_sketch(prev, node))
+				add_node(prev, &stack, &n_stack, &alloc_stack, NULL);
+		}
+	}
+}
+
 /* Add a dependency between nodes */
 void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev_job)
 {
@@ -199,6 +341,15 @@ void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev
 	prev_node->outgoing_slot[rank_outgoing] = rank_incoming;
 	node->incoming_slot[rank_incoming] = rank_outgoing;
 
+	/* Update the ancestors */
+	if (!depths_outdated && prev_node->depth < node->depth + 1)
+	{
+		prev_node->depth = node->depth + 1;
+		propagate_depth(prev_node);
+	}
+	if (merge_sketch(prev_node, node))
+		propagate_descendants(prev_node);
+
 	_starpu_graph_wrunlock();
 }
 
@@ -208,6 +359,9 @@ void _starpu_graph_drop_node(struct _starpu_graph_node *node)
 	unsigned i;
 	STARPU_ASSERT(!node->job);
 
+	/* The job has completed, so the node is not a descendant of any live
+	 * node, and their depths and descendants do not need to be updated */
+
 	if (_starpu_graph_node_multilist_queued_bottom(node))
 		_starpu_graph_node_multilist_erase_bottom(&bottom, node);
 	if (_starpu_graph_node_multilist_queued_top(node))
@@ -353,6 +507,13 @@ void _starpu_graph_compute_depths(void)
 
 	_starpu_graph_wrlock();
 
+	if (!depths_outdated)
+	{
+		/* Incremental updates kept them up to date */
+		_starpu_graph_wrunlock();
+		return;
+	}
+
 	/* The bottom of the graph has depth 0 */
 	for (node = _starpu_graph_node_multilist_begin_bottom(&bottom);
 	     node != _starpu_graph_node_multilist_end_bottom(&bottom);
@@ -360,87 +521,11 @@ void _starpu_graph_compute_depths(void)
 		node->depth = 0;
 
 	_starpu_graph_compute_bottom_up(compute_depth, NULL);
+	depths_outdated = 0;
 
 	_starpu_graph_wrunlock();
 }
 
-void _starpu_graph_compute_descendants(void)
-{
-	struct _starpu_graph_node *node, *node2, *node3;
-	struct _starpu_graph_node **current_set = NULL, **next_set = NULL, **swap_set;
-	unsigned current_n, next_n, i, j;
-	unsigned current_alloc = 0, next_alloc = 0, swap_alloc;
-
-	_starpu_graph_wrlock();
-
-	/* Yes, this is O(|V|.(|V|+|E|)) */
-
-	/* We could get O(|V|.|E|) by doing a topological sort first.
-	 *
-	 * |E| is usually O(|V|), though (bounded number of data dependencies,
-	 * and we use synchronization tasks) */
-
-	for (node = _starpu_graph_node_multilist_begin_all(&all);
-	     node != _starpu_graph_node_multilist_end_all(&all);
-	     node = _starpu_graph_node_multilist_next_all(node))
-	{
-		unsigned descendants;
-
-		/* Mark all nodes as unseen */
-		for (node2 = _starpu_graph_node_multilist_begin_all(&all);
-		     node2 != _starpu_graph_node_multilist_end_all(&all);
-		     node2 = _starpu_graph_node_multilist_next_all(node2))
-			node2->graph_n = 0;
-
-		/* Start with the node we want to compute the number of descendants of */
-		current_n = 0;
-		add_node(node, &current_set, &current_n, &current_alloc, NULL);
-		node->graph_n = 1;
-
-		descendants = 0;
-		/* While we have descendants, count their descendants */
-		while (current_n)
-		{
-			/* Next set is initially empty */
-			next_n = 0;
-
-			/* For each node in the current set */
-			for (i = 0; i < current_n; i++)
-			{
-				node2 = current_set[i];
-				/* For each child of this node2 */
-				for (j = 0; j < node2->n_outgoing; j++)
-				{
-					node3 = node2->outgoing[j];
-					if (!node3)
-						continue;
-					if (node3->graph_n)
-						/* Already seen */
-						continue;
-					/* Add this node */
-					node3->graph_n = 1;
-					descendants++;
-					add_node(node3, &next_set, &next_n, &next_alloc, NULL);
-				}
-			}
-			/* Swap next set with current set */
-			swap_set = next_set;
-			swap_alloc = next_alloc;
-			next_set = current_set;
-			next_alloc = current_alloc;
-			current_set = swap_set;
-			current_alloc = swap_alloc;
-			current_n = next_n;
-		}
-		node->descendants = descendants;
-	}
-
-	_starpu_graph_wrunlock();
-
-	free(current_set);
-	free(next_set);
-}
-
 void _starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph_node *node), void *data)
 {
 	_starpu_graph_wrlock();
@@ -24,6 +24,9 @@
 
 /** @file */
 
+/** Number of hashes kept to estimate the number of descendants of a node */
+#define _STARPU_GRAPH_SKETCH 32
+
 MULTILIST_CREATE_TYPE(_starpu_graph_node, all)
 MULTILIST_CREATE_TYPE(_starpu_graph_node, top)
 MULTILIST_CREATE_TYPE(_starpu_graph_node, bottom)
@@ -71,14 +74,23 @@ struct _starpu_graph_node
 	unsigned alloc_outgoing;
 
 	/** Rank from bottom, in number of jobs
-	 * Only available if _starpu_graph_compute_depths was called
+	 * Maintained incrementally as long as it is cheap, guaranteed to be
+	 * up to date only after _starpu_graph_compute_depths was called
 	 */
 	unsigned depth;
 	/** Number of children, grand-children, etc.
-	 * Only available if _starpu_graph_compute_descendants was called
+	 * Maintained incrementally, exact up to _STARPU_GRAPH_SKETCH
+	 * descendants, estimated from \p sketch beyond that.
 	 */
 	unsigned descendants;
 
+	/** Hash of the node, used to estimate the number of descendants */
+	uint32_t hash;
+	/** Number of hashes in \p sketch */
+	unsigned sketch_n;
+	/** Smallest hashes of the descendants, in increasing order */
+	uint32_t sketch[_STARPU_GRAPH_SKETCH];
+
 	/** Variable available for graph flow */
 	int graph_n;
 };
@@ -111,12 +123,12 @@ void _starpu_graph_drop_dropped_nodes(void);
  * This make StarPU compute for each task the depth, i.e. the length
  * of the longest path to a task without outgoing dependencies.
  * This does not take job duration into account, just the number
+ * of dependencies.
+ * Depths are maintained incrementally when adding dependencies, this only
+ * walks the graph if that became too expensive since the previous call.
 */
 void _starpu_graph_compute_depths(void);
 
-/** Compute the descendants of jobs in the graph */
-void _starpu_graph_compute_descendants(void);
-
 /**
  * This calls \e func for each node of the task graph, passing also \e
  * data as it
@@ -0,0 +1,257 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <common/objpool.h>
+
+/* Free objects are chained through their first word, and batches of free
+ * objects in the depot are chained through the second word of their first
+ * object */
+#define OBJ_NEXT(obj) (((void **) (obj))[0])
+#define BATCH_NEXT(obj) (((void **) (obj))[1])
+
+#define OBJPOOL_BATCH 64
+
+struct _starpu_objpool_local
+{
+	struct _starpu_objpool *pool;
+	/** Chain of free objects */
+	void *head;
+	unsigned n;
+	unsigned long hits;
+	unsigned long misses;
+	struct _starpu_objpool_local *prev;
+	struct _starpu_objpool_local *next;
+};
+
+static void free_obj(struct _starpu_objpool *pool, void *obj)
+{
+	if (pool->destruct)
+		pool->destruct(obj);
+	free(obj);
+}
+
+static void free_chain(struct _starpu_objpool *pool, void *obj)
+{
+	while (obj)
+	{
+		void *next = OBJ_NEXT(obj);
+		free_obj(pool, obj);
+		obj = next;
+	}
+}
+
+/* Called with pool->lock held */
+static void release_local(struct _starpu_objpool_local *local)
+{
+	struct _starpu_objpool *pool = local->pool;
+
+	if (local->prev)
+		local->prev->next = local->next;
+	else
+		pool->locals = local->next;
+	if (local->next)
+		local->next->prev = local->prev;
+
+	pool->hits += local->hits;
+	pool->misses += local->misses;
+	free_chain(pool, local->head);
+	free(local);
+}
+
+/* Called on thread termination */
+static void local_destructor(void *arg)
+{
+	struct _starpu_objpool_local *local = arg;
+	struct _starpu_objpool *pool = local->pool;
+
+	_starpu_spin_lock(&pool->lock);
+	release_local(local);
+	_starpu_spin_unlock(&pool->lock);
+}
+
+static struct _starpu_objpool_local *get_local(struct _starpu_objpool *pool)
+{
+	struct _starpu_objpool_local *local = STARPU_PTHREAD_GETSPECIFIC(pool->key);
+
+	if (STARPU_LIKELY(local))
+		return local;
+
+	_STARPU_CALLOC(local, 1, sizeof(*local));
+	local->pool = pool;
+
+	_starpu_spin_lock(&pool->lock);
+	local->next = pool->locals;
+	if (local->next)
+		local->next->prev = local;
+	pool->locals = local;
+	_starpu_spin_unlock(&pool->lock);
+
+	STARPU_PTHREAD_SETSPECIFIC(pool->key, local);
+	return local;
+}
+
+void _starpu_objpool_init(struct _starpu_objpool *pool, unsigned max_objects)
+{
+	STARPU_ASSERT(pool->size >= 2 * sizeof(void *));
+
+	pool->batch = OBJPOOL_BATCH;
+	pool->max_batches = (max_objects + OBJPOOL_BATCH - 1) / OBJPOOL_BATCH;
+	pool->depot = NULL;
+	pool->ndepot = 0;
+	pool->locals = NULL;
+	pool->hits = 0;
+	pool->misses = 0;
+	_starpu_spin_init(&pool->lock);
+	STARPU_PTHREAD_KEY_CREATE(&pool->key, local_destructor);
+	pool->enabled = max_objects > 0;
+}
+
+void _starpu_objpool_deinit(struct _starpu_objpool *pool)
+{
+	/* From now on, objects go straight back to the heap */
+	pool->enabled = 0;
+
+	_starpu_spin_lock(&pool->lock);
+	while (pool->locals)
+		release_local(pool->locals);
+	while (pool->depot)
+	{
+		void *batch = pool->depot;
+		pool->depot = BATCH_NEXT(batch);
+		free_chain(pool, batch);
+	}
+	pool->ndepot = 0;
+	_starpu_spin_unlock(&pool->lock);
+
+	STARPU_PTHREAD_SETSPECIFIC(pool->key, NULL);
+	STARPU_PTHREAD_KEY_DELETE(pool->key);
+	_starpu_spin_destroy(&pool->lock);
+}
+
+void *_starpu_objpool_alloc(struct _starpu_objpool *pool)
+{
+	void *obj;
+
+	if (STARPU_LIKELY(pool->enabled))
+	{
+		struct _starpu_objpool_local *local = get_local(pool);
+
+		if (STARPU_UNLIKELY(!local->n))
+		{
+			/* Refill from the depot */
+			_starpu_spin_lock(&pool->lock);
+			if (pool->depot)
+			{
+				local->head = pool->depot;
+				pool->depot = BATCH_NEXT(local->head);
+				pool->ndepot--;
+				local->n = pool->batch;
+			}
+			_starpu_spin_unlock(&pool->lock);
+		}
+
+		if (STARPU_LIKELY(local->n))
+		{
+			obj = local->head;
+			local->head = OBJ_NEXT(obj);
+			local->n--;
+			local->hits++;
+			return obj;
+		}
+		local->misses++;
+	}
+
+	_STARPU_MALLOC(obj, pool->size);
+	if (pool->construct)
+		pool->construct(obj);
+	return obj;
+}
+
+void _starpu_objpool_free(struct _starpu_objpool *pool, void *obj)
+{
+	if (STARPU_UNLIKELY(!pool->enabled))
+	{
+		free_obj(pool, obj);
+		return;
+	}
+
+	struct _starpu_objpool_local *local = get_local(pool);
+
+	OBJ_NEXT(obj) = local->head;
+	local->head = obj;
+	local->n++;
+
+	if (STARPU_UNLIKELY(local->n >= 2 * pool->batch))
+	{
+		/* Too many objects here, pass a batch to the depot */
+		void *batch = local->head;
+		void *last = batch;
+		unsigned i;
+
+		for (i = 1; i < pool->batch; i++)
+			last = OBJ_NEXT(last);
+		local->head = OBJ_NEXT(last);
+		OBJ_NEXT(last) = NULL;
+		local->n -= pool->batch;
+
+		_starpu_spin_lock(&pool->lock);
+		if (pool->ndepot < pool->max_batches)
+		{
+			BATCH_NEXT(batch) = pool->depot;
+			pool->depot = batch;
+			pool->ndepot++;
+			batch = NULL;
+		}
+		_starpu_spin_unlock(&pool->lock);
+
+		/* The depot is full, give back to the heap */
+		free_chain(pool, batch);
+	}
+}
+
+void _starpu_objpool_get_stats(struct _starpu_objpool *pool, unsigned long *hits, unsigned long *misses)
+{
+	struct _starpu_objpool_local *local;
+
+	_starpu_spin_lock(&pool->lock);
+	*hits = pool->hits;
+	*misses = pool->misses;
+	for (local = pool->locals; local; local = local->next)
+	{
+		/* Only statistics, we do not care about races */
+		STARPU_HG_DISABLE_CHECKING(local->hits);
+		STARPU_HG_DISABLE_CHECKING(local->misses);
+		*hits += local->hits;
+		*misses += local->misses;
+	}
+	_starpu_spin_unlock(&pool->lock);
+}
+
+void _starpu_objpool_display_stats(struct _starpu_objpool *pool, FILE *stream)
+{
+	unsigned long hits, misses;
+
+	_starpu_objpool_get_stats(pool, &hits, &misses);
+	if (!hits && !misses)
+		return;
+
+	fprintf(stream, "%s pool\n", pool->name);
+	fprintf(stream, "\thit : %lu (%2.2f %%)\n", hits, (100.0f*hits)/(hits+misses));
+	fprintf(stream, "\tmiss : %lu (%2.2f %%)\n", misses, (100.0f*misses)/(hits+misses));
+}
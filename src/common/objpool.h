@@ -0,0 +1,102 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __OBJPOOL_H__
+#define __OBJPOOL_H__
+
+/** @file */
+
+#include <stdio.h>
+#include <common/config.h>
+#include <common/thread.h>
+#include <common/starpu_spinlock.h>
+
+#pragma GCC visibility push(hidden)
+
+/**
+ * Recycling pool of fixed-size objects.
+ *
+ * Each thread keeps a small cache of free objects, so that allocating and
+ * releasing objects in steady state does not touch the heap nor any shared
+ * cacheline. When a thread cache overflows (typically on workers which
+ * destroy tasks), a batch of objects is moved to a global depot, from which
+ * threads with an empty cache (typically the submitting thread) refill
+ * themselves a batch at a time.
+ *
+ * Objects are plain malloc()ed blocks of the same size, so objects allocated
+ * before _starpu_objpool_init() or released after _starpu_objpool_deinit()
+ * are simply taken from or given back to the heap.
+ *
+ * The optional construct and destruct callbacks are called when an object is
+ * taken from and given back to the heap respectively, so that costly parts
+ * of the objects (e.g. mutexes) are set up only once, and kept while they are
+ * recycled. The first two words of the objects are used for chaining free
+ * objects, and are thus not preserved.
+ */
+
+struct _starpu_objpool_local;
+
+struct _starpu_objpool
+{
+	const char *name;
+	/** Size of the objects */
+	size_t size;
+	/** Called on objects freshly allocated from the heap */
+	void (*construct)(void *obj);
+	/** Called on objects before giving them back to the heap */
+	void (*destruct)(void *obj);
+	/** Number of objects moved at a time between thread caches and the depot */
+	unsigned batch;
+	/** Maximum number of batches kept in the depot */
+	unsigned max_batches;
+	/** Whether the pool is active, objects go to the heap otherwise */
+	int enabled;
+	starpu_pthread_key_t key;
+
+	/** Protects the fields below */
+	struct _starpu_spinlock lock;
+	/** Stack of batches of free objects */
+	void *depot;
+	unsigned ndepot;
+	/** List of thread caches */
+	struct _starpu_objpool_local *locals;
+	/** Statistics from the thread caches which are gone */
+	unsigned long hits;
+	unsigned long misses;
+};
+
+/** Static initializer, so that objects can be allocated before
+ * _starpu_objpool_init() is called */
+#define _STARPU_OBJPOOL_INITIALIZER(_name, _size) { .name = (_name), .size = (_size) }
+/** Same, with construct and destruct callbacks */
+#define _STARPU_OBJPOOL_INITIALIZER_CTOR(_name, _size, _construct, _destruct) \
+	{ .name = (_name), .size = (_size), .construct = (_construct), .destruct = (_destruct) }
+
+/** Start recycling objects, keeping up to max_objects objects aside */
+void _starpu_objpool_init(struct _starpu_objpool *pool, unsigned max_objects);
+void _starpu_objpool_deinit(struct _starpu_objpool *pool);
+
+/** Get an object, uninitialized except for what construct sets up */
+void *_starpu_objpool_alloc(struct _starpu_objpool *pool);
+/** Give back an object */
+void _starpu_objpool_free(struct _starpu_objpool *pool, void *obj);
+
+void _starpu_objpool_get_stats(struct _starpu_objpool *pool, unsigned long *hits, unsigned long *misses);
+void _starpu_objpool_display_stats(struct _starpu_objpool *pool, FILE *stream);
+
+#pragma GCC visibility pop
+
+#endif // __OBJPOOL_H__
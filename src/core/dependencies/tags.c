@@ -37,8 +37,31 @@ struct _starpu_tag_table
 #define HASH_ADD_UINT64_T(head,field,add) HASH_ADD(hh,head,field,sizeof(uint64_t),add)
 #define HASH_FIND_UINT64_T(head,find,out) HASH_FIND(hh,head,find,sizeof(uint64_t),out)
 
-static struct _starpu_tag_table *tag_htbl = NULL;
-static starpu_pthread_rwlock_t tag_global_rwlock;
+/* Tags are spread over several hash tables, each with its own lock, so that
+ * threads declaring or notifying different tags do not contend */
+#define STARPU_TAG_NSHARDS_LOG2 6
+#define STARPU_TAG_NSHARDS (1U << STARPU_TAG_NSHARDS_LOG2)
+
+struct _starpu_tag_shard
+{
+	starpu_pthread_rwlock_t rwlock;
+	struct _starpu_tag_table *htbl;
+	/* Avoid false sharing between the shard locks */
+	char padding[STARPU_CACHELINE_SIZE];
+};
+
+static struct _starpu_tag_shard tag_shards[STARPU_TAG_NSHARDS];
+
+/* Serializes starpu_tag_wait_array, which keeps several tags locked at the
+ * same time */
+static starpu_pthread_mutex_t tag_wait_mutex;
+
+static struct _starpu_tag_shard *get_tag_shard(starpu_tag_t id)
+{
+	/* Tags are often consecutive integers, mix the bits (Fibonacci hashing) */
+	uint64_t hash = (uint64_t) id * 0x9E3779B97F4A7C15ULL;
+	return &tag_shards[hash >> (64 - STARPU_TAG_NSHARDS_LOG2)];
+}
 
 static struct _starpu_cg *create_cg_apps(unsigned ntags)
 {
@@ -146,12 +169,18 @@ static void _starpu_tag_free(void *_tag)
 }
 
 /*
- * Staticly initializing tag_global_rwlock seems to lead to weird errors
+ * Staticly initializing the rwlocks seems to lead to weird errors
  * on Darwin, so we do it dynamically.
  */
 void _starpu_init_tags(void)
 {
-	STARPU_PTHREAD_RWLOCK_INIT(&tag_global_rwlock, NULL);
+	unsigned i;
+	for (i = 0; i < STARPU_TAG_NSHARDS; i++)
+	{
+		STARPU_PTHREAD_RWLOCK_INIT(&tag_shards[i].rwlock, NULL);
+		tag_shards[i].htbl = NULL;
+	}
+	STARPU_PTHREAD_MUTEX_INIT(&tag_wait_mutex, NULL);
 }
 
 void starpu_tag_remove(starpu_tag_t id)
@@ -160,12 +189,13 @@ void starpu_tag_remove(starpu_tag_t id)
 
 	STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
 	STARPU_AYU_REMOVETASK(id + STARPU_AYUDAME_OFFSET);
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
+	struct _starpu_tag_shard *shard = get_tag_shard(id);
+	STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
 
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
-	if (entry) HASH_DEL(tag_htbl, entry);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	if (entry) HASH_DEL(shard->htbl, entry);
 
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 
 	if (entry)
 	{
@@ -176,33 +206,49 @@ void starpu_tag_remove(starpu_tag_t id)
 
 void _starpu_tag_clear(void)
 {
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-
-	/* XXX: _starpu_tag_free takes the tag spinlocks while we are keeping
-	 * the global rwlock. This contradicts the lock order of
-	 * starpu_tag_wait_array. Should not be a problem in practice since
-	 * _starpu_tag_clear is called at shutdown only. */
-	struct _starpu_tag_table *entry=NULL, *tmp=NULL;
+	unsigned i;
 
-	HASH_ITER(hh, tag_htbl, entry, tmp)
+	for (i = 0; i < STARPU_TAG_NSHARDS; i++)
 	{
-		HASH_DEL(tag_htbl, entry);
-		_starpu_tag_free(entry->tag);
-		free(entry);
+		struct _starpu_tag_shard *shard = &tag_shards[i];
+		struct _starpu_tag_table *entry=NULL, *tmp=NULL;
+
+		/* XXX: _starpu_tag_free takes the tag spinlocks while we are
+		 * keeping the shard rwlock. This contradicts the lock order of
+		 * starpu_tag_wait_array. Should not be a problem in practice
+		 * since _starpu_tag_clear is called at shutdown only. */
+		STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
+		HASH_ITER(hh, shard->htbl, entry, tmp)
+		{
+			HASH_DEL(shard->htbl, entry);
+			_starpu_tag_free(entry->tag);
+			free(entry);
+		}
+		STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
+		STARPU_PTHREAD_RWLOCK_DESTROY(&shard->rwlock);
 	}
-
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_MUTEX_DESTROY(&tag_wait_mutex);
 }
 
-static struct _starpu_tag *_gettag_struct(starpu_tag_t id)
+static struct _starpu_tag *gettag_struct(starpu_tag_t id)
 {
-	/* search if the tag is already declared or not */
+	struct _starpu_tag_shard *shard = get_tag_shard(id);
 	struct _starpu_tag_table *entry;
 	struct _starpu_tag *tag;
 
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
+	/* search if the tag is already declared or not, which is the common
+	 * case, so only take the read lock */
+	STARPU_PTHREAD_RWLOCK_RDLOCK(&shard->rwlock);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
+	if (entry != NULL)
+		return entry->tag;
+
+	STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
+	/* somebody may have created it in the meanwhile */
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
 	if (entry != NULL)
-	     tag = entry->tag;
+		tag = entry->tag;
 	else
 	{
 		/* the tag does not exist yet : create an entry */
@@ -213,24 +259,16 @@ static struct _starpu_tag *_gettag_struct(starpu_tag_t id)
 		entry2->id = id;
 		entry2->tag = tag;
 
-		HASH_ADD_UINT64_T(tag_htbl, id, entry2);
+		HASH_ADD_UINT64_T(shard->htbl, id, entry2);
 
 		STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
 		STARPU_AYU_ADDTASK(id + STARPU_AYUDAME_OFFSET, NULL);
 	}
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 
 	return tag;
 }
 
-static struct _starpu_tag *gettag_struct(starpu_tag_t id)
-{
-	struct _starpu_tag *tag;
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-	tag = _gettag_struct(id);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
-	return tag;
-}
-
 /* lock should be taken, and this releases it */
 void _starpu_tag_set_ready(struct _starpu_tag *tag)
 {
@@ -464,11 +502,11 @@ int starpu_tag_wait_array(unsigned ntags, starpu_tag_t *id)
 	STARPU_ASSERT_MSG(_starpu_worker_may_perform_blocking_calls(), "starpu_tag_wait must not be called from a task or callback");
 
 	starpu_do_schedule();
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_MUTEX_LOCK(&tag_wait_mutex);
 	/* only wait the tags that are not done yet */
 	for (i = 0, current = 0; i < ntags; i++)
 	{
-		struct _starpu_tag *tag = _gettag_struct(id[i]);
+		struct _starpu_tag *tag = gettag_struct(id[i]);
 
 		_starpu_spin_lock(&tag->lock);
 
@@ -483,7 +521,7 @@ int starpu_tag_wait_array(unsigned ntags, starpu_tag_t *id)
 			current++;
 		}
 	}
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tag_wait_mutex);
 
 	if (current == 0)
 	{
@@ -527,9 +565,10 @@ struct starpu_task *starpu_tag_get_task(starpu_tag_t id)
 	struct _starpu_tag_table *entry;
 	struct _starpu_tag *tag;
 
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	struct _starpu_tag_shard *shard = get_tag_shard(id);
+	STARPU_PTHREAD_RWLOCK_RDLOCK(&shard->rwlock);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 
 	if (!entry)
 		return NULL;
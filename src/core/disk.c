@@ -501,6 +501,19 @@ void _starpu_swap_init(void)
 	{
 		ops = &starpu_disk_unistd_ops;
 	}
+	else if (!strcmp(backend, "unistd_slab"))
+	{
+		ops = &starpu_disk_unistd_slab_ops;
+	}
+	else if (!strcmp(backend, "unistd_uring"))
+	{
+#ifdef STARPU_HAVE_IO_URING
+		ops = &starpu_disk_unistd_uring_ops;
+#else
+		_STARPU_DISP("Warning: io_uring support is not compiled in, could not enable disk swap");
+		return;
+#endif
+	}
 	else if (!strcmp(backend, "unistd_o_direct"))
 	{
 #ifdef STARPU_LINUX_SYS
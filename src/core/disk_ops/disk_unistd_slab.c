@@ -0,0 +1,531 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <core/disk.h>
+#include <core/perfmodel/perfmodel.h>
+#include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <datawizard/memory_manager.h>
+
+/* ------------------- use UNISTD to write in a few big files -------------------  */
+
+/*
+ * Instead of creating one file per allocation, data are stored in a few big
+ * files, in which extents are allocated. Free extents are kept in lists by
+ * size class (power of two number of blocks), and are coalesced with their
+ * free neighbours when released. The actual I/O is performed by the unistd
+ * backend, at the extent offset.
+ */
+
+/* Allocation granularity within the files */
+#define SLAB_BLOCK_SIZE 4096
+/* Default size of the files */
+#define SLAB_FILE_SIZE (1024ULL*1024*1024)
+#define SLAB_NCLASSES (sizeof(size_t)*8)
+
+struct starpu_unistd_slab_extent;
+
+struct starpu_unistd_slab_file
+{
+	int descriptor;
+	char *path;
+	size_t size;
+	/* All extents of the file, in offset order */
+	struct starpu_unistd_slab_extent *extents;
+	struct starpu_unistd_slab_file *prev;
+	struct starpu_unistd_slab_file *next;
+};
+
+struct starpu_unistd_slab_extent
+{
+	struct starpu_unistd_slab_file *file;
+	off_t offset;
+	size_t size;
+	int free;
+	/* Neighbours within the file */
+	struct starpu_unistd_slab_extent *prev;
+	struct starpu_unistd_slab_extent *next;
+	/* Neighbours within the free list of the size class */
+	struct starpu_unistd_slab_extent *free_prev;
+	struct starpu_unistd_slab_extent *free_next;
+};
+
+struct starpu_unistd_slab_base
+{
+	/* Base of the underlying unistd backend */
+	void *unistd_base;
+	char *path;
+	size_t file_size;
+	starpu_pthread_mutex_t mutex;
+	struct starpu_unistd_slab_file *files;
+	unsigned nfiles;
+	struct starpu_unistd_slab_extent *free_lists[SLAB_NCLASSES];
+};
+
+struct starpu_unistd_slab_obj
+{
+	/* Must be first, the unistd backend functions get a pointer to it */
+	struct starpu_unistd_global_obj obj;
+	/* NULL for objects opened with starpu_disk_open */
+	struct starpu_unistd_slab_extent *extent;
+};
+
+static unsigned size_class(size_t size)
+{
+	size_t nblocks = size / SLAB_BLOCK_SIZE;
+	unsigned class = 0;
+
+	while (nblocks >>= 1)
+		class++;
+	return class;
+}
+
+static void free_list_add(struct starpu_unistd_slab_base *base, struct starpu_unistd_slab_extent *extent)
+{
+	struct starpu_unistd_slab_extent **head = &base->free_lists[size_class(extent->size)];
+
+	extent->free = 1;
+	extent->free_prev = NULL;
+	extent->free_next = *head;
+	if (*head)
+		(*head)->free_prev = extent;
+	*head = extent;
+}
+
+static void free_list_remove(struct starpu_unistd_slab_base *base, struct starpu_unistd_slab_extent *extent)
+{
+	if (extent->free_prev)
+		extent->free_prev->free_next = extent->free_next;
+	else
+		base->free_lists[size_class(extent->size)] = extent->free_next;
+	if (extent->free_next)
+		extent->free_next->free_prev = extent->free_prev;
+	extent->free = 0;
+}
+
+/* Find a free extent of at least size bytes, and remove it from its free list */
+static struct starpu_unistd_slab_extent *find_free_extent(struct starpu_unistd_slab_base *base, size_t size)
+{
+	unsigned class = size_class(size);
+	struct starpu_unistd_slab_extent *extent;
+
+	/* In the first class, extents may be too small */
+	for (extent = base->free_lists[class]; extent; extent = extent->free_next)
+		if (extent->size >= size)
+			break;
+
+	/* In the next classes, they are all big enough */
+	while (!extent && ++class < SLAB_NCLASSES)
+		extent = base->free_lists[class];
+
+	if (extent)
+		free_list_remove(base, extent);
+	return extent;
+}
+
+/* Create a new file, made of one free extent, which is returned */
+static struct starpu_unistd_slab_extent *add_file(struct starpu_unistd_slab_base *base, size_t size)
+{
+	struct starpu_unistd_slab_file *file;
+	struct starpu_unistd_slab_extent *extent;
+	int fd;
+	char *path = _starpu_mktemp(base->path, O_RDWR | O_BINARY, &fd);
+
+	if (!path)
+		return NULL;
+
+	if (_starpu_ftruncate(fd, size) < 0)
+	{
+		_STARPU_DISP("Could not truncate file, ftruncate failed with error '%s'\n", strerror(errno));
+		close(fd);
+		unlink(path);
+		free(path);
+		return NULL;
+	}
+
+	_STARPU_MALLOC(file, sizeof(*file));
+	file->descriptor = fd;
+	file->path = path;
+	file->size = size;
+	file->prev = NULL;
+	file->next = base->files;
+	if (base->files)
+		base->files->prev = file;
+	base->files = file;
+	base->nfiles++;
+
+	_STARPU_CALLOC(extent, 1, sizeof(*extent));
+	extent->file = file;
+	extent->offset = 0;
+	extent->size = size;
+	file->extents = extent;
+
+	return extent;
+}
+
+static void remove_file(struct starpu_unistd_slab_base *base, struct starpu_unistd_slab_file *file)
+{
+	struct starpu_unistd_slab_extent *extent, *next;
+
+	for (extent = file->extents; extent; extent = next)
+	{
+		next = extent->next;
+		if (extent->free)
+			free_list_remove(base, extent);
+		free(extent);
+	}
+
+	if (file->prev)
+		file->prev->next = file->next;
+	else
+		base->files = file->next;
+	if (file->next)
+		file->next->prev = file->prev;
+	base->nfiles--;
+
+	close(file->descriptor);
+	unlink(file->path);
+	free(file->path);
+	free(file);
+}
+
+static struct starpu_unistd_slab_extent *extent_alloc(struct starpu_unistd_slab_base *base, size_t size)
+{
+	struct starpu_unistd_slab_extent *extent;
+
+	size = (size + SLAB_BLOCK_SIZE - 1) & ~((size_t) SLAB_BLOCK_SIZE - 1);
+	if (!size)
+		size = SLAB_BLOCK_SIZE;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	extent = find_free_extent(base, size);
+	if (!extent)
+		extent = add_file(base, STARPU_MAX(base->file_size, size));
+	if (!extent)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+		return NULL;
+	}
+
+	if (extent->size > size)
+	{
+		/* Split, and put the remainder back in the free lists */
+		struct starpu_unistd_slab_extent *rest;
+		_STARPU_CALLOC(rest, 1, sizeof(*rest));
+		rest->file = extent->file;
+		rest->offset = extent->offset + size;
+		rest->size = extent->size - size;
+		rest->prev = extent;
+		rest->next = extent->next;
+		if (rest->next)
+			rest->next->prev = rest;
+		extent->next = rest;
+		extent->size = size;
+		free_list_add(base, rest);
+	}
+	extent->free = 0;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+
+	return extent;
+}
+
+static void extent_free(struct starpu_unistd_slab_base *base, struct starpu_unistd_slab_extent *extent)
+{
+	struct starpu_unistd_slab_extent *neighbour;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+
+	/* Coalesce with the free neighbours */
+	neighbour = extent->next;
+	if (neighbour && neighbour->free)
+	{
+		free_list_remove(base, neighbour);
+		extent->size += neighbour->size;
+		extent->next = neighbour->next;
+		if (extent->next)
+			extent->next->prev = extent;
+		free(neighbour);
+	}
+	neighbour = extent->prev;
+	if (neighbour && neighbour->free)
+	{
+		free_list_remove(base, neighbour);
+		neighbour->size += extent->size;
+		neighbour->next = extent->next;
+		if (neighbour->next)
+			neighbour->next->prev = neighbour;
+		free(extent);
+		extent = neighbour;
+	}
+
+	free_list_add(base, extent);
+
+	/* Give back the space of files which became empty, but keep one */
+	if (!extent->prev && !extent->next && base->nfiles > 1)
+		remove_file(base, extent->file);
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+static off_t slab_offset(struct starpu_unistd_slab_obj *obj)
+{
+	return obj->extent ? obj->extent->offset : 0;
+}
+
+/* allocation memory on disk */
+static void *starpu_unistd_slab_alloc(void *base, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_extent *extent = extent_alloc(slab_base, size);
+	struct starpu_unistd_slab_obj *obj;
+
+	if (!extent)
+		return NULL;
+
+	_STARPU_CALLOC(obj, 1, sizeof(*obj));
+	obj->extent = extent;
+	obj->obj.descriptor = extent->file->descriptor;
+	obj->obj.path = extent->file->path;
+	obj->obj.size = size;
+	obj->obj.flags = O_RDWR | O_BINARY;
+	STARPU_PTHREAD_MUTEX_INIT(&obj->obj.mutex, NULL);
+
+	return obj;
+}
+
+/* free memory on disk */
+static void starpu_unistd_slab_free(void *base, void *_obj, size_t size STARPU_ATTRIBUTE_UNUSED)
+{
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	extent_free(base, obj->extent);
+	STARPU_PTHREAD_MUTEX_DESTROY(&obj->obj.mutex);
+	free(obj);
+}
+
+/* open an existing memory on disk, it is kept in its own file */
+static void *starpu_unistd_slab_open(void *base, void *pos, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj;
+
+	_STARPU_CALLOC(obj, 1, sizeof(*obj));
+	obj->obj.flags = O_RDWR | O_BINARY;
+	return starpu_unistd_global_open(&obj->obj, slab_base->unistd_base, pos, size);
+}
+
+/* free memory without delete it */
+static void starpu_unistd_slab_close(void *base, void *_obj, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	STARPU_ASSERT_MSG(!obj->extent, "only data opened with starpu_disk_open can be closed");
+	starpu_unistd_global_close(slab_base->unistd_base, &obj->obj, size);
+}
+
+static int starpu_unistd_slab_read(void *base, void *_obj, void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	return starpu_unistd_global_read(slab_base->unistd_base, &obj->obj, buf, slab_offset(obj) + offset, size);
+}
+
+static int starpu_unistd_slab_write(void *base, void *_obj, const void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	return starpu_unistd_global_write(slab_base->unistd_base, &obj->obj, buf, slab_offset(obj) + offset, size);
+}
+
+static int starpu_unistd_slab_full_read(void *base, void *_obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	if (!obj->extent)
+		return starpu_unistd_global_full_read(slab_base->unistd_base, &obj->obj, ptr, size, dst_node);
+
+	*size = obj->obj.size;
+	/* Allocated aligned buffer */
+	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+	return starpu_unistd_slab_read(base, obj, *ptr, 0, *size);
+}
+
+/* Make room for size bytes in obj, for a full write */
+static void slab_resize(struct starpu_unistd_slab_base *base, struct starpu_unistd_slab_obj *obj, size_t size)
+{
+	if (size > obj->extent->size)
+	{
+		/* The content will be completely overwritten, just move to a
+		 * bigger extent */
+		struct starpu_unistd_slab_extent *extent = extent_alloc(base, size);
+		STARPU_ASSERT_MSG(extent, "could not allocate %lu bytes on disk", (unsigned long) size);
+		extent_free(base, obj->extent);
+		obj->extent = extent;
+		obj->obj.descriptor = extent->file->descriptor;
+		obj->obj.path = extent->file->path;
+	}
+	obj->obj.size = size;
+}
+
+static int starpu_unistd_slab_full_write(void *base, void *_obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	if (!obj->extent)
+		return starpu_unistd_global_full_write(slab_base->unistd_base, &obj->obj, ptr, size);
+
+	slab_resize(slab_base, obj, size);
+	return starpu_unistd_slab_write(base, obj, ptr, 0, size);
+}
+
+#ifdef HAVE_AIO_H
+static void *starpu_unistd_slab_async_read(void *base, void *_obj, void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	return starpu_unistd_global_async_read(slab_base->unistd_base, &obj->obj, buf, slab_offset(obj) + offset, size);
+}
+
+static void *starpu_unistd_slab_async_write(void *base, void *_obj, void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	return starpu_unistd_global_async_write(slab_base->unistd_base, &obj->obj, buf, slab_offset(obj) + offset, size);
+}
+
+static void *starpu_unistd_slab_async_full_read(void *base, void *_obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	if (!obj->extent)
+		return starpu_unistd_global_async_full_read(slab_base->unistd_base, &obj->obj, ptr, size, dst_node);
+
+	*size = obj->obj.size;
+	/* Allocated aligned buffer */
+	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+	return starpu_unistd_slab_async_read(base, obj, *ptr, 0, *size);
+}
+
+static void *starpu_unistd_slab_async_full_write(void *base, void *_obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+	struct starpu_unistd_slab_obj *obj = _obj;
+
+	if (!obj->extent)
+		return starpu_unistd_global_async_full_write(slab_base->unistd_base, &obj->obj, ptr, size);
+
+	slab_resize(slab_base, obj, size);
+	return starpu_unistd_slab_async_write(base, obj, ptr, 0, size);
+}
+#endif
+
+#ifdef STARPU_UNISTD_USE_COPY
+static void *starpu_unistd_slab_copy(void *base_src, void *_obj_src, off_t offset_src, void *base_dst, void *_obj_dst, off_t offset_dst, size_t size)
+{
+	struct starpu_unistd_slab_base *slab_base_src = base_src;
+	struct starpu_unistd_slab_base *slab_base_dst = base_dst;
+	struct starpu_unistd_slab_obj *obj_src = _obj_src;
+	struct starpu_unistd_slab_obj *obj_dst = _obj_dst;
+
+	return starpu_unistd_global_copy(slab_base_src->unistd_base, &obj_src->obj, slab_offset(obj_src) + offset_src,
+					 slab_base_dst->unistd_base, &obj_dst->obj, slab_offset(obj_dst) + offset_dst, size);
+}
+#endif
+
+static void *starpu_unistd_slab_plug(void *parameter, starpu_ssize_t size)
+{
+	struct starpu_unistd_slab_base *base;
+
+	_STARPU_CALLOC(base, 1, sizeof(*base));
+	base->unistd_base = starpu_unistd_global_plug(parameter, size);
+	base->path = strdup((char *) parameter);
+	STARPU_ASSERT(base->path);
+	base->file_size = SLAB_FILE_SIZE;
+	if (size > 0 && (size_t) size < base->file_size)
+		/* No need for bigger files than the disk */
+		base->file_size = (size + SLAB_BLOCK_SIZE - 1) & ~((size_t) SLAB_BLOCK_SIZE - 1);
+	STARPU_PTHREAD_MUTEX_INIT(&base->mutex, NULL);
+
+	return base;
+}
+
+static void starpu_unistd_slab_unplug(void *_base)
+{
+	struct starpu_unistd_slab_base *base = _base;
+
+	while (base->files)
+		remove_file(base, base->files);
+	STARPU_PTHREAD_MUTEX_DESTROY(&base->mutex);
+
+	starpu_unistd_global_unplug(base->unistd_base);
+	free(base->path);
+	free(base);
+}
+
+static int starpu_unistd_slab_bandwidth(unsigned node, void *base)
+{
+	struct starpu_unistd_slab_base *slab_base = base;
+
+	/* This allocates and accesses data through our methods */
+	return _starpu_get_unistd_global_bandwidth_between_disk_and_main_ram(node, slab_base->unistd_base);
+}
+
+struct starpu_disk_ops starpu_disk_unistd_slab_ops =
+{
+	.alloc = starpu_unistd_slab_alloc,
+	.free = starpu_unistd_slab_free,
+	.open = starpu_unistd_slab_open,
+	.close = starpu_unistd_slab_close,
+	.read = starpu_unistd_slab_read,
+	.write = starpu_unistd_slab_write,
+	.plug = starpu_unistd_slab_plug,
+	.unplug = starpu_unistd_slab_unplug,
+#ifdef STARPU_UNISTD_USE_COPY
+	.copy = starpu_unistd_slab_copy,
+#else
+	.copy = NULL,
+#endif
+	.bandwidth = starpu_unistd_slab_bandwidth,
+#ifdef HAVE_AIO_H
+	.async_read = starpu_unistd_slab_async_read,
+	.async_write = starpu_unistd_slab_async_write,
+	.async_full_read = starpu_unistd_slab_async_full_read,
+	.async_full_write = starpu_unistd_slab_async_full_write,
+	.wait_request = starpu_unistd_global_wait_request,
+	.test_request = starpu_unistd_global_test_request,
+	.free_request = starpu_unistd_global_free_request,
+#endif
+	.full_read = starpu_unistd_slab_full_read,
+	.full_write = starpu_unistd_slab_full_write
+};
@@ -0,0 +1,578 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <core/disk.h>
+#include <core/perfmodel/perfmodel.h>
+#include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <datawizard/malloc.h>
+
+/* ------------------- use UNISTD with io_uring to write on disk -------------------  */
+
+/*
+ * Files are managed like with the unistd backend, but asynchronous reads and
+ * writes are queued in an io_uring ring per disk instead of going through
+ * POSIX AIO. Requests are only handed to the kernel when the queue gets long
+ * enough or when a request is tested or waited for, so that the requests
+ * issued by a data request progression pass get submitted with a single
+ * system call. Completions are reaped by whichever thread tests a request.
+ *
+ * If the kernel does not support io_uring, asynchronous requests are refused,
+ * and StarPU falls back to synchronous I/O.
+ */
+
+/* Number of submission entries of the ring */
+#define URING_ENTRIES 64
+/* Number of queued requests which triggers a submission */
+#define URING_BATCH 16
+
+struct starpu_unistd_uring_base
+{
+	/* The underlying unistd base */
+	void *unistd_base;
+	/* -1 if io_uring is not available */
+	int ring_fd;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned sq_mask;
+	unsigned sq_entries;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	unsigned cq_entries;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	/* Protects the rings and the counters below */
+	starpu_pthread_mutex_t mutex;
+	/* Number of requests queued but not submitted yet */
+	unsigned to_submit;
+	/* Number of requests submitted and not completed yet */
+	unsigned inflight;
+};
+
+enum starpu_unistd_uring_type { STARPU_UNISTD_URING_RW, STARPU_UNISTD_URING_COPY };
+
+struct starpu_unistd_uring_request
+{
+	enum starpu_unistd_uring_type type;
+	struct starpu_unistd_uring_base *base;
+	struct starpu_unistd_global_obj *obj;
+	/* The descriptor used for the request, may have been reopened */
+	int fd;
+	size_t len;
+	struct iovec iov;
+	/* Set by the thread which reaps the completion */
+	volatile int finished;
+	int res;
+	/* Event of the unistd backend, for copies */
+	void *copy_event;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+#ifdef __NR_io_uring_setup
+	return syscall(__NR_io_uring_setup, entries, p);
+#else
+	(void) entries;
+	(void) p;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+#ifdef __NR_io_uring_enter
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+#else
+	(void) fd;
+	(void) to_submit;
+	(void) min_complete;
+	(void) flags;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static void uring_init(struct starpu_unistd_uring_base *base)
+{
+	struct io_uring_params p;
+	int fd;
+
+	memset(&p, 0, sizeof(p));
+	base->ring_fd = -1;
+	fd = uring_setup(URING_ENTRIES, &p);
+	if (fd < 0)
+	{
+		_STARPU_DISP("Warning: io_uring is not available (%s), the unistd_uring disk backend will use synchronous I/O\n", strerror(errno));
+		return;
+	}
+
+	base->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	base->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (base->cq_ring_size > base->sq_ring_size)
+			base->sq_ring_size = base->cq_ring_size;
+		base->cq_ring_size = 0;
+	}
+#endif
+
+	base->sq_ring = mmap(NULL, base->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	STARPU_ASSERT_MSG(base->sq_ring != MAP_FAILED, "mapping the io_uring submission ring failed: %s", strerror(errno));
+	if (base->cq_ring_size)
+	{
+		base->cq_ring = mmap(NULL, base->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		STARPU_ASSERT_MSG(base->cq_ring != MAP_FAILED, "mapping the io_uring completion ring failed: %s", strerror(errno));
+	}
+	else
+		base->cq_ring = base->sq_ring;
+	base->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	base->sqes = mmap(NULL, base->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	STARPU_ASSERT_MSG(base->sqes != MAP_FAILED, "mapping the io_uring submission entries failed: %s", strerror(errno));
+
+	base->sq_head = (unsigned *) ((char *) base->sq_ring + p.sq_off.head);
+	base->sq_tail = (unsigned *) ((char *) base->sq_ring + p.sq_off.tail);
+	base->sq_mask = *(unsigned *) ((char *) base->sq_ring + p.sq_off.ring_mask);
+	base->sq_entries = p.sq_entries;
+	base->sq_array = (unsigned *) ((char *) base->sq_ring + p.sq_off.array);
+
+	base->cq_head = (unsigned *) ((char *) base->cq_ring + p.cq_off.head);
+	base->cq_tail = (unsigned *) ((char *) base->cq_ring + p.cq_off.tail);
+	base->cq_mask = *(unsigned *) ((char *) base->cq_ring + p.cq_off.ring_mask);
+	base->cq_entries = p.cq_entries;
+	base->cqes = (struct io_uring_cqe *) ((char *) base->cq_ring + p.cq_off.cqes);
+
+	base->to_submit = 0;
+	base->inflight = 0;
+	base->ring_fd = fd;
+}
+
+static void uring_deinit(struct starpu_unistd_uring_base *base)
+{
+	if (base->ring_fd < 0)
+		return;
+
+	STARPU_ASSERT_MSG(base->to_submit == 0 && base->inflight == 0, "io_uring requests are still pending");
+	munmap(base->sqes, base->sqes_size);
+	if (base->cq_ring != base->sq_ring)
+		munmap(base->cq_ring, base->cq_ring_size);
+	munmap(base->sq_ring, base->sq_ring_size);
+	close(base->ring_fd);
+}
+
+/* Hand the queued requests to the kernel, and wait for min_complete
+ * completions. Must be called with the base mutex held */
+static void uring_flush(struct starpu_unistd_uring_base *base, unsigned min_complete)
+{
+	int ret;
+
+	if (!base->to_submit && !min_complete)
+		return;
+
+	ret = uring_enter(base->ring_fd, base->to_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+	if (ret < 0)
+	{
+		/* We will try again on next test */
+		STARPU_ASSERT_MSG(errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter failed: %s", strerror(errno));
+		return;
+	}
+	base->to_submit -= ret;
+	base->inflight += ret;
+}
+
+/* Mark the completed requests as finished. Must be called with the base
+ * mutex held */
+static void uring_reap(struct starpu_unistd_uring_base *base)
+{
+	unsigned head = *base->cq_head;
+	unsigned tail = *(volatile unsigned *) base->cq_tail;
+
+	if (head == tail)
+		return;
+
+	STARPU_RMB();
+	while (head != tail)
+	{
+		struct io_uring_cqe *cqe = &base->cqes[head & base->cq_mask];
+		struct starpu_unistd_uring_request *req = (void *) (uintptr_t) cqe->user_data;
+
+		req->res = cqe->res;
+		STARPU_WMB();
+		req->finished = 1;
+		base->inflight--;
+		head++;
+	}
+	/* Make sure we are done reading the entries before the kernel reuses them */
+	STARPU_SYNCHRONIZE();
+	*(volatile unsigned *) base->cq_head = head;
+}
+
+/* Queue a request, returns 0 if the ring is full */
+static int uring_queue(struct starpu_unistd_uring_base *base, struct starpu_unistd_uring_request *req, uint8_t opcode, void *buf, off_t offset)
+{
+	unsigned tail, idx;
+	struct io_uring_sqe *sqe;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+
+	/* Do not let the completion ring overflow */
+	if (base->inflight + base->to_submit >= base->cq_entries
+	 || *(volatile unsigned *) base->sq_tail - *(volatile unsigned *) base->sq_head >= base->sq_entries)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+		return 0;
+	}
+
+	tail = *base->sq_tail;
+	idx = tail & base->sq_mask;
+	sqe = &base->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = req->fd;
+	/* Vectored operations are supported by all io_uring versions */
+	req->iov.iov_base = buf;
+	req->iov.iov_len = req->len;
+	sqe->addr = (uintptr_t) &req->iov;
+	sqe->len = 1;
+	sqe->off = offset;
+	sqe->user_data = (uintptr_t) req;
+	base->sq_array[idx] = idx;
+
+	/* Publish the entry before the tail */
+	STARPU_WMB();
+	*(volatile unsigned *) base->sq_tail = tail + 1;
+	base->to_submit++;
+
+	if (base->to_submit >= URING_BATCH)
+		uring_flush(base, 0);
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+	return 1;
+}
+
+static void uring_check_request(struct starpu_unistd_uring_request *req)
+{
+	STARPU_RMB();
+	STARPU_ASSERT_MSG(req->res == (int) req->len, "io_uring op got %d instead of %lu bytes (%s)", req->res, (unsigned long) req->len, req->res < 0 ? strerror(-req->res) : "short transfer");
+}
+
+static void *uring_rw(struct starpu_unistd_uring_base *base, struct starpu_unistd_global_obj *obj, uint8_t opcode, void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_uring_request *req;
+
+	/* Let StarPU fall back to synchronous I/O */
+	if (base->ring_fd < 0 || size > INT_MAX)
+		return NULL;
+
+	_STARPU_CALLOC(req, 1, sizeof(*req));
+	req->type = STARPU_UNISTD_URING_RW;
+	req->base = base;
+	req->obj = obj;
+	req->len = size;
+	req->fd = obj->descriptor;
+	if (req->fd < 0)
+	{
+		req->fd = open(obj->path, obj->flags);
+		STARPU_ASSERT_MSG(req->fd >= 0, "Reopening file %s failed: errno %d", obj->path, errno);
+	}
+
+	if (!uring_queue(base, req, opcode, buf, offset))
+	{
+		if (obj->descriptor < 0)
+			close(req->fd);
+		free(req);
+		return NULL;
+	}
+
+	return req;
+}
+
+/* allocation memory on disk */
+static void *starpu_unistd_uring_alloc(void *base, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	struct starpu_unistd_global_obj *obj;
+	_STARPU_MALLOC(obj, sizeof(struct starpu_unistd_global_obj));
+	obj->flags = O_RDWR | O_BINARY;
+	return starpu_unistd_global_alloc(obj, uring_base->unistd_base, size);
+}
+
+static void starpu_unistd_uring_free(void *base, void *obj, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	starpu_unistd_global_free(uring_base->unistd_base, obj, size);
+}
+
+/* open an existing memory on disk */
+static void *starpu_unistd_uring_open(void *base, void *pos, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	struct starpu_unistd_global_obj *obj;
+	_STARPU_MALLOC(obj, sizeof(struct starpu_unistd_global_obj));
+	obj->flags = O_RDWR | O_BINARY;
+	return starpu_unistd_global_open(obj, uring_base->unistd_base, pos, size);
+}
+
+static void starpu_unistd_uring_close(void *base, void *obj, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	starpu_unistd_global_close(uring_base->unistd_base, obj, size);
+}
+
+static int starpu_unistd_uring_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	return starpu_unistd_global_read(uring_base->unistd_base, obj, buf, offset, size);
+}
+
+static int starpu_unistd_uring_write(void *base, void *obj, const void *buf, off_t offset, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	return starpu_unistd_global_write(uring_base->unistd_base, obj, buf, offset, size);
+}
+
+static int starpu_unistd_uring_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	return starpu_unistd_global_full_read(uring_base->unistd_base, obj, ptr, size, dst_node);
+}
+
+static int starpu_unistd_uring_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+	return starpu_unistd_global_full_write(uring_base->unistd_base, obj, ptr, size);
+}
+
+static void *starpu_unistd_uring_async_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return uring_rw(base, obj, IORING_OP_READV, buf, offset, size);
+}
+
+static void *starpu_unistd_uring_async_write(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return uring_rw(base, obj, IORING_OP_WRITEV, buf, offset, size);
+}
+
+static void *starpu_unistd_uring_async_full_read(void *base, void *_obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_global_obj *obj = _obj;
+	int fd = obj->descriptor;
+	struct stat st;
+	int ret;
+
+	if (fd < 0)
+	{
+		fd = open(obj->path, obj->flags);
+		STARPU_ASSERT_MSG(fd >= 0, "Reopening file %s failed: errno %d", obj->path, errno);
+	}
+	ret = fstat(fd, &st);
+	STARPU_ASSERT(ret == 0);
+	*size = st.st_size;
+	if (obj->descriptor < 0)
+		close(fd);
+
+	/* Allocated aligned buffer */
+	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+	return starpu_unistd_uring_async_read(base, obj, *ptr, 0, *size);
+}
+
+static void *starpu_unistd_uring_async_full_write(void *base, void *_obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_global_obj *obj = _obj;
+
+	/* update file size to realise the next good full_read */
+	if (size != obj->size)
+	{
+		int fd = obj->descriptor;
+		int val;
+
+		if (fd < 0)
+		{
+			fd = open(obj->path, obj->flags);
+			STARPU_ASSERT_MSG(fd >= 0, "Reopening file %s failed: errno %d", obj->path, errno);
+		}
+		val = _starpu_ftruncate(fd, size);
+		if (obj->descriptor < 0)
+			close(fd);
+		STARPU_ASSERT(val == 0);
+		obj->size = size;
+	}
+
+	return starpu_unistd_uring_async_write(base, obj, ptr, 0, size);
+}
+
+#ifdef STARPU_UNISTD_USE_COPY
+static void *starpu_unistd_uring_copy(void *base_src, void *obj_src, off_t offset_src, void *base_dst, void *obj_dst, off_t offset_dst, size_t size)
+{
+	struct starpu_unistd_uring_base *uring_base_src = base_src;
+	struct starpu_unistd_uring_base *uring_base_dst = base_dst;
+	struct starpu_unistd_uring_request *req;
+	void *event;
+
+	/* Disk to disk copies are done by the unistd copy threads */
+	event = starpu_unistd_global_copy(uring_base_src->unistd_base, obj_src, offset_src,
+					  uring_base_dst->unistd_base, obj_dst, offset_dst, size);
+	if (!event)
+		return NULL;
+
+	_STARPU_CALLOC(req, 1, sizeof(*req));
+	req->type = STARPU_UNISTD_URING_COPY;
+	req->copy_event = event;
+	return req;
+}
+#endif
+
+static void starpu_unistd_uring_wait_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = async_channel;
+	struct starpu_unistd_uring_base *base = req->base;
+
+	if (req->type == STARPU_UNISTD_URING_COPY)
+	{
+		starpu_unistd_global_wait_request(req->copy_event);
+		return;
+	}
+
+	if (!req->finished)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+		uring_reap(base);
+		while (!req->finished)
+		{
+			/* Our request is submitted or queued, so we will get a completion */
+			uring_flush(base, 1);
+			uring_reap(base);
+		}
+		STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+	}
+	uring_check_request(req);
+}
+
+static int starpu_unistd_uring_test_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = async_channel;
+	struct starpu_unistd_uring_base *base = req->base;
+
+	if (req->type == STARPU_UNISTD_URING_COPY)
+		return starpu_unistd_global_test_request(req->copy_event);
+
+	if (!req->finished)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+		uring_flush(base, 0);
+		uring_reap(base);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+		if (!req->finished)
+			return 0;
+	}
+	uring_check_request(req);
+	return 1;
+}
+
+static void starpu_unistd_uring_free_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = async_channel;
+
+	if (req->type == STARPU_UNISTD_URING_COPY)
+		starpu_unistd_global_free_request(req->copy_event);
+	else if (req->obj->descriptor < 0)
+		close(req->fd);
+	free(req);
+}
+
+static void *starpu_unistd_uring_plug(void *parameter, starpu_ssize_t size)
+{
+	struct starpu_unistd_uring_base *base;
+
+	_STARPU_CALLOC(base, 1, sizeof(*base));
+	base->unistd_base = starpu_unistd_global_plug(parameter, size);
+	STARPU_PTHREAD_MUTEX_INIT(&base->mutex, NULL);
+	uring_init(base);
+
+	return base;
+}
+
+static void starpu_unistd_uring_unplug(void *_base)
+{
+	struct starpu_unistd_uring_base *base = _base;
+
+	uring_deinit(base);
+	STARPU_PTHREAD_MUTEX_DESTROY(&base->mutex);
+	starpu_unistd_global_unplug(base->unistd_base);
+	free(base);
+}
+
+static int starpu_unistd_uring_bandwidth(unsigned node, void *base)
+{
+	struct starpu_unistd_uring_base *uring_base = base;
+
+	/* This allocates and accesses data through our methods */
+	return _starpu_get_unistd_global_bandwidth_between_disk_and_main_ram(node, uring_base->unistd_base);
+}
+
+struct starpu_disk_ops starpu_disk_unistd_uring_ops =
+{
+	.alloc = starpu_unistd_uring_alloc,
+	.free = starpu_unistd_uring_free,
+	.open = starpu_unistd_uring_open,
+	.close = starpu_unistd_uring_close,
+	.read = starpu_unistd_uring_read,
+	.write = starpu_unistd_uring_write,
+	.plug = starpu_unistd_uring_plug,
+	.unplug = starpu_unistd_uring_unplug,
+#ifdef STARPU_UNISTD_USE_COPY
+	.copy = starpu_unistd_uring_copy,
+#else
+	.copy = NULL,
+#endif
+	.bandwidth = starpu_unistd_uring_bandwidth,
+	.async_read = starpu_unistd_uring_async_read,
+	.async_write = starpu_unistd_uring_async_write,
+	.async_full_read = starpu_unistd_uring_async_full_read,
+	.async_full_write = starpu_unistd_uring_async_full_write,
+	.wait_request = starpu_unistd_uring_wait_request,
+	.test_request = starpu_unistd_uring_test_request,
+	.free_request = starpu_unistd_uring_free_request,
+	.full_read = starpu_unistd_uring_full_read,
+	.full_write = starpu_unistd_uring_full_write
+};
@@ -24,6 +24,7 @@
 #include <common/config.h>
 #include <common/utils.h>
 #include <common/graph.h>
+#include <common/objpool.h>
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
@@ -36,6 +37,25 @@ static int task_progress;
 static unsigned long njobs_finished;
 static unsigned long njobs, maxnjobs;
 
+/* The synchronization structures are initialized only once per job
+ * structure, and kept while the structure is recycled */
+static void job_construct(void *obj)
+{
+	struct _starpu_job *job = obj;
+	STARPU_PTHREAD_MUTEX_INIT(&job->sync_mutex, NULL);
+	STARPU_PTHREAD_COND_INIT(&job->sync_cond, NULL);
+}
+
+static void job_destruct(void *obj)
+{
+	struct _starpu_job *job = obj;
+	STARPU_PTHREAD_COND_DESTROY(&job->sync_cond);
+	STARPU_PTHREAD_MUTEX_DESTROY(&job->sync_mutex);
+}
+
+/* Recycles job structures, so that steady-state submission does not hit the heap */
+static struct _starpu_objpool job_pool = _STARPU_OBJPOOL_INITIALIZER_CTOR("Job", sizeof(struct _starpu_job), job_construct, job_destruct);
+
 #ifdef STARPU_DEBUG
 /* List of all jobs, for debugging */
 static struct _starpu_job_multilist_all_submitted all_jobs_list;
@@ -52,6 +72,19 @@ void _starpu_job_init(void)
 	_starpu_job_multilist_head_init_all_submitted(&all_jobs_list);
 #endif
 	_starpu_crash_add_hook(&_starpu_job_crash);
+	_starpu_objpool_init(&job_pool, starpu_getenv_number_default("STARPU_TASK_POOL_SIZE", 4096));
+}
+
+void _starpu_display_task_pool_stats(FILE *stream)
+{
+	if (!starpu_enable_stats())
+		return;
+
+	fprintf(stream, "\n#---------------------\n");
+	fprintf(stream, "Task pool stats:\n");
+	_starpu_task_display_pool_stats(stream);
+	_starpu_objpool_display_stats(&job_pool, stream);
+	fprintf(stream, "#---------------------\n");
 }
 
 void _starpu_job_memory_use(int check)
@@ -72,6 +105,7 @@ void _starpu_job_crash()
 void _starpu_job_fini(void)
 {
 	_starpu_job_memory_use(1);
+	_starpu_objpool_deinit(&job_pool);
 }
 
 void _starpu_exclude_task_from_dag(struct starpu_task *task)
@@ -89,8 +123,11 @@ struct _starpu_job* STARPU_ATTRIBUTE_MALLOC _starpu_job_create(struct starpu_tas
 	_STARPU_LOG_IN();
 
 	/* As most of the fields must be initialized at NULL, let's put 0
-	 * everywhere */
-	_STARPU_CALLOC(job, 1, sizeof(*job));
+	 * everywhere, except in the synchronization structures which are
+	 * already initialized */
+	job = _starpu_objpool_alloc(&job_pool);
+	memset(job, 0, offsetof(struct _starpu_job, sync_mutex));
+	memset(&job->sync_cond + 1, 0, sizeof(*job) - offsetof(struct _starpu_job, sync_cond) - sizeof(job->sync_cond));
 
 	if (task->dyn_handles)
 	{
@@ -123,9 +160,6 @@ struct _starpu_job* STARPU_ATTRIBUTE_MALLOC _starpu_job_create(struct starpu_tas
 
 	_starpu_cg_list_init0(&job->job_successors);
 
-	STARPU_PTHREAD_MUTEX_INIT0(&job->sync_mutex, NULL);
-	STARPU_PTHREAD_COND_INIT0(&job->sync_cond, NULL);
-
 	/* By default we have sequential tasks */
 	job->task_size = 1;
 
@@ -181,8 +215,6 @@ void _starpu_job_destroy(struct _starpu_job *j)
 	 * probably our waker) */
 	STARPU_PTHREAD_MUTEX_LOCK(&j->sync_mutex);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&j->sync_mutex);
-	STARPU_PTHREAD_COND_DESTROY(&j->sync_cond);
-	STARPU_PTHREAD_MUTEX_DESTROY(&j->sync_mutex);
 
 	if (j->task_size > 1)
 	{
@@ -209,7 +241,7 @@ void _starpu_job_destroy(struct _starpu_job *j)
 	if (max_memory_use)
 		(void) STARPU_ATOMIC_ADDL(&njobs, -1);
 
-	free(j);
+	_starpu_objpool_free(&job_pool, j);
 }
 
 int _starpu_job_finished(struct _starpu_job *j)
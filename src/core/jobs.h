@@ -85,7 +85,9 @@ struct _starpu_job
 	struct _starpu_job *quick_next;
 
 	/** These synchronization structures are used to wait for the job to be
-	 * available or terminated for instance. */
+	 * available or terminated for instance. They are initialized once when
+	 * the job structure is allocated from the heap, and kept across
+	 * recycling, so they must stay contiguous, see _starpu_job_create. */
 	starpu_pthread_mutex_t sync_mutex;
 	starpu_pthread_cond_t sync_cond;
 
@@ -223,6 +225,9 @@ MULTILIST_CREATE_INLINES(struct _starpu_job, _starpu_job, all_submitted)
 void _starpu_job_init(void);
 void _starpu_job_fini(void);
 
+/** Display the hit ratio of the recycling pools of task and job structures */
+void _starpu_display_task_pool_stats(FILE *stream);
+
 /** Create an internal struct _starpu_job *structure to encapsulate the task. */
 struct _starpu_job* _starpu_job_create(struct starpu_task *task) STARPU_ATTRIBUTE_MALLOC;
 
@@ -37,6 +37,7 @@
 #include <core/topology.h>
 #include <common/utils.h>
 #include <drivers/mpi/driver_mpi_common.h>
+#include <drivers/tcpip/driver_tcpip_common.h>
 #include <datawizard/memory_nodes.h>
 
 #ifdef STARPU_USE_OPENCL
@@ -99,6 +100,7 @@ static unsigned ncuda = 0;
 static unsigned nopencl = 0;
 #ifndef STARPU_SIMGRID
 static unsigned nmpi_ms = 0;
+static unsigned ntcpip_ms = 0;
 
 /* Benchmarking the performance of the bus */
 
@@ -139,6 +141,11 @@ static struct dev_timing opencldev_timing_per_numa[STARPU_MAXOPENCLDEVS*STARPU_M
 static double mpi_time_device_to_device[STARPU_MAXMPIDEVS][STARPU_MAXMPIDEVS] = {{0.0}};
 static double mpi_latency_device_to_device[STARPU_MAXMPIDEVS][STARPU_MAXMPIDEVS] = {{0.0}};
 #endif
+
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+static double tcpip_time_device_to_device[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1] = {{0.0}};
+static double tcpip_latency_device_to_device[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1] = {{0.0}};
+#endif
 #endif
 
 #ifdef STARPU_HAVE_HWLOC
@@ -846,6 +853,11 @@ static void benchmark_all_memory_nodes(void)
 	_starpu_mpi_common_measure_bandwidth_latency(mpi_time_device_to_device, mpi_latency_device_to_device);
 #endif /* STARPU_USE_MPI_MASTER_SLAVE */
 
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	if (_starpu_tcpip_common_is_mp_initialized())
+		_starpu_tcpip_common_measure_bandwidth_latency(tcpip_time_device_to_device, tcpip_latency_device_to_device);
+#endif /* STARPU_USE_TCPIP_MASTER_SLAVE */
+
 #ifdef STARPU_HAVE_HWLOC
 	hwloc_set_cpubind(hwtopology, former_cpuset, HWLOC_CPUBIND_THREAD);
 	hwloc_bitmap_free(former_cpuset);
@@ -1056,6 +1068,11 @@ static void generate_bus_affinity_file(void)
 	if (!_starpu_mpi_common_is_src_node())
 		return;
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* Slaves don't write files */
+	if (!_starpu_tcpip_common_is_src_node())
+		return;
+#endif
 
 	write_bus_affinity_file_content();
 }
@@ -1361,6 +1378,9 @@ static void write_bus_latency_file_content(void)
 #endif
 #ifdef STARPU_USE_MPI_MASTER_SLAVE
 	maxnode += nmpi_ms;
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	maxnode += ntcpip_ms;
 #endif
 	for (src = 0; src < STARPU_MAXNODES; src++)
 	{
@@ -1454,6 +1474,28 @@ static void write_bus_latency_file_content(void)
 						latency += mpi_latency_device_to_device[mpi_master][mpi_dst];
 				}
 				b_low += nmpi_ms;
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+				b_up += ntcpip_ms;
+				/* Same as MPI Master-Slave */
+				int tcpip_master = _starpu_tcpip_common_get_src_node();
+
+				int tcpip_src = src - b_low;
+				tcpip_src = (tcpip_master <= tcpip_src) ? tcpip_src+1 : tcpip_src;
+
+				int tcpip_dst = dst - b_low;
+				tcpip_dst = (tcpip_master <= tcpip_dst) ? tcpip_dst+1 : tcpip_dst;
+
+				if (src >= b_low && src < b_up && dst >= b_low && dst < b_up)
+					latency += tcpip_latency_device_to_device[tcpip_src][tcpip_dst];
+				else
+				{
+					if (src >= b_low && src < b_up)
+						latency += tcpip_latency_device_to_device[tcpip_src][tcpip_master];
+					if (dst >= b_low && dst < b_up)
+						latency += tcpip_latency_device_to_device[tcpip_master][tcpip_dst];
+				}
+				b_low += ntcpip_ms;
 #endif
 			}
 
@@ -1481,6 +1523,11 @@ static void generate_bus_latency_file(void)
 	if (!_starpu_mpi_common_is_src_node())
 		return;
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* Slaves don't write files */
+	if (!_starpu_tcpip_common_is_src_node())
+		return;
+#endif
 
 #ifndef STARPU_SIMGRID
 	write_bus_latency_file_content();
@@ -1705,6 +1752,9 @@ static void write_bus_bandwidth_file_content(void)
 #endif
 #ifdef STARPU_USE_MPI_MASTER_SLAVE
 	maxnode += nmpi_ms;
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	maxnode += ntcpip_ms;
 #endif
 	for (src = 0; src < STARPU_MAXNODES; src++)
 	{
@@ -1795,6 +1845,29 @@ static void write_bus_bandwidth_file_content(void)
 				}
 
 				b_low += nmpi_ms;
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+				b_up += ntcpip_ms;
+				/* Same as MPI Master-Slave */
+				int tcpip_master = _starpu_tcpip_common_get_src_node();
+
+				int tcpip_src = src - b_low;
+				tcpip_src = (tcpip_master <= tcpip_src) ? tcpip_src+1 : tcpip_src;
+
+				int tcpip_dst = dst - b_low;
+				tcpip_dst = (tcpip_master <= tcpip_dst) ? tcpip_dst+1 : tcpip_dst;
+
+				if (src >= b_low && src < b_up && dst >= b_low && dst < b_up)
+					slowness += tcpip_time_device_to_device[tcpip_src][tcpip_dst];
+				else
+				{
+					if (src >= b_low && src < b_up)
+						slowness += tcpip_time_device_to_device[tcpip_src][tcpip_master];
+					if (dst >= b_low && dst < b_up)
+						slowness += tcpip_time_device_to_device[tcpip_master][tcpip_dst];
+				}
+
+				b_low += ntcpip_ms;
 #endif
 				bandwidth = 1.0/slowness;
 			}
@@ -1928,6 +2001,11 @@ static void generate_bus_bandwidth_file(void)
 	if (!_starpu_mpi_common_is_src_node())
 		return;
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* Slaves don't write files */
+	if (!_starpu_tcpip_common_is_src_node())
+		return;
+#endif
 
 #ifndef STARPU_SIMGRID
 	write_bus_bandwidth_file_content();
@@ -1981,6 +2059,30 @@ static int mpi_check_recalibrate(int my_recalibrate)
 }
 #endif
 
+#if defined(STARPU_USE_TCPIP_MASTER_SLAVE)
+/* check if the master or one slave has to recalibrate */
+static int tcpip_check_recalibrate(int my_recalibrate)
+{
+	int nb_tcpip = _starpu_tcpip_src_get_device_count() + 1;
+	int tcpip_recalibrate[nb_tcpip];
+	int i;
+
+	if (!_starpu_tcpip_common_is_mp_initialized())
+		return my_recalibrate;
+
+	_starpu_tcpip_common_allgather(&my_recalibrate, tcpip_recalibrate, sizeof(my_recalibrate));
+
+	for (i = 0; i < nb_tcpip; i++)
+	{
+		if (tcpip_recalibrate[i])
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
+
 static void compare_value_and_recalibrate(char * msg, unsigned val_file, unsigned val_detected)
 {
 	int recalibrate = 0;
@@ -1991,12 +2093,19 @@ static void compare_value_and_recalibrate(char * msg, unsigned val_file, unsigne
 	//Send to each other to know if we had to recalibrate because someone cannot have the correct value in the config file
 	recalibrate = mpi_check_recalibrate(recalibrate);
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	recalibrate = tcpip_check_recalibrate(recalibrate);
+#endif
 
 	if (recalibrate)
 	{
 #ifdef STARPU_USE_MPI_MASTER_SLAVE
 		/* Only the master prints the message */
 		if (_starpu_mpi_common_is_src_node())
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+		/* Only the master prints the message */
+		if (_starpu_tcpip_common_is_src_node())
 #endif
 			_STARPU_DISP("Current configuration does not match the bus performance model (%s: (stored) %d != (current) %d), recalibrating...\n", msg, val_file, val_detected);
 
@@ -2004,6 +2113,9 @@ static void compare_value_and_recalibrate(char * msg, unsigned val_file, unsigne
 
 #ifdef STARPU_USE_MPI_MASTER_SLAVE
 		if (_starpu_mpi_common_is_src_node())
+#endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+		if (_starpu_tcpip_common_is_src_node())
 #endif
 			_STARPU_DISP("... done\n");
 	}
@@ -2026,6 +2138,9 @@ static void check_bus_config_file(void)
 	//Send to each other to know if we had to recalibrate because someone cannot have the config file
 	recalibrate = mpi_check_recalibrate(recalibrate);
 #endif
+#if defined(STARPU_USE_TCPIP_MASTER_SLAVE)
+	recalibrate = tcpip_check_recalibrate(recalibrate);
+#endif
 
 	if (recalibrate)
 	{
@@ -2039,7 +2154,7 @@ static void check_bus_config_file(void)
 	{
 		FILE *f;
 		int ret;
-		unsigned read_cuda = -1, read_opencl = -1, read_mpi_ms = -1;
+		unsigned read_cuda = -1, read_opencl = -1, read_mpi_ms = -1, read_tcpip_ms = -1;
 		unsigned read_cpus = -1, read_numa = -1;
 		int locked;
 
@@ -2070,6 +2185,12 @@ static void check_bus_config_file(void)
 			read_mpi_ms = 0;
 		_starpu_drop_comments(f);
 
+		ret = fscanf(f, "%u\t", &read_tcpip_ms);
+		if (ret != 1)
+			/* Older files do not have it */
+			read_tcpip_ms = 0;
+		_starpu_drop_comments(f);
+
 		if (locked)
 			_starpu_frdunlock(f);
 		fclose(f);
@@ -2086,6 +2207,9 @@ static void check_bus_config_file(void)
 #ifdef STARPU_USE_MPI_MASTER_SLAVE
 		nmpi_ms = _starpu_mpi_src_get_device_count();
 #endif /* STARPU_USE_MPI_MASTER_SLAVE */
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+		ntcpip_ms = _starpu_tcpip_src_get_device_count();
+#endif /* STARPU_USE_TCPIP_MASTER_SLAVE */
 
 		// Checking if both configurations match
 		compare_value_and_recalibrate("CPUS", read_cpus, ncpus);
@@ -2093,6 +2217,7 @@ static void check_bus_config_file(void)
 		compare_value_and_recalibrate("CUDA", read_cuda, ncuda);
 		compare_value_and_recalibrate("OpenCL", read_opencl, nopencl);
 		compare_value_and_recalibrate("MPI Master-Slave", read_mpi_ms, nmpi_ms);
+		compare_value_and_recalibrate("TCP/IP Master-Slave", read_tcpip_ms, ntcpip_ms);
 	}
 }
 
@@ -2119,6 +2244,7 @@ static void write_bus_config_file_content(void)
 	fprintf(f, "%u # Number of CUDA devices\n", ncuda);
 	fprintf(f, "%u # Number of OpenCL devices\n", nopencl);
 	fprintf(f, "%u # Number of MPI devices\n", nmpi_ms);
+	fprintf(f, "%u # Number of TCP/IP devices\n", ntcpip_ms);
 
 	if (locked)
 		_starpu_fwrunlock(f);
@@ -2135,6 +2261,11 @@ static void generate_bus_config_file(void)
 	if (!_starpu_mpi_common_is_src_node())
 		return;
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* Slaves don't write files */
+	if (!_starpu_tcpip_common_is_src_node())
+		return;
+#endif
 
 	write_bus_config_file_content();
 }
@@ -3081,6 +3212,11 @@ static void generate_bus_platform_file(void)
 	if (!_starpu_mpi_common_is_src_node())
 		return;
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* Slaves don't write files */
+	if (!_starpu_tcpip_common_is_src_node())
+		return;
+#endif
 
 	write_bus_platform_file_content(3);
 	write_bus_platform_file_content(4);
@@ -3143,6 +3279,9 @@ void _starpu_load_bus_performance_files(void)
 #if defined(STARPU_USE_MPI_MASTER_SLAVE)
 	nmpi_ms = _starpu_mpi_src_get_device_count();
 #endif
+#if defined(STARPU_USE_TCPIP_MASTER_SLAVE)
+	ntcpip_ms = _starpu_tcpip_src_get_device_count();
+#endif
 
 #ifndef STARPU_SIMGRID
 	check_bus_config_file();
@@ -3152,6 +3291,11 @@ void _starpu_load_bus_performance_files(void)
 	/* be sure that master wrote the perf files */
 	_starpu_mpi_common_barrier();
 #endif
+#ifdef STARPU_USE_TCPIP_MASTER_SLAVE
+	/* be sure that master wrote the perf files */
+	if (_starpu_tcpip_common_is_mp_initialized())
+		_starpu_tcpip_common_barrier();
+#endif
 
 #ifndef STARPU_SIMGRID
 	load_bus_affinity_file();
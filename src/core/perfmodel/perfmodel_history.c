@@ -48,10 +48,21 @@
 #define STR_LONG_LENGTH 256
 #define STR_VERY_LONG_LENGTH 1024
 
+/* arch_combs is only modified with arch_combs_mutex held, but it is read
+ * without it: a new combination is published by incrementing
+ * current_arch_comb once it is completely filled, and arrays replaced when
+ * growing arch_combs are only freed at termination, in case readers are still
+ * using them */
 static struct starpu_perfmodel_arch **arch_combs;
 static int current_arch_comb;
 static int nb_arch_combs;
 static starpu_pthread_rwlock_t arch_combs_mutex = STARPU_PTHREAD_RWLOCK_INITIALIZER;
+struct _starpu_old_arch_combs
+{
+	struct starpu_perfmodel_arch **arch_combs;
+	struct _starpu_old_arch_combs *next;
+};
+static struct _starpu_old_arch_combs *old_arch_combs;
 static int historymaxerror;
 static char ignore_devid[STARPU_NARCH];
 
@@ -66,6 +77,52 @@ struct starpu_perfmodel_history_table
 	struct starpu_perfmodel_history_entry *history_entry;
 };
 
+/* Incremented (with the model rwlock held in write mode) whenever an entry is
+ * added to or removed from a history table. History entries are otherwise
+ * never freed, so as long as this does not change, a pointer to an entry
+ * looked up previously is still the answer for the same lookup. */
+static unsigned long history_generation;
+
+/* Per-thread cache of history lookups, so that predictions in steady state do
+ * not have to take the model rwlock, and thus do not write to shared
+ * cachelines */
+#define HISTORY_CACHE_SIZE 256
+
+struct _starpu_history_cache_slot
+{
+	struct _starpu_perfmodel_state *state;
+	unsigned long generation;
+	int comb;
+	unsigned nimpl;
+	uint32_t footprint;
+	struct starpu_perfmodel_history_entry *entry;
+};
+
+static starpu_pthread_key_t history_cache_key;
+static int history_cache_initialized;
+
+static void history_cache_destructor(void *cache)
+{
+	free(cache);
+}
+
+static void history_cache_init(void)
+{
+	STARPU_PTHREAD_KEY_CREATE(&history_cache_key, history_cache_destructor);
+	STARPU_HG_DISABLE_CHECKING(history_generation);
+	history_cache_initialized = 1;
+}
+
+static void history_cache_deinit(void)
+{
+	if (!history_cache_initialized)
+		return;
+	history_cache_initialized = 0;
+	free(STARPU_PTHREAD_GETSPECIFIC(history_cache_key));
+	STARPU_PTHREAD_SETSPECIFIC(history_cache_key, NULL);
+	STARPU_PTHREAD_KEY_DELETE(history_cache_key);
+}
+
 /* We want more than 10% variance on X to trust regression */
 #define VALID_REGRESSION(reg_model) \
 	((reg_model)->minx < (9*(reg_model)->maxx)/10 && (reg_model)->nsample >= _starpu_calibration_minimum)
@@ -88,6 +145,9 @@ void starpu_perfmodel_initialize(void)
 	STARPU_PTHREAD_RWLOCK_INIT(&registered_models_rwlock, NULL);
 	STARPU_PTHREAD_RWLOCK_INIT(&arch_combs_mutex, NULL);
 
+	if (!history_cache_initialized)
+		history_cache_init();
+
 	_starpu_gethostname(_starpu_perfmodel_hostname, sizeof(_starpu_perfmodel_hostname));
 }
 
@@ -162,22 +222,30 @@ void _starpu_perfmodel_malloc_per_arch_is_set(struct starpu_perfmodel *model, in
 int _starpu_perfmodel_arch_comb_get(int ndevices, struct starpu_perfmodel_device *devices)
 {
 	int comb, ncomb;
+	struct starpu_perfmodel_arch **combs;
+
+	STARPU_HG_DISABLE_CHECKING(current_arch_comb);
+	STARPU_HG_DISABLE_CHECKING(arch_combs);
 	ncomb = current_arch_comb;
+	/* Make sure we see at least the arch_combs array and content that
+	 * were written before current_arch_comb was incremented */
+	STARPU_RMB();
+	combs = arch_combs;
 	for(comb = 0; comb < ncomb; comb++)
 	{
 		int found = 0;
-		if(arch_combs[comb]->ndevices == ndevices)
+		if(combs[comb]->ndevices == ndevices)
 		{
 			int dev1, dev2;
 			int nfounded = 0;
-			for(dev1 = 0; dev1 < arch_combs[comb]->ndevices; dev1++)
+			for(dev1 = 0; dev1 < combs[comb]->ndevices; dev1++)
 			{
 				for(dev2 = 0; dev2 < ndevices; dev2++)
 				{
-					if(arch_combs[comb]->devices[dev1].type == devices[dev2].type &&
+					if(combs[comb]->devices[dev1].type == devices[dev2].type &&
 					   (ignore_devid[devices[dev2].type] ||
-					    arch_combs[comb]->devices[dev1].devid == devices[dev2].devid) &&
-					   arch_combs[comb]->devices[dev1].ncores == devices[dev2].ncores)
+					    combs[comb]->devices[dev1].devid == devices[dev2].devid) &&
+					   combs[comb]->devices[dev1].ncores == devices[dev2].ncores)
 						nfounded++;
 				}
 			}
@@ -192,11 +260,9 @@ int _starpu_perfmodel_arch_comb_get(int ndevices, struct starpu_perfmodel_device
 
 int starpu_perfmodel_arch_comb_get(int ndevices, struct starpu_perfmodel_device *devices)
 {
-	int ret;
-	STARPU_PTHREAD_RWLOCK_RDLOCK(&arch_combs_mutex);
-	ret = _starpu_perfmodel_arch_comb_get(ndevices, devices);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&arch_combs_mutex);
-	return ret;
+	/* This is called for each prediction, so we do not take
+	 * arch_combs_mutex, see the comment at its definition */
+	return _starpu_perfmodel_arch_comb_get(ndevices, devices);
 }
 
 int starpu_perfmodel_arch_comb_add(int ndevices, struct starpu_perfmodel_device* devices)
@@ -212,19 +278,37 @@ int starpu_perfmodel_arch_comb_add(int ndevices, struct starpu_perfmodel_device*
 	if (current_arch_comb >= nb_arch_combs)
 	{
 		// We need to allocate more arch_combs
+		struct starpu_perfmodel_arch **new_arch_combs;
 		nb_arch_combs = current_arch_comb+10;
-		_STARPU_REALLOC(arch_combs, nb_arch_combs*sizeof(struct starpu_perfmodel_arch*));
+		_STARPU_MALLOC(new_arch_combs, nb_arch_combs*sizeof(struct starpu_perfmodel_arch*));
+		if (current_arch_comb)
+			memcpy(new_arch_combs, arch_combs, current_arch_comb*sizeof(struct starpu_perfmodel_arch*));
+		if (arch_combs)
+		{
+			/* Readers may still be looking at it */
+			struct _starpu_old_arch_combs *old;
+			_STARPU_MALLOC(old, sizeof(*old));
+			old->arch_combs = arch_combs;
+			old->next = old_arch_combs;
+			old_arch_combs = old;
+		}
+		STARPU_WMB();
+		arch_combs = new_arch_combs;
 	}
-	_STARPU_MALLOC(arch_combs[current_arch_comb], sizeof(struct starpu_perfmodel_arch));
-	_STARPU_MALLOC(arch_combs[current_arch_comb]->devices, ndevices*sizeof(struct starpu_perfmodel_device));
-	arch_combs[current_arch_comb]->ndevices = ndevices;
+	struct starpu_perfmodel_arch *arch;
+	_STARPU_MALLOC(arch, sizeof(struct starpu_perfmodel_arch));
+	_STARPU_MALLOC(arch->devices, ndevices*sizeof(struct starpu_perfmodel_device));
+	arch->ndevices = ndevices;
 	int dev;
 	for(dev = 0; dev < ndevices; dev++)
 	{
-		arch_combs[current_arch_comb]->devices[dev].type = devices[dev].type;
-		arch_combs[current_arch_comb]->devices[dev].devid = devices[dev].devid;
-		arch_combs[current_arch_comb]->devices[dev].ncores = devices[dev].ncores;
+		arch->devices[dev].type = devices[dev].type;
+		arch->devices[dev].devid = devices[dev].devid;
+		arch->devices[dev].ncores = devices[dev].ncores;
 	}
+	arch_combs[current_arch_comb] = arch;
+	/* Publish the new combination only once it is complete */
+	STARPU_WMB();
 	comb = current_arch_comb++;
 	STARPU_PTHREAD_RWLOCK_UNLOCK(&arch_combs_mutex);
 	return comb;
@@ -242,7 +326,18 @@ void _starpu_free_arch_combs(void)
 	current_arch_comb = 0;
 	free(arch_combs);
 	arch_combs = NULL;
+	nb_arch_combs = 0;
+	while (old_arch_combs)
+	{
+		struct _starpu_old_arch_combs *old = old_arch_combs;
+		old_arch_combs = old->next;
+		free(old->arch_combs);
+		free(old);
+	}
 	STARPU_PTHREAD_RWLOCK_UNLOCK(&arch_combs_mutex);
+
+	/* This is the termination counterpart of starpu_perfmodel_initialize */
+	history_cache_deinit();
 	STARPU_PTHREAD_RWLOCK_DESTROY(&arch_combs_mutex);
 	STARPU_PTHREAD_RWLOCK_INIT(&arch_combs_mutex, NULL);
 }
@@ -317,6 +412,60 @@ static void insert_history_entry(struct starpu_perfmodel_history_entry *entry, s
 	table->footprint = entry->footprint;
 	table->history_entry = entry;
 	HASH_ADD_UINT32_T(*history_ptr, footprint, table);
+
+	/* Invalidate lookups cached by threads */
+	(void) STARPU_ATOMIC_ADDL(&history_generation, 1);
+}
+
+/* Look up the history entry for footprint in the comb/nimpl table of model */
+static struct starpu_perfmodel_history_entry *history_lookup(struct starpu_perfmodel *model, int comb, unsigned nimpl, uint32_t footprint)
+{
+	struct _starpu_perfmodel_state *state = model->state;
+	struct _starpu_history_cache_slot *cache = NULL, *slot = NULL;
+	struct starpu_perfmodel_history_entry *entry = NULL;
+	struct starpu_perfmodel_history_table *elt;
+	unsigned long generation;
+
+	if (history_cache_initialized)
+	{
+		cache = STARPU_PTHREAD_GETSPECIFIC(history_cache_key);
+		if (STARPU_UNLIKELY(!cache))
+		{
+			_STARPU_CALLOC(cache, HISTORY_CACHE_SIZE, sizeof(*cache));
+			STARPU_PTHREAD_SETSPECIFIC(history_cache_key, cache);
+		}
+
+		uintptr_t hash = footprint ^ ((uintptr_t) state >> 4) ^ (comb * STARPU_MAXIMPLEMENTATIONS + nimpl) * 0x9E3779B1U;
+		slot = &cache[(hash ^ (hash >> 16)) % HISTORY_CACHE_SIZE];
+
+		generation = history_generation;
+		/* Make sure the entry we may return is not older than generation */
+		STARPU_RMB();
+		if (slot->state == state && slot->generation == generation && slot->comb == comb && slot->nimpl == nimpl && slot->footprint == footprint)
+			return slot->entry;
+	}
+
+	STARPU_PTHREAD_RWLOCK_RDLOCK(&state->model_rwlock);
+	/* Writers modify it with the lock held, so it is stable here */
+	generation = history_generation;
+	if (comb < state->ncombs_set && state->per_arch[comb] != NULL)
+	{
+		HASH_FIND_UINT32_T(state->per_arch[comb][nimpl].history, &footprint, elt);
+		entry = (elt == NULL) ? NULL : elt->history_entry;
+	}
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&state->model_rwlock);
+
+	if (slot)
+	{
+		slot->state = state;
+		slot->generation = generation;
+		slot->comb = comb;
+		slot->nimpl = nimpl;
+		slot->footprint = footprint;
+		slot->entry = entry;
+	}
+
+	return entry;
 }
 
 #ifndef STARPU_SIMGRID
@@ -1295,6 +1444,7 @@ void _starpu_deinitialize_performance_model(struct starpu_perfmodel *model)
 							free(entry);
 						}
 						archmodel->history = NULL;
+						(void) STARPU_ATOMIC_ADDL(&history_generation, 1);
 
 						list = archmodel->list;
 						while (list)
@@ -1760,9 +1910,7 @@ double _starpu_history_based_job_expected_perf(struct starpu_perfmodel *model, s
 {
 	int comb;
 	double exp = NAN;
-	struct starpu_perfmodel_per_arch *per_arch_model;
 	struct starpu_perfmodel_history_entry *entry = NULL;
-	struct starpu_perfmodel_history_table *history, *elt;
 	uint32_t key;
 
 	comb = starpu_perfmodel_arch_comb_get(arch->ndevices, arch->devices);
@@ -1770,21 +1918,8 @@ double _starpu_history_based_job_expected_perf(struct starpu_perfmodel *model, s
 	if(comb == -1)
 		goto docal;
 
-	STARPU_PTHREAD_RWLOCK_RDLOCK(&model->state->model_rwlock);
-	if (model->state->per_arch[comb] == NULL)
-	{
-		// The model has not been executed on this combination
-		STARPU_PTHREAD_RWLOCK_UNLOCK(&model->state->model_rwlock);
-		goto docal;
-	}
-
-	per_arch_model = &model->state->per_arch[comb][nimpl];
-
-	history = per_arch_model->history;
-	HASH_FIND_UINT32_T(history, &key, elt);
-	entry = (elt == NULL) ? NULL : elt->history_entry;
+	entry = history_lookup(model, comb, nimpl, key);
 	STARPU_ASSERT_MSG(!entry || entry->mean >= 0, "entry=%p, entry->mean=%lf\n", entry, entry?entry->mean:NAN);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&model->state->model_rwlock);
 
 	/* Here helgrind would shout that this is unprotected access.
 	 * We do not care about racing access to the mean, we only want
@@ -748,8 +748,16 @@ int _starpu_push_task_to_workers(struct starpu_task *task)
 			STARPU_ASSERT(sched_ctx->sched_policy->push_task);
 			/* check out if there are any workers in the context */
 			unsigned nworkers = starpu_sched_ctx_get_nworkers(sched_ctx->id);
+			struct _starpu_task_batch *batch = _starpu_task_get_current_batch();
 			if (nworkers == 0)
 				ret = -1;
+			else if (batch && sched_ctx->sched_policy->push_tasks)
+			{
+				/* This is submitted along other tasks, push them all
+				 * together at the end of the submission */
+				starpu_task_list_push_back(&batch->tasks, task);
+				batch->ntasks++;
+			}
 			else
 			{
 				struct _starpu_worker *worker = _starpu_get_local_worker_key();
@@ -785,6 +793,81 @@ int _starpu_push_task_to_workers(struct starpu_task *task)
 
 }
 
+void _starpu_push_task_batch(struct _starpu_task_batch *batch)
+{
+	struct starpu_task **tasks;
+	struct starpu_task *task;
+	struct _starpu_worker *worker = _starpu_get_local_worker_key();
+	unsigned count[STARPU_NMAX_SCHED_CTXS] = { 0 };
+	unsigned start[STARPU_NMAX_SCHED_CTXS];
+	unsigned sched_ctx_id, pos;
+
+	if (!batch->ntasks)
+		return;
+
+	/* Bucket the tasks by context, keeping the submission order */
+	for (task = starpu_task_list_begin(&batch->tasks);
+	     task != starpu_task_list_end(&batch->tasks);
+	     task = starpu_task_list_next(task))
+		count[task->sched_ctx]++;
+	for (sched_ctx_id = 0, pos = 0; sched_ctx_id < STARPU_NMAX_SCHED_CTXS; sched_ctx_id++)
+	{
+		start[sched_ctx_id] = pos;
+		pos += count[sched_ctx_id];
+	}
+	STARPU_ASSERT(pos == batch->ntasks);
+
+	_STARPU_MALLOC(tasks, batch->ntasks * sizeof(*tasks));
+	while (!starpu_task_list_empty(&batch->tasks))
+	{
+		task = starpu_task_list_pop_front(&batch->tasks);
+		_STARPU_TASK_BREAK_ON(task, push);
+		tasks[start[task->sched_ctx]++] = task;
+	}
+	batch->ntasks = 0;
+
+	for (sched_ctx_id = 0, pos = 0; sched_ctx_id < STARPU_NMAX_SCHED_CTXS; pos += count[sched_ctx_id], sched_ctx_id++)
+	{
+		struct _starpu_sched_ctx *sched_ctx;
+		unsigned ntasks = count[sched_ctx_id];
+		int ret;
+
+		if (!ntasks)
+			continue;
+		sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+
+		if (worker)
+		{
+			STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+			_starpu_worker_enter_sched_op(worker);
+			STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
+		}
+		_STARPU_SCHED_BEGIN;
+		ret = sched_ctx->sched_policy->push_tasks(&tasks[pos], ntasks);
+		_STARPU_SCHED_END;
+		if (worker)
+		{
+			STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+			_starpu_worker_leave_sched_op(worker);
+			STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
+		}
+
+		if (ret == -1)
+		{
+			/* None of them was pushed, push them one by one */
+			unsigned i;
+			_STARPU_MSG("repush tasks \n");
+			for (i = pos; i < pos + ntasks; i++)
+			{
+				_STARPU_TRACE_JOB_POP(tasks[i], tasks[i]->priority);
+				_starpu_push_task_to_workers(tasks[i]);
+			}
+		}
+	}
+
+	free(tasks);
+}
+
 /* This is called right after the scheduler has pushed a task to a queue
  * but just before releasing mutexes: we need the task to still be alive!
  */
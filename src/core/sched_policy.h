@@ -57,6 +57,9 @@ int _starpu_repush_task(struct _starpu_job *task);
 
 /** actually pushes the tasks to the specific worker or to the scheduler */
 int _starpu_push_task_to_workers(struct starpu_task *task);
+struct _starpu_task_batch;
+/** push the tasks which were kept aside in \p batch */
+void _starpu_push_task_batch(struct _starpu_task_batch *batch);
 
 /** pop a task that can be executed on the worker */
 struct starpu_task *_starpu_pop_task(struct _starpu_worker *worker);
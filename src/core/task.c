@@ -30,6 +30,7 @@
 #include <common/utils.h>
 #include <common/fxt.h>
 #include <common/knobs.h>
+#include <common/objpool.h>
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
@@ -239,6 +240,9 @@ void _starpu__task_c__unregister_knobs(void)
  * possible that we have a task with a NULL codelet, which means its callback
  * could be executed by a user thread as well. */
 static starpu_pthread_key_t current_task_key;
+/* This key stores the batch of tasks being submitted by the thread through
+ * starpu_task_submit_array(), if any */
+static starpu_pthread_key_t current_batch_key;
 static int limit_min_submitted_tasks;
 static int limit_max_submitted_tasks;
 static int watchdog_crash;
@@ -250,23 +254,35 @@ static int watchdog_delay;
 static void (*watchdog_hook)(void *) = NULL;
 static void * watchdog_hook_arg = NULL;
 
+/* Recycles the structures of tasks created by starpu_task_create */
+static struct _starpu_objpool task_pool = _STARPU_OBJPOOL_INITIALIZER("Task", sizeof(struct starpu_task));
+
 #define _STARPU_TASK_MAGIC 42
 
 /* Called once at starpu_init */
 void _starpu_task_init(void)
 {
 	STARPU_PTHREAD_KEY_CREATE(&current_task_key, NULL);
+	STARPU_PTHREAD_KEY_CREATE(&current_batch_key, NULL);
 	limit_min_submitted_tasks = starpu_getenv_number("STARPU_LIMIT_MIN_SUBMITTED_TASKS");
 	limit_max_submitted_tasks = starpu_getenv_number("STARPU_LIMIT_MAX_SUBMITTED_TASKS");
 	watchdog_crash = starpu_getenv_number_default("STARPU_WATCHDOG_CRASH", 0);
 	watchdog_delay = starpu_getenv_number_default("STARPU_WATCHDOG_DELAY", 0);
+	_starpu_objpool_init(&task_pool, starpu_getenv_number_default("STARPU_TASK_POOL_SIZE", 4096));
 }
 
 void _starpu_task_deinit(void)
 {
+	_starpu_objpool_deinit(&task_pool);
+	STARPU_PTHREAD_KEY_DELETE(current_batch_key);
 	STARPU_PTHREAD_KEY_DELETE(current_task_key);
 }
 
+void _starpu_task_display_pool_stats(FILE *stream)
+{
+	_starpu_objpool_display_stats(&task_pool, stream);
+}
+
 void starpu_set_limit_min_submitted_tasks(int limit_min)
 {
 	limit_min_submitted_tasks = limit_min;
@@ -360,7 +376,7 @@ struct starpu_task * STARPU_ATTRIBUTE_MALLOC starpu_task_create(void)
 {
 	struct starpu_task *task;
 
-	_STARPU_MALLOC(task, sizeof(struct starpu_task));
+	task = _starpu_objpool_alloc(&task_pool);
 	starpu_task_init(task);
 
 	/* Dynamically allocated tasks are destroyed by default */
@@ -430,7 +446,7 @@ void _starpu_task_destroy(struct starpu_task *task)
 		if (task->prologue_callback_pop_arg_free)
 			free(task->prologue_callback_pop_arg);
 
-		free(task);
+		_starpu_objpool_free(&task_pool, task);
 	}
 }
 
@@ -544,8 +560,10 @@ int _starpu_task_test_termination(struct starpu_task *task)
 #endif
 
 /* NB in case we have a regenerable task, it is possible that the job was
- * already counted. */
-int _starpu_submit_job(struct _starpu_job *j, int nodeps)
+ * already counted.
+ * When \p counted is set, the task was already accounted in the number of
+ * submitted tasks of its context. */
+static int __starpu_submit_job(struct _starpu_job *j, int nodeps, int counted)
 {
 	struct starpu_task *task = j->task;
 	int ret;
@@ -559,7 +577,8 @@ int _starpu_submit_job(struct _starpu_job *j, int nodeps)
 	/* notify bound computation of a new task */
 	_starpu_bound_record(j);
 
-	_starpu_increment_nsubmitted_tasks_of_sched_ctx(j->task->sched_ctx);
+	if (!counted)
+		_starpu_increment_nsubmitted_tasks_of_sched_ctx(j->task->sched_ctx);
 	_starpu_sched_task_submit(task);
 
 #ifdef STARPU_USE_SC_HYPERVISOR
@@ -641,6 +660,16 @@ int _starpu_submit_job(struct _starpu_job *j, int nodeps)
 	return ret;
 }
 
+int _starpu_submit_job(struct _starpu_job *j, int nodeps)
+{
+	return __starpu_submit_job(j, nodeps, 0);
+}
+
+struct _starpu_task_batch *_starpu_task_get_current_batch(void)
+{
+	return (struct _starpu_task_batch *) STARPU_PTHREAD_GETSPECIFIC(current_batch_key);
+}
+
 /* Note: this is racy, so valgrind would complain. But since we'll always put
  * the same values, this is not a problem. */
 void _starpu_codelet_check_deprecated_fields(struct starpu_codelet *cl)
@@ -945,8 +974,10 @@ static int _starpu_task_submit_head(struct starpu_task *task)
 	return 0;
 }
 
-/* application should submit new tasks to StarPU through this function */
-int _starpu_task_submit(struct starpu_task *task, int nodeps)
+/* When \p batched is set, the task is being submitted by
+ * starpu_task_submit_array(), which already took care of the submission
+ * counters and of throttling */
+static int __starpu_task_submit(struct starpu_task *task, int nodeps, int batched)
 {
 	_STARPU_LOG_IN();
 	STARPU_ASSERT(task);
@@ -990,7 +1021,7 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 		0
 #endif
 		;
-	if (!_starpu_perf_counter_paused() && !j->internal && !continuation)
+	if (!batched && !_starpu_perf_counter_paused() && !j->internal && !continuation)
 	{
 		(void) STARPU_ATOMIC_ADD64(&_starpu_task__g_total_submitted__value, 1);
 		int64_t value = STARPU_ATOMIC_ADD64(&_starpu_task__g_current_submitted__value, 1);
@@ -1009,11 +1040,13 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 	}
 	STARPU_ASSERT_MSG(!(nodeps && continuation), "not supported\n");
 
-	if (!j->internal && limit_max_submitted_tasks >= 0 && limit_min_submitted_tasks >= 0)
+	if (!batched && !j->internal && limit_max_submitted_tasks >= 0 && limit_min_submitted_tasks >= 0)
 	{
 		int nsubmitted_tasks = starpu_task_nsubmitted();
 		if (limit_max_submitted_tasks < nsubmitted_tasks
-			&& limit_min_submitted_tasks < nsubmitted_tasks)
+			&& limit_min_submitted_tasks < nsubmitted_tasks
+			/* We would wait for the tasks kept aside by the batch */
+			&& !_starpu_task_get_current_batch())
 		{
 			starpu_do_schedule();
 			_STARPU_TRACE_TASK_THROTTLE_START();
@@ -1099,7 +1132,7 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 	if (STARPU_UNLIKELY(profiling))
 		_starpu_clock_gettime(&info->submit_time);
 
-	ret = _starpu_submit_job(j, nodeps);
+	ret = __starpu_submit_job(j, nodeps, batched);
 #ifdef STARPU_SIMGRID
 	if (_starpu_simgrid_task_submit_cost())
 		starpu_sleep(0.000001);
@@ -1107,6 +1140,10 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 
 	if (is_sync)
 	{
+		struct _starpu_task_batch *batch = _starpu_task_get_current_batch();
+		if (batch)
+			/* The task may depend on tasks kept aside by the batch */
+			_starpu_push_task_batch(batch);
 		_starpu_sched_do_schedule(task->sched_ctx);
 		_starpu_wait_job(j);
 		if (task->destroy)
@@ -1118,6 +1155,12 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 	return ret;
 }
 
+/* application should submit new tasks to StarPU through this function */
+int _starpu_task_submit(struct starpu_task *task, int nodeps)
+{
+	return __starpu_task_submit(task, nodeps, 0);
+}
+
 #undef starpu_task_submit
 int starpu_task_submit(struct starpu_task *task)
 {
@@ -1144,6 +1187,131 @@ int starpu_task_submit_to_ctx(struct starpu_task *task, unsigned sched_ctx_id)
 	return starpu_task_submit(task);
 }
 
+int starpu_task_submit_array(struct starpu_task **tasks, unsigned ntasks)
+{
+	struct _starpu_task_batch batch;
+	unsigned i, submitted, nsubmitted = 0;
+	int ret = 0;
+
+	STARPU_ASSERT_MSG(starpu_is_initialized(), "starpu_init must be called (and return no error) before submitting tasks.");
+
+	if (_starpu_task_get_current_batch())
+	{
+		/* Already within a batch, e.g. from a task submitted by the
+		 * batch, just add to it */
+		for (i = 0; i < ntasks; i++)
+		{
+			ret = starpu_task_submit(tasks[i]);
+			if (ret)
+				break;
+		}
+		return ret;
+	}
+
+	/* Resolve the contexts like _starpu_task_submit_head does, so we can
+	 * account the tasks in them all at once */
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = tasks[i];
+		struct _starpu_job *j;
+
+		STARPU_ASSERT(task);
+		STARPU_ASSERT_MSG(task->magic == _STARPU_TASK_MAGIC, "Tasks must be created with starpu_task_create, or initialized with starpu_task_init.");
+		j = _starpu_get_job_associated_to_task(task);
+		if (j->internal)
+			task->sched_ctx = _starpu_get_initial_sched_ctx()->id;
+		else if (task->sched_ctx == STARPU_NMAX_SCHED_CTXS)
+			task->sched_ctx = _starpu_sched_ctx_get_current_context();
+
+		if (!j->internal
+#ifdef STARPU_OPENMP
+		    && !j->continuation
+#endif
+		   )
+		{
+			nsubmitted++;
+			if (!_starpu_perf_counter_paused() && task->cl && task->cl->perf_counter_values)
+			{
+				struct starpu_perf_counter_sample_cl_values * const pcv = task->cl->perf_counter_values;
+				int64_t value;
+
+				(void) STARPU_ATOMIC_ADD64(&pcv->task.total_submitted, 1);
+				value = STARPU_ATOMIC_ADD64(&pcv->task.current_submitted, 1);
+				_starpu_perf_counter_update_max_int64(&pcv->task.peak_submitted, value);
+				_starpu_perf_counter_update_per_codelet_sample(task->cl);
+			}
+		}
+	}
+
+	if (nsubmitted && !_starpu_perf_counter_paused())
+	{
+		(void) STARPU_ATOMIC_ADD64(&_starpu_task__g_total_submitted__value, nsubmitted);
+		int64_t value = STARPU_ATOMIC_ADD64(&_starpu_task__g_current_submitted__value, nsubmitted);
+		_starpu_perf_counter_update_max_int64(&_starpu_task__g_peak_submitted__value, value);
+		_starpu_perf_counter_update_global_sample();
+	}
+
+	if (nsubmitted && limit_max_submitted_tasks >= 0 && limit_min_submitted_tasks >= 0)
+	{
+		int nsubmitted_tasks = starpu_task_nsubmitted();
+		if (limit_max_submitted_tasks < nsubmitted_tasks
+			&& limit_min_submitted_tasks < nsubmitted_tasks)
+		{
+			starpu_do_schedule();
+			_STARPU_TRACE_TASK_THROTTLE_START();
+			starpu_task_wait_for_n_submitted(limit_min_submitted_tasks);
+			_STARPU_TRACE_TASK_THROTTLE_END();
+		}
+	}
+
+	/* Account the tasks in their contexts, one run of tasks at a time */
+	for (i = 0; i < ntasks; )
+	{
+		unsigned sched_ctx_id = tasks[i]->sched_ctx;
+		unsigned n = 0;
+		while (i < ntasks && tasks[i]->sched_ctx == sched_ctx_id)
+		{
+			i++;
+			n++;
+		}
+		_starpu_increment_nsubmitted_tasks_of_sched_ctx_n(sched_ctx_id, n);
+	}
+
+	starpu_task_list_init(&batch.tasks);
+	batch.ntasks = 0;
+	STARPU_PTHREAD_SETSPECIFIC(current_batch_key, &batch);
+
+	for (submitted = 0; submitted < ntasks; submitted++)
+	{
+		ret = __starpu_task_submit(tasks[submitted], 0, 1);
+		if (ret)
+			break;
+	}
+
+	STARPU_PTHREAD_SETSPECIFIC(current_batch_key, NULL);
+
+	/* Tasks which were not submitted should not be accounted */
+	for (i = submitted; i < ntasks; i++)
+	{
+		struct _starpu_job *j = _starpu_get_job_associated_to_task(tasks[i]);
+		if (!j->internal
+#ifdef STARPU_OPENMP
+		    && !j->continuation
+#endif
+		    && !_starpu_perf_counter_paused())
+		{
+			(void) STARPU_ATOMIC_ADD64(&_starpu_task__g_current_submitted__value, -1);
+			if (tasks[i]->cl && tasks[i]->cl->perf_counter_values)
+				(void) STARPU_ATOMIC_ADD64(&tasks[i]->cl->perf_counter_values->task.current_submitted, -1);
+		}
+		_starpu_decrement_nsubmitted_tasks_of_sched_ctx(tasks[i]->sched_ctx);
+	}
+
+	_starpu_push_task_batch(&batch);
+
+	return ret;
+}
+
 /* The StarPU core can submit tasks directly to the scheduler or a worker,
  * skipping dependencies completely (when it knows what it is doing).  */
 int starpu_task_submit_nodeps(struct starpu_task *task)
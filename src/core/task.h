@@ -42,8 +42,15 @@ void _starpu_task_init(void);
 void _starpu_task_deinit(void);
 void _starpu_set_current_task(struct starpu_task *task);
 
+/** Display the hit ratio of the recycling pool of task structures */
+void _starpu_task_display_pool_stats(FILE *stream);
+
 int _starpu_submit_job(struct _starpu_job *j, int nodeps);
 
+struct _starpu_task_batch;
+/** Return the batch being submitted by the current thread, if any */
+struct _starpu_task_batch *_starpu_task_get_current_batch(void);
+
 void _starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, struct starpu_task *task_array[], int check);
 
 #define _STARPU_JOB_UNSET ((struct _starpu_job *) NULL)
@@ -139,6 +146,14 @@ int _starpu_task_wait_for_all_in_ctx_and_return_nb_waited_tasks(unsigned sched_c
 #ifdef BUILDING_STARPU
 LIST_CREATE_TYPE_NOSTRUCT(starpu_task, prev, next);
 PRIO_LIST_CREATE_TYPE(starpu_task, priority);
+
+/** Tasks which became ready during a starpu_task_submit_array() call, and
+ * which are pushed to the scheduler all together at the end of the call */
+struct _starpu_task_batch
+{
+	struct starpu_task_list tasks;
+	unsigned ntasks;
+};
 #endif
 
 /** transaction states */
@@ -155,6 +155,29 @@ int _starpu_get_logical_numa_node_worker(unsigned workerid)
 	}
 }
 
+/* This returns the logical index of the NUMA node next to a CPU worker, even
+ * when NUMA memory nodes are not enabled, or -1 if it is not known */
+int _starpu_get_cpu_worker_numa_node(unsigned workerid)
+{
+#if defined(STARPU_HAVE_HWLOC)
+	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
+	struct _starpu_machine_config *config = (struct _starpu_machine_config *)_starpu_get_machine_config() ;
+	hwloc_obj_t obj;
+
+	if (worker->arch != STARPU_CPU_WORKER || worker->bindid < 0)
+		return -1;
+
+	obj = hwloc_get_obj_by_type(config->topology.hwtopology, HWLOC_OBJ_PU, worker->bindid);
+	if (obj)
+		obj = numa_get_obj(obj);
+	if (obj)
+		return obj->logical_index;
+#else
+	(void) workerid; /* unused */
+#endif
+	return -1;
+}
+
 /* This returns the exact NUMA node next to a worker */
 static int _starpu_get_physical_numa_node_worker(unsigned workerid)
 {
@@ -117,6 +117,10 @@ int starpu_memory_nodes_numa_hwloclogid_to_id(int logid);
 /* This returns the exact NUMA node next to a worker */
 int _starpu_get_logical_numa_node_worker(unsigned workerid);
 
+/** This returns the logical index of the NUMA node next to a CPU worker, even
+ * when NUMA memory nodes are not enabled, or -1 if it is not known */
+int _starpu_get_cpu_worker_numa_node(unsigned workerid);
+
 /** returns the number of hyperthreads per core */
 unsigned _starpu_get_nhyperthreads() STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
@@ -861,6 +861,10 @@ void _starpu_worker_init(struct _starpu_worker *workerarg, struct _starpu_machin
 		workerarg->removed_from_ctx[ctx] = 0;
 
 	workerarg->spinning_backoff = 1;
+	workerarg->wake_seq = 0;
+	STARPU_HG_DISABLE_CHECKING(workerarg->wake_seq);
+	workerarg->idle_start = 0.;
+	workerarg->idle_avg = 0.;
 
 	for(ctx = 0; ctx < STARPU_NMAX_SCHED_CTXS; ctx++)
 	{
@@ -1231,6 +1235,7 @@ int starpu_conf_init(struct starpu_conf *conf)
 
 	conf->driver_spinning_backoff_min = (unsigned) starpu_getenv_number_default("STARPU_BACKOFF_MIN", 1);
 	conf->driver_spinning_backoff_max = (unsigned) starpu_getenv_number_default("STARPU_BACKOFF_MAX", 32);
+	conf->driver_idle_spin_max = (unsigned) starpu_getenv_number_default("STARPU_IDLE_SPIN_MAX", 20);
 
 	/* Do not start performance counter collection by default */
 	conf->start_perf_counter_collection = 0;
@@ -2158,6 +2163,7 @@ void starpu_shutdown(void)
 	     {
 		  _starpu_display_msi_stats(stderr);
 		  _starpu_display_alloc_cache_stats(stderr);
+		  _starpu_display_task_pool_stats(stderr);
 	     }
 	}
 
@@ -2733,6 +2739,8 @@ static int starpu_wakeup_worker_locked(int workerid, starpu_pthread_cond_t *sche
 #ifdef STARPU_SIMGRID
 	starpu_pthread_queue_broadcast(&_starpu_simgrid_task_queue[workerid]);
 #endif
+	/* Let a spinning worker notice the wake-up */
+	_starpu_config.workers[workerid].wake_seq++;
 	if (_starpu_config.workers[workerid].status & STATUS_SLEEPING)
 	{
 		int ret = 0;
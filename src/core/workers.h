@@ -88,9 +88,16 @@ struct _starpu_node
 	 * considered as clean) */
 	unsigned mc_nb, mc_clean_nb;
 
+	/** Allocation cache: buckets of released memory chunks, indexed by
+	 * footprint */
 	struct mc_cache_entry *mc_cache;
+	/** Eviction index of the allocation cache: the non-empty buckets,
+	 * least recently fed first */
+	struct mc_cache_entry *mc_cache_lru_head, *mc_cache_lru_tail;
 	int mc_cache_nb;
 	starpu_ssize_t mc_cache_size;
+	/** Allocation cache statistics */
+	unsigned long mc_cache_hits, mc_cache_misses, mc_cache_flushed;
 
 	/** Whether some thread is currently tidying this node */
 	unsigned tidying;
@@ -117,6 +124,9 @@ struct _starpu_node
 	/** requests that are not terminated (eg. async transfers) */
 	struct _starpu_data_request_prio_list data_requests_pending[STARPU_MAXNODES][2];
 	unsigned data_requests_npending[STARPU_MAXNODES][2];
+	/** Moving average of the size of the transfers posted, to size the
+	 * number of requests in flight */
+	size_t data_requests_avg_size[STARPU_MAXNODES][2];
 	starpu_pthread_mutex_t data_requests_pending_list_mutex[STARPU_MAXNODES][2];
 
 	/*
@@ -252,6 +262,9 @@ LIST_TYPE(_starpu_worker,
 	unsigned removed_from_ctx[STARPU_NMAX_SCHED_CTXS+1];
 
 	unsigned spinning_backoff ; /**< number of cycles to pause when spinning  */
+	unsigned wake_seq; /**< incremented, with sched_mutex held, by each wake-up request, polled by the worker when spinning before sleeping */
+	double idle_start; /**< date at which the worker became idle, 0 if it is not */
+	double idle_avg; /**< moving average of the time in µs the worker stays idle before getting a task */
 
 	unsigned nb_buffers_transferred; /**< number of piece of data already send to worker */
 	unsigned nb_buffers_totransfer; /**< number of piece of data already send to worker */
@@ -809,6 +822,8 @@ static inline void _starpu_worker_request_blocking_in_parallel(struct _starpu_wo
 
 		/* trigger the block_in_parallel_req */
 		worker->state_block_in_parallel_req = 1;
+		/* let the worker stop spinning right away, see _starpu_worker_idle_spin */
+		worker->wake_seq++;
 		STARPU_PTHREAD_COND_BROADCAST(&worker->sched_cond);
 #ifdef STARPU_SIMGRID
 		starpu_pthread_queue_broadcast(&_starpu_simgrid_task_queue[worker->workerid]);
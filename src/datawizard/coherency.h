@@ -109,6 +109,10 @@ struct _starpu_data_replicate
 	 */
 	unsigned nb_tasks_prefetch;
 
+	/** Hint left by the eviction policy when this replicate got evicted
+	 * from its memory node */
+	unsigned eviction_hint:2;
+
 	/** Pointer to memchunk for LRU strategy */
 	struct _starpu_mem_chunk * mc;
 };
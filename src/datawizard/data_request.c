@@ -24,10 +24,20 @@
 #include <core/disk.h>
 #include <core/simgrid.h>
 
+/* Requests which were freed, kept for reuse */
+static struct _starpu_spinlock request_pool_lock;
+static struct _starpu_data_request_list request_pool;
+static unsigned request_pool_size;
+
 void _starpu_init_data_request_lists(void)
 {
 	unsigned i, j;
 	enum _starpu_data_request_inout k;
+
+	_starpu_spin_init(&request_pool_lock);
+	_starpu_data_request_list_init(&request_pool);
+	request_pool_size = 0;
+
 	for (i = 0; i < STARPU_MAXNODES; i++)
 	{
 		struct _starpu_node *node = _starpu_get_node_struct(i);
@@ -49,12 +59,14 @@ void _starpu_init_data_request_lists(void)
 #endif
 				_starpu_data_request_prio_list_init(&node->data_requests_pending[j][k]);
 				node->data_requests_npending[j][k] = 0;
+				node->data_requests_avg_size[j][k] = 0;
 
 				STARPU_PTHREAD_MUTEX_INIT(&node->data_requests_list_mutex[j][k], NULL);
 				STARPU_PTHREAD_MUTEX_INIT(&node->data_requests_pending_list_mutex[j][k], NULL);
 			}
 		}
 		STARPU_HG_DISABLE_CHECKING(node->data_requests_npending);
+		STARPU_HG_DISABLE_CHECKING(node->data_requests_avg_size);
 	}
 }
 
@@ -78,6 +90,11 @@ void _starpu_deinit_data_request_lists(void)
 			}
 		}
 	}
+
+	while (!_starpu_data_request_list_empty(&request_pool))
+		_starpu_data_request_delete(_starpu_data_request_list_pop_front(&request_pool));
+	request_pool_size = 0;
+	_starpu_spin_destroy(&request_pool_lock);
 }
 
 /* Unlink the request from the handle. New requests can then be made. */
@@ -128,10 +145,40 @@ static void _starpu_data_request_unlink(struct _starpu_data_request *r)
 	}
 }
 
+static struct _starpu_data_request *_starpu_data_request_alloc(void)
+{
+	struct _starpu_data_request *r = NULL;
+
+	_starpu_spin_lock(&request_pool_lock);
+	if (!_starpu_data_request_list_empty(&request_pool))
+	{
+		r = _starpu_data_request_list_pop_front(&request_pool);
+		request_pool_size--;
+	}
+	_starpu_spin_unlock(&request_pool_lock);
+
+	if (!r)
+		r = _starpu_data_request_new();
+	return r;
+}
+
 static void _starpu_data_request_destroy(struct _starpu_data_request *r)
 {
 	//fprintf(stderr, "DESTROY REQ %p (%d) refcnt %d\n", r, node, r->refcnt);
-	_starpu_data_request_delete(r);
+	_starpu_spin_destroy(&r->lock);
+
+	/* Keep it for a later request, to avoid going through malloc for each transfer */
+	_starpu_spin_lock(&request_pool_lock);
+	if (request_pool_size < MAX_POOLED_REQUESTS)
+	{
+		_starpu_data_request_list_push_front(&request_pool, r);
+		request_pool_size++;
+		r = NULL;
+	}
+	_starpu_spin_unlock(&request_pool_lock);
+
+	if (r)
+		_starpu_data_request_delete(r);
 }
 
 /* handle->lock should already be taken !  */
@@ -147,7 +194,7 @@ struct _starpu_data_request *_starpu_create_data_request(starpu_data_handle_t ha
 							 unsigned is_write_invalidation,
 							 const char *origin)
 {
-	struct _starpu_data_request *r = _starpu_data_request_new();
+	struct _starpu_data_request *r = _starpu_data_request_alloc();
 
 	_starpu_spin_checklocked(&handle->header_lock);
 
@@ -365,6 +412,13 @@ void _starpu_post_data_request(struct _starpu_data_request *r)
 
 	/* insert the request in the proper list */
 	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->data_requests_list_mutex[r->peer_node][r->inout]);
+	if (r->mode & STARPU_R && r->src_replicate->memory_node != r->dst_replicate->memory_node)
+	{
+		/* Record the typical size of the transfers on this link */
+		size_t size = _starpu_data_get_size(r->handle);
+		size_t *avg_size = &node_struct->data_requests_avg_size[r->peer_node][r->inout];
+		*avg_size = *avg_size ? (*avg_size * 7 + size) / 8 : size;
+	}
 	if (r->prefetch >= STARPU_IDLEFETCH)
 		_starpu_data_request_prio_list_push_back(&node_struct->idle_requests[r->peer_node][r->inout], r);
 	else if (r->prefetch > STARPU_FETCH)
@@ -801,19 +855,57 @@ static int __starpu_handle_node_data_requests(struct _starpu_data_request_prio_l
 	return ret;
 }
 
+/*
+ * Number of requests which can be in flight on the link between handling_node
+ * and peer_node. MAX_PENDING_REQUESTS_PER_NODE is enough when transfers are
+ * large compared to the latency-bandwidth product of the link, but with small
+ * transfers we need more of them in flight to keep the link busy. Prefetch
+ * and idle requests get the same share of it as with the default limits, so
+ * that demand fetches always keep some room.
+ */
+static unsigned _starpu_data_request_link_limit(unsigned handling_node, unsigned peer_node, enum _starpu_data_request_inout inout, unsigned n)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(handling_node);
+	size_t avg_size = node_struct->data_requests_avg_size[peer_node][inout];
+	unsigned src_node = inout == _STARPU_DATA_REQUEST_IN ? peer_node : handling_node;
+	unsigned dst_node = inout == _STARPU_DATA_REQUEST_IN ? handling_node : peer_node;
+	double bandwidth, latency, limit;
+
+	if (!avg_size || src_node == dst_node
+		/* The disk backends size their queues with the default limits */
+		|| starpu_node_get_kind(src_node) == STARPU_DISK_RAM
+		|| starpu_node_get_kind(dst_node) == STARPU_DISK_RAM)
+		return n;
+
+	/* In MB/s, i.e. bytes/us, and in us */
+	bandwidth = starpu_transfer_bandwidth(src_node, dst_node);
+	latency = starpu_transfer_latency(src_node, dst_node);
+	if (!(bandwidth > 0.) || !(latency > 0.))
+		/* Not calibrated */
+		return n;
+
+	limit = MAX_PENDING_REQUESTS_PER_NODE + latency * bandwidth / avg_size;
+	if (limit > MAX_PENDING_REQUESTS_PER_LINK)
+		limit = MAX_PENDING_REQUESTS_PER_LINK;
+	return n * (unsigned) limit / MAX_PENDING_REQUESTS_PER_NODE;
+}
+
 int _starpu_handle_node_data_requests(unsigned handling_node, unsigned peer_node, enum _starpu_data_request_inout inout, enum _starpu_may_alloc may_alloc, unsigned *pushed)
 {
-	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->data_requests, handling_node, peer_node, inout, may_alloc, MAX_PENDING_REQUESTS_PER_NODE, pushed, STARPU_FETCH);
+	unsigned n = _starpu_data_request_link_limit(handling_node, peer_node, inout, MAX_PENDING_REQUESTS_PER_NODE);
+	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->data_requests, handling_node, peer_node, inout, may_alloc, n, pushed, STARPU_FETCH);
 }
 
 int _starpu_handle_node_prefetch_requests(unsigned handling_node, unsigned peer_node, enum _starpu_data_request_inout inout, enum _starpu_may_alloc may_alloc, unsigned *pushed)
 {
-	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->prefetch_requests, handling_node, peer_node, inout, may_alloc, MAX_PENDING_PREFETCH_REQUESTS_PER_NODE, pushed, STARPU_PREFETCH);
+	unsigned n = _starpu_data_request_link_limit(handling_node, peer_node, inout, MAX_PENDING_PREFETCH_REQUESTS_PER_NODE);
+	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->prefetch_requests, handling_node, peer_node, inout, may_alloc, n, pushed, STARPU_PREFETCH);
 }
 
 int _starpu_handle_node_idle_requests(unsigned handling_node, unsigned peer_node, enum _starpu_data_request_inout inout, enum _starpu_may_alloc may_alloc, unsigned *pushed)
 {
-	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->idle_requests, handling_node, peer_node, inout, may_alloc, MAX_PENDING_IDLE_REQUESTS_PER_NODE, pushed, STARPU_IDLEFETCH);
+	unsigned n = _starpu_data_request_link_limit(handling_node, peer_node, inout, MAX_PENDING_IDLE_REQUESTS_PER_NODE);
+	return __starpu_handle_node_data_requests(_starpu_get_node_struct(handling_node)->idle_requests, handling_node, peer_node, inout, may_alloc, n, pushed, STARPU_IDLEFETCH);
 }
 
 static int _handle_pending_node_data_requests(unsigned handling_node, unsigned peer_node, enum _starpu_data_request_inout inout, unsigned force)
@@ -38,6 +38,11 @@
 #define MAX_PENDING_REQUESTS_PER_NODE 5
 #define MAX_PENDING_PREFETCH_REQUESTS_PER_NODE 2
 #define MAX_PENDING_IDLE_REQUESTS_PER_NODE 1
+/** Maximum number of requests which can be in flight on a link with a high
+ * latency-bandwidth product, see _starpu_data_request_link_limit */
+#define MAX_PENDING_REQUESTS_PER_LINK 32
+/** Maximum number of freed requests kept for reuse */
+#define MAX_POOLED_REQUESTS 1024
 /** Maximum time in us that we can afford pushing requests before going back to the driver loop, e.g. for checking GPU task termination */
 #define MAX_PUSH_TIME 1000
 
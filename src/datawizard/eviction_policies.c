@@ -0,0 +1,202 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <core/workers.h>
+#include <datawizard/coherency.h>
+#include <datawizard/eviction_policies.h>
+
+/* ------------------- LRU -------------------  */
+
+/* Just follow the order of the mc_list */
+static struct _starpu_eviction_policy lru_policy =
+{
+	.name = "lru",
+	.description = "evict the least recently used data first (default)",
+};
+
+/* ------------------- ARC -------------------  */
+
+/*
+ * Adaptive Replacement Cache-like policy: chunks which were used only once
+ * since they were allocated (T1) are separated from chunks used several times
+ * (T2), and a target number p of T1 chunks is adapted according to the ghost
+ * hits, i.e. when data evicted from T1 (resp. T2) is allocated again, p is
+ * increased (resp. decreased). We evict from T1 when it has more than p
+ * chunks, and from T2 otherwise, each in LRU order.
+ */
+
+#define ARC_GHOST_T1 1
+#define ARC_GHOST_T2 2
+
+/* Target number of T1 chunks */
+static unsigned arc_p[STARPU_MAXNODES];
+/* Number of T1 chunks, computed when preparing an eviction */
+static unsigned arc_t1[STARPU_MAXNODES];
+
+static void arc_init(void)
+{
+	memset(arc_p, 0, sizeof(arc_p));
+	memset(arc_t1, 0, sizeof(arc_t1));
+}
+
+static void arc_allocated(struct _starpu_mem_chunk *mc, unsigned node)
+{
+	struct _starpu_data_replicate *replicate = mc->replicate;
+	unsigned nb = _starpu_get_node_struct(node)->mc_nb;
+
+	if (replicate->eviction_hint == ARC_GHOST_T1)
+	{
+		/* T1 was too small */
+		if (arc_p[node] < nb)
+			arc_p[node]++;
+	}
+	else if (replicate->eviction_hint == ARC_GHOST_T2)
+	{
+		/* T2 was too small */
+		if (arc_p[node] > 0)
+			arc_p[node]--;
+	}
+	replicate->eviction_hint = 0;
+}
+
+static void arc_used(struct _starpu_mem_chunk *mc, unsigned node STARPU_ATTRIBUTE_UNUSED)
+{
+	if (mc->nb_uses < 2)
+		mc->nb_uses++;
+}
+
+static void arc_evicted(struct _starpu_mem_chunk *mc, unsigned node STARPU_ATTRIBUTE_UNUSED)
+{
+	mc->replicate->eviction_hint = mc->nb_uses >= 2 ? ARC_GHOST_T2 : ARC_GHOST_T1;
+}
+
+static void arc_prepare(unsigned node)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	struct _starpu_mem_chunk *mc;
+	unsigned t1 = 0;
+
+	for (mc = _starpu_mem_chunk_list_begin(&node_struct->mc_list);
+	     mc != _starpu_mem_chunk_list_end(&node_struct->mc_list);
+	     mc = _starpu_mem_chunk_list_next(mc))
+		if (mc->nb_uses < 2)
+			t1++;
+	arc_t1[node] = t1;
+}
+
+static int arc_rank(struct _starpu_mem_chunk *mc, unsigned node)
+{
+	int in_t1 = mc->nb_uses < 2;
+
+	if (arc_t1[node] > arc_p[node])
+		return in_t1 ? 0 : 1;
+	else
+		return in_t1 ? 1 : 0;
+}
+
+static struct _starpu_eviction_policy arc_policy =
+{
+	.name = "arc",
+	.description = "balance between recently and frequently used data, ARC-like",
+	.init = arc_init,
+	.allocated = arc_allocated,
+	.used = arc_used,
+	.evicted = arc_evicted,
+	.prepare = arc_prepare,
+	.rank = arc_rank,
+};
+
+/* ------------------- Next use -------------------  */
+
+/*
+ * Approximate Belady's farthest-next-use policy with what StarPU knows about
+ * upcoming tasks: data which no submitted task will access again is evicted
+ * first, then data which will be accessed by tasks not scheduled on this
+ * memory node yet, and last data which tasks already scheduled on this memory
+ * node will access.
+ */
+
+static int nextuse_rank(struct _starpu_mem_chunk *mc, unsigned node STARPU_ATTRIBUTE_UNUSED)
+{
+	starpu_data_handle_t handle = mc->data;
+
+	if (mc->wontuse)
+		return 0;
+
+	if (mc->replicate && mc->replicate->nb_tasks_prefetch)
+		/* Tasks scheduled here will use it soon */
+		return 2;
+
+	/* This is only a hint, we do not need to take the
+	 * sequential_consistency_mutex */
+	if (handle->sequential_consistency
+		&& !handle->last_sync_task
+		&& handle->last_submitted_accessors.next == &handle->last_submitted_accessors)
+		/* No submitted task will access it */
+		return 0;
+
+	return 1;
+}
+
+static struct _starpu_eviction_policy nextuse_policy =
+{
+	.name = "nextuse",
+	.description = "evict data which submitted tasks will use the latest first",
+	.rank = nextuse_rank,
+};
+
+/* ------------------- Selection -------------------  */
+
+static struct _starpu_eviction_policy *predefined_eviction_policies[] =
+{
+	&lru_policy,
+	&arc_policy,
+	&nextuse_policy,
+	NULL
+};
+
+struct _starpu_eviction_policy *_starpu_eviction_policy = &lru_policy;
+
+void _starpu_eviction_policy_init(void)
+{
+	struct _starpu_eviction_policy **policy;
+	const char *name = starpu_getenv("STARPU_EVICTION_POLICY");
+
+	_starpu_eviction_policy = &lru_policy;
+
+	if (name && strcmp(name, "help") == 0)
+	{
+		fprintf(stderr, "\nThe variable STARPU_EVICTION_POLICY can be set to one of the following strings:\n");
+		for (policy = predefined_eviction_policies; *policy; policy++)
+			fprintf(stderr, "%-30s\t-> %s\n", (*policy)->name, (*policy)->description);
+		fprintf(stderr, "\n");
+	}
+	else if (name && name[0])
+	{
+		for (policy = predefined_eviction_policies; *policy; policy++)
+			if (strcmp(name, (*policy)->name) == 0)
+				break;
+		if (*policy)
+			_starpu_eviction_policy = *policy;
+		else
+			_STARPU_MSG("Warning: eviction policy '%s' does not exist, using lru. Use STARPU_EVICTION_POLICY=help to get the list of policies\n", name);
+	}
+
+	if (_starpu_eviction_policy->init)
+		_starpu_eviction_policy->init();
+}
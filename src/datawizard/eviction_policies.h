@@ -0,0 +1,66 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __EVICTION_POLICIES_H__
+#define __EVICTION_POLICIES_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <datawizard/memalloc.h>
+
+#pragma GCC visibility push(hidden)
+
+/**
+ * Policy deciding which memory chunks get evicted first when memory needs to
+ * be reclaimed on a memory node.
+ *
+ * The mc_list of each node is always kept in LRU order (chunks are moved to
+ * its end when used, and chunks marked as "won't use" are moved to its clean
+ * part). A policy without a rank method simply evicts chunks in that order.
+ * Otherwise, reclaiming repeatedly evicts the first chunk of the mc_list with
+ * the lowest rank, 0 being the lowest possible rank.
+ *
+ * All methods are optional, and are called with the mc_lock of the node held.
+ */
+struct _starpu_eviction_policy
+{
+	const char *name;
+	const char *description;
+
+	/** Called at initialization of StarPU */
+	void (*init)(void);
+	/** A chunk was allocated for a replicate and put in the mc_list */
+	void (*allocated)(struct _starpu_mem_chunk *mc, unsigned node);
+	/** A chunk was used by a task */
+	void (*used)(struct _starpu_mem_chunk *mc, unsigned node);
+	/** A chunk is getting evicted, its replicate is still valid. */
+	void (*evicted)(struct _starpu_mem_chunk *mc, unsigned node);
+	/** Called before looking for chunks to evict */
+	void (*prepare)(unsigned node);
+	/** Eviction rank of the chunk, the lowest get evicted first */
+	int (*rank)(struct _starpu_mem_chunk *mc, unsigned node);
+};
+
+/** The eviction policy in use, selected by STARPU_EVICTION_POLICY */
+extern struct _starpu_eviction_policy *_starpu_eviction_policy;
+
+/** Select the eviction policy according to the environment */
+void _starpu_eviction_policy_init(void);
+
+#pragma GCC visibility pop
+
+#endif // __EVICTION_POLICIES_H__
@@ -19,6 +19,7 @@
 #include <datawizard/memory_nodes.h>
 #include <datawizard/memalloc.h>
 #include <datawizard/footprint.h>
+#include <datawizard/eviction_policies.h>
 #include <core/disk.h>
 #include <core/topology.h>
 #include <starpu.h>
@@ -47,6 +48,7 @@ static int limit_cpu_mem;
 		/* This is the only dirty element for now */		 \
 		node_struct->mc_dirty_head = mc;			 \
 	node_struct->mc_nb++;						 \
+	(mc)->cache_entry->nb_in_use++;					 \
 } while(0)
 
 /* Put new clean mc at the end of the clean part of mc_list, i.e. just before mc_dirty_head (if any) */
@@ -58,6 +60,7 @@ static int limit_cpu_mem;
 	/* This is clean */						 \
 	node_struct->mc_clean_nb++;					 \
 	node_struct->mc_nb++;						 \
+	(mc)->cache_entry->nb_in_use++;					 \
 } while (0)
 
 #define MC_LIST_ERASE(node_struct, mc) do {				 \
@@ -68,6 +71,7 @@ static int limit_cpu_mem;
 		node_struct->mc_dirty_head = _starpu_mem_chunk_list_next((mc)); \
 	/* One element less */						 \
 	node_struct->mc_nb--;							 \
+	(mc)->cache_entry->nb_in_use--;					 \
 	/* Remove element */						 \
 	_starpu_mem_chunk_list_erase(&node_struct->mc_list, (mc));		 \
 	/* Notify whoever asked for it */				 \
@@ -78,14 +82,89 @@ static int limit_cpu_mem;
 	} \
 } while (0)
 
-/* Explicitly caches memory chunks that can be reused */
+/* Explicitly caches memory chunks that can be reused.
+ *
+ * There is one bucket per footprint, i.e. per size and shape of data. Besides
+ * the released chunks, a bucket records how many chunks of mc_list have this
+ * footprint, so that looking for a chunk to reuse can give up immediately when
+ * there is none. Non-empty buckets are kept in an eviction index, ordered by
+ * the last time a chunk was released into them, so that flushing the cache
+ * frees the chunks of the least recently used sizes first. */
 struct mc_cache_entry
 {
 	UT_hash_handle hh;
+	/* Released chunks, most recently released first */
 	struct _starpu_mem_chunk_list list;
+	/* Number of chunks of mc_list with this footprint */
+	unsigned nb_in_use;
+	/* Position in the eviction index, while list is not empty */
+	struct mc_cache_entry *lru_prev, *lru_next;
 	uint32_t footprint;
 };
 
+/* Get the cache bucket for a footprint, creating it if needed. Must be called
+ * with mc_lock held */
+static struct mc_cache_entry *mc_cache_get_entry(struct _starpu_node *node_struct, uint32_t footprint)
+{
+	struct mc_cache_entry *entry;
+
+	HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
+	if (!entry)
+	{
+		_STARPU_CALLOC(entry, 1, sizeof(*entry));
+		_starpu_mem_chunk_list_init(&entry->list);
+		entry->footprint = footprint;
+		HASH_ADD(hh, node_struct->mc_cache, footprint, sizeof(entry->footprint), entry);
+	}
+	return entry;
+}
+
+static void mc_cache_lru_remove(struct _starpu_node *node_struct, struct mc_cache_entry *entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		node_struct->mc_cache_lru_head = entry->lru_next;
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		node_struct->mc_cache_lru_tail = entry->lru_prev;
+	entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void mc_cache_lru_push_back(struct _starpu_node *node_struct, struct mc_cache_entry *entry)
+{
+	entry->lru_prev = node_struct->mc_cache_lru_tail;
+	entry->lru_next = NULL;
+	if (node_struct->mc_cache_lru_tail)
+		node_struct->mc_cache_lru_tail->lru_next = entry;
+	else
+		node_struct->mc_cache_lru_head = entry;
+	node_struct->mc_cache_lru_tail = entry;
+}
+
+/* Whether some chunk of mc_list has this footprint. Must be called with
+ * mc_lock held */
+static int mc_list_has_footprint(struct _starpu_node *node_struct, uint32_t footprint)
+{
+	struct mc_cache_entry *entry;
+
+	HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
+	return entry && entry->nb_in_use;
+}
+
+/* Take a chunk out of a cache bucket. Must be called with mc_lock held */
+static void mc_cache_erase(struct _starpu_node *node_struct, struct mc_cache_entry *entry, struct _starpu_mem_chunk *mc)
+{
+	_starpu_mem_chunk_list_erase(&entry->list, mc);
+	if (_starpu_mem_chunk_list_empty(&entry->list))
+		mc_cache_lru_remove(node_struct, entry);
+	node_struct->mc_cache_nb--;
+	STARPU_ASSERT_MSG(node_struct->mc_cache_nb >= 0, "allocation cache has %d objects??", node_struct->mc_cache_nb);
+	node_struct->mc_cache_size -= mc->size;
+	STARPU_ASSERT_MSG(node_struct->mc_cache_size >= 0, "allocation cache has %ld bytes??", (long) node_struct->mc_cache_size);
+}
+
 int _starpu_is_reclaiming(unsigned node)
 {
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
@@ -157,6 +236,9 @@ void _starpu_init_mem_chunk_lists(void)
 		struct _starpu_node *node = _starpu_get_node_struct(i);
 		_starpu_spin_init(&node->mc_lock);
 		_starpu_mem_chunk_list_init(&node->mc_list);
+		node->mc_cache_hits = 0;
+		node->mc_cache_misses = 0;
+		node->mc_cache_flushed = 0;
 		STARPU_HG_DISABLE_CHECKING(node->mc_cache_size);
 		STARPU_HG_DISABLE_CHECKING(node->mc_nb);
 		STARPU_HG_DISABLE_CHECKING(node->mc_clean_nb);
@@ -171,6 +253,7 @@ void _starpu_init_mem_chunk_lists(void)
 	minimum_clean_p = starpu_getenv_number_default("STARPU_MINIMUM_CLEAN_BUFFERS", 5);
 	target_clean_p = starpu_getenv_number_default("STARPU_TARGET_CLEAN_BUFFERS", 10);
 	limit_cpu_mem = starpu_getenv_number("STARPU_LIMIT_CPU_MEM");
+	_starpu_eviction_policy_init();
 }
 
 void _starpu_deinit_mem_chunk_lists(void)
@@ -186,11 +269,13 @@ void _starpu_deinit_mem_chunk_lists(void)
 		HASH_ITER(hh, node->mc_cache, entry, tmp)
 		{
 			STARPU_ASSERT(_starpu_mem_chunk_list_empty(&entry->list));
+			STARPU_ASSERT(entry->nb_in_use == 0);
 			HASH_DEL(node->mc_cache, entry);
 			free(entry);
 		}
 		STARPU_ASSERT(node->mc_cache_nb == 0);
 		STARPU_ASSERT(node->mc_cache_size == 0);
+		STARPU_ASSERT(node->mc_cache_lru_head == NULL);
 		_starpu_spin_destroy(&node->mc_lock);
 	}
 }
@@ -457,6 +542,8 @@ static size_t do_free_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node)
 		_starpu_spin_checklocked(&handle->header_lock);
 		mc->size = _starpu_data_get_alloc_size(handle);
 
+		if (_starpu_eviction_policy->evicted)
+			_starpu_eviction_policy->evicted(mc, node);
 		mc->replicate->mc=NULL;
 	}
 
@@ -489,6 +576,8 @@ static void reuse_mem_chunk(unsigned node, struct _starpu_data_replicate *new_re
 	struct _starpu_data_replicate *old_replicate = mc->replicate;
 	if (old_replicate)
 	{
+		if (_starpu_eviction_policy->evicted)
+			_starpu_eviction_policy->evicted(mc, node);
 		old_replicate->mc = NULL;
 		old_replicate->allocated = 0;
 		old_replicate->automatically_allocated = 0;
@@ -739,9 +828,12 @@ static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_locked(unsigned n
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
 
 	HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
-	if (!entry)
+	if (!entry || _starpu_mem_chunk_list_empty(&entry->list))
+	{
 		/* No data with that footprint */
+		node_struct->mc_cache_misses++;
 		return NULL;
+	}
 
 	struct _starpu_mem_chunk *mc;
 	for (mc = _starpu_mem_chunk_list_begin(&entry->list);
@@ -753,17 +845,15 @@ static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_locked(unsigned n
 			continue;
 
 		/* Cache hit */
+		node_struct->mc_cache_hits++;
 
 		/* Remove from the cache */
-		_starpu_mem_chunk_list_erase(&entry->list, mc);
-		node_struct->mc_cache_nb--;
-		STARPU_ASSERT_MSG(node_struct->mc_cache_nb >= 0, "allocation cache for node %u has %d objects??", node, node_struct->mc_cache_nb);
-		node_struct->mc_cache_size -= mc->size;
-		STARPU_ASSERT_MSG(node_struct->mc_cache_size >= 0, "allocation cache for node %u has %ld bytes??", node, (long) node_struct->mc_cache_size);
+		mc_cache_erase(node_struct, entry, mc);
 		return mc;
 	}
 
 	/* This is a cache miss */
+	node_struct->mc_cache_misses++;
 	return NULL;
 }
 
@@ -797,6 +887,12 @@ static int try_to_reuse_not_important_mc(unsigned node, starpu_data_handle_t dat
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
 
 	_starpu_spin_lock(&node_struct->mc_lock);
+	if (!mc_list_has_footprint(node_struct, footprint))
+	{
+		/* No chunk of that size, no need to go through the list */
+		_starpu_spin_unlock(&node_struct->mc_lock);
+		return 0;
+	}
 restart:
 	/* now look for some non essential data in the active list */
 	for (mc = _starpu_mem_chunk_list_begin(&node_struct->mc_list);
@@ -868,7 +964,12 @@ static int try_to_reuse_potentially_in_use_mc(unsigned node, starpu_data_handle_
 	 */
 
 	_starpu_spin_lock(&node_struct->mc_lock);
-
+	if (!mc_list_has_footprint(node_struct, footprint))
+	{
+		/* No chunk of that size, no need to go through the list */
+		_starpu_spin_unlock(&node_struct->mc_lock);
+		return 0;
+	}
 restart:
 	for (mc = _starpu_mem_chunk_list_begin(&node_struct->mc_list);
 	     mc != _starpu_mem_chunk_list_end(&node_struct->mc_list) && !success;
@@ -915,47 +1016,125 @@ restart:
 }
 
 /*
- * Free the memory chunks that are explicitely tagged to be freed.
+ * Free the memory chunks that are explicitely tagged to be freed, starting
+ * with the least recently used sizes.
  */
 static size_t flush_memchunk_cache(unsigned node, size_t reclaim)
 {
 	struct _starpu_mem_chunk *mc;
-	struct mc_cache_entry *entry=NULL, *tmp=NULL;
+	struct mc_cache_entry *entry;
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
 
 	size_t freed = 0;
 
-restart:
-	_starpu_spin_lock(&node_struct->mc_lock);
-	HASH_ITER(hh, node_struct->mc_cache, entry, tmp)
+	while (!reclaim || freed < reclaim)
 	{
-		if (!_starpu_mem_chunk_list_empty(&entry->list))
+		_starpu_spin_lock(&node_struct->mc_lock);
+		entry = node_struct->mc_cache_lru_head;
+		if (!entry)
 		{
-			mc = _starpu_mem_chunk_list_pop_front(&entry->list);
-			STARPU_ASSERT(!mc->data);
-			STARPU_ASSERT(!mc->replicate);
-
-			node_struct->mc_cache_nb--;
-			STARPU_ASSERT(node_struct->mc_cache_nb >= 0);
-			node_struct->mc_cache_size -= mc->size;
-			STARPU_ASSERT(node_struct->mc_cache_size >= 0);
 			_starpu_spin_unlock(&node_struct->mc_lock);
+			break;
+		}
 
-			freed += free_memory_on_node(mc, node);
+		/* Oldest chunk of the bucket */
+		mc = _starpu_mem_chunk_list_back(&entry->list);
+		STARPU_ASSERT(!mc->data);
+		STARPU_ASSERT(!mc->replicate);
+		mc_cache_erase(node_struct, entry, mc);
+		node_struct->mc_cache_flushed++;
+		_starpu_spin_unlock(&node_struct->mc_lock);
 
-			free(mc->chunk_interface);
-			_starpu_mem_chunk_delete(mc);
+		freed += free_memory_on_node(mc, node);
 
-			if (reclaim && freed >= reclaim)
-				goto out;
-			goto restart;
-		}
+		free(mc->chunk_interface);
+		_starpu_mem_chunk_delete(mc);
+	}
 
-		if (reclaim && freed >= reclaim)
-			break;
+	return freed;
+}
+
+struct ranked_mc
+{
+	struct _starpu_mem_chunk *mc;
+	int rank;
+	unsigned idx;
+};
+
+static int ranked_mc_cmp(const void *a, const void *b)
+{
+	const struct ranked_mc *ra = a, *rb = b;
+
+	if (ra->rank != rb->rank)
+		return ra->rank < rb->rank ? -1 : 1;
+	/* Keep the LRU order of mc_list between equal ranks */
+	return ra->idx < rb->idx ? -1 : ra->idx > rb->idx;
+}
+
+/*
+ * Try to free the buffers currently in use on the memory node, in the order
+ * given by the ranks of the eviction policy. The chunks are ranked once, and
+ * then tried in that order. Since try_to_throw_mem_chunk may release mc_lock,
+ * the candidates get their remove_notify pointed at their array entry, so
+ * that we notice the ones which get dropped meanwhile.
+ */
+static size_t free_potentially_in_use_mc_ranked(unsigned node, size_t reclaim, enum starpu_is_prefetch is_prefetch)
+{
+	size_t freed = 0;
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	struct _starpu_mem_chunk *mc;
+	struct ranked_mc *ranked;
+	unsigned n = 0, i;
+
+	_starpu_spin_lock(&node_struct->mc_lock);
+	if (!node_struct->mc_nb)
+	{
+		_starpu_spin_unlock(&node_struct->mc_lock);
+		return 0;
 	}
+	if (_starpu_eviction_policy->prepare)
+		_starpu_eviction_policy->prepare(node);
+
+	_STARPU_MALLOC(ranked, node_struct->mc_nb * sizeof(*ranked));
+	for (mc = _starpu_mem_chunk_list_begin(&node_struct->mc_list);
+	     mc != _starpu_mem_chunk_list_end(&node_struct->mc_list);
+	     mc = _starpu_mem_chunk_list_next(mc))
+	{
+		if (mc->remove_notify)
+			/* Somebody already working here, skip */
+			continue;
+		STARPU_ASSERT(n < node_struct->mc_nb);
+		ranked[n].mc = mc;
+		ranked[n].rank = _starpu_eviction_policy->rank(mc, node);
+		ranked[n].idx = n;
+		n++;
+	}
+	qsort(ranked, n, sizeof(*ranked), ranked_mc_cmp);
+	for (i = 0; i < n; i++)
+		ranked[i].mc->remove_notify = &ranked[i].mc;
+
+	for (i = 0; i < n && (!reclaim || freed < reclaim); i++)
+	{
+		mc = ranked[i].mc;
+		if (!mc)
+			/* Dropped while we were not keeping the mc_lock */
+			continue;
+		STARPU_ASSERT(mc->remove_notify == &ranked[i].mc);
+		mc->remove_notify = NULL;
+		/* Note: this may unlock mc_list! */
+		freed += try_to_throw_mem_chunk(mc, node, NULL, 0, is_prefetch);
+	}
+
+	/* Release the candidates we did not need to try */
+	for (; i < n; i++)
+		if (ranked[i].mc)
+		{
+			STARPU_ASSERT(ranked[i].mc->remove_notify == &ranked[i].mc);
+			ranked[i].mc->remove_notify = NULL;
+		}
 	_starpu_spin_unlock(&node_struct->mc_lock);
-out:
+
+	free(ranked);
 	return freed;
 }
 
@@ -971,6 +1150,9 @@ static size_t free_potentially_in_use_mc(unsigned node, unsigned force, size_t r
 
 	struct _starpu_mem_chunk *mc, *next_mc;
 
+	if (!force && _starpu_eviction_policy->rank)
+		return free_potentially_in_use_mc_ranked(node, reclaim, is_prefetch);
+
 	/*
 	 * We have to unlock mc_lock before locking header_lock, so we have
 	 * to be careful with the list.  We try to do just one pass, by
@@ -1352,6 +1534,7 @@ static struct _starpu_mem_chunk *_starpu_memchunk_init(struct _starpu_data_repli
 	mc->size_interface = interface_size;
 	mc->remove_notify = NULL;
 	mc->wontuse = 0;
+	mc->nb_uses = 0;
 
 	return mc;
 }
@@ -1370,7 +1553,10 @@ static void register_mem_chunk(starpu_data_handle_t handle, struct _starpu_data_
 	mc = _starpu_memchunk_init(replicate, interface_size, (int) dst_node == handle->home_node, automatically_allocated);
 
 	_starpu_spin_lock(&node_struct->mc_lock);
+	mc->cache_entry = mc_cache_get_entry(node_struct, mc->footprint);
 	MC_LIST_PUSH_BACK(node_struct, mc);
+	if (_starpu_eviction_policy->allocated)
+		_starpu_eviction_policy->allocated(mc, dst_node);
 	_starpu_spin_unlock(&node_struct->mc_lock);
 }
 
@@ -1439,19 +1625,14 @@ void _starpu_request_mem_chunk_removal(starpu_data_handle_t handle, struct _star
 		memcpy(mc->chunk_interface, replicate->data_interface, mc->size_interface);
 
 		/* put it in the list of buffers to be removed */
-		uint32_t footprint = mc->footprint;
-		struct mc_cache_entry *entry;
+		struct mc_cache_entry *entry = mc->cache_entry;
 		_starpu_spin_lock(&node_struct->mc_lock);
-		HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
-		if (!entry)
-		{
-			_STARPU_MALLOC(entry, sizeof(*entry));
-			_starpu_mem_chunk_list_init(&entry->list);
-			entry->footprint = footprint;
-			HASH_ADD(hh, node_struct->mc_cache, footprint, sizeof(entry->footprint), entry);
-		}
 		node_struct->mc_cache_nb++;
 		node_struct->mc_cache_size += mc->size;
+		/* This bucket is now the most recently used */
+		if (!_starpu_mem_chunk_list_empty(&entry->list))
+			mc_cache_lru_remove(node_struct, entry);
+		mc_cache_lru_push_back(node_struct, entry);
 		_starpu_mem_chunk_list_push_front(&entry->list, mc);
 		_starpu_spin_unlock(&node_struct->mc_lock);
 	}
@@ -1705,6 +1886,8 @@ void _starpu_memchunk_recently_used(struct _starpu_mem_chunk *mc, unsigned node)
 	MC_LIST_ERASE(node_struct, mc);
 	mc->wontuse = 0;
 	MC_LIST_PUSH_BACK(node_struct, mc);
+	if (_starpu_eviction_policy->used)
+		_starpu_eviction_policy->used(mc, node);
 	_starpu_spin_unlock(&node_struct->mc_lock);
 }
 
@@ -1790,6 +1973,14 @@ void _starpu_memory_display_stats_by_node(FILE *stream, int node)
 
 	}
 
+	if (node_struct->mc_cache_hits || node_struct->mc_cache_misses || node_struct->mc_cache_nb)
+	{
+		fprintf(stream, "#-------\n");
+		fprintf(stream, "Allocation cache on Node #%d\n", node);
+		fprintf(stream, "\t%d chunks (%ld bytes) in %u size classes\n", node_struct->mc_cache_nb, (long) node_struct->mc_cache_size, HASH_COUNT(node_struct->mc_cache));
+		fprintf(stream, "\t%lu hits, %lu misses, %lu chunks flushed\n", node_struct->mc_cache_hits, node_struct->mc_cache_misses, node_struct->mc_cache_flushed);
+	}
+
 	_starpu_spin_unlock(&node_struct->mc_lock);
 }
 
@@ -32,6 +32,7 @@
 #pragma GCC visibility push(hidden)
 
 struct _starpu_data_replicate;
+struct mc_cache_entry;
 
 /** While associated with a handle, the content is protected by the handle lock, except a few fields
  */
@@ -40,6 +41,8 @@ LIST_TYPE(_starpu_mem_chunk,
 	starpu_data_handle_t data;
 
 	uint32_t footprint;
+	/** The allocation cache bucket for this footprint, protected by the mc_lock */
+	struct mc_cache_entry *cache_entry;
 
 	/*
 	 * When re-using a memchunk, the footprint of the data is not
@@ -64,6 +67,8 @@ LIST_TYPE(_starpu_mem_chunk,
 	unsigned clean:1;
 	/** Was this chunk marked as "won't use"? */
 	unsigned wontuse:1;
+	/** Number of uses, as counted by the eviction policy */
+	unsigned nb_uses;
 
 	/** the size of the data is only set when calling _starpu_request_mem_chunk_removal(),
 	 * it is needed to estimate how much memory is in mc_cache, and by
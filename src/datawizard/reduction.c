@@ -22,6 +22,7 @@
 #include <datawizard/datawizard.h>
 #include <drivers/mp_common/source_common.h>
 #include <datawizard/memory_nodes.h>
+#include <core/topology.h>
 
 void starpu_data_set_reduction_methods(starpu_data_handle_t handle,
 				       struct starpu_codelet *redux_cl,
@@ -196,6 +197,85 @@ void _starpu_data_start_reduction_mode(starpu_data_handle_t handle)
 
 //#define NO_TREE_REDUCTION
 
+#ifndef NO_TREE_REDUCTION
+/* Localization levels of the replicates, from the closest to the farthest */
+#define REDUX_NUMA	0	/* NUMA node of CPU workers */
+#define REDUX_NODE	1	/* memory node */
+#define REDUX_NLEVELS	2
+
+/* Append to plan the reduction steps of a binary tree over the n replicates
+ * of items, putting the result in items[0] */
+static unsigned redux_plan_tree(const unsigned *items, unsigned n, unsigned (*plan)[2], unsigned nplan)
+{
+	unsigned step, i;
+	for (step = 1; step < n; step *= 2)
+		for (i = 0; i + step < n; i += 2*step)
+		{
+			plan[nplan][0] = items[i];
+			plan[nplan][1] = items[i+step];
+			nplan++;
+		}
+	return nplan;
+}
+
+static int redux_key_cmp(const int (*key)[REDUX_NLEVELS], unsigned a, unsigned b, unsigned from_level)
+{
+	int level;
+	for (level = REDUX_NLEVELS-1; level >= (int) from_level; level--)
+		if (key[a][level] != key[b][level])
+			return key[a][level] < key[b][level] ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Compute the reduction steps for replicates 0..n-1, as pairs (dst, src) in
+ * an order compatible with their dependencies. Replicates are first reduced
+ * with the replicates of the same NUMA node, then of the same memory node,
+ * then all together, so that only one value crosses each NUMA or memory node
+ * boundary.
+ *
+ * key[i] contains the localization of replicate i at each level. The
+ * replicate which sorts first ends up containing the result, it is returned
+ * in root.
+ */
+static unsigned redux_plan(unsigned n, const int (*key)[REDUX_NLEVELS], unsigned (*plan)[2], unsigned *root)
+{
+	unsigned items[n];
+	unsigned nitems = n, nplan = 0, i, j;
+	unsigned level;
+
+	/* Sort by localization, keeping the original order for equal ones */
+	for (i = 0; i < n; i++)
+	{
+		unsigned item = i;
+		for (j = i; j > 0 && redux_key_cmp(key, items[j-1], item, 0) > 0; j--)
+			items[j] = items[j-1];
+		items[j] = item;
+	}
+
+	for (level = 0; level <= REDUX_NLEVELS; level++)
+	{
+		unsigned start, nroots = 0;
+
+		/* Reduce each group of replicates which share the same
+		 * localization from this level up, and keep their roots */
+		for (start = 0; start < nitems; start = i)
+		{
+			for (i = start + 1; i < nitems; i++)
+				if (redux_key_cmp(key, items[start], items[i], level))
+					break;
+			nplan = redux_plan_tree(&items[start], i - start, plan, nplan);
+			items[nroots++] = items[start];
+		}
+		nitems = nroots;
+	}
+	STARPU_ASSERT(nitems == 1 && nplan == n - 1);
+
+	*root = items[0];
+	return nplan;
+}
+#endif
+
 /* Force reduction. The lock should already have been taken.  */
 void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 {
@@ -206,6 +286,13 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 	/* Put every valid replicate in the same array */
 	unsigned replicate_count = 0;
 	starpu_data_handle_t replicate_array[1 + STARPU_NMAXWORKERS];
+#ifndef NO_TREE_REDUCTION
+	/* And where they are */
+	int replicate_key[1 + STARPU_NMAXWORKERS][REDUX_NLEVELS];
+	/* Reduction steps */
+	unsigned plan[STARPU_NMAXWORKERS][2];
+	unsigned nplan = 0, root = 0;
+#endif
 
 	_starpu_spin_checklocked(&handle->header_lock);
 
@@ -218,8 +305,12 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 
 #ifndef NO_TREE_REDUCTION
 	if (!empty)
-		/* Include the initial value into the reduction tree */
+	{
+		/* Include the initial value into the reduction tree, at the root */
+		replicate_key[replicate_count][REDUX_NUMA] = -1;
+		replicate_key[replicate_count][REDUX_NODE] = -1;
 		replicate_array[replicate_count++] = handle;
+	}
 #endif
 
 	/* Register all valid per-worker replicates */
@@ -239,6 +330,10 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 
 			starpu_data_set_sequential_consistency_flag(handle->reduction_tmp_handles[worker], 0);
 
+#ifndef NO_TREE_REDUCTION
+			replicate_key[replicate_count][REDUX_NUMA] = _starpu_get_cpu_worker_numa_node(worker);
+			replicate_key[replicate_count][REDUX_NODE] = home_node;
+#endif
 			replicate_array[replicate_count++] = handle->reduction_tmp_handles[worker];
 		}
 		else
@@ -248,6 +343,9 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 	}
 
 #ifndef NO_TREE_REDUCTION
+	if (replicate_count)
+		nplan = redux_plan(replicate_count, (const int (*)[REDUX_NLEVELS]) replicate_key, plan, &root);
+
 	if (empty)
 	{
 		/* Only the final copy will touch the actual handle */
@@ -255,14 +353,14 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 	}
 	else
 	{
-		unsigned step = 1;
+		unsigned i;
+		/* The initial value sorts first, it gets the result */
+		STARPU_ASSERT(root == 0);
 		handle->reduction_refcnt = 0;
-		while (step < replicate_count)
-		{
-			/* Each stage will touch the actual handle */
-			handle->reduction_refcnt++;
-			step *= 2;
-		}
+		for (i = 0; i < nplan; i++)
+			if (plan[i][0] == 0)
+				/* This step will touch the actual handle */
+				handle->reduction_refcnt++;
 	}
 #else
 	/* We know that in this reduction algorithm there is exactly one task per valid replicate. */
@@ -289,78 +387,73 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle)
 		memset(last_replicate_deps, 0, replicate_count*sizeof(struct starpu_task *));
 		struct starpu_task *redux_tasks[replicate_count];
 
-		/* Redux step-by-step for step from 1 to replicate_count/2, i.e.
-		 * 1-by-1, then 2-by-2, then 4-by-4, etc. */
-		unsigned step;
-		unsigned redux_task_idx = 0;
-		for (step = 1; step < replicate_count; step *=2)
+		/* Follow the reduction plan, each step depends on the
+		 * previous steps which touched its replicates */
+		unsigned redux_task_idx;
+		for (redux_task_idx = 0; redux_task_idx < nplan; redux_task_idx++)
 		{
-			unsigned i;
-			for (i = 0; i < replicate_count; i+=2*step)
+			unsigned dst = plan[redux_task_idx][0];
+			unsigned src = plan[redux_task_idx][1];
+
+			/* Perform the reduction between replicates dst
+			 * and src and put the result in replicate dst */
+			struct starpu_task *redux_task = starpu_task_create();
+			redux_task->name = "redux_task_between_replicates";
+
+			/* Mark these tasks so that StarPU does not block them
+			 * when they try to access the handle (normal tasks are
+			 * data requests to that handle are frozen until the
+			 * data is coherent again). */
+			struct _starpu_job *j = _starpu_get_job_associated_to_task(redux_task);
+			j->reduction_task = 1;
+
+			redux_task->cl = handle->redux_cl;
+			STARPU_ASSERT(redux_task->cl);
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0)))
+				STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_RW|STARPU_COMMUTE, 0);
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 1)))
+				STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_R, 1);
+
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0) & STARPU_COMMUTE))
 			{
-				if (i + step < replicate_count)
+				static int warned;
+				STARPU_HG_DISABLE_CHECKING(warned);
+				if (!warned)
 				{
-					/* Perform the reduction between replicates i
-					 * and i+step and put the result in replicate i */
-					struct starpu_task *redux_task = starpu_task_create();
-					redux_task->name = "redux_task_between_replicates";
-
-					/* Mark these tasks so that StarPU does not block them
-					 * when they try to access the handle (normal tasks are
-					 * data requests to that handle are frozen until the
-					 * data is coherent again). */
-					struct _starpu_job *j = _starpu_get_job_associated_to_task(redux_task);
-					j->reduction_task = 1;
-
-					redux_task->cl = handle->redux_cl;
-					STARPU_ASSERT(redux_task->cl);
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0)))
-						STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_RW|STARPU_COMMUTE, 0);
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 1)))
-						STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_R, 1);
-
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0) & STARPU_COMMUTE))
-					{
-						static int warned;
-						STARPU_HG_DISABLE_CHECKING(warned);
-						if (!warned)
-						{
-							warned = 1;
-							_STARPU_DISP("Warning: for reductions, codelet %p should have STARPU_COMMUTE along STARPU_RW\n", redux_task->cl);
-						}
-					}
-
-					STARPU_TASK_SET_HANDLE(redux_task, replicate_array[i], 0);
-					STARPU_TASK_SET_HANDLE(redux_task, replicate_array[i+step], 1);
-
-					int ndeps = 0;
-					struct starpu_task *task_deps[2];
-
-					if (last_replicate_deps[i])
-						task_deps[ndeps++] = last_replicate_deps[i];
-
-					if (last_replicate_deps[i+step])
-						task_deps[ndeps++] = last_replicate_deps[i+step];
-
-					/* i depends on this task */
-					last_replicate_deps[i] = redux_task;
-
-					/* we don't perform the reduction until both replicates are ready */
-					starpu_task_declare_deps_array(redux_task, ndeps, task_deps);
-
-					/* We cannot submit tasks here : we do
-					 * not want to depend on tasks that have
-					 * been completed, so we juste store
-					 * this task : it will be submitted
-					 * later. */
-					redux_tasks[redux_task_idx++] = redux_task;
+					warned = 1;
+					_STARPU_DISP("Warning: for reductions, codelet %p should have STARPU_COMMUTE along STARPU_RW\n", redux_task->cl);
 				}
 			}
+
+			STARPU_TASK_SET_HANDLE(redux_task, replicate_array[dst], 0);
+			STARPU_TASK_SET_HANDLE(redux_task, replicate_array[src], 1);
+
+			int ndeps = 0;
+			struct starpu_task *task_deps[2];
+
+			if (last_replicate_deps[dst])
+				task_deps[ndeps++] = last_replicate_deps[dst];
+
+			if (last_replicate_deps[src])
+				task_deps[ndeps++] = last_replicate_deps[src];
+
+			/* dst depends on this task */
+			last_replicate_deps[dst] = redux_task;
+
+			/* we don't perform the reduction until both replicates are ready */
+			starpu_task_declare_deps_array(redux_task, ndeps, task_deps);
+
+			/* We cannot submit tasks here : we do
+			 * not want to depend on tasks that have
+			 * been completed, so we juste store
+			 * this task : it will be submitted
+			 * later. */
+			redux_tasks[redux_task_idx] = redux_task;
 		}
 
 		if (empty)
 			/* The handle was empty, we just need to copy the reduced value. */
-			_starpu_data_cpy(handle, replicate_array[0], 1, NULL, 0, 1, last_replicate_deps[0], STARPU_DEFAULT_PRIO);
+			_starpu_data_cpy(handle, replicate_array[root], 1, NULL, 0, 1, last_replicate_deps[root], STARPU_DEFAULT_PRIO);
 
 		/* Let's submit all the reduction tasks. */
 		unsigned i;
@@ -32,6 +32,7 @@
 #include "starpu_fxt.h"
 #include <inttypes.h>
 #include <starpu_hash.h>
+#include <pthread.h>
 
 #define CPUS_WORKER_COLORS_NB	8
 #define ACCEL_WORKER_COLORS_NB	9
@@ -76,6 +77,37 @@ static FILE *comms_file;
 static FILE *sched_tasks_file;
 static FILE *number_events_file;
 
+/* The output files are written with a lot of small fprintf calls, give them
+ * big buffers. These are freed once all the files are closed at the end of
+ * the trace generation. */
+#define OUT_FILE_BUFFER_SIZE	(1024*1024)
+#define OUT_FILE_MAX_BUFFERS	16
+static char *out_file_buffers[OUT_FILE_MAX_BUFFERS];
+static unsigned out_file_nbuffers;
+
+FILE *_starpu_fxt_fopen(const char *path)
+{
+	FILE *file = fopen(path, "w+");
+	if (file && out_file_nbuffers < OUT_FILE_MAX_BUFFERS)
+	{
+		char *buffer;
+		_STARPU_MALLOC(buffer, OUT_FILE_BUFFER_SIZE);
+		if (setvbuf(file, buffer, _IOFBF, OUT_FILE_BUFFER_SIZE) == 0)
+			out_file_buffers[out_file_nbuffers++] = buffer;
+		else
+			free(buffer);
+	}
+	return file;
+}
+
+static void free_out_file_buffers(void)
+{
+	unsigned i;
+	for (i = 0; i < out_file_nbuffers; i++)
+		free(out_file_buffers[i]);
+	out_file_nbuffers = 0;
+}
+
 struct data_parameter_info
 {
 	unsigned long handle;
@@ -1151,9 +1183,28 @@ static void mpicommthread_pop_state(double time, const char *prefix)
 #endif
 }
 
-static void recfmt_dump_state(double time, const char *event, int workerid, long int threadid, const char *name, const char *type)
+/* Whether the states have to be dumped in trace.rec or trace.bin */
+static int recfmt_enabled(void)
 {
-	fprintf(trace_file, "E: %s\n", event);
+	return trace_file || _starpu_trace_bin_is_enabled();
+}
+
+static const char *recfmt_event_names[] =
+{
+	[_STARPU_TRACE_BIN_SET_STATE] = "SetState",
+	[_STARPU_TRACE_BIN_PUSH_STATE] = "PushState",
+	[_STARPU_TRACE_BIN_POP_STATE] = "PopState",
+	[_STARPU_TRACE_BIN_PROG_EVENT] = "ProgEvent",
+};
+
+static void recfmt_dump_state(double time, enum _starpu_trace_bin_event_type event, int workerid, long int threadid, const char *name, const char *type)
+{
+	_starpu_trace_bin_dump_state(time, event, workerid, threadid, name, type);
+
+	if (!trace_file)
+		return;
+
+	fprintf(trace_file, "E: %s\n", recfmt_event_names[event]);
 	if (name)
 		fprintf(trace_file, "N: %s\n", name);
 	if (type)
@@ -1169,17 +1220,17 @@ static void recfmt_dump_state(double time, const char *event, int workerid, long
 
 static void recfmt_set_state(double time, int workerid, long int threadid, const char *name, const char *type)
 {
-	recfmt_dump_state(time, "SetState", workerid, threadid, name, type);
+	recfmt_dump_state(time, _STARPU_TRACE_BIN_SET_STATE, workerid, threadid, name, type);
 }
 
 static void recfmt_push_state(double time, int workerid, long unsigned int threadid, const char *name, const char *type)
 {
-	recfmt_dump_state(time, "PushState", workerid, threadid, name, type);
+	recfmt_dump_state(time, _STARPU_TRACE_BIN_PUSH_STATE, workerid, threadid, name, type);
 }
 
 static void recfmt_pop_state(double time, int workerid, long unsigned int threadid)
 {
-	recfmt_dump_state(time, "PopState", workerid, threadid, NULL, NULL);
+	recfmt_dump_state(time, _STARPU_TRACE_BIN_POP_STATE, workerid, threadid, NULL, NULL);
 }
 
 static void recfmt_worker_set_state(double time, int workerid, const char *name, const char *type)
@@ -1254,7 +1305,7 @@ static void do_worker_set_state(double time, const char *prefix, int workerid, c
 {
 	if (out_paje_file)
 		worker_set_state(time, prefix, workerid, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_worker_set_state(time, workerid, name, type);
 }
 
@@ -1262,7 +1313,7 @@ static void do_thread_set_state(double time, const char *prefix, long unsigned i
 {
 	if (out_paje_file)
 		thread_set_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_thread_set_state(time, prefixTOnodeid(prefix), threadid, name, type);
 }
 
@@ -1270,7 +1321,7 @@ static void do_thread_push_state(double time, const char *prefix, long unsigned
 {
 	if (out_paje_file)
 		thread_push_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_thread_push_state(time, prefixTOnodeid(prefix), threadid, name, type);
 }
 
@@ -1278,7 +1329,7 @@ static void do_thread_pop_state(double time, const char *prefix, long unsigned i
 {
 	if (out_paje_file)
 		thread_pop_state(time, prefix, threadid);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_thread_pop_state(time, prefixTOnodeid(prefix), threadid);
 }
 
@@ -1286,7 +1337,7 @@ static void do_mpicommthread_set_state(double time, const char *prefix, const ch
 {
 	if (out_paje_file)
 		mpicommthread_set_state(time, prefix, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_mpicommthread_set_state(time, name);
 }
 
@@ -1294,7 +1345,7 @@ static void do_mpicommthread_push_state(double time, const char *prefix, const c
 {
 	if (out_paje_file)
 		mpicommthread_push_state(time, prefix, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_mpicommthread_push_state(time, name);
 }
 
@@ -1302,7 +1353,7 @@ static void do_mpicommthread_pop_state(double time, const char *prefix)
 {
 	if (out_paje_file)
 		mpicommthread_pop_state(time, prefix);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_mpicommthread_pop_state(time);
 }
 
@@ -1310,7 +1361,7 @@ static void do_user_thread_push_state(double time, const char *prefix, long unsi
 {
 	if (out_paje_file)
 		user_thread_push_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_user_thread_push_state(time, threadid, name, type);
 }
 
@@ -1318,7 +1369,7 @@ static void do_user_thread_pop_state(double time, const char *prefix, long unsig
 {
 	if (out_paje_file)
 		user_thread_pop_state(time, prefix, threadid);
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_user_thread_pop_state(time, threadid);
 }
 
@@ -1556,7 +1607,7 @@ static void handle_worker_deinit_end(struct fxt_ev_64 *ev, struct starpu_fxt_opt
 			get_event_time_stamp(ev, options), prefix, ev->param[1]);
 #endif
 	}
-	if (trace_file)
+	if (recfmt_enabled())
 		recfmt_thread_set_state(get_event_time_stamp(ev, options), prefixTOnodeid(prefix), ev->param[1], "End", NULL);
 }
 
@@ -3482,8 +3533,8 @@ static void handle_string_event(struct fxt_ev_64 *ev, const char *event, struct
 #endif
 	}
 
-	if (trace_file)
-		recfmt_dump_state(get_event_time_stamp(ev, options), "ProgEvent", -1, 0, event, "Program");
+	if (recfmt_enabled())
+		recfmt_dump_state(get_event_time_stamp(ev, options), _STARPU_TRACE_BIN_PROG_EVENT, -1, 0, event, "Program");
 }
 
 static void handle_event(struct fxt_ev_64 *ev, struct starpu_fxt_options *options)
@@ -3589,28 +3640,266 @@ void _starpu_fxt_process_computations(struct starpu_fxt_options *options)
 	}
 }
 
-static
-void _starpu_fxt_parse_new_file(char *filename_in, struct starpu_fxt_options *options)
+/*
+ * The events of a trace file are decoded by a reader thread, which hands them
+ * over by chunks to the thread running the handlers, so that decoding the
+ * file and generating the outputs proceed in parallel. The number of pending
+ * chunks is bounded, so the whole file is never loaded in memory. With
+ * options->nthreads == 1, the chunks are rather decoded on demand by the
+ * thread running the handlers.
+ */
+
+#define READER_CHUNK_NEVENTS	4096
+#define READER_MAX_CHUNKS	16
+
+/* The converter does not run within StarPU, also in simgrid builds, so use
+ * plain pthreads, and check them like STARPU_PTHREAD_* do */
+#define READER_PTHREAD_CHECK(call)						\
+	do {									\
+		int p_ret = (call);						\
+		if (STARPU_UNLIKELY(p_ret))					\
+		{								\
+			fprintf(stderr, "%s:%d %s: %s\n",			\
+				__FILE__, __LINE__, #call, strerror(p_ret));	\
+			STARPU_ABORT();						\
+		}								\
+	}									\
+	while (0)
+
+/* libfxt is not documented to be thread-safe, so it is only called by one
+ * thread at a time. The handlers do not need it, and still run in parallel */
+static pthread_mutex_t fxt_lib_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct reader_chunk
+{
+	struct reader_chunk *next;
+	unsigned nevents;
+	struct fxt_ev_64 events[READER_CHUNK_NEVENTS];
+};
+
+struct reader
 {
-	/* Open the trace file */
+	char *filename;
 	int fd_in;
-	fd_in = open(filename_in, O_RDONLY);
-	if (fd_in < 0)
+	fxt_t fut;
+	fxt_blockev_t block;
+
+	/* Whether the events are decoded by a reader thread */
+	int threaded;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	/* Chunks decoded by the reader thread, not processed yet */
+	struct reader_chunk *first;
+	struct reader_chunk *last;
+	unsigned nchunks;
+	/* Whether the whole file has been decoded */
+	int finished;
+	/* Chunks already processed, which can be filled again */
+	struct reader_chunk *free_chunks;
+
+	/* Chunk being processed, and next event to process in it */
+	struct reader_chunk *current;
+	unsigned next;
+};
+
+static void reader_open(struct reader *reader)
+{
+	/* Open the trace file */
+	reader->fd_in = open(reader->filename, O_RDONLY);
+	if (reader->fd_in < 0)
 	{
-		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", filename_in, strerror(errno));
+		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", reader->filename, strerror(errno));
 	}
 
-	static fxt_t fut;
-	fut = fxt_fdopen(fd_in);
-	if (!fut)
+	READER_PTHREAD_CHECK(pthread_mutex_lock(&fxt_lib_mutex));
+	reader->fut = fxt_fdopen(reader->fd_in);
+	if (!reader->fut)
 	{
 		perror("fxt_fdopen :");
 		exit(-1);
 	}
 
-	fxt_blockev_t block;
-	block = fxt_blockev_enter(fut);
+	reader->block = fxt_blockev_enter(reader->fut);
+	READER_PTHREAD_CHECK(pthread_mutex_unlock(&fxt_lib_mutex));
+}
+
+/* Decode the next events of the file into chunk, return 0 at the end of the
+ * file */
+static int reader_fill(struct reader *reader, struct reader_chunk *chunk)
+{
+	int ret = FXT_EV_OK;
 
+	READER_PTHREAD_CHECK(pthread_mutex_lock(&fxt_lib_mutex));
+	for (chunk->nevents = 0; chunk->nevents < READER_CHUNK_NEVENTS; chunk->nevents++)
+	{
+		struct fxt_ev_64 *ev = &chunk->events[chunk->nevents];
+		unsigned i;
+		ret = fxt_next_ev(reader->block, FXT_EV_TYPE_64, (struct fxt_ev *)ev);
+		if (ret != FXT_EV_OK)
+			break;
+		for (i = ev->nb_params; i < FXT_MAX_PARAMS; i++)
+			ev->param[i] = 0;
+	}
+	READER_PTHREAD_CHECK(pthread_mutex_unlock(&fxt_lib_mutex));
+
+	return ret == FXT_EV_OK;
+}
+
+static void reader_close(struct reader *reader)
+{
+	READER_PTHREAD_CHECK(pthread_mutex_lock(&fxt_lib_mutex));
+#ifdef HAVE_FXT_BLOCKEV_LEAVE
+	fxt_blockev_leave(reader->block);
+#endif
+
+	/* Close the trace file */
+#ifdef HAVE_FXT_CLOSE
+	fxt_close(reader->fut);
+#else
+	if (close(reader->fd_in))
+	{
+		perror("close failed :");
+		exit(-1);
+	}
+#endif
+	READER_PTHREAD_CHECK(pthread_mutex_unlock(&fxt_lib_mutex));
+}
+
+static void *reader_thread(void *arg)
+{
+	struct reader *reader = arg;
+	int more = 1;
+
+	reader_open(reader);
+
+	while (more)
+	{
+		struct reader_chunk *chunk;
+
+		/* Wait for the handlers to catch up if we are too much ahead */
+		READER_PTHREAD_CHECK(pthread_mutex_lock(&reader->mutex));
+		while (reader->nchunks >= READER_MAX_CHUNKS)
+			READER_PTHREAD_CHECK(pthread_cond_wait(&reader->cond, &reader->mutex));
+		chunk = reader->free_chunks;
+		if (chunk)
+			reader->free_chunks = chunk->next;
+		READER_PTHREAD_CHECK(pthread_mutex_unlock(&reader->mutex));
+
+		if (!chunk)
+			_STARPU_MALLOC(chunk, sizeof(*chunk));
+
+		more = reader_fill(reader, chunk);
+
+		chunk->next = NULL;
+		READER_PTHREAD_CHECK(pthread_mutex_lock(&reader->mutex));
+		if (reader->last)
+			reader->last->next = chunk;
+		else
+			reader->first = chunk;
+		reader->last = chunk;
+		reader->nchunks++;
+		if (!more)
+			reader->finished = 1;
+		READER_PTHREAD_CHECK(pthread_cond_broadcast(&reader->cond));
+		READER_PTHREAD_CHECK(pthread_mutex_unlock(&reader->mutex));
+	}
+
+	reader_close(reader);
+	return NULL;
+}
+
+/* Start decoding the given file, in the background if threaded */
+static struct reader *reader_start(char *filename, int threaded)
+{
+	struct reader *reader;
+	_STARPU_CALLOC(reader, 1, sizeof(*reader));
+	reader->filename = filename;
+	reader->threaded = threaded;
+	if (threaded)
+	{
+		READER_PTHREAD_CHECK(pthread_mutex_init(&reader->mutex, NULL));
+		READER_PTHREAD_CHECK(pthread_cond_init(&reader->cond, NULL));
+		READER_PTHREAD_CHECK(pthread_create(&reader->thread, NULL, reader_thread, reader));
+	}
+	else
+		reader_open(reader);
+	return reader;
+}
+
+/* Get the next event of the file, return 0 at the end of the file */
+static int reader_next_ev(struct reader *reader, struct fxt_ev_64 *ev)
+{
+	if (!reader->threaded)
+	{
+		/* Decode the next chunk ourselves */
+		while (!reader->current || reader->next == reader->current->nevents)
+		{
+			if (reader->finished)
+				return 0;
+			if (!reader->current)
+				_STARPU_MALLOC(reader->current, sizeof(*reader->current));
+			reader->finished = !reader_fill(reader, reader->current);
+			reader->next = 0;
+		}
+	}
+	else while (!reader->current || reader->next == reader->current->nevents)
+	{
+		READER_PTHREAD_CHECK(pthread_mutex_lock(&reader->mutex));
+		if (reader->current)
+		{
+			reader->current->next = reader->free_chunks;
+			reader->free_chunks = reader->current;
+			reader->current = NULL;
+		}
+		while (!reader->first && !reader->finished)
+			READER_PTHREAD_CHECK(pthread_cond_wait(&reader->cond, &reader->mutex));
+		if (!reader->first)
+		{
+			READER_PTHREAD_CHECK(pthread_mutex_unlock(&reader->mutex));
+			return 0;
+		}
+		reader->current = reader->first;
+		reader->first = reader->current->next;
+		if (!reader->first)
+			reader->last = NULL;
+		reader->nchunks--;
+		READER_PTHREAD_CHECK(pthread_cond_broadcast(&reader->cond));
+		READER_PTHREAD_CHECK(pthread_mutex_unlock(&reader->mutex));
+		reader->next = 0;
+	}
+	*ev = reader->current->events[reader->next++];
+	return 1;
+}
+
+/* Wait for the reader thread to finish, and free the reader */
+static void reader_stop(struct reader *reader)
+{
+	struct reader_chunk *chunk, *next;
+
+	if (reader->threaded)
+	{
+		READER_PTHREAD_CHECK(pthread_join(reader->thread, NULL));
+		READER_PTHREAD_CHECK(pthread_cond_destroy(&reader->cond));
+		READER_PTHREAD_CHECK(pthread_mutex_destroy(&reader->mutex));
+	}
+	else
+		reader_close(reader);
+
+	STARPU_ASSERT(!reader->first);
+	free(reader->current);
+	for (chunk = reader->free_chunks; chunk; chunk = next)
+	{
+		next = chunk->next;
+		free(chunk);
+	}
+	free(reader);
+}
+
+static
+void _starpu_fxt_parse_new_file(struct reader *reader, struct starpu_fxt_options *options)
+{
 	char *prefix = options->file_prefix;
 
 	/* TODO starttime ...*/
@@ -3664,17 +3953,8 @@ void _starpu_fxt_parse_new_file(char *filename_in, struct starpu_fxt_options *op
 		show_mpi_thread(options);
 
 	struct fxt_ev_64 ev;
-	while(1)
+	while (reader_next_ev(reader, &ev))
 	{
-		unsigned i;
-		int ret = fxt_next_ev(block, FXT_EV_TYPE_64, (struct fxt_ev *)&ev);
-		for (i = ev.nb_params; i < FXT_MAX_PARAMS; i++)
-			ev.param[i] = 0;
-		if (ret != FXT_EV_OK)
-		{
-			break;
-		}
-
 		if (number_events_file != NULL)
 		{
 			assert(number_events != NULL);
@@ -4487,21 +4767,6 @@ void _starpu_fxt_parse_new_file(char *filename_in, struct starpu_fxt_options *op
 	_starpu_fxt_component_deinit();
 
 	free_worker_ids();
-
-#ifdef HAVE_FXT_BLOCKEV_LEAVE
-	fxt_blockev_leave(block);
-#endif
-
-	/* Close the trace file */
-#ifdef HAVE_FXT_CLOSE
-	fxt_close(fut);
-#else
-	if (close(fd_in))
-	{
-		perror("close failed :");
-		exit(-1);
-	}
-#endif
 }
 
 /* Initialize FxT options to default values */
@@ -4516,6 +4781,7 @@ void starpu_fxt_options_init(struct starpu_fxt_options *options)
 	options->papi_path = strdup("papi.rec");
 	options->anim_path = strdup("trace.html");
 	options->states_path = strdup("trace.rec");
+	options->states_bin_path = strdup("trace.bin");
 	options->distrib_time_path = strdup("distrib.data");
 	options->activity_path = strdup("activity.data");
 	options->sched_tasks_path = strdup("sched_tasks.rec");
@@ -4550,6 +4816,7 @@ void _starpu_fxt_options_set_dir(struct starpu_fxt_options *options)
 	_set_dir(options->dir, &options->papi_path);
 	_set_dir(options->dir, &options->anim_path);
 	_set_dir(options->dir, &options->states_path);
+	_set_dir(options->dir, &options->states_bin_path);
 	_set_dir(options->dir, &options->distrib_time_path);
 	_set_dir(options->dir, &options->activity_path);
 	_set_dir(options->dir, &options->sched_tasks_path);
@@ -4566,6 +4833,7 @@ void starpu_fxt_options_shutdown(struct starpu_fxt_options *options)
 	free(options->papi_path);
 	free(options->anim_path);
 	free(options->states_path);
+	free(options->states_bin_path);
 	free(options->distrib_time_path);
 	free(options->activity_path);
 	free(options->sched_tasks_path);
@@ -4579,7 +4847,7 @@ void _starpu_fxt_distrib_file_init(struct starpu_fxt_options *options)
 
 	if (options->distrib_time_path)
 	{
-		distrib_time = fopen(options->distrib_time_path, "w+");
+		distrib_time = _starpu_fxt_fopen(options->distrib_time_path);
 		if (distrib_time == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->distrib_time_path, strerror(errno));
 	}
@@ -4607,7 +4875,7 @@ void _starpu_fxt_activity_file_init(struct starpu_fxt_options *options)
 {
 	if (options->activity_path)
 	{
-		activity_file = fopen(options->activity_path, "w+");
+		activity_file = _starpu_fxt_fopen(options->activity_path);
 		if (activity_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->activity_path, strerror(errno));
 	}
@@ -4620,7 +4888,7 @@ void _starpu_fxt_sched_tasks_file_init(struct starpu_fxt_options *options)
 {
 	if (options->sched_tasks_path)
 	{
-		sched_tasks_file = fopen(options->sched_tasks_path, "w+");
+		sched_tasks_file = _starpu_fxt_fopen(options->sched_tasks_path);
 		if (sched_tasks_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->sched_tasks_path, strerror(errno));
 	}
@@ -4633,7 +4901,7 @@ void _starpu_fxt_anim_file_init(struct starpu_fxt_options *options)
 {
 	if (options->anim_path)
 	{
-		anim_file = fopen(options->anim_path, "w+");
+		anim_file = _starpu_fxt_fopen(options->anim_path);
 		if (anim_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->anim_path, strerror(errno));
 
@@ -4648,7 +4916,7 @@ void _starpu_fxt_tasks_file_init(struct starpu_fxt_options *options)
 {
 	if (options->tasks_path)
 	{
-		tasks_file = fopen(options->tasks_path, "w+");
+		tasks_file = _starpu_fxt_fopen(options->tasks_path);
 		if (tasks_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->tasks_path, strerror(errno));
 	}
@@ -4661,7 +4929,7 @@ void _starpu_fxt_data_file_init(struct starpu_fxt_options *options)
 {
 	if (options->data_path)
 	{
-		data_file = fopen(options->data_path, "w+");
+		data_file = _starpu_fxt_fopen(options->data_path);
 		if (data_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->data_path, strerror(errno));
 	}
@@ -4674,7 +4942,7 @@ void _starpu_fxt_comms_file_init(struct starpu_fxt_options *options)
 {
 	if (options->comms_path)
 	{
-		comms_file = fopen(options->comms_path, "w+");
+		comms_file = _starpu_fxt_fopen(options->comms_path);
 		if (comms_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->comms_path, strerror(errno));
 	}
@@ -4687,7 +4955,7 @@ void _starpu_fxt_number_events_file_init(struct starpu_fxt_options *options)
 {
 	if (options->number_events_path)
 	{
-		number_events_file = fopen(options->number_events_path, "w+");
+		number_events_file = _starpu_fxt_fopen(options->number_events_path);
 		if (number_events_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->number_events_path, strerror(errno));
 
@@ -4704,7 +4972,7 @@ void _starpu_fxt_papi_file_init(struct starpu_fxt_options *options)
 #ifdef STARPU_PAPI
 	if (options->papi_path)
 	{
-		papi_file = fopen(options->papi_path, "w+");
+		papi_file = _starpu_fxt_fopen(options->papi_path);
 		if (papi_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->papi_path, strerror(errno));
 	}
@@ -4734,7 +5002,7 @@ void _starpu_fxt_trace_file_init(struct starpu_fxt_options *options)
 {
 	if (options->states_path)
 	{
-		trace_file = fopen(options->states_path, "w+");
+		trace_file = _starpu_fxt_fopen(options->states_path);
 		if (trace_file == NULL)
 			STARPU_ABORT_MSG("Failed to open '%s' (err %s)", options->states_path, strerror(errno));
 	}
@@ -4837,7 +5105,7 @@ void _starpu_fxt_paje_file_init(struct starpu_fxt_options *options)
 	/* create a new file */
 	if (options->out_paje_path)
 	{
-		out_paje_file = fopen(options->out_paje_path, "w+");
+		out_paje_file = _starpu_fxt_fopen(options->out_paje_path);
 		if (!out_paje_file)
 		{
 			_STARPU_MSG("error while opening %s\n", options->out_paje_path);
@@ -4901,7 +5169,7 @@ uint64_t _starpu_fxt_find_start_time(char *filename_in)
 		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", filename_in, strerror(errno));
 	}
 
-	static fxt_t fut;
+	fxt_t fut;
 	fut = fxt_fdopen(fd_in);
 	if (!fut)
 	{
@@ -4949,6 +5217,7 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 	_starpu_fxt_comms_file_init(options);
 	_starpu_fxt_number_events_file_init(options);
 	_starpu_fxt_trace_file_init(options);
+	_starpu_trace_bin_init(options->states_bin_path);
 
 	_starpu_fxt_paje_file_init(options);
 
@@ -4965,7 +5234,9 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 		options->file_offset.offset_start = -file_start_time;
 		options->file_rank = -1;
 
-		_starpu_fxt_parse_new_file(options->filenames[0], options);
+		struct reader *reader = reader_start(options->filenames[0], options->nthreads != 1);
+		_starpu_fxt_parse_new_file(reader, options);
+		reader_stop(reader);
 	}
 	else
 	{
@@ -5074,10 +5345,14 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 			}
 		}
 
-		/* generate the Paje trace for the different files */
+		/* generate the Paje trace for the different files, while
+		 * decoding the next file in advance */
+		struct reader *next_reader = reader_start(options->filenames[0], options->nthreads != 1);
 		for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
 		{
 			int filerank = rank_k[inputfile];
+			struct reader *reader = next_reader;
+			next_reader = inputfile + 1 < options->ninputfiles ? reader_start(options->filenames[inputfile + 1], options->nthreads != 1) : NULL;
 
 			_STARPU_DISP("Parsing file %s (rank %d)\n", options->filenames[inputfile], filerank);
 
@@ -5089,7 +5364,8 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 			options->file_offset = sync_barriers[inputfile];
 			options->file_rank = filerank;
 
-			_starpu_fxt_parse_new_file(options->filenames[inputfile], options);
+			_starpu_fxt_parse_new_file(reader, options);
+			reader_stop(reader);
 		}
 
 		/* display the MPI transfers if possible */
@@ -5109,8 +5385,10 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 	_starpu_fxt_comms_file_close();
 	_starpu_fxt_number_events_file_close();
 	_starpu_fxt_trace_file_close();
+	_starpu_trace_bin_terminate();
 
 	_starpu_fxt_dag_terminate();
+	free_out_file_buffers();
 
 	options->nworkers = nworkers;
 	free(options->file_prefix);
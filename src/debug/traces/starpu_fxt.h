@@ -40,6 +40,7 @@
 #include "../mpi/src/starpu_mpi_fxt.h"
 #include <starpu.h>
 #include "../../../include/starpu_fxt.h"
+#include "starpu_trace_bin.h"
 
 #ifdef STARPU_HAVE_POTI
 #include <poti.h>
@@ -51,6 +52,8 @@
 
 extern char _starpu_last_codelet_symbol[STARPU_NMAXWORKERS][(FXT_MAX_PARAMS-5)*sizeof(unsigned long)];
 
+FILE *_starpu_fxt_fopen(const char *path);
+
 void _starpu_fxt_dag_init(char *dag_filename);
 void _starpu_fxt_dag_terminate(void);
 void _starpu_fxt_dag_add_tag(const char *prefix, uint64_t tag, unsigned long job_id, const char *label);
@@ -84,6 +87,11 @@ void _starpu_fxt_display_mpi_transfers(struct starpu_fxt_options *options, int *
 
 void _starpu_fxt_write_paje_header(FILE *file, struct starpu_fxt_options *options);
 
+void _starpu_trace_bin_init(const char *path);
+int _starpu_trace_bin_is_enabled(void);
+void _starpu_trace_bin_dump_state(double time, enum _starpu_trace_bin_event_type type, int workerid, long threadid, const char *name, const char *category);
+void _starpu_trace_bin_terminate(void);
+
 extern int _starpu_poti_extendedSetState;
 extern int _starpu_poti_semiExtendedSetState;
 extern int _starpu_poti_MemoryEvent;
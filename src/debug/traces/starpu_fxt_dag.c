@@ -34,7 +34,7 @@ void _starpu_fxt_dag_init(char *out_path)
 	}
 
 	/* create a new file */
-	out_file = fopen(out_path, "w+");
+	out_file = _starpu_fxt_fopen(out_path);
 	if (!out_file)
 	{
 		_STARPU_MSG("error while opening %s\n", out_path);
@@ -58,7 +58,7 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 		exit(-1);
 	}
 
-	static fxt_t fut;
+	fxt_t fut;
 	fut = fxt_fdopen(fd_in);
 	if (!fut)
 	{
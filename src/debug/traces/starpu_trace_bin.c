@@ -0,0 +1,195 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <common/config.h>
+#include <common/uthash.h>
+
+#ifdef STARPU_USE_FXT
+
+#include "starpu_fxt.h"
+#include "starpu_trace_bin.h"
+
+/*
+ * Write the states of trace.rec in the binary format described in
+ * starpu_trace_bin.h. Events are accumulated by columns, and written as one
+ * record every _STARPU_TRACE_BIN_NEVENTS events.
+ */
+
+static FILE *bin_file;
+
+static struct bin_string
+{
+	UT_hash_handle hh;
+	char *str;
+	uint32_t id;
+} *bin_strings;
+static uint32_t bin_nstrings;
+
+static uint32_t bin_nevents;
+static double *bin_time;
+static int64_t *bin_thread;
+static int32_t *bin_worker;
+static uint32_t *bin_name;
+static uint32_t *bin_category;
+static uint8_t *bin_type;
+
+static void bin_write(const void *ptr, size_t size)
+{
+	if (size && fwrite(ptr, size, 1, bin_file) != 1)
+		STARPU_ABORT_MSG("Failed to write the binary trace (err %s)", strerror(errno));
+}
+
+static void bin_write_record(uint32_t type, uint32_t n, uint64_t size)
+{
+	struct _starpu_trace_bin_record record = { .type = type, .n = n, .size = size };
+	bin_write(&record, sizeof(record));
+}
+
+static void bin_write_padding(uint64_t written, uint64_t size)
+{
+	static const char zeroes[8];
+	STARPU_ASSERT(size >= written && size - written < sizeof(zeroes));
+	bin_write(zeroes, size - written);
+}
+
+/* Get the identifier of a string, writing it to the file if it is new */
+static uint32_t bin_get_string(const char *str)
+{
+	struct bin_string *string;
+
+	if (!str)
+		return 0;
+
+	HASH_FIND_STR(bin_strings, str, string);
+	if (!string)
+	{
+		size_t len = strlen(str) + 1;
+		uint64_t size = (len + 7) & ~(uint64_t) 7;
+
+		_STARPU_MALLOC(string, sizeof(*string));
+		string->str = strdup(str);
+		string->id = ++bin_nstrings;
+		HASH_ADD_KEYPTR(hh, bin_strings, string->str, len - 1, string);
+
+		bin_write_record(_STARPU_TRACE_BIN_STRING, len, size);
+		bin_write(str, len);
+		bin_write_padding(len, size);
+	}
+	return string->id;
+}
+
+static void bin_flush(void)
+{
+	uint32_t n = bin_nevents;
+	uint64_t size = _starpu_trace_bin_events_size(n);
+
+	if (!n)
+		return;
+
+	bin_write_record(_STARPU_TRACE_BIN_EVENTS, n, size);
+	bin_write(bin_time, n * sizeof(*bin_time));
+	bin_write(bin_thread, n * sizeof(*bin_thread));
+	bin_write(bin_worker, n * sizeof(*bin_worker));
+	bin_write(bin_name, n * sizeof(*bin_name));
+	bin_write(bin_category, n * sizeof(*bin_category));
+	bin_write(bin_type, n * sizeof(*bin_type));
+	bin_write_padding(n * (sizeof(*bin_time) + sizeof(*bin_thread) + sizeof(*bin_worker) + sizeof(*bin_name) + sizeof(*bin_category) + sizeof(*bin_type)), size);
+
+	bin_nevents = 0;
+}
+
+void _starpu_trace_bin_init(const char *path)
+{
+	struct _starpu_trace_bin_header header = { .version = _STARPU_TRACE_BIN_VERSION, .one = 1 };
+
+	if (!path)
+	{
+		bin_file = NULL;
+		return;
+	}
+
+	bin_file = fopen(path, "wb");
+	if (!bin_file)
+		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", path, strerror(errno));
+
+	memcpy(header.magic, _STARPU_TRACE_BIN_MAGIC, sizeof(header.magic));
+	bin_write(&header, sizeof(header));
+
+	bin_strings = NULL;
+	bin_nstrings = 0;
+	bin_nevents = 0;
+	_STARPU_MALLOC(bin_time, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_time));
+	_STARPU_MALLOC(bin_thread, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_thread));
+	_STARPU_MALLOC(bin_worker, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_worker));
+	_STARPU_MALLOC(bin_name, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_name));
+	_STARPU_MALLOC(bin_category, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_category));
+	_STARPU_MALLOC(bin_type, _STARPU_TRACE_BIN_NEVENTS * sizeof(*bin_type));
+}
+
+int _starpu_trace_bin_is_enabled(void)
+{
+	return bin_file != NULL;
+}
+
+void _starpu_trace_bin_dump_state(double time, enum _starpu_trace_bin_event_type type, int workerid, long threadid, const char *name, const char *category)
+{
+	uint32_t n;
+
+	if (!bin_file)
+		return;
+
+	n = bin_nevents;
+	bin_time[n] = time;
+	bin_thread[n] = threadid;
+	bin_worker[n] = workerid;
+	bin_name[n] = bin_get_string(name);
+	bin_category[n] = bin_get_string(category);
+	bin_type[n] = type;
+
+	if (++bin_nevents == _STARPU_TRACE_BIN_NEVENTS)
+		bin_flush();
+}
+
+void _starpu_trace_bin_terminate(void)
+{
+	struct bin_string *string, *tmp;
+
+	if (!bin_file)
+		return;
+
+	bin_flush();
+	if (fclose(bin_file))
+		STARPU_ABORT_MSG("Failed to close the binary trace (err %s)", strerror(errno));
+	bin_file = NULL;
+
+	HASH_ITER(hh, bin_strings, string, tmp)
+	{
+		HASH_DEL(bin_strings, string);
+		free(string->str);
+		free(string);
+	}
+
+	free(bin_time);
+	free(bin_thread);
+	free(bin_worker);
+	free(bin_name);
+	free(bin_category);
+	free(bin_type);
+}
+
+#endif /* STARPU_USE_FXT */
@@ -0,0 +1,121 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __STARPU_TRACE_BIN_H__
+#define __STARPU_TRACE_BIN_H__
+
+/** @file */
+
+#include <stdint.h>
+
+/*
+ * Binary version of the trace.rec file, which can be mapped in memory and
+ * analyzed without parsing text.
+ *
+ * The file starts with a struct _starpu_trace_bin_header, followed by
+ * records, each of them made of a struct _starpu_trace_bin_record followed by
+ * \p size bytes of payload. The payload sizes are multiples of 8 bytes, so
+ * that all records are aligned.
+ *
+ * A _STARPU_TRACE_BIN_STRING record contains a null-terminated string of \p n
+ * bytes (including the null byte), which gets the next string identifier.
+ * String identifiers start from 1, 0 means no string. A string is always
+ * defined before the events which use it.
+ *
+ * A _STARPU_TRACE_BIN_EVENTS record contains \p n events, stored by columns
+ * in the following order:
+ *	double time[n];		start time, in us
+ *	int64_t thread[n];	thread id, -1 if none
+ *	int32_t worker[n];	worker id, -1 if none
+ *	uint32_t name[n];	string identifier of the state name
+ *	uint32_t category[n];	string identifier of the state category
+ *	uint8_t type[n];	enum _starpu_trace_bin_event_type
+ */
+
+#define _STARPU_TRACE_BIN_MAGIC		"STPUTBIN"
+#define _STARPU_TRACE_BIN_VERSION	1
+/** Maximum number of events in an events record */
+#define _STARPU_TRACE_BIN_NEVENTS	65536
+
+enum _starpu_trace_bin_record_type
+{
+	_STARPU_TRACE_BIN_STRING,
+	_STARPU_TRACE_BIN_EVENTS,
+};
+
+enum _starpu_trace_bin_event_type
+{
+	_STARPU_TRACE_BIN_SET_STATE,
+	_STARPU_TRACE_BIN_PUSH_STATE,
+	_STARPU_TRACE_BIN_POP_STATE,
+	_STARPU_TRACE_BIN_PROG_EVENT,
+};
+
+struct _starpu_trace_bin_header
+{
+	char magic[8];
+	uint32_t version;
+	/** Set to 1 by the writer, to detect files written with another endianness */
+	uint32_t one;
+};
+
+struct _starpu_trace_bin_record
+{
+	/** enum _starpu_trace_bin_record_type */
+	uint32_t type;
+	/** Number of bytes of the string, or number of events */
+	uint32_t n;
+	/** Size of the payload following this header, in bytes */
+	uint64_t size;
+};
+
+/** Size of the payload of an events record of \p n events */
+static inline uint64_t _starpu_trace_bin_events_size(uint32_t n)
+{
+	return ((uint64_t) n * (sizeof(double) + sizeof(int64_t) + sizeof(int32_t) + 2*sizeof(uint32_t) + sizeof(uint8_t)) + 7) & ~(uint64_t) 7;
+}
+
+/** Columns of an events record */
+struct _starpu_trace_bin_events
+{
+	uint32_t n;
+	const double *time;
+	const int64_t *thread;
+	const int32_t *worker;
+	const uint32_t *name;
+	const uint32_t *category;
+	const uint8_t *type;
+};
+
+/** Get the columns of the events record whose payload starts at \p payload */
+static inline void _starpu_trace_bin_get_events(struct _starpu_trace_bin_events *events, const void *payload, uint32_t n)
+{
+	const char *p = payload;
+	events->n = n;
+	events->time = (const double *) p;
+	p += n * sizeof(double);
+	events->thread = (const int64_t *) p;
+	p += n * sizeof(int64_t);
+	events->worker = (const int32_t *) p;
+	p += n * sizeof(int32_t);
+	events->name = (const uint32_t *) p;
+	p += n * sizeof(uint32_t);
+	events->category = (const uint32_t *) p;
+	p += n * sizeof(uint32_t);
+	events->type = (const uint8_t *) p;
+}
+
+#endif /* __STARPU_TRACE_BIN_H__ */
@@ -392,6 +392,38 @@ static void _starpu_exponential_backoff(struct _starpu_worker *worker)
 	while(delay--)
 		STARPU_UYIELD();
 }
+
+#ifndef STARPU_NON_BLOCKING_DRIVERS
+/* Spin for a bit before going to sleep when tasks usually arrive shortly,
+ * since waking up a sleeping worker takes time. The sched mutex is released
+ * meanwhile, as when waiting on sched_cond, and wake-ups are noticed through
+ * wake_seq. Not all wake-ups bump wake_seq, so when this returns 1, i.e. the
+ * mutex was released, the caller has to check the wake-up conditions again
+ * before waiting on sched_cond. */
+static int _starpu_worker_idle_spin(struct _starpu_worker *worker)
+{
+	unsigned spin_max = worker->config->conf.driver_idle_spin_max;
+	unsigned seq = worker->wake_seq;
+	double start;
+	unsigned i;
+
+	if (!spin_max || worker->idle_avg > spin_max)
+		/* Tasks do not come fast enough for spinning to pay off */
+		return 0;
+
+	STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
+	start = starpu_timing_now();
+	do
+	{
+		for (i = 0; i < 64 && seq == *(volatile unsigned *) &worker->wake_seq; i++)
+			STARPU_UYIELD();
+	}
+	while (seq == *(volatile unsigned *) &worker->wake_seq && starpu_timing_now() - start < spin_max);
+	STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+
+	return 1;
+}
+#endif
 #endif
 
 
@@ -444,6 +476,8 @@ struct starpu_task *_starpu_get_worker_task(struct _starpu_worker *worker, int w
 		 * from popping a task from the scheduler to blocking. Otherwise the
 		 * driver may go block just after the scheduler got a new task to be
 		 * executed, and thus hanging. */
+		if (!worker->idle_start)
+			worker->idle_start = starpu_timing_now();
 		_starpu_worker_set_status_sleeping(workerid);
 		_starpu_worker_leave_sched_op(worker);
 		STARPU_PTHREAD_COND_BROADCAST(&worker->sched_cond);
@@ -454,6 +488,7 @@ struct starpu_task *_starpu_get_worker_task(struct _starpu_worker *worker, int w
 			&& !worker->state_unblock_in_parallel_req
 			&& !_starpu_sched_ctx_last_worker_awake(worker))
 		{
+			unsigned spun = 0;
 
 #ifdef STARPU_WORKER_CALLBACKS
 			if (_starpu_config.conf.callback_worker_going_to_sleep != NULL)
@@ -463,7 +498,10 @@ struct starpu_task *_starpu_get_worker_task(struct _starpu_worker *worker, int w
 #endif
 			do
 			{
-				STARPU_PTHREAD_COND_WAIT(&worker->sched_cond, &worker->sched_mutex);
+				/* After spinning, check the wake-up conditions before waiting */
+				if (spun || !_starpu_worker_idle_spin(worker))
+					STARPU_PTHREAD_COND_WAIT(&worker->sched_cond, &worker->sched_mutex);
+				spun = 1;
 				if (!worker->state_keep_awake
 					&& _starpu_worker_can_block(memnode, worker)
 					&& !worker->state_block_in_parallel_req
@@ -511,6 +549,15 @@ struct starpu_task *_starpu_get_worker_task(struct _starpu_worker *worker, int w
 	{
 		_starpu_worker_set_status_scheduling_done(workerid);
 		_starpu_worker_set_status_wakeup(workerid);
+#if !defined(STARPU_SIMGRID)
+		if (worker->idle_start)
+		{
+			/* Learn how fast tasks arrive */
+			double idle = starpu_timing_now() - worker->idle_start;
+			worker->idle_avg = worker->idle_avg ? (worker->idle_avg * 7 + idle) / 8 : idle;
+			worker->idle_start = 0.;
+		}
+#endif
 	}
 	else
 	{
@@ -26,7 +26,8 @@
 #include <sys/types.h>
 #include <netdb.h>
 #include <arpa/inet.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <signal.h>
 #include <core/workers.h>
@@ -39,6 +40,8 @@
 
 #define NITER 32
 #define SIZE_BANDWIDTH (1024*1024)
+/* maximum number of events handled per epoll_wait() call */
+#define NEVENTS 64
 
 #define _SELECT_DEBUG 0
 #if _SELECT_DEBUG
@@ -63,6 +66,11 @@ static int nb_sink;
 static char* host_port;
 static int index_sink = 0;
 
+/* number of sockets per peer for asynchronous communications, and size from
+ * which messages are striped over them, both given by the master */
+static int nstreams;
+static int stripe_threshold;
+
 int _starpu_tcpip_common_multiple_thread;
 
 static int is_running;
@@ -72,6 +80,8 @@ static struct _starpu_spinlock ListLock;
 
 static starpu_pthread_t thread_pending;
 static int thread_pipe[2];
+/* epoll set of the pipe and of the asynchronous sockets with requests */
+static int thread_epoll;
 
 static pthread_t master_thread;
 
@@ -91,6 +101,11 @@ int _starpu_tcpip_mp_has_local()
 	return 0;
 }
 
+int _starpu_tcpip_mp_is_local(int index)
+{
+	return local_flag[index] == 1;
+}
+
 MULTILIST_CREATE_TYPE(_starpu_tcpip_ms_request, event); /*_starpu_tcpip_ms_request_multilist_event*/
 MULTILIST_CREATE_TYPE(_starpu_tcpip_ms_request, thread); /*_starpu_tcpip_ms_request_multilist_thread*/
 MULTILIST_CREATE_TYPE(_starpu_tcpip_ms_request, pending); /*_starpu_tcpip_ms_request_multilist_pending*/
@@ -105,6 +120,8 @@ struct _starpu_tcpip_ms_request
 	struct _starpu_tcpip_ms_request_multilist_pending pending;
 	/*the struct of remote socket to send/receive message*/
 	struct _starpu_tcpip_socket *remote_sock;
+	/*the socket to the remote node on which to send/receive this part of the message*/
+	int sock;
 	/*the message to send/receive*/
 	char* buf;
 	/*the length of message*/
@@ -117,7 +134,7 @@ struct _starpu_tcpip_ms_request
 	int is_sender;
 	/*the length of message that has been sent/wrote*/
 	int offset;
-	/*active the flag MSG_ZEROCOPY*/
+	/*whether the socket accepts the flag MSG_ZEROCOPY*/
 	int zerocopy;
 	/*record the count at the end of send*/
 	uint32_t send_end;
@@ -143,272 +160,296 @@ static inline struct _starpu_tcpip_ms_async_event *_starpu_tcpip_ms_async_event(
 	return event;
 }
 
-/*hash table struct*/
+/*hash table struct, one per remote socket, kept until the end of the thread
+ * since the socket stays registered in the epoll set*/
 struct _starpu_tcpip_req_pending
 {
 	int remote_sock;
+	/*whether the socket accepts the flag MSG_ZEROCOPY*/
+	int zerocopy;
+	/*how many times a message was given to send() with MSG_ZEROCOPY*/
+	unsigned nbsend;
+	/*how many of these sends were notified as completed*/
+	unsigned nback;
 	struct _starpu_tcpip_ms_request_multilist_thread send_list;
 	struct _starpu_tcpip_ms_request_multilist_thread recv_list;
 	struct _starpu_tcpip_ms_request_multilist_pending pending_list;
 	UT_hash_handle hh;
 };
 
-//function thread
-static void * _starpu_tcpip_thread_pending()
+/*get the table of the socket of the request, create it and register the
+ * socket in the epoll set on the first request*/
+static struct _starpu_tcpip_req_pending *_starpu_tcpip_get_pending_table(struct _starpu_tcpip_req_pending **pending_tables, struct _starpu_tcpip_ms_request *req)
 {
-	fd_set reads;
-	fd_set writes;
-	int fdmax=0;
-
-	struct _starpu_tcpip_req_pending *pending_tables = NULL;
-	struct _starpu_tcpip_req_pending *table, *tmp;
+	struct _starpu_tcpip_req_pending *table;
+	int remote_sock = req->sock;
 
-	FD_ZERO(&reads);
-	FD_ZERO(&writes);
+	HASH_FIND_INT(*pending_tables, &remote_sock, table);
+	if(table == NULL)
+	{
+		_STARPU_MALLOC(table, sizeof(*table));
+		table->remote_sock = remote_sock;
+		table->zerocopy = req->zerocopy;
+		table->nbsend = 0;
+		table->nback = 0;
+		_starpu_tcpip_ms_request_multilist_head_init_thread(&table->send_list);
+		_starpu_tcpip_ms_request_multilist_head_init_thread(&table->recv_list);
+		_starpu_tcpip_ms_request_multilist_head_init_pending(&table->pending_list);
+		HASH_ADD_INT(*pending_tables, remote_sock, table);
+
+		/*the asynchronous socket is only used by this thread, make it
+		 * non-blocking so that we can read/write until EAGAIN, as
+		 * required by the edge-triggered mode*/
+		int flags = fcntl(remote_sock, F_GETFL);
+		STARPU_ASSERT_MSG(flags != -1, "fcntl failed: %s", strerror(errno));
+		int ret = fcntl(remote_sock, F_SETFL, flags | O_NONBLOCK);
+		STARPU_ASSERT_MSG(ret == 0, "fcntl failed: %s", strerror(errno));
+
+		/*EPOLLERR is always reported, which we need for MSG_ZEROCOPY notifications*/
+		struct epoll_event ev;
+		ev.events = EPOLLIN|EPOLLOUT|EPOLLET;
+		ev.data.ptr = table;
+		ret = epoll_ctl(thread_epoll, EPOLL_CTL_ADD, remote_sock, &ev);
+		STARPU_ASSERT_MSG(ret == 0, "epoll_ctl failed: %s", strerror(errno));
+	}
+	return table;
+}
 
-	FD_SET(thread_pipe[0], &reads);
-	fd_set reads2;
-	fd_set writes2;
+static void _starpu_tcpip_req_completed(struct _starpu_tcpip_ms_request *req)
+{
+	req->flag_completed = 1;
+	starpu_sem_post(&req->sem_wait_request);
 
-	fdmax = thread_pipe[0];
+	/*send the signal that message is ready */
+	struct _starpu_mp_node *node = NULL;
+	_starpu_tcpip_common_signal(node);
+}
 
-	while(is_running)
+/*read or write the requests of the list as long as the socket accepts it*/
+static void _starpu_tcpip_socket_action(struct _starpu_tcpip_req_pending *table, what_t what, const char * whatstr, struct _starpu_tcpip_ms_request_multilist_thread *list)
+{
+	while(!_starpu_tcpip_ms_request_multilist_empty_thread(list))
 	{
-		_SELECT_PRINT("in while\n");
-		reads2 = reads;
-		writes2 = writes;
+		struct _starpu_tcpip_ms_request * req = _starpu_tcpip_ms_request_multilist_begin_thread(list);
+		char* msg = req->buf;
+		int len = req->len;
+
+		int res = what(table->remote_sock, msg+req->offset, len-req->offset);
+		_SELECT_PRINT("%s res is %d\n", whatstr, res);
+		if(res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			/*wait for the next event on the socket*/
+			return;
+		if(res == -1 && errno == EINTR)
+			continue;
+		STARPU_ASSERT_MSG(res > 0, "TCP/IP Master/Slave cannot %s a msg asynchronous with a size of %d Bytes!, the result of %s is %d, the error is %s ", whatstr, len, whatstr, res, strerror(errno));
+		req->offset+=res;
 
-		int ret;
-		ret=select(fdmax+1, &reads2, &writes2, NULL, NULL);
-		STARPU_ASSERT(ret>=0);
+		_SELECT_PRINT("offset after %s is %d\n", whatstr, req->offset);
 
-		if(FD_ISSET(thread_pipe[0], &reads2))
+		if(req->offset == len)
 		{
-			char buf[16];
-			int n=read(thread_pipe[0], buf, sizeof(buf));
-			STARPU_ASSERT(n>=0);
-			if(!is_running)
-				break;
-
-			for(int i=0; i<n; i++)
-			{
-				_SELECT_PRINT("pop push loop %d\n", i);
-				_starpu_spin_lock(&ListLock);
-				STARPU_ASSERT(!_starpu_tcpip_ms_request_multilist_empty_thread(&thread_list));
-				struct _starpu_tcpip_ms_request * req_thread = _starpu_tcpip_ms_request_multilist_pop_front_thread(&thread_list);
-				_starpu_spin_unlock(&ListLock);
-
-				int remote_sock = req_thread->remote_sock->async_sock;
-				int is_sender = req_thread->is_sender;
+			_starpu_tcpip_ms_request_multilist_erase_thread(list, req);
+			_starpu_tcpip_req_completed(req);
+		}
+	}
+}
 
-				HASH_FIND_INT(pending_tables, &remote_sock, table);
-				if(table == NULL)
-				{
-					_STARPU_MALLOC(table, sizeof(*table));
-					table->remote_sock = remote_sock;
-					_starpu_tcpip_ms_request_multilist_head_init_thread(&table->send_list);
-					_starpu_tcpip_ms_request_multilist_head_init_thread(&table->recv_list);
-					_starpu_tcpip_ms_request_multilist_head_init_pending(&table->pending_list);
-					HASH_ADD_INT(pending_tables, remote_sock, table);
+#ifdef SO_ZEROCOPY
+/*send the requests with MSG_ZEROCOPY as long as the socket accepts it, they
+ * are completed by _starpu_tcpip_zerocopy_completion()*/
+static void _starpu_tcpip_zerocopy_send(struct _starpu_tcpip_req_pending *table)
+{
+	while(!_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list))
+	{
+		struct _starpu_tcpip_ms_request * req = _starpu_tcpip_ms_request_multilist_begin_thread(&table->send_list);
+		char* msg = req->buf;
+		int len = req->len;
+
+		_ZC_PRINT("msg len is %d\n", len);
+		_ZC_PRINT("offset before send is %d\n", req->offset);
+
+		int res = send(table->remote_sock, msg+req->offset, len-req->offset, MSG_ZEROCOPY);
+		_ZC_PRINT("send return %d\n", res);
+		/*ENOBUFS means that too many notifications are pending, the next one will wake us up*/
+		if(res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+			return;
+		if(res == -1 && errno == EINTR)
+			continue;
+		STARPU_ASSERT_MSG(res > 0, "TCP/IP Master/Slave cannot send a msg asynchronous with a size of %d Bytes!, the result of send is %d, the error is %s ", len, res, strerror(errno));
 
-				}
-				if(is_sender)
-				{
-					_starpu_tcpip_ms_request_multilist_push_back_thread(&table->send_list, req_thread);
-					FD_SET(remote_sock, &writes);
-				}
-				else
-				{
-					_starpu_tcpip_ms_request_multilist_push_back_thread(&table->recv_list, req_thread);
-					FD_SET(remote_sock, &reads);
-				}
+		if(req->offset == 0)
+			_starpu_tcpip_ms_request_multilist_push_back_pending(&table->pending_list, req);
 
-				if(remote_sock > fdmax)
-					fdmax=remote_sock;
-			}
+		table->nbsend++;
+		req->offset+=res;
 
-		}
+		_ZC_PRINT("offset after send is %d\n", req->offset);
 
-		HASH_ITER(hh, pending_tables, table, tmp)
+		if(req->offset == len)
 		{
-			int remote_sock = table->remote_sock;
-			_SELECT_PRINT("remote_sock in loop is %d\n", remote_sock);
-
-			void socket_action(what_t what, const char * whatstr, struct _starpu_tcpip_ms_request_multilist_thread *list, fd_set * fdset)
-			{
-				struct _starpu_tcpip_ms_request * req = _starpu_tcpip_ms_request_multilist_begin_thread(list);
-				char* msg = req->buf;
-				int len = req->len;
-
-				int res = 0;
-				res = what(remote_sock, msg+req->offset, len-req->offset);
-				_SELECT_PRINT("%s res is %d\n", whatstr, res);
-				STARPU_ASSERT_MSG(res > 0, "TCP/IP Master/Slave cannot %s a msg asynchronous with a size of %d Bytes!, the result of %s is %d, the error is %s ", whatstr, len, whatstr, res, strerror(errno));
-				req->offset+=res;
-
-				_SELECT_PRINT("offset after %s is %d\n", whatstr, req->offset);
+			req->send_end = table->nbsend;
+			_ZC_PRINT("send end after send is %d\n", req->send_end);
+			_starpu_tcpip_ms_request_multilist_erase_thread(&table->send_list, req);
+		}
+	}
+}
 
-				if(req->offset == len)
-				{
-					_starpu_tcpip_ms_request_multilist_erase_thread(list, req);
+/*read the MSG_ZEROCOPY notifications of the socket, and complete the requests
+ * whose buffers are not used by the kernel any more*/
+static void _starpu_tcpip_zerocopy_completion(struct _starpu_tcpip_req_pending *table)
+{
+	while(!_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list))
+	{
+		_ZC_PRINT("nbsend is %d\n", table->nbsend);
+		struct sock_extended_err *serr;
+		struct msghdr mg = {};
+		struct cmsghdr *cm;
+		uint32_t hi, lo;
+		char control[100];
+
+		mg.msg_control = control;
+		mg.msg_controllen = sizeof(control);
+
+		_ZC_PRINT("before recvmsg\n");
+		int r = recvmsg(table->remote_sock, &mg, MSG_ERRQUEUE);
+		if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+		if (r == -1 && errno == EINTR)
+			continue;
+		if (r == -1)
+			error(1, errno, "recvmsg notification");
+		if (mg.msg_flags & MSG_CTRUNC)
+			error(1, errno, "recvmsg notification: truncated");
 
-					if(_starpu_tcpip_ms_request_multilist_empty_thread(list))
-						FD_CLR(remote_sock, fdset);
+		cm = CMSG_FIRSTHDR(&mg);
+		if (!cm)
+			error(1, 0, "cmsg: no cmsg");
 
-					req->flag_completed = 1;
-					starpu_sem_post(&req->sem_wait_request);
+		serr = (void *) CMSG_DATA(cm);
 
-					/*send the signal that message is ready */
-					struct _starpu_mp_node *node = NULL;
-					_starpu_tcpip_common_signal(node);
-				}
-			}
+		if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+			error(1, 0, "serr: wrong origin: %u", serr->ee_origin);
+		if (serr->ee_errno != 0)
+			error(1, 0, "serr: wrong error code: %u", serr->ee_errno);
 
-			if(FD_ISSET(remote_sock, &writes2))
-			{
-#ifdef SO_ZEROCOPY
-				struct pollfd pfd;
-				pfd.fd = remote_sock;
-				pfd.events = POLLERR|POLLOUT;
-				pfd.revents = 0;
-				if(poll(&pfd, 1, -1) <= 0)
-					error(1, errno, "poll");
-
-				if(pfd.revents & POLLERR)
-				{
-					struct _starpu_tcpip_ms_request * req_pending = _starpu_tcpip_ms_request_multilist_begin_pending(&table->pending_list);
-					_ZC_PRINT("nbsend is %d\n", req_pending->remote_sock->nbsend);
-					struct sock_extended_err *serr;
-					struct msghdr mg = {};
-					struct cmsghdr *cm;
-					uint32_t hi, lo;
-					char control[100];
+		hi = serr->ee_data;
+		lo = serr->ee_info;
 
-					mg.msg_control = control;
-					mg.msg_controllen = sizeof(control);
+		_ZC_PRINT("h=%u l=%u\n", hi, lo);
 
-					_ZC_PRINT("before recvmsg\n");
-					int r = recvmsg(remote_sock, &mg, MSG_ERRQUEUE);
-					// if (r == -1 && errno == EAGAIN)
-					//	   continue;
-					if (r == -1)
-						error(1, errno, "recvmsg notification");
-					if (mg.msg_flags & MSG_CTRUNC)
-						error(1, errno, "recvmsg notification: truncated");
+		STARPU_ASSERT(lo == table->nback);
+		STARPU_ASSERT(hi < table->nbsend);
 
-					cm = CMSG_FIRSTHDR(&mg);
-					if (!cm)
-						error(1, 0, "cmsg: no cmsg");
+		table->nback = hi+1;
 
-					serr = (void *) CMSG_DATA(cm);
+		while(!_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list))
+		{
+			struct _starpu_tcpip_ms_request * req_tmp = _starpu_tcpip_ms_request_multilist_begin_pending(&table->pending_list);
+			_ZC_PRINT("send end is %d\n", req_tmp->send_end);
 
-					if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
-						error(1, 0, "serr: wrong origin: %u", serr->ee_origin);
-					if (serr->ee_errno != 0)
-						error(1, 0, "serr: wrong error code: %u", serr->ee_errno);
+			/*send_end is only set once the whole message was given to send()*/
+			if(req_tmp->send_end != 0 && hi+1 >= req_tmp->send_end)
+			{
+				_starpu_tcpip_ms_request_multilist_erase_pending(&table->pending_list, req_tmp);
+				_starpu_tcpip_req_completed(req_tmp);
+			}
+			else
+				break;
+		}
+	}
+}
+#endif
 
-					if (serr->ee_code != SO_EE_CODE_ZEROCOPY_COPIED)
-						req_pending->zerocopy = 0;
+/*make the requests of the socket progress according to the epoll events. The
+ * socket is registered in edge-triggered mode, so we have to go on until it
+ * would block, or until there is no more request*/
+static void _starpu_tcpip_socket_progress(struct _starpu_tcpip_req_pending *table, uint32_t events)
+{
+#ifdef SO_ZEROCOPY
+	if(table->zerocopy)
+	{
+		if(events & EPOLLERR)
+			_starpu_tcpip_zerocopy_completion(table);
+		if(events & (EPOLLOUT|EPOLLERR))
+			_starpu_tcpip_zerocopy_send(table);
+	}
+	else
+#endif
+	if(events & (EPOLLOUT|EPOLLERR|EPOLLHUP))
+		_starpu_tcpip_socket_action(table, (what_t)write, "write", &table->send_list);
 
-					hi = serr->ee_data;
-					lo = serr->ee_info;
+	if(events & (EPOLLIN|EPOLLERR|EPOLLHUP))
+		_starpu_tcpip_socket_action(table, read, "read", &table->recv_list);
+}
 
-					_ZC_PRINT("h=%u l=%u\n", hi, lo);
+//function thread
+static void * _starpu_tcpip_thread_pending()
+{
+	struct epoll_event events[NEVENTS];
 
-					STARPU_ASSERT(lo == req_pending->remote_sock->nback);
-					STARPU_ASSERT(hi < req_pending->remote_sock->nbsend);
+	struct _starpu_tcpip_req_pending *pending_tables = NULL;
+	struct _starpu_tcpip_req_pending *table, *tmp;
 
-					req_pending->remote_sock->nback = hi+1;
+	while(is_running)
+	{
+		_SELECT_PRINT("in while\n");
 
-					_ZC_PRINT("send end is %d\n", req_pending->send_end);
-					while(!_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list))
-					{
-						struct _starpu_tcpip_ms_request * req_tmp = _starpu_tcpip_ms_request_multilist_begin_pending(&table->pending_list);
+		int nevents = epoll_wait(thread_epoll, events, NEVENTS, -1);
+		if(nevents == -1 && errno == EINTR)
+			continue;
+		STARPU_ASSERT_MSG(nevents >= 0, "epoll_wait failed: %s", strerror(errno));
 
-						if(hi+1 >= req_tmp->send_end)
-						{
-							_starpu_tcpip_ms_request_multilist_erase_pending(&table->pending_list, req_tmp);
+		for(int e=0; e<nevents; e++)
+		{
+			table = events[e].data.ptr;
+			if(table != NULL)
+			{
+				_SELECT_PRINT("remote_sock in loop is %d\n", table->remote_sock);
+				_starpu_tcpip_socket_progress(table, events[e].events);
+				continue;
+			}
 
-							if(_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list)&&_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list))
-								FD_CLR(remote_sock, &writes);
+			/*the pipe, one byte per new request*/
+			char buf[16];
+			int n=read(thread_pipe[0], buf, sizeof(buf));
+			STARPU_ASSERT(n>=0);
+			if(!is_running)
+				break;
 
-							req_tmp->flag_completed = 1;
-							starpu_sem_post(&req_tmp->sem_wait_request);
+			for(int i=0; i<n; i++)
+			{
+				_SELECT_PRINT("pop push loop %d\n", i);
+				_starpu_spin_lock(&ListLock);
+				STARPU_ASSERT(!_starpu_tcpip_ms_request_multilist_empty_thread(&thread_list));
+				struct _starpu_tcpip_ms_request * req_thread = _starpu_tcpip_ms_request_multilist_pop_front_thread(&thread_list);
+				_starpu_spin_unlock(&ListLock);
 
-							/*send the signal that message is ready*/
-							struct _starpu_mp_node *node = NULL;
-							_starpu_tcpip_common_signal(node);
-						}
-						else
-							break;
-					}
+				table = _starpu_tcpip_get_pending_table(&pending_tables, req_thread);
 
+				/*the socket may already be ready, in which case no
+				 * new event will come, so try right away*/
+				if(req_thread->is_sender)
+				{
+					_starpu_tcpip_ms_request_multilist_push_back_thread(&table->send_list, req_thread);
+					_starpu_tcpip_socket_progress(table, EPOLLOUT);
 				}
 				else
 				{
-					if(!(_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list)))
-					{
-						struct _starpu_tcpip_ms_request * req = _starpu_tcpip_ms_request_multilist_begin_thread(&table->send_list);
-						char* msg = req->buf;
-						int len = req->len;
-
-						if(req->remote_sock->zerocopy)
-						{
-							_ZC_PRINT("msg len is %d\n", len);
-							_ZC_PRINT("offset before send is %d\n", req->offset);
-
-							if(req->offset == 0)
-							{
-								_starpu_tcpip_ms_request_multilist_push_back_pending(&table->pending_list, req);
-							}
-
-							int res = send(remote_sock, msg+req->offset, len-req->offset, MSG_ZEROCOPY);
-							_ZC_PRINT("send return %d\n", res);
-							STARPU_ASSERT_MSG(res > 0, "TCP/IP Master/Slave cannot send a msg asynchronous with a size of %d Bytes!, the result of send is %d, the error is %s ", len, res, strerror(errno));
-
-							req->remote_sock->nbsend++;
-							req->offset+=res;
-
-							_ZC_PRINT("offset after send is %d\n", req->offset);
-
-							if(req->offset == len)
-							{
-								req->send_end = req->remote_sock->nbsend;
-								_ZC_PRINT("send end after send is %d\n", req->send_end);
-								_starpu_tcpip_ms_request_multilist_erase_thread(&table->send_list, req);
-
-								//if(_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list))
-									//we need this to check whether the msg are all sent, we would have to remove POLLOUT from poll.events
-									//FD_CLR(remote_sock, &writes);
-							}
-						}
-						else
-#endif
-						{
-							socket_action((what_t)write, "write", &table->send_list, &writes);
-						}
-#ifdef SO_ZEROCOPY
-					}
+					_starpu_tcpip_ms_request_multilist_push_back_thread(&table->recv_list, req_thread);
+					_starpu_tcpip_socket_progress(table, EPOLLIN);
 				}
-#endif
-			}
-
-			if(FD_ISSET(remote_sock, &reads2))
-			{
-				socket_action(read, "read", &table->recv_list, &reads);
-			}
-			/*if the recv/send_list is empty, delete and free hash table*/
-			if(_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list)&&_starpu_tcpip_ms_request_multilist_empty_thread(&table->recv_list)&&_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list))
-			{
-				HASH_DEL(pending_tables, table);
-				free(table);
 			}
-
 		}
-
 	}
-	/*all hash tables should be deleted*/
-	STARPU_ASSERT(pending_tables == NULL);
+	/*all requests should be completed*/
+	HASH_ITER(hh, pending_tables, table, tmp)
+	{
+		STARPU_ASSERT(_starpu_tcpip_ms_request_multilist_empty_thread(&table->send_list));
+		STARPU_ASSERT(_starpu_tcpip_ms_request_multilist_empty_thread(&table->recv_list));
+		STARPU_ASSERT(_starpu_tcpip_ms_request_multilist_empty_pending(&table->pending_list));
+		HASH_DEL(pending_tables, table);
+		free(table);
+	}
 	starpu_sem_post(&sem_thread_finished);
 
 	return 0;
@@ -416,6 +457,24 @@ static void * _starpu_tcpip_thread_pending()
 
 static void handler(int num STARPU_ATTRIBUTE_UNUSED){}
 
+/*allocate the stripe sockets to each node, once nstreams is known*/
+static void _starpu_tcpip_stripe_init(void)
+{
+	int i;
+
+	if(nstreams == 1)
+		return;
+
+	for(i=0; i<=nb_sink; i++)
+	{
+		_STARPU_CALLOC(tcpip_sock[i].stripe_socks, nstreams-1, sizeof(int));
+		_STARPU_CALLOC(tcpip_sock[i].stripe_zerocopy, nstreams-1, sizeof(int));
+	}
+	/*we do not connect to ourself*/
+	for(i=0; i<nstreams-1; i++)
+		tcpip_sock[index_sink].stripe_socks[i] = -1;
+}
+
 int _starpu_tcpip_common_mp_init()
 {
 	//Here we supposed the programmer called two times starpu_init.
@@ -441,6 +500,15 @@ int _starpu_tcpip_common_mp_init()
 	int r=pipe(thread_pipe);
 	STARPU_ASSERT(r==0);
 
+	/*initialize the epoll set, the sockets are added on their first request*/
+	thread_epoll = epoll_create1(0);
+	STARPU_ASSERT_MSG(thread_epoll >= 0, "epoll_create1 failed: %s", strerror(errno));
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	r = epoll_ctl(thread_epoll, EPOLL_CTL_ADD, thread_pipe[0], &ev);
+	STARPU_ASSERT_MSG(r == 0, "epoll_ctl failed: %s", strerror(errno));
+
 	_starpu_spin_init(&ListLock);
 	/*initialize the thread*/
 	_starpu_tcpip_ms_request_multilist_head_init_thread(&thread_list);
@@ -468,7 +536,12 @@ int _starpu_tcpip_common_mp_init()
 		struct sockaddr_in source_addr_init;
 		socklen_t source_addr_init_size = sizeof(source_addr_init);
 
-		int init_res = master_init(1, &source_sock_init, &local_sock, &source_addr_init, &source_addr_init_size, &name, htonl(INADDR_ANY), htons(1234), 2*nb_sink);
+		nstreams = starpu_getenv_number_default("STARPU_TCPIP_MS_NSTREAMS", 1);
+		STARPU_ASSERT_MSG(nstreams >= 1, "STARPU_TCPIP_MS_NSTREAMS must be at least 1");
+		stripe_threshold = starpu_getenv_number_default("STARPU_TCPIP_MS_STRIPE_THRESHOLD", 1024*1024);
+		_starpu_tcpip_stripe_init();
+
+		int init_res = master_init(1, &source_sock_init, &local_sock, &source_addr_init, &source_addr_init_size, &name, htonl(INADDR_ANY), htons(1234), (nstreams+1)*nb_sink);
 		if(init_res != 0)
 			return -1;
 
@@ -507,6 +580,10 @@ int _starpu_tcpip_common_mp_init()
 
 			_TCPIP_PRINT("write to slave %d its index\n", id_sink);
 
+			/*write the striping parameters to slave*/
+			WRITE(tcpip_sock[i].sync_sock, &nstreams, sizeof(nstreams));
+			WRITE(tcpip_sock[i].sync_sock, &stripe_threshold, sizeof(stripe_threshold));
+
 			/*receive the slave address with the random allocated port number connect to other slaves*/
 			struct sockaddr_in buf_addr;
 			READ(tcpip_sock[i].sync_sock, &buf_addr, sizeof(buf_addr));
@@ -516,8 +593,8 @@ int _starpu_tcpip_common_mp_init()
 			inet_ntop(AF_INET, &sink_addr_list[i].sin_addr, clnt_ip, sizeof(clnt_ip)), ntohs(sink_addr_list[i].sin_port));
 
 		}
-		/*connect each slave, generate async socket and notif socket*/
-		for (i=1; i<=2*nb_sink; i++)
+		/*connect each slave, generate async socket, notif socket and stripe sockets*/
+		for (i=1; i<=(nstreams+1)*nb_sink; i++)
 		{
 			int sink_sock2;
 			int zerocopy;
@@ -536,11 +613,19 @@ int _starpu_tcpip_common_mp_init()
 				tcpip_sock[i_sink].async_sock = sink_sock2;
 				tcpip_sock[i_sink].zerocopy = zerocopy;
 			}
-			else
+			else if(tcpip_sock[i_sink].notif_sock == 0)
 			{
-				STARPU_ASSERT(tcpip_sock[i_sink].notif_sock == 0);
 				tcpip_sock[i_sink].notif_sock = sink_sock2;
 			}
+			else
+			{
+				int k = 0;
+				while(k < nstreams-1 && tcpip_sock[i_sink].stripe_socks[k] != 0)
+					k++;
+				STARPU_ASSERT(k < nstreams-1);
+				tcpip_sock[i_sink].stripe_socks[k] = sink_sock2;
+				tcpip_sock[i_sink].stripe_zerocopy[k] = zerocopy;
+			}
 
 		}
 
@@ -644,6 +729,11 @@ int _starpu_tcpip_common_mp_init()
 		/*get slave index in master sock_list*/
 		READ(source_sock, &index_sink, sizeof(index_sink));
 
+		/*get the striping parameters from master*/
+		READ(source_sock, &nstreams, sizeof(nstreams));
+		READ(source_sock, &stripe_threshold, sizeof(stripe_threshold));
+		_starpu_tcpip_stripe_init();
+
 		tcpip_sock[index_sink].sync_sock = -1;
 		tcpip_sock[index_sink].async_sock = -1;
 		tcpip_sock[index_sink].notif_sock = -1;
@@ -657,7 +747,7 @@ int _starpu_tcpip_common_mp_init()
 		struct sockaddr_in sink_serv_addr;
 		socklen_t sink_serv_addr_size = sizeof(sink_serv_addr);
 
-		int init_res = master_init(0, &sink_serv_sock, &sink_local_sock, &sink_serv_addr, &sink_serv_addr_size, &sink_name, sink_addr.sin_addr.s_addr, 0, 2*(nb_sink-index_sink));
+		int init_res = master_init(0, &sink_serv_sock, &sink_local_sock, &sink_serv_addr, &sink_serv_addr_size, &sink_name, sink_addr.sin_addr.s_addr, 0, (nstreams+1)*(nb_sink-index_sink));
 		if(init_res != 0)
 			return -1;
 
@@ -716,6 +806,15 @@ int _starpu_tcpip_common_mp_init()
 			_TCPIP_PRINT("source_notif_sock is %d\n", source_notif_sock);
 			tcpip_sock[0].notif_sock = source_notif_sock;
 
+			/*stripe connect*/
+			int k;
+			for(k=0; k<nstreams-1; k++)
+			{
+				int connect_stripe_res = slave_connect(&tcpip_sock[0].stripe_socks[k], cur1, NULL, NULL, &tcpip_sock[0].stripe_zerocopy[k], NULL);
+				if(connect_stripe_res != 0)
+					return -1;
+			}
+
 			break;
 		}
 		freeaddrinfo(res1);
@@ -731,6 +830,10 @@ int _starpu_tcpip_common_mp_init()
 		/*send slave index to master notif socket*/
 		WRITE(source_notif_sock, &index_sink, sizeof(index_sink));
 
+		/*send slave index to master stripe sockets*/
+		for(int k=0; k<nstreams-1; k++)
+			WRITE(tcpip_sock[0].stripe_socks[k], &index_sink, sizeof(index_sink));
+
 		/*communication between slaves*/
 		int j;
 		/*the active part*/
@@ -781,6 +884,17 @@ int _starpu_tcpip_common_mp_init()
 
 			tcpip_sock[j].notif_sock = serv_notif_sock;
 
+			/*stripe connect*/
+			for(int k=0; k<nstreams-1; k++)
+			{
+				int connect_stripe_res = slave_connect(&tcpip_sock[j].stripe_socks[k], NULL, NULL, &serv_addr, &tcpip_sock[j].stripe_zerocopy[k], NULL);
+				if(connect_stripe_res != 0)
+					return -1;
+
+				/*send sink stripe id to another slave*/
+				WRITE(tcpip_sock[j].stripe_socks[k], &index_sink, sizeof(index_sink));
+			}
+
 			_TCPIP_PRINT("sock_list[%d] in slave part is %d\n", j, serv_sock);
 			_TCPIP_PRINT("sock_async_list[%d] in slave part is %d\n", j, serv_async_sock);
 			_TCPIP_PRINT("sock_notif_list[%d] in slave part is %d\n", j, serv_notif_sock);
@@ -830,6 +944,23 @@ int _starpu_tcpip_common_mp_init()
 
 			tcpip_sock[sink_notif_id].notif_sock = clnt_notif_sock;
 
+			/*stripe accept*/
+			for(int k=0; k<nstreams-1; k++)
+			{
+				int clnt_stripe_sock;
+				int zerocopy_stripe;
+				int accept_stripe_res = master_accept(&clnt_stripe_sock, sink_serv_sock, sink_local_sock, &zerocopy_stripe, NULL);
+				if(accept_stripe_res != 0)
+					return -1;
+
+				int sink_stripe_id;
+				/*get sink stripe id*/
+				READ(clnt_stripe_sock, &sink_stripe_id, sizeof(sink_stripe_id));
+
+				tcpip_sock[sink_stripe_id].stripe_socks[k] = clnt_stripe_sock;
+				tcpip_sock[sink_stripe_id].stripe_zerocopy[k] = zerocopy_stripe;
+			}
+
 			_TCPIP_PRINT("sock_list[%d] in master part is %d\n", sink_id, clnt_sock);
 			_TCPIP_PRINT("sock_async_list[%d] in master part is %d\n", sink_async_id, clnt_async_sock);
 			_TCPIP_PRINT("sock_notif_list[%d] in master part is %d\n", sink_notif_id, clnt_notif_sock);
@@ -875,6 +1006,7 @@ void _starpu_tcpip_common_mp_deinit()
 	char buf = 0;
 	write(thread_pipe[1], &buf, 1);
 	starpu_sem_wait(&sem_thread_finished);
+	close(thread_epoll);
 	if (!extern_initialized)
 	{
 		int i;
@@ -883,8 +1015,15 @@ void _starpu_tcpip_common_mp_deinit()
 			close(tcpip_sock[i].sync_sock);
 			close(tcpip_sock[i].async_sock);
 			close(tcpip_sock[i].notif_sock);
+			for (int k=0; k<nstreams-1; k++)
+				close(tcpip_sock[i].stripe_socks[k]);
 		}
 	}
+	for (int i=0; i<=nb_sink; i++)
+	{
+		free(tcpip_sock[i].stripe_socks);
+		free(tcpip_sock[i].stripe_zerocopy);
+	}
 	free(tcpip_sock);
 	free(local_flag);
 	_starpu_spin_destroy(&ListLock);
@@ -1120,36 +1259,59 @@ static void _starpu_tcpip_common_action_socket(what_t what, const char * whatstr
 			_starpu_tcpip_ms_request_multilist_head_init_event(tcpip_ms_event->requests);
 		}
 
-		struct _starpu_tcpip_ms_request *req;
-		_STARPU_MALLOC(req, sizeof(*req));
-		_starpu_tcpip_ms_request_multilist_init_thread(req);
-		_starpu_tcpip_ms_request_multilist_init_event(req);
-		_starpu_tcpip_ms_request_multilist_init_pending(req);
-
-		/*complete the fields*/
-		req->remote_sock = remote_sock;
-		req->len = len;
-		req->buf = msg;
-		req->flag_completed = 0;
-		starpu_sem_init(&req->sem_wait_request, 0, 0);
-		req->is_sender = is_sender;
-		req->offset = 0;
-		req->send_end = 0;
-
-		_SELECT_PRINT("%s push back\n", whatstr);
-		_starpu_spin_lock(&ListLock);
-		_starpu_tcpip_ms_request_multilist_push_back_thread(&thread_list, req);
-		_starpu_spin_unlock(&ListLock);
-
-		char buf = 0;
-		int res;
-		while((res = write(thread_pipe[1], &buf, 1)) == -1 && errno == EINTR)
-		;
-
-		channel->starpu_mp_common_finished_receiver++;
-		channel->starpu_mp_common_finished_sender++;
-
-		_starpu_tcpip_ms_request_multilist_push_back_event(tcpip_ms_event->requests, req);
+		/*large messages are striped over all the asynchronous
+		 * sockets, the remote node splits them the same way*/
+		int nparts = 1;
+		if(nstreams > 1 && len >= stripe_threshold)
+			nparts = nstreams;
+		int part_len = (len + nparts - 1) / nparts;
+
+		int part;
+		for(part = 0; part < nparts; part++)
+		{
+			struct _starpu_tcpip_ms_request *req;
+			_STARPU_MALLOC(req, sizeof(*req));
+			_starpu_tcpip_ms_request_multilist_init_thread(req);
+			_starpu_tcpip_ms_request_multilist_init_event(req);
+			_starpu_tcpip_ms_request_multilist_init_pending(req);
+
+			/*complete the fields*/
+			req->remote_sock = remote_sock;
+			if(part == 0)
+			{
+				req->sock = remote_sock->async_sock;
+				req->zerocopy = remote_sock->zerocopy;
+			}
+			else
+			{
+				req->sock = remote_sock->stripe_socks[part-1];
+				req->zerocopy = remote_sock->stripe_zerocopy[part-1];
+			}
+			req->len = STARPU_MIN(part_len, len - part*part_len);
+			req->buf = (char*)msg + part*part_len;
+			req->flag_completed = 0;
+			starpu_sem_init(&req->sem_wait_request, 0, 0);
+			req->is_sender = is_sender;
+			req->offset = 0;
+			req->send_end = 0;
+
+			_SELECT_PRINT("%s push back\n", whatstr);
+			_starpu_spin_lock(&ListLock);
+			_starpu_tcpip_ms_request_multilist_push_back_thread(&thread_list, req);
+			_starpu_spin_unlock(&ListLock);
+
+			char buf = 0;
+			int res;
+			while((res = write(thread_pipe[1], &buf, 1)) == -1 && errno == EINTR)
+			;
+
+			_starpu_tcpip_ms_request_multilist_push_back_event(tcpip_ms_event->requests, req);
+		}
+
+		/*we wait for the completion of each part here, but for only one
+		 * notification from the remote node*/
+		channel->starpu_mp_common_finished_receiver += is_sender ? 1 : nparts;
+		channel->starpu_mp_common_finished_sender += is_sender ? nparts : 1;
 	}
 	else
 	{
@@ -1302,14 +1464,12 @@ void _starpu_tcpip_common_barrier(void)
 		{
 			//_TCPIP_PRINT("slave socket in sock list is %d\n", sock_list[i]);
 			ret=read(tcpip_sock[i].sync_sock, &buf, 1);
-			printf("ret2 is %d\n", ret);
 			STARPU_ASSERT_MSG(ret > 0, "Cannot read from slave!");
 		}
 
 		for(i=1; i<nb_sink+1; i++)
 		{
 			ret=write(tcpip_sock[i].sync_sock, &buf, 1);
-			printf("ret3 is %d\n", ret);
 			STARPU_ASSERT_MSG(ret > 0, "Cannot write to slave!");
 		}
 
@@ -1319,24 +1479,75 @@ void _starpu_tcpip_common_barrier(void)
 	{
 		//_TCPIP_PRINT("master socket in sock list is %d\n", sock_list[0]);
 		ret=write(tcpip_sock[0].sync_sock, &buf, 1);
-		printf("ret1 is %d\n", ret);
 		STARPU_ASSERT_MSG(ret > 0, "Cannot write to master!");
 		ret=read(tcpip_sock[0].sync_sock, &buf, 1);
-		printf("ret4 is %d\n", ret);
 		STARPU_ASSERT_MSG(ret > 0, "Cannot read from master!");
 	}
 	_TCPIP_PRINT("finish common barrier\n");
 }
 
+/* Gather size bytes from sendbuf of each node into recvbuf of all nodes, in
+ * the order of the node indexes */
+void _starpu_tcpip_common_allgather(const void *sendbuf, void *recvbuf, int size)
+{
+	char *recv = recvbuf;
+	int ret;
+	/*master part*/
+	if(index_sink == 0)
+	{
+		int i;
+		memcpy(recv, sendbuf, size);
+		for(i=1; i<nb_sink+1; i++)
+		{
+			ret=read(tcpip_sock[i].sync_sock, recv + i*size, size);
+			STARPU_ASSERT_MSG(ret == size, "Cannot read from slave!");
+		}
+
+		for(i=1; i<nb_sink+1; i++)
+		{
+			ret=write(tcpip_sock[i].sync_sock, recv, (nb_sink+1)*size);
+			STARPU_ASSERT_MSG(ret == (nb_sink+1)*size, "Cannot write to slave!");
+		}
+	}
+	/*slave part*/
+	else
+	{
+		ret=write(tcpip_sock[0].sync_sock, sendbuf, size);
+		STARPU_ASSERT_MSG(ret == size, "Cannot write to master!");
+		ret=read(tcpip_sock[0].sync_sock, recv, (nb_sink+1)*size);
+		STARPU_ASSERT_MSG(ret == (nb_sink+1)*size, "Cannot read from master!");
+	}
+}
+
 /* Compute bandwidth and latency between source and sink nodes
  * Source node has to have the entire set of times at the end
  */
-void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MAXTCPIPDEVS][STARPU_MAXTCPIPDEVS], double latency_dtod[STARPU_MAXTCPIPDEVS][STARPU_MAXTCPIPDEVS])
+/*send or receive a message through the asynchronous sockets like data
+ * transfers, thus striped if it is large enough, and wait for its completion*/
+static void _starpu_tcpip_common_async_action_wait(int is_sender, struct _starpu_tcpip_socket *remote_sock, void *msg, int len)
+{
+	struct _starpu_async_channel channel;
+	memset(&channel, 0, sizeof(channel));
+	/*we do not wait for any notification from the remote node*/
+	if(is_sender)
+		channel.starpu_mp_common_finished_receiver = -1;
+	else
+		channel.starpu_mp_common_finished_sender = -1;
+
+	if(is_sender)
+		_starpu_tcpip_common_action_socket((what_t)write, "send", 1, NULL, remote_sock, msg, len, &channel, 0);
+	else
+		_starpu_tcpip_common_action_socket(read, "recv", 0, NULL, remote_sock, msg, len, &channel, 0);
+	_starpu_tcpip_common_wait_request_completion(&channel);
+}
+
+void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1], double latency_dtod[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1])
 {
 	int ret;
 	unsigned iter;
 	//_TCPIP_PRINT("index_sink is %d\n", index_sink);
 	char * buf;
+	STARPU_ASSERT_MSG(nb_sink <= STARPU_MAXTCPIPDEVS, "Too many TCP/IP Master/Slave slaves (%d) for measuring the bus, reconfigure with a larger --enable-maxtcpipdev", nb_sink);
 	_STARPU_MALLOC(buf, SIZE_BANDWIDTH);
 	memset(buf, 0, SIZE_BANDWIDTH);
 
@@ -1358,13 +1569,13 @@ void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MA
 
 				//_TCPIP_PRINT("sender id is %d\n", sender);
 				double start, end;
-				/* measure bandwidth sender to receiver */
+				/* measure bandwidth sender to receiver, with the
+				 * asynchronous sockets used for data transfers */
 				start = starpu_timing_now();
 				for (iter = 0; iter < NITER; iter++)
 				{
-					ret = write(tcpip_sock[receiver].sync_sock, buf, SIZE_BANDWIDTH);
-					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
-					ret = read(tcpip_sock[sender].sync_sock, buf, 1);
+					_starpu_tcpip_common_async_action_wait(1, &tcpip_sock[receiver], buf, SIZE_BANDWIDTH);
+					ret = read(tcpip_sock[receiver].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
 				}
 				end = starpu_timing_now();
@@ -1376,7 +1587,7 @@ void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MA
 				{
 					ret = write(tcpip_sock[receiver].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
-					ret = read(tcpip_sock[sender].sync_sock, buf, 1);
+					ret = read(tcpip_sock[receiver].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
 				}
 				end = starpu_timing_now();
@@ -1392,9 +1603,8 @@ void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MA
 				/* measure bandwidth sender to receiver*/
 				for (iter = 0; iter < NITER; iter++)
 				{
-					ret = read(tcpip_sock[sender].sync_sock, buf, SIZE_BANDWIDTH);
-					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
-					ret = write(tcpip_sock[receiver].sync_sock, buf, 1);
+					_starpu_tcpip_common_async_action_wait(0, &tcpip_sock[sender], buf, SIZE_BANDWIDTH);
+					ret = write(tcpip_sock[sender].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
 				}
 
@@ -1403,7 +1613,7 @@ void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MA
 				{
 					ret = read(tcpip_sock[sender].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
-					ret = write(tcpip_sock[receiver].sync_sock, buf, 1);
+					ret = write(tcpip_sock[sender].sync_sock, buf, 1);
 					STARPU_ASSERT_MSG(ret > 0, "Bandwidth of TCP/IP Master/Slave cannot be measured !");
 				}
 			}
@@ -1418,15 +1628,19 @@ void _starpu_tcpip_common_measure_bandwidth_latency(double timing_dtod[STARPU_MA
 		/* if we are the sender, we send the data */
 		if (sender == index_sink)
 		{
-			write(tcpip_sock[0].sync_sock, timing_dtod[sender], sizeof(timing_dtod[sender])*STARPU_MAXMPIDEVS);
-			write(tcpip_sock[0].sync_sock, latency_dtod[sender], sizeof(latency_dtod[sender])*STARPU_MAXMPIDEVS);
+			ret = write(tcpip_sock[0].sync_sock, timing_dtod[sender], sizeof(timing_dtod[sender]));
+			STARPU_ASSERT_MSG(ret == sizeof(timing_dtod[sender]), "Bandwidth of TCP/IP Master/Slave cannot be sent !");
+			ret = write(tcpip_sock[0].sync_sock, latency_dtod[sender], sizeof(latency_dtod[sender]));
+			STARPU_ASSERT_MSG(ret == sizeof(latency_dtod[sender]), "Latency of TCP/IP Master/Slave cannot be sent !");
 		}
 
 		/* the master node receives the data */
 		if (index_sink == 0)
 		{
-			read(tcpip_sock[sender].sync_sock, timing_dtod[sender], sizeof(timing_dtod[sender])*STARPU_MAXMPIDEVS);
-			read(tcpip_sock[sender].sync_sock, latency_dtod[sender], sizeof(latency_dtod[sender])*STARPU_MAXMPIDEVS);
+			ret = read(tcpip_sock[sender].sync_sock, timing_dtod[sender], sizeof(timing_dtod[sender]));
+			STARPU_ASSERT_MSG(ret == sizeof(timing_dtod[sender]), "Bandwidth of TCP/IP Master/Slave cannot be received !");
+			ret = read(tcpip_sock[sender].sync_sock, latency_dtod[sender], sizeof(latency_dtod[sender]));
+			STARPU_ASSERT_MSG(ret == sizeof(latency_dtod[sender]), "Latency of TCP/IP Master/Slave cannot be received !");
 		}
 
 	}
@@ -38,14 +38,17 @@ struct _starpu_tcpip_socket
 	int notif_sock;
 	/* a flag to detect whether the socket can be used for MSG_ZEROCOPY */
 	int zerocopy;
-	/* how many times is this message split up to send */
-	unsigned nbsend;
-	unsigned nback;
+	/* additional sockets over which large asynchronous messages are
+	 * striped (see STARPU_TCPIP_MS_NSTREAMS), and their MSG_ZEROCOPY flags */
+	int *stripe_socks;
+	int *stripe_zerocopy;
 };
 
 extern struct _starpu_tcpip_socket *tcpip_sock;
 
 int _starpu_tcpip_mp_has_local();
+/** Whether the node of index \p index in tcpip_sock runs on the same host */
+int _starpu_tcpip_mp_is_local(int index);
 
 int _starpu_tcpip_common_mp_init();
 void _starpu_tcpip_common_mp_deinit();
@@ -77,8 +80,10 @@ unsigned int _starpu_tcpip_common_test_event(struct _starpu_async_channel * even
 void _starpu_tcpip_common_wait_request_completion(struct _starpu_async_channel * event);
 
 void _starpu_tcpip_common_barrier(void);
+/** Gather \p size bytes of \p sendbuf from each node into \p recvbuf of all nodes */
+void _starpu_tcpip_common_allgather(const void *sendbuf, void *recvbuf, int size);
 
-void _starpu_tcpip_common_measure_bandwidth_latency(double bandwidth_dtod[STARPU_MAXTCPIPDEVS][STARPU_MAXTCPIPDEVS], double latency_dtod[STARPU_MAXTCPIPDEVS][STARPU_MAXTCPIPDEVS]);
+void _starpu_tcpip_common_measure_bandwidth_latency(double bandwidth_dtod[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1], double latency_dtod[STARPU_MAXTCPIPDEVS+1][STARPU_MAXTCPIPDEVS+1]);
 
 #endif  /* STARPU_USE_TCPIP_MASTER_SLAVE */
 
@@ -24,6 +24,7 @@
 
 #include <drivers/driver_common/driver_common.h>
 #include <drivers/mp_common/source_common.h>
+#include <common/rbtree.h>
 
 #ifdef STARPU_USE_TCPIP_MASTER_SLAVE
 static unsigned tcpip_bindid_init[STARPU_MAXTCPIPDEVS] = { };
@@ -32,6 +33,24 @@ static unsigned tcpip_memory_init[STARPU_MAXTCPIPDEVS] = { };
 static unsigned tcpip_memory_nodes[STARPU_MAXTCPIPDEVS];
 
 static struct _starpu_worker_set tcpip_worker_set[STARPU_MAXTCPIPDEVS];
+
+/* Buffers of the sinks running on the same host, which are allocated in
+ * shared memory segments mapped both here and on the sink, so that data
+ * transfers with them are mere memcpy (see STARPU_TCPIP_USE_SHARED_MEMORY) */
+struct _starpu_tcpip_shm
+{
+	struct starpu_rbtree_node node;
+	/* address of the buffer on the sink */
+	uintptr_t sink_addr;
+	/* address of the buffer here */
+	uintptr_t addr;
+	size_t size;
+};
+
+static int tcpip_use_shm;
+/* the buffers of each sink, sorted by address on the sink */
+static struct starpu_rbtree tcpip_shm_tree[STARPU_MAXTCPIPDEVS];
+static starpu_pthread_mutex_t tcpip_shm_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
 #endif
 
 struct _starpu_mp_node *_starpu_tcpip_ms_src_get_actual_thread_mp_node()
@@ -231,6 +250,9 @@ void _starpu_deinit_tcpip_config(struct _starpu_machine_config *config)
 void _starpu_tcpip_source_init(struct _starpu_mp_node *node)
 {
 	_starpu_tcpip_common_mp_initialize_src_sink(node);
+#ifdef HAVE_MMAP
+	tcpip_use_shm = starpu_getenv_number_default("STARPU_TCPIP_USE_SHARED_MEMORY", 1);
+#endif
 	//TODO
 }
 
@@ -371,12 +393,157 @@ int _starpu_tcpip_update_map(uintptr_t src, size_t src_offset, unsigned src_node
 	/* Memory mappings are cache-coherent */
 	return 0;
 }
+
+static int _starpu_tcpip_shm_cmp_insert(struct starpu_rbtree_node *left_elm, struct starpu_rbtree_node *right_elm)
+{
+	uintptr_t addr_left = ((struct _starpu_tcpip_shm *) left_elm)->sink_addr;
+	uintptr_t addr_right = ((struct _starpu_tcpip_shm *) right_elm)->sink_addr;
+
+	return addr_left < addr_right ? -1 : addr_left > addr_right;
+}
+
+static int _starpu_tcpip_shm_cmp_lookup(uintptr_t addr_left, struct starpu_rbtree_node *right_elm)
+{
+	uintptr_t addr_right = ((struct _starpu_tcpip_shm *) right_elm)->sink_addr;
+
+	return addr_left < addr_right ? -1 : addr_left > addr_right;
+}
+
+/* Whether buffers of the sink of memory node NODE may be in shared memory */
+static int _starpu_tcpip_shm_node(unsigned node)
+{
+	if (!tcpip_use_shm)
+		return 0;
+
+	struct _starpu_mp_node *mp_node = _starpu_src_common_get_mp_node_from_memory_node(node);
+	return _starpu_tcpip_mp_is_local(mp_node->peer_id);
+}
+
+/* Return the address here of the SIZE bytes at ADDR on the sink of memory
+ * node NODE, or NULL if they are not in shared memory */
+static void *_starpu_tcpip_shm_lookup(unsigned node, uintptr_t addr, size_t size)
+{
+	void *local_addr = NULL;
+	int devid = starpu_memory_node_get_devid(node);
+
+	if (!_starpu_tcpip_shm_node(node))
+		/* Do not bother taking the lock */
+		return NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tcpip_shm_mutex);
+	struct starpu_rbtree_node *shm_node = starpu_rbtree_lookup_nearest(&tcpip_shm_tree[devid], addr, _starpu_tcpip_shm_cmp_lookup, STARPU_RBTREE_LEFT);
+	if (shm_node != NULL)
+	{
+		struct _starpu_tcpip_shm *shm = (struct _starpu_tcpip_shm *) shm_node;
+		if (addr >= shm->sink_addr && addr + size <= shm->sink_addr + shm->size)
+			local_addr = (void *) (shm->addr + (addr - shm->sink_addr));
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tcpip_shm_mutex);
+
+	return local_addr;
+}
+
+/* Allocate the buffers of the local sinks in shared memory segments that we
+ * ask them to map, and the others with a plain allocation on the sink */
+static uintptr_t _starpu_tcpip_allocate(unsigned dst_node, size_t size, int flags)
+{
+#ifdef HAVE_MMAP
+	if (_starpu_tcpip_shm_node(dst_node))
+	{
+		void *addr = _starpu_map_allocate(size, dst_node);
+		if (addr)
+		{
+			uintptr_t sink_addr = _starpu_src_common_map(dst_node, (uintptr_t) addr, size);
+			if (sink_addr)
+			{
+				struct _starpu_tcpip_shm *shm;
+				_STARPU_MALLOC(shm, sizeof(*shm));
+				starpu_rbtree_node_init(&shm->node);
+				shm->sink_addr = sink_addr;
+				shm->addr = (uintptr_t) addr;
+				shm->size = size;
+
+				int devid = starpu_memory_node_get_devid(dst_node);
+				STARPU_PTHREAD_MUTEX_LOCK(&tcpip_shm_mutex);
+				starpu_rbtree_insert(&tcpip_shm_tree[devid], &shm->node, _starpu_tcpip_shm_cmp_insert);
+				STARPU_PTHREAD_MUTEX_UNLOCK(&tcpip_shm_mutex);
+				return sink_addr;
+			}
+			_starpu_map_deallocate(addr, size);
+		}
+		/* Fallback to an allocation on the sink */
+	}
+#endif
+	return _starpu_src_common_allocate(dst_node, size, flags);
+}
+
+static void _starpu_tcpip_free(unsigned dst_node, uintptr_t addr, size_t size, int flags)
+{
+	int devid = starpu_memory_node_get_devid(dst_node);
+	struct _starpu_tcpip_shm *shm = NULL;
+
+	if (_starpu_tcpip_shm_node(dst_node))
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&tcpip_shm_mutex);
+		struct starpu_rbtree_node *shm_node = starpu_rbtree_lookup(&tcpip_shm_tree[devid], addr, _starpu_tcpip_shm_cmp_lookup);
+		if (shm_node != NULL)
+		{
+			shm = (struct _starpu_tcpip_shm *) shm_node;
+			starpu_rbtree_remove(&tcpip_shm_tree[devid], shm_node);
+		}
+		STARPU_PTHREAD_MUTEX_UNLOCK(&tcpip_shm_mutex);
+	}
+
+	if (shm != NULL)
+	{
+		_starpu_src_common_unmap(dst_node, addr, size);
+		_starpu_map_deallocate((void *) shm->addr, shm->size);
+		free(shm);
+	}
+	else
+		_starpu_src_common_free(dst_node, addr, size, flags);
+}
+
+static int _starpu_tcpip_copy_data_host_to_sink(uintptr_t src, size_t src_offset, unsigned src_node, uintptr_t dst, size_t dst_offset, unsigned dst_node, size_t size, struct _starpu_async_channel *async_channel)
+{
+	void *local_dst = _starpu_tcpip_shm_lookup(dst_node, dst + dst_offset, size);
+	if (local_dst != NULL)
+	{
+		memcpy(local_dst, (void *) (src + src_offset), size);
+		return 0;
+	}
+	return _starpu_src_common_copy_data_host_to_sink(src, src_offset, src_node, dst, dst_offset, dst_node, size, async_channel);
+}
+
+static int _starpu_tcpip_copy_data_sink_to_host(uintptr_t src, size_t src_offset, unsigned src_node, uintptr_t dst, size_t dst_offset, unsigned dst_node, size_t size, struct _starpu_async_channel *async_channel)
+{
+	void *local_src = _starpu_tcpip_shm_lookup(src_node, src + src_offset, size);
+	if (local_src != NULL)
+	{
+		memcpy((void *) (dst + dst_offset), local_src, size);
+		return 0;
+	}
+	return _starpu_src_common_copy_data_sink_to_host(src, src_offset, src_node, dst, dst_offset, dst_node, size, async_channel);
+}
+
+static int _starpu_tcpip_copy_data_sink_to_sink(uintptr_t src, size_t src_offset, unsigned src_node, uintptr_t dst, size_t dst_offset, unsigned dst_node, size_t size, struct _starpu_async_channel *async_channel)
+{
+	void *local_src = _starpu_tcpip_shm_lookup(src_node, src + src_offset, size);
+	void *local_dst = _starpu_tcpip_shm_lookup(dst_node, dst + dst_offset, size);
+	if (local_src != NULL && local_dst != NULL)
+	{
+		memcpy(local_dst, local_src, size);
+		return 0;
+	}
+	return _starpu_src_common_copy_data_sink_to_sink(src, src_offset, src_node, dst, dst_offset, dst_node, size, async_channel);
+}
+
 struct _starpu_node_ops _starpu_driver_tcpip_ms_node_ops =
 {
 	.name = "tcpip driver",
 
-	.malloc_on_node = _starpu_src_common_allocate,
-	.free_on_node = _starpu_src_common_free,
+	.malloc_on_node = _starpu_tcpip_allocate,
+	.free_on_node = _starpu_tcpip_free,
 
 	.is_direct_access_supported = _starpu_tcpip_is_direct_access_supported,
 
@@ -386,11 +553,11 @@ struct _starpu_node_ops _starpu_driver_tcpip_ms_node_ops =
 	.copy_interface_from[STARPU_CPU_RAM] = _starpu_copy_interface_any_to_any,
 	.copy_interface_from[STARPU_TCPIP_MS_RAM] = _starpu_copy_interface_any_to_any,
 
-	.copy_data_to[STARPU_CPU_RAM] = _starpu_src_common_copy_data_sink_to_host,
-	.copy_data_to[STARPU_TCPIP_MS_RAM] = _starpu_src_common_copy_data_sink_to_sink,
+	.copy_data_to[STARPU_CPU_RAM] = _starpu_tcpip_copy_data_sink_to_host,
+	.copy_data_to[STARPU_TCPIP_MS_RAM] = _starpu_tcpip_copy_data_sink_to_sink,
 
-	.copy_data_from[STARPU_CPU_RAM] = _starpu_src_common_copy_data_host_to_sink,
-	.copy_data_from[STARPU_TCPIP_MS_RAM] = _starpu_src_common_copy_data_sink_to_sink,
+	.copy_data_from[STARPU_CPU_RAM] = _starpu_tcpip_copy_data_host_to_sink,
+	.copy_data_from[STARPU_TCPIP_MS_RAM] = _starpu_tcpip_copy_data_sink_to_sink,
 
 	.wait_request_completion = _starpu_tcpip_common_wait_request_completion,
 	.test_request_completion = _starpu_tcpip_common_test_event,
@@ -27,6 +27,7 @@
 #include <core/jobs.h>
 #include <core/workers.h>
 #include <datawizard/memory_nodes.h>
+#include <common/uthash.h>
 
 #ifdef STARPU_HAVE_GLPK_H
 #include <glpk.h>
@@ -81,8 +82,10 @@ struct bound_task_pool
  */
 struct task_dep
 {
-	/* Task this depends on */
+	/* Task this depends on, NULL when streaming */
 	struct bound_task *dep;
+	/* Its ID */
+	unsigned long id;
 	/* Data transferred between tasks (i.e. implicit data dep size) */
 	size_t size;
 };
@@ -90,6 +93,8 @@ struct bound_task
 {
 	/* Unique ID */
 	unsigned long id;
+	/* Member of the tasks_by_id hash table */
+	UT_hash_handle hh;
 	/* Tag ID, if any */
 	starpu_tag_t tag_id;
 	int use_tag;
@@ -102,10 +107,14 @@ struct bound_task
 	/* Tasks this one depends on */
 	struct task_dep *deps;
 	int depsn;
+	int depsalloc;
 
 	/* Estimated duration */
 	double** duration[STARPU_NARCH];
 
+	/* Last ancestor() walk which visited this task */
+	unsigned long ancestor_walk;
+
 	/* Other tasks */
 	struct bound_task *next;
 };
@@ -119,18 +128,46 @@ struct bound_tag_dep
 
 static struct bound_task_pool *task_pools, *last;
 static struct bound_task *tasks;
+/* Index of tasks by job ID */
+static struct bound_task *tasks_by_id;
 static struct bound_tag_dep *tag_deps;
 int _starpu_bound_recording;
 static int recorddeps;
 static int recordprio;
+/* When streaming, where the linear programming problem is being written */
+static FILE *stream;
+/* When streaming, ID of the last task written, to chain worker loads */
+static unsigned long stream_last_id;
+static int stream_has_last;
+/* When streaming, IDs of the tasks written, to declare their binary
+ * variables after all the constraints */
+static unsigned long *stream_ids;
+static unsigned stream_nids, stream_nidsalloc;
 
 static starpu_pthread_mutex_t mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
 
-static void _starpu_bound_clear(int record, int deps, int prio)
+static void free_task(struct bound_task *t)
+{
+	unsigned i,j;
+	for (i = 0; i < STARPU_NARCH; i++)
+	{
+		if (t->duration[i])
+		{
+			for (j = 0; t->duration[i][j]; j++)
+				free(t->duration[i][j]);
+			free(t->duration[i]);
+		}
+	}
+	free(t->deps);
+	free(t);
+}
+
+static void _starpu_bound_clear(int record, int deps, int prio, FILE *output)
 {
 	struct bound_task_pool *tp;
-	struct bound_task *t;
+	struct bound_task *t, *tt, *tmp;
 	struct bound_tag_dep *td;
+	unsigned long *ids;
 
 	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
 
@@ -140,6 +177,19 @@ static void _starpu_bound_clear(int record, int deps, int prio)
 
 	t = tasks;
 	tasks = NULL;
+	if (stream)
+		/* When streaming, the tasks not written yet are only in the index */
+		HASH_ITER(hh, tasks_by_id, tt, tmp)
+		{
+			tt->next = t;
+			t = tt;
+		}
+	HASH_CLEAR(hh, tasks_by_id);
+
+	ids = stream_ids;
+	stream_ids = NULL;
+	stream_nids = 0;
+	stream_nidsalloc = 0;
 
 	td = tag_deps;
 	tag_deps = NULL;
@@ -147,9 +197,18 @@ static void _starpu_bound_clear(int record, int deps, int prio)
 	_starpu_bound_recording = record;
 	recorddeps = deps;
 	recordprio = prio;
+	stream = output;
+	stream_has_last = 0;
+
+	if (output)
+		fprintf(output, "/* StarPU upper bound linear programming problem, to be run in lp_solve. */\n\n"
+				"/* We want to minimize total execution time (ms) */\n"
+				"min: tmax;\n");
 
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 
+	free(ids);
+
 	while (tp != NULL)
 	{
 		struct bound_task_pool *next = tp->next;
@@ -160,18 +219,7 @@ static void _starpu_bound_clear(int record, int deps, int prio)
 	while (t != NULL)
 	{
 		struct bound_task *next = t->next;
-		unsigned i,j;
-		for (i = 0; i < STARPU_NARCH; i++)
-		{
-			if (t->duration[i])
-			{
-				for (j = 0; t->duration[i][j]; j++)
-					free(t->duration[i][j]);
-				free(t->duration[i]);
-			}
-		}
-		free(t->deps);
-		free(t);
+		free_task(t);
 		t = next;
 	}
 
@@ -185,13 +233,19 @@ static void _starpu_bound_clear(int record, int deps, int prio)
 
 void starpu_bound_clear(void)
 {
-	_starpu_bound_clear(0, 0, 0);
+	_starpu_bound_clear(0, 0, 0, NULL);
 }
 
 /* Initialization */
 void starpu_bound_start(int deps, int prio)
 {
-	_starpu_bound_clear(1, deps, prio);
+	_starpu_bound_clear(1, deps, prio, NULL);
+}
+
+void starpu_bound_start_stream(FILE *output)
+{
+	STARPU_ASSERT(output);
+	_starpu_bound_clear(1, 1, 0, output);
 }
 
 /* Whether we will include it in the computation */
@@ -266,10 +320,209 @@ static void new_task(struct _starpu_job *j)
 	t->priority = j->task->priority;
 	t->deps = NULL;
 	t->depsn = 0;
+	t->depsalloc = 0;
 	initialize_duration(t);
-	t->next = tasks;
 	j->bound_task = t;
-	tasks = t;
+	if (!stream)
+	{
+		t->next = tasks;
+		tasks = t;
+	}
+	/* When streaming, the tasks are only kept in the index until they get
+	 * submitted */
+	HASH_ADD(hh, tasks_by_id, id, sizeof(t->id), t);
+}
+
+/* Remove a task from the index, only used when streaming */
+static void remove_task(struct bound_task *t)
+{
+	HASH_DEL(tasks_by_id, t);
+}
+
+/* Add a dependency of t on task of id ID, or add size if it is already there */
+static void add_dep(struct bound_task *t, struct bound_task *dep, unsigned long id, size_t size)
+{
+	int i;
+	for (i = 0; i < t->depsn; i++)
+		if (t->deps[i].id == id)
+		{
+			/* Found, just add size */
+			t->deps[i].size += size;
+			return;
+		}
+
+	/* Not already there, add */
+	if (t->depsn == t->depsalloc)
+	{
+		t->depsalloc = t->depsalloc ? 2*t->depsalloc : 4;
+		_STARPU_REALLOC(t->deps, t->depsalloc * sizeof(t->deps[0]));
+	}
+	t->deps[t->depsn].dep = dep;
+	t->deps[t->depsn].id = id;
+	t->deps[t->depsn].size = size;
+	t->depsn++;
+}
+
+/* Estimated duration of task t on worker w */
+static double *task_duration(struct bound_task *t, int w)
+{
+	struct starpu_perfmodel_arch* arch = starpu_worker_get_perf_archtype(w, STARPU_NMAX_SCHED_CTXS);
+	return &t->duration[arch->devices[0].type][arch->devices[0].devid][arch->devices[0].ncores];
+}
+
+/* Fill the estimated durations of task t on the nw workers */
+static void compute_durations(struct bound_task *t, int nw)
+{
+	int w;
+
+	if (t->cl->model->type != STARPU_HISTORY_BASED &&
+	    t->cl->model->type != STARPU_NL_REGRESSION_BASED)
+		/* TODO: */
+		_STARPU_MSG("Warning: task %s uses a perf model which is neither history nor non-linear regression-based, support for such model is not implemented yet, system will not be solvable.\n", _starpu_codelet_get_model_name(t->cl));
+
+	struct _starpu_job j =
+	{
+		.footprint = t->footprint,
+		.footprint_is_computed = 1,
+	};
+	for (w = 0; w < nw; w++)
+	{
+		double *duration = task_duration(t, w);
+		if (_STARPU_IS_ZERO(*duration))
+		{
+			struct starpu_perfmodel_arch* arch = starpu_worker_get_perf_archtype(w, STARPU_NMAX_SCHED_CTXS);
+			double length = _starpu_history_based_job_expected_perf(t->cl->model, arch, &j,j.nimpl);
+			if (isnan(length))
+				/* Avoid problems with binary coding of doubles */
+				*duration = NAN;
+			else
+				*duration = length / 1000.;
+		}
+	}
+}
+
+/* Print the constraints of the i-th dependency of task t1 */
+static void print_lp_dep(FILE *output, struct bound_task *t1, int i, int nw)
+{
+	unsigned n, n2;
+	int w, w2;
+	unsigned long dep_id = t1->deps[i].id;
+
+	fprintf(output, "/* %lu bytes transferred */\n", (unsigned long) t1->deps[i].size);
+	fprintf(output, "s%lu >= c%lu", t1->id, dep_id);
+	/* Transfer time: pick up one source node and a worker on it */
+	for (n = 0; n < starpu_memory_nodes_get_count(); n++)
+	for (w = 0; w < nw; w++)
+	if (starpu_worker_get_memory_node(w) == n)
+	{
+		/* pick up another destination node and a worker on it */
+		for (n2 = 0; n2 < starpu_memory_nodes_get_count(); n2++)
+		if (n2 != n)
+		{
+			for (w2 = 0; w2 < nw; w2++)
+			if (starpu_worker_get_memory_node(w2) == n2)
+			{
+				/* If predecessor is on worker w and successor
+				 * on worker w2 on different nodes, we need to
+				 * transfer the data. */
+				fprintf(output, " + d_t%luw%dt%luw%d", dep_id, w, t1->id, w2);
+
+			}
+		}
+	}
+	fprintf(output, ";\n");
+	/* Transfer time: pick up one source node and a worker on it */
+	for (n = 0; n < starpu_memory_nodes_get_count(); n++)
+	for (w = 0; w < nw; w++)
+	if (starpu_worker_get_memory_node(w) == n)
+	{
+		/* pick up another destination node and a worker on it */
+		for (n2 = 0; n2 < starpu_memory_nodes_get_count(); n2++)
+		if (n2 != n)
+		{
+			for (w2 = 0; w2 < nw; w2++)
+			if (starpu_worker_get_memory_node(w2) == n2)
+			{
+				/* The data transfer is at least 0ms */
+				fprintf(output, "d_t%luw%dt%luw%d >= 0;\n", dep_id, w, t1->id, w2);
+				/* The data transfer from w to w2 only happens if tasks run there */
+				fprintf(output, "d_t%luw%dt%luw%d >= %f - 2e5 + 1e5 t%luw%d + 1e5 t%luw%d;\n",
+						dep_id, w, t1->id, w2,
+						starpu_transfer_predict(n, n2, t1->deps[i].size)/1000.,
+						dep_id, w, t1->id, w2);
+			}
+		}
+	}
+}
+
+/*
+ * Write all the constraints of task t1 on the stream.
+ *
+ * We can not express that tasks executed by the same worker do not overlap,
+ * since that needs constraints for each pair of tasks. We instead express that
+ * the total execution time is at least the load of each worker, accumulated
+ * along the stream in the l<w>t<id> variables.
+ */
+static void stream_task(struct bound_task *t1)
+{
+	int nw = starpu_worker_get_count();
+	int w, i;
+
+	compute_durations(t1, nw);
+
+	fprintf(stream, "\n/* %s %x */\n", _starpu_codelet_get_model_name(t1->cl), (unsigned) t1->footprint);
+	fprintf(stream, "c%lu <= tmax;\n", t1->id);
+
+	/* Exactly one worker executes it */
+	for (w = 0; w < nw; w++)
+		if (!isnan(*task_duration(t1, w)))
+			fprintf(stream, " +t%luw%d", t1->id, w);
+	fprintf(stream, " = 1;\n");
+
+	/* Completion time is start time plus computation time */
+	fprintf(stream, "c%lu = s%lu", t1->id, t1->id);
+	for (w = 0; w < nw; w++)
+		if (!isnan(*task_duration(t1, w)))
+			fprintf(stream, " + %f t%luw%d", *task_duration(t1, w), t1->id, w);
+	fprintf(stream, ";\n");
+
+	/* It starts after all its task dependencies finish and data is transferred */
+	for (i = 0; i < t1->depsn; i++)
+		print_lp_dep(stream, t1, i, nw);
+
+	/* Its tag finishes when it finishes */
+	if (t1->use_tag)
+		fprintf(stream, "c%lu = tag%lu;\n", t1->id, (unsigned long) t1->tag_id);
+
+	/* Load of the workers */
+	for (w = 0; w < nw; w++)
+	{
+		int empty = 1;
+		fprintf(stream, "l%dt%lu =", w, t1->id);
+		if (stream_has_last)
+		{
+			fprintf(stream, " l%dt%lu", w, stream_last_id);
+			empty = 0;
+		}
+		if (!isnan(*task_duration(t1, w)))
+		{
+			fprintf(stream, " + %f t%luw%d", *task_duration(t1, w), t1->id, w);
+			empty = 0;
+		}
+		fprintf(stream, "%s;\n", empty ? " 0" : "");
+	}
+
+	/* The binary variables can only be declared after all the
+	 * constraints, see starpu_bound_stop */
+	if (stream_nids == stream_nidsalloc)
+	{
+		stream_nidsalloc = stream_nidsalloc ? 2*stream_nidsalloc : 1024;
+		_STARPU_REALLOC(stream_ids, stream_nidsalloc * sizeof(stream_ids[0]));
+	}
+	stream_ids[stream_nids++] = t1->id;
+
+	stream_last_id = t1->id;
+	stream_has_last = 1;
 }
 
 /* A new task was submitted, record it */
@@ -292,6 +545,15 @@ void _starpu_bound_record(struct _starpu_job *j)
 	if (recorddeps)
 	{
 		new_task(j);
+		if (stream)
+		{
+			/* All its dependencies are known now, write it and forget it */
+			struct bound_task *t = j->bound_task;
+			stream_task(t);
+			remove_task(t);
+			free_task(t);
+			j->bound_task = NULL;
+		}
 	}
 	else
 	{
@@ -339,20 +601,22 @@ void _starpu_bound_tag_dep(starpu_tag_t id, starpu_tag_t dep_id)
 		return;
 	}
 
-	_STARPU_MALLOC(td, sizeof(*td));
-	td->tag = id;
-	td->dep_tag = dep_id;
-	td->next = tag_deps;
-	tag_deps = td;
+	if (stream)
+		fprintf(stream, "tag%lu >= tag%lu;\n", (unsigned long) id, (unsigned long) dep_id);
+	else
+	{
+		_STARPU_MALLOC(td, sizeof(*td));
+		td->tag = id;
+		td->dep_tag = dep_id;
+		td->next = tag_deps;
+		tag_deps = td;
+	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 }
 
 /* A task dependency was emitted, record it */
 void _starpu_bound_task_dep(struct _starpu_job *j, struct _starpu_job *dep_j)
 {
-	struct bound_task *t;
-	int i;
-
 	if (!_starpu_bound_recording || !recorddeps)
 		return;
 
@@ -368,18 +632,10 @@ void _starpu_bound_task_dep(struct _starpu_job *j, struct _starpu_job *dep_j)
 	}
 
 	new_task(j);
-	new_task(dep_j);
-	t = j->bound_task;
-	for (i = 0; i < t->depsn; i++)
-		if (t->deps[i].dep == dep_j->bound_task)
-			break;
-	if (i == t->depsn)
-	{
-		/* Not already there, add */
-		_STARPU_REALLOC(t->deps, ++t->depsn * sizeof(t->deps[0]));
-		t->deps[t->depsn-1].dep = dep_j->bound_task;
-		t->deps[t->depsn-1].size = 0; /* We don't have data information in that case */
-	}
+	if (!stream)
+		new_task(dep_j);
+	/* We don't have data information in that case */
+	add_dep(j->bound_task, dep_j->bound_task, dep_j->job_id, 0);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 }
 
@@ -388,17 +644,14 @@ static struct bound_task *find_job(unsigned long id)
 {
 	struct bound_task *t;
 
-	for (t = tasks; t; t = t->next)
-		if (t->id == id)
-			return t;
-	return NULL;
+	HASH_FIND(hh, tasks_by_id, &id, sizeof(id), t);
+	return t;
 }
 
 /* Job J depends on previous job of id ID (which is already finished) */
 void _starpu_bound_job_id_dep_size(size_t size, struct _starpu_job *j, unsigned long id)
 {
-	struct bound_task *t, *dep_t;
-	int i;
+	struct bound_task *dep_t = NULL;
 
 	if (!_starpu_bound_recording || !recorddeps)
 		return;
@@ -415,28 +668,19 @@ void _starpu_bound_job_id_dep_size(size_t size, struct _starpu_job *j, unsigned
 	}
 
 	new_task(j);
-	dep_t = find_job(id);
-	if (!dep_t)
+	if (!stream)
 	{
-		_STARPU_MSG("dependency %lu not found !\n", id);
-		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
-		return;
-	}
-	t = j->bound_task;
-	for (i = 0; i < t->depsn; i++)
-		if (t->deps[i].dep == dep_t)
+		/* When streaming, the previous job was already written and
+		 * forgotten, just refer to its ID */
+		dep_t = find_job(id);
+		if (!dep_t)
 		{
-			/* Found, just add size */
-			t->deps[i].size += size;
-			break;
+			_STARPU_MSG("dependency %lu not found !\n", id);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+			return;
 		}
-	if (i == t->depsn)
-	{
-		/* Not already there, add */
-		_STARPU_REALLOC(t->deps, ++t->depsn * sizeof(t->deps[0]));
-		t->deps[t->depsn-1].dep = dep_t;
-		t->deps[t->depsn-1].size = size;
 	}
+	add_dep(j->bound_task, dep_t, id, size);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 }
 
@@ -454,6 +698,25 @@ void _starpu_bound_job_id_dep(starpu_data_handle_t handle, struct _starpu_job *j
 void starpu_bound_stop(void)
 {
 	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	if (_starpu_bound_recording && stream)
+	{
+		int w, nw = starpu_worker_get_count();
+		unsigned i;
+		if (stream_has_last)
+		{
+			fprintf(stream, "\n/* The total execution time is at least the load of each worker */\n");
+			for (w = 0; w < nw; w++)
+				fprintf(stream, "l%dt%lu <= tmax;\n", w, stream_last_id);
+		}
+
+		/* lp_format wants the declarations after all the constraints */
+		if (stream_nids)
+			fprintf(stream, "\n");
+		for (i = 0; i < stream_nids; i++)
+			for (w = 0; w < nw; w++)
+				fprintf(stream, "bin t%luw%d;\n", stream_ids[i], w);
+		fflush(stream);
+	}
 	_starpu_bound_recording = 0;
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 }
@@ -482,20 +745,33 @@ static void _starpu_get_tasks_times(int nw, int nt, double *times)
 	}
 }
 
-/* Return whether PARENT is an ancestor of CHILD */
-static int ancestor(struct bound_task *child, struct bound_task *parent)
+static unsigned long ancestor_walk;
+
+static int _ancestor(struct bound_task *child, struct bound_task *parent)
 {
 	int i;
 	for (i = 0; i < child->depsn; i++)
 	{
-		if (parent == child->deps[i].dep)
+		struct bound_task *dep = child->deps[i].dep;
+		if (parent == dep)
 			return 1;
-		if (ancestor(child->deps[i].dep, parent))
+		/* Do not walk again through tasks already visited */
+		if (dep->ancestor_walk == ancestor_walk)
+			continue;
+		dep->ancestor_walk = ancestor_walk;
+		if (_ancestor(dep, parent))
 			return -1;
 	}
 	return 0;
 }
 
+/* Return whether PARENT is an ancestor of CHILD */
+static int ancestor(struct bound_task *child, struct bound_task *parent)
+{
+	ancestor_walk++;
+	return _ancestor(child, parent);
+}
+
 /* Print bound recording in .dot format */
 void starpu_bound_print_dot(FILE *output)
 {
@@ -503,7 +779,7 @@ void starpu_bound_print_dot(FILE *output)
 	struct bound_tag_dep *td;
 	int i;
 
-	if (!recorddeps)
+	if (!recorddeps || stream)
 	{
 		fprintf(output, "Not supported\n");
 		return;
@@ -513,7 +789,7 @@ void starpu_bound_print_dot(FILE *output)
 	{
 		fprintf(output, "\"t%lu\" [label=\"%lu: %s\"]\n", t->id, t->id, _starpu_codelet_get_model_name(t->cl));
 		for (i = 0; i < t->depsn; i++)
-			fprintf(output, "\"t%lu\" -> \"t%lu\"\n", t->deps[i].dep->id, t->id);
+			fprintf(output, "\"t%lu\" -> \"t%lu\"\n", t->deps[i].id, t->id);
 	}
 	for (td = tag_deps; td; td = td->next)
 		fprintf(output, "\"tag%lu\" -> \"tag%lu\";\n", (unsigned long) td->dep_tag, (unsigned long) td->tag);
@@ -531,14 +807,22 @@ void starpu_bound_print_lp(FILE *output)
 	int nt; /* Number of different kinds of tasks */
 	int nw; /* Number of different workers */
 	int t;
-	int w, w2; /* worker */
-	unsigned n, n2;
+	int w; /* worker */
+
+	if (stream)
+	{
+		fprintf(output, "Not supported\n");
+		return;
+	}
 
 	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
 	nw = starpu_worker_get_count();
 	if (!nw)
+	{
 		/* Make llvm happy about the VLA below */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 		return;
+	}
 
 	if (recorddeps)
 	{
@@ -549,33 +833,14 @@ void starpu_bound_print_lp(FILE *output)
 		nt = 0;
 		for (t1 = tasks; t1; t1 = t1->next)
 		{
-			if (t1->cl->model->type != STARPU_HISTORY_BASED &&
-			    t1->cl->model->type != STARPU_NL_REGRESSION_BASED)
-				/* TODO: */
-				_STARPU_MSG("Warning: task %s uses a perf model which is neither history nor non-linear regression-based, support for such model is not implemented yet, system will not be solvable.\n", _starpu_codelet_get_model_name(t1->cl));
-
-			struct _starpu_job j =
-			{
-				.footprint = t1->footprint,
-				.footprint_is_computed = 1,
-			};
-			for (w = 0; w < nw; w++)
-			{
-				struct starpu_perfmodel_arch* arch = starpu_worker_get_perf_archtype(w, STARPU_NMAX_SCHED_CTXS);
-				if (_STARPU_IS_ZERO(t1->duration[arch->devices[0].type][arch->devices[0].devid][arch->devices[0].ncores]))
-				{
-					double length = _starpu_history_based_job_expected_perf(t1->cl->model, arch, &j,j.nimpl);
-					if (isnan(length))
-						/* Avoid problems with binary coding of doubles */
-						t1->duration[arch->devices[0].type][arch->devices[0].devid][arch->devices[0].ncores] = NAN;
-					else
-						t1->duration[arch->devices[0].type][arch->devices[0].devid][arch->devices[0].ncores] = length / 1000.;
-				}
-			}
+			compute_durations(t1, nw);
 			nt++;
 		}
 		if (!nt)
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 			return;
+		}
 		fprintf(output, "/* StarPU upper bound linear programming problem, to be run in lp_solve. */\n\n");
 		fprintf(output, "/* !! This is a big system, it will be long to solve !! */\n\n");
 
@@ -621,54 +886,7 @@ void starpu_bound_print_lp(FILE *output)
 		fprintf(output, "/* Note that the dependency finish time depends on the worker where it's working */\n");
 		for (t1 = tasks; t1; t1 = t1->next)
 			for (i = 0; i < t1->depsn; i++)
-			{
-				fprintf(output, "/* %lu bytes transferred */\n", (unsigned long) t1->deps[i].size);
-				fprintf(output, "s%lu >= c%lu", t1->id, t1->deps[i].dep->id);
-				/* Transfer time: pick up one source node and a worker on it */
-				for (n = 0; n < starpu_memory_nodes_get_count(); n++)
-				for (w = 0; w < nw; w++)
-				if (starpu_worker_get_memory_node(w) == n)
-				{
-					/* pick up another destination node and a worker on it */
-					for (n2 = 0; n2 < starpu_memory_nodes_get_count(); n2++)
-					if (n2 != n)
-					{
-						for (w2 = 0; w2 < nw; w2++)
-						if (starpu_worker_get_memory_node(w2) == n2)
-						{
-							/* If predecessor is on worker w and successor
-							 * on worker w2 on different nodes, we need to
-							 * transfer the data. */
-							fprintf(output, " + d_t%luw%dt%luw%d", t1->deps[i].dep->id, w, t1->id, w2);
-
-						}
-					}
-				}
-				fprintf(output, ";\n");
-				/* Transfer time: pick up one source node and a worker on it */
-				for (n = 0; n < starpu_memory_nodes_get_count(); n++)
-				for (w = 0; w < nw; w++)
-				if (starpu_worker_get_memory_node(w) == n)
-				{
-					/* pick up another destination node and a worker on it */
-					for (n2 = 0; n2 < starpu_memory_nodes_get_count(); n2++)
-					if (n2 != n)
-					{
-						for (w2 = 0; w2 < nw; w2++)
-						if (starpu_worker_get_memory_node(w2) == n2)
-						{
-							/* The data transfer is at least 0ms */
-							fprintf(output, "d_t%luw%dt%luw%d >= 0;\n", t1->deps[i].dep->id, w, t1->id, w2);
-							/* The data transfer from w to w2 only happens if tasks run there */
-							fprintf(output, "d_t%luw%dt%luw%d >= %f - 2e5 + 1e5 t%luw%d + 1e5 t%luw%d;\n",
-									t1->deps[i].dep->id, w, t1->id, w2,
-									starpu_transfer_predict(n, n2, t1->deps[i].size)/1000.,
-									t1->deps[i].dep->id, w, t1->id, w2);
-						}
-					}
-				}
-			}
-
+				print_lp_dep(output, t1, i, nw);
 
 		fprintf(output, "\n/* Each tag finishes when its corresponding task finishes */\n");
 		for (t1 = tasks; t1; t1 = t1->next)
@@ -822,7 +1040,10 @@ void starpu_bound_print_lp(FILE *output)
 		for (tp = task_pools; tp; tp = tp->next)
 			nt++;
 		if (!nt)
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
 			return;
+		}
 
 		{
 			double times[nw*nt];
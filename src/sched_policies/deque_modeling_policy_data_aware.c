@@ -430,9 +430,7 @@ static int push_task_on_best_worker(struct starpu_task *task, int best_workerid,
 	else
 	{
 		starpu_worker_lock(best_workerid);
-		starpu_task_list_push_back (&dt->queue_array[best_workerid].taskq, task);
-		dt->queue_array[best_workerid].ntasks++;
-		dt->queue_array[best_workerid].nprocessed++;
+		_starpu_fifo_taskq_append_task(&dt->queue_array[best_workerid], task);
 #if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
 		starpu_wake_worker_locked(best_workerid);
 #endif
@@ -445,15 +443,48 @@ static int push_task_on_best_worker(struct starpu_task *task, int best_workerid,
 	return ret;
 }
 
-/* TODO: factorise CPU computations, expensive with a lot of cores */
+/* Whether two architectures are described the same way, and thus get the same
+ * predictions from non-per-worker performance models */
+static int same_perf_arch(struct starpu_perfmodel_arch *arch1, struct starpu_perfmodel_arch *arch2)
+{
+	int dev;
+
+	if (arch1 == arch2)
+		return 1;
+	if (arch1->ndevices != arch2->ndevices)
+		return 0;
+	for (dev = 0; dev < arch1->ndevices; dev++)
+		if (arch1->devices[dev].type != arch2->devices[dev].type
+		 || arch1->devices[dev].devid != arch2->devices[dev].devid
+		 || arch1->devices[dev].ncores != arch2->devices[dev].ncores)
+			return 0;
+	return 1;
+}
+
+/* The (worker, implementation) pairs which may execute a task, along with the
+ * predictions for them. This is kept as a structure of arrays, padded to a
+ * multiple of DMDA_VECTOR_WIDTH, so that the fitness of all pairs can be
+ * computed with vectorized loops. */
+#define DMDA_VECTOR_WIDTH 4
+
+struct _starpu_dmda_candidates
+{
+	unsigned n;
+	unsigned *workerid;
+	unsigned *worker_ctx;
+	unsigned *impl;
+	double *exp_end;
+	double *length;
+	double *penalty;
+	double *energy;
+};
+
 static void compute_all_performance_predictions(struct starpu_task *task,
 						unsigned nworkers,
-						double local_task_length[nworkers][STARPU_MAXIMPLEMENTATIONS],
-						double exp_end[nworkers][STARPU_MAXIMPLEMENTATIONS],
+						struct _starpu_dmda_candidates *c,
 						double *max_exp_endp_of_workers,
 						double *min_exp_endp_of_task,
-						double local_data_penalty[nworkers][STARPU_MAXIMPLEMENTATIONS],
-						double local_energy[nworkers][STARPU_MAXIMPLEMENTATIONS],
+						unsigned da,
 						int *forced_worker, int *forced_impl, unsigned sched_ctx_id, unsigned sorted_decision)
 {
 	int calibrating = 0;
@@ -478,6 +509,30 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
 	double now = starpu_timing_now();
 
+	/* With a lot of cores, most workers have the same architecture, so
+	 * unless the model is per-worker, only compute the task length and
+	 * energy once per architecture. We remember which candidate computed
+	 * them for which implementations. */
+	struct starpu_perfmodel *model = task->cl ? task->cl->model : NULL;
+	struct starpu_perfmodel *energy_model = task->cl ? task->cl->energy_model : NULL;
+	unsigned share_lengths = !bundle && (!model || model->type != STARPU_PER_WORKER);
+	unsigned share_energies = da && !bundle && (!energy_model || energy_model->type != STARPU_PER_WORKER);
+	struct starpu_perfmodel_arch *known_arch[nworkers];
+	unsigned known_arch_cand[nworkers][STARPU_MAXIMPLEMENTATIONS];
+	unsigned known_arch_impl_mask[nworkers];
+	unsigned nknown_archs = 0;
+
+	/* Similarly, unless the codelet asks for specific nodes, the transfer
+	 * time only depends on the memory node of the worker, so only compute
+	 * it once per memory node. */
+	unsigned share_penalties = bundle || !task->cl || !task->cl->specific_nodes;
+	double node_penalty[STARPU_MAXNODES];
+	char node_penalty_known[STARPU_MAXNODES];
+	if (da && share_penalties)
+		memset(node_penalty_known, 0, sizeof(node_penalty_known));
+
+	c->n = 0;
+
 	struct starpu_sched_ctx_iterator it;
 	workers->init_iterator_for_parallel_tasks(workers, &it, task);
 	while(worker_ctx<nworkers && workers->has_next(workers, &it))
@@ -488,6 +543,7 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 		struct starpu_st_fifo_taskq *fifo = &dt->queue_array[workerid];
 		struct starpu_perfmodel_arch* perf_arch = starpu_worker_get_perf_archtype(workerid, sched_ctx_id);
 		unsigned memory_node = starpu_worker_get_memory_node(workerid);
+		double penalty = 0.;
 
 		STARPU_ASSERT_MSG(fifo != NULL, "workerid %u ctx %u\n", workerid, sched_ctx_id);
 
@@ -497,6 +553,43 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 		if (!starpu_worker_can_execute_task_impl(workerid, task, &impl_mask))
 			continue;
 
+		int known = -1;
+		if (share_lengths || share_energies)
+		{
+			unsigned i;
+			for (i = 0; i < nknown_archs; i++)
+				if (same_perf_arch(known_arch[i], perf_arch))
+				{
+					known = i;
+					break;
+				}
+			if (known == -1)
+			{
+				known = nknown_archs++;
+				known_arch[known] = perf_arch;
+				known_arch_impl_mask[known] = 0;
+			}
+		}
+
+		/* The transfer time does not depend on the implementation */
+		if (da)
+		{
+			if (share_penalties && node_penalty_known[memory_node])
+				penalty = node_penalty[memory_node];
+			else
+			{
+				if (bundle)
+					penalty = starpu_task_bundle_expected_data_transfer_time(bundle, memory_node);
+				else
+					penalty = starpu_task_expected_data_transfer_time_for(task, workerid);
+				if (share_penalties)
+				{
+					node_penalty[memory_node] = penalty;
+					node_penalty_known[memory_node] = 1;
+				}
+			}
+		}
+
 		for (nimpl  = 0; nimpl < STARPU_MAXIMPLEMENTATIONS; nimpl++)
 		{
 			if (!(impl_mask & (1U << nimpl)))
@@ -505,6 +598,13 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 				continue;
 			}
 
+			unsigned cand = c->n++;
+			c->workerid[cand] = workerid;
+			c->worker_ctx[cand] = worker_ctx;
+			c->impl[cand] = nimpl;
+			c->penalty[cand] = penalty;
+			c->energy[cand] = 0.;
+
 			int fifo_ntasks = fifo->ntasks;
 			double prev_exp_len = fifo->exp_len;
 			/* consider the priority of the task when deciding on which workerid to schedule,
@@ -524,32 +624,43 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 				}
 			}
 
-			exp_end[worker_ctx][nimpl] = exp_start + prev_exp_len;
-			if (exp_end[worker_ctx][nimpl] > max_exp_end_of_workers)
-				max_exp_end_of_workers = exp_end[worker_ctx][nimpl];
+			c->exp_end[cand] = exp_start + prev_exp_len;
+			if (c->exp_end[cand] > max_exp_end_of_workers)
+				max_exp_end_of_workers = c->exp_end[cand];
 
-			//_STARPU_DEBUG("Scheduler dmda: task length (%lf) workerid (%u) kernel (%u) \n", local_task_length[workerid][nimpl],workerid,nimpl);
+			//_STARPU_DEBUG("Scheduler dmda: task length (%lf) workerid (%u) kernel (%u) \n", c->length[cand],workerid,nimpl);
 
 			if (bundle)
 			{
 				/* TODO : conversion time */
-				local_task_length[worker_ctx][nimpl] = starpu_task_bundle_expected_length(bundle, perf_arch, nimpl);
-				if (local_data_penalty)
-					local_data_penalty[worker_ctx][nimpl] = starpu_task_bundle_expected_data_transfer_time(bundle, memory_node);
-				if (local_energy)
-					local_energy[worker_ctx][nimpl] = starpu_task_bundle_expected_energy(bundle, perf_arch,nimpl);
+				c->length[cand] = starpu_task_bundle_expected_length(bundle, perf_arch, nimpl);
+				if (da)
+					c->energy[cand] = starpu_task_bundle_expected_energy(bundle, perf_arch,nimpl);
 
 			}
 			else
 			{
-				local_task_length[worker_ctx][nimpl] = starpu_task_worker_expected_length(task, workerid, sched_ctx_id, nimpl);
-				if (local_data_penalty)
-					local_data_penalty[worker_ctx][nimpl] = starpu_task_expected_data_transfer_time_for(task, workerid);
-				if (local_energy)
-					local_energy[worker_ctx][nimpl] = starpu_task_worker_expected_energy(task, workerid, sched_ctx_id,nimpl);
-				double conversion_time = starpu_task_expected_conversion_time(task, perf_arch, nimpl);
-				if (conversion_time > 0.0)
-					local_task_length[worker_ctx][nimpl] += conversion_time;
+				/* Whether this was already computed for a worker of the same architecture */
+				int same = known != -1 && (known_arch_impl_mask[known] & (1U << nimpl));
+
+				if (same && share_lengths)
+					c->length[cand] = c->length[known_arch_cand[known][nimpl]];
+				else
+				{
+					c->length[cand] = starpu_task_worker_expected_length(task, workerid, sched_ctx_id, nimpl);
+					double conversion_time = starpu_task_expected_conversion_time(task, perf_arch, nimpl);
+					if (conversion_time > 0.0)
+						c->length[cand] += conversion_time;
+				}
+				if (same && share_energies)
+					c->energy[cand] = c->energy[known_arch_cand[known][nimpl]];
+				else if (da)
+					c->energy[cand] = starpu_task_worker_expected_energy(task, workerid, sched_ctx_id,nimpl);
+				if (known != -1 && !same)
+				{
+					known_arch_impl_mask[known] |= 1U << nimpl;
+					known_arch_cand[known][nimpl] = cand;
+				}
 			}
 			double ntasks_end = fifo_ntasks / starpu_worker_get_relative_speedup(perf_arch);
 
@@ -575,12 +686,12 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 			    /* The performance model of this task is not
 			     * calibrated on this workerid, try to run it there
 			     * to calibrate it there. */
-			    || (!calibrating && isnan(local_task_length[worker_ctx][nimpl]))
+			    || (!calibrating && isnan(c->length[cand]))
 
 			    /* the performance model of this task is not
 			     * calibrated on this workerid either, rather run it
 			     * there if this one is low on scheduled tasks. */
-			    || (calibrating && isnan(local_task_length[worker_ctx][nimpl]) && ntasks_end < ntasks_best_end)
+			    || (calibrating && isnan(c->length[cand]) && ntasks_end < ntasks_best_end)
 				)
 			{
 				ntasks_best_end = ntasks_end;
@@ -588,14 +699,14 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 				nimpl_best = nimpl;
 			}
 
-			if (isnan(local_task_length[worker_ctx][nimpl]))
+			if (isnan(c->length[cand]))
 				/* we are calibrating, we want to speed-up calibration time
 				 * so we privilege non-calibrated tasks (but still
 				 * greedily distribute them to avoid dumb schedules) */
 				calibrating = 1;
 
-			if (isnan(local_task_length[worker_ctx][nimpl])
-					|| _STARPU_IS_ZERO(local_task_length[worker_ctx][nimpl]))
+			if (isnan(c->length[cand])
+					|| _STARPU_IS_ZERO(c->length[cand]))
 				/* there is no prediction available for that task
 				 * with that arch (yet or at all), so switch to a greedy strategy */
 				unknown = 1;
@@ -604,22 +715,21 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 				continue;
 
 			double task_starting_time = exp_start + prev_exp_len;
-			if (local_data_penalty)
+			if (da)
 				task_starting_time = STARPU_MAX(task_starting_time,
-					now + local_data_penalty[worker_ctx][nimpl]);
+					now + penalty);
 
-			exp_end[worker_ctx][nimpl] = task_starting_time + local_task_length[worker_ctx][nimpl];
+			c->exp_end[cand] = task_starting_time + c->length[cand];
 
-			if (exp_end[worker_ctx][nimpl] < best_exp_end_of_task)
+			if (c->exp_end[cand] < best_exp_end_of_task)
 			{
 				/* a better solution was found */
-				best_exp_end_of_task = exp_end[worker_ctx][nimpl];
+				best_exp_end_of_task = c->exp_end[cand];
 				nimpl_best = nimpl;
 			}
 
-			if (local_energy)
-				if (isnan(local_energy[worker_ctx][nimpl]))
-					local_energy[worker_ctx][nimpl] = 0.;
+			if (isnan(c->energy[cand]))
+				c->energy[cand] = 0.;
 
 		}
 		worker_ctx++;
@@ -639,6 +749,31 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 	*max_exp_endp_of_workers = max_exp_end_of_workers;
 }
 
+/* Compute the fitness of all candidates, DMDA_VECTOR_WIDTH at a time so that
+ * the compiler can use SIMD instructions. The arrays are padded accordingly. */
+static void compute_all_fitness(unsigned n,
+				double * restrict fitness,
+				const double * restrict exp_end,
+				const double * restrict penalty,
+				const double * restrict energy,
+				double alpha, double beta, double _gamma, double idle,
+				double min_exp_end_of_task, double max_exp_end_of_workers)
+{
+	size_t i, j;
+
+	for (i = 0; i < n; i += DMDA_VECTOR_WIDTH)
+		for (j = 0; j < DMDA_VECTOR_WIDTH; j++)
+		{
+			/* If this placement makes the computation longer, take
+			 * into account the idle consumption of other cpus */
+			double extra = exp_end[i+j] - max_exp_end_of_workers;
+			fitness[i+j] = alpha * (exp_end[i+j] - min_exp_end_of_task)
+				+ beta * penalty[i+j]
+				+ _gamma * energy[i+j]
+				+ idle * (extra > 0. ? extra : 0.);
+		}
+}
+
 static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned sched_ctx_id, unsigned da, unsigned simulate, unsigned sorted_decision)
 {
 	/* find the queue */
@@ -655,12 +790,28 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 	struct _starpu_dmda_data *dt = (struct _starpu_dmda_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
 	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
 	unsigned nworkers_ctx = workers->nworkers;
-	double local_task_length[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
-	double local_data_penalty[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
-	double local_energy[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
+	unsigned max_candidates = (nworkers_ctx * STARPU_MAXIMPLEMENTATIONS + DMDA_VECTOR_WIDTH - 1) / DMDA_VECTOR_WIDTH * DMDA_VECTOR_WIDTH;
+	unsigned cand_workerid[max_candidates];
+	unsigned cand_worker_ctx[max_candidates];
+	unsigned cand_impl[max_candidates];
+	double cand_length[max_candidates];
+	double cand_penalty[max_candidates];
+	double cand_energy[max_candidates];
+	double cand_fitness[max_candidates];
 
 	/* Expected end of this task on the workers */
-	double exp_end[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
+	double cand_exp_end[max_candidates];
+
+	struct _starpu_dmda_candidates candidates =
+	{
+		.workerid = cand_workerid,
+		.worker_ctx = cand_worker_ctx,
+		.impl = cand_impl,
+		.exp_end = cand_exp_end,
+		.length = cand_length,
+		.penalty = cand_penalty,
+		.energy = cand_energy,
+	};
 
 	/* This is the minimum among the exp_end[] matrix */
 	double min_exp_end_of_task;
@@ -668,74 +819,55 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 	/* This is the maximum termination time of already-scheduled tasks over all workers */
 	double max_exp_end_of_workers = 0.0;
 
-	double fitness[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
-
+	unsigned cand = 0;
 
 	compute_all_performance_predictions(task,
 					    nworkers_ctx,
-					    local_task_length,
-					    exp_end,
+					    &candidates,
 					    &max_exp_end_of_workers,
 					    &min_exp_end_of_task,
-					    da ? local_data_penalty : NULL,
-					    da ? local_energy : NULL,
+					    da,
 					    &forced_best,
 					    &forced_impl, sched_ctx_id, sorted_decision);
 
 
-	if (forced_best == -1)
+	if (forced_best == -1 && candidates.n)
 	{
-		double best_fitness = -1;
-		unsigned worker_ctx = 0;
-		struct starpu_sched_ctx_iterator it;
-		workers->init_iterator_for_parallel_tasks(workers, &it, task);
-		while(worker_ctx < nworkers_ctx && workers->has_next(workers, &it))
-		{
-			unsigned worker = workers->get_next(workers, &it);
-			unsigned nimpl;
-			unsigned impl_mask;
-
-			if (!starpu_worker_can_execute_task_impl(worker, task, &impl_mask))
-				continue;
-
-			for (nimpl = 0; nimpl < STARPU_MAXIMPLEMENTATIONS; nimpl++)
-			{
-				if (!(impl_mask & (1U << nimpl)))
-				{
-					/* no one on that queue may execute this task */
-					continue;
-				}
-				if (da)
-					fitness[worker_ctx][nimpl] = dt->alpha * __s_alpha__value *(exp_end[worker_ctx][nimpl] - min_exp_end_of_task)
-						+ dt->beta * __s_beta__value *(local_data_penalty[worker_ctx][nimpl])
-						+ dt->_gamma * __s_gamma__value *(local_energy[worker_ctx][nimpl]);
-				else
-					fitness[worker_ctx][nimpl] = exp_end[worker_ctx][nimpl] - min_exp_end_of_task;
-
-				if (da && exp_end[worker_ctx][nimpl] > max_exp_end_of_workers)
-				{
-					/* This placement will make the computation
-					 * longer, take into account the idle
-					 * consumption of other cpus */
-					fitness[worker_ctx][nimpl] += dt->_gamma * __s_gamma__value * dt->idle_power * __s_idle_power__value * (exp_end[worker_ctx][nimpl] - max_exp_end_of_workers) / 1000000.0; /* Since gamma is the cost in us of one Joules,
-																									  then  d->idle_power * (exp_end - max_exp_end_of_workers)
-																									  must be in Joules, thus the / 1000000.0 */
-				}
-
-				if (best == -1 || fitness[worker_ctx][nimpl] < best_fitness)
-				{
-					/* we found a better solution */
-					best_fitness = fitness[worker_ctx][nimpl];
-					best = worker;
-					best_in_ctx = worker_ctx;
-					selected_impl = nimpl;
+		unsigned i;
 
-					//_STARPU_DEBUG("best fitness (worker %d) %e = alpha*(%e) + beta(%e) +gamma(%e)\n", worker, best_fitness, exp_end[worker][nimpl] - min_exp_end_of_task, local_data_penalty[worker][nimpl], local_energy[worker][nimpl]);
-
-				}
-			}
-			worker_ctx++;
+		/* Clear the padding */
+		for (i = candidates.n; i % DMDA_VECTOR_WIDTH; i++)
+		{
+			cand_exp_end[i] = 0.;
+			cand_penalty[i] = 0.;
+			cand_energy[i] = 0.;
 		}
+
+		if (da)
+			compute_all_fitness(candidates.n, cand_fitness, cand_exp_end, cand_penalty, cand_energy,
+					    dt->alpha * __s_alpha__value,
+					    dt->beta * __s_beta__value,
+					    dt->_gamma * __s_gamma__value,
+					    /* Since gamma is the cost in us of one Joules,
+					       then  d->idle_power * (exp_end - max_exp_end_of_workers)
+					       must be in Joules, thus the / 1000000.0 */
+					    dt->_gamma * __s_gamma__value * dt->idle_power * __s_idle_power__value / 1000000.0,
+					    min_exp_end_of_task, max_exp_end_of_workers);
+		else
+			compute_all_fitness(candidates.n, cand_fitness, cand_exp_end, cand_penalty, cand_energy,
+					    1., 0., 0., 0.,
+					    min_exp_end_of_task, max_exp_end_of_workers);
+
+		for (i = 1; i < candidates.n; i++)
+			if (cand_fitness[i] < cand_fitness[cand])
+				/* we found a better solution */
+				cand = i;
+
+		best = cand_workerid[cand];
+		best_in_ctx = cand_worker_ctx[cand];
+		selected_impl = cand_impl[cand];
+
+		//_STARPU_DEBUG("best fitness (worker %d) %e = alpha*(%e) + beta(%e) +gamma(%e)\n", best, cand_fitness[cand], cand_exp_end[cand] - min_exp_end_of_task, cand_penalty[cand], cand_energy[cand]);
 	}
 	STARPU_ASSERT(forced_best != -1 || best != -1);
 
@@ -748,6 +880,19 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 		selected_impl = forced_impl;
 		model_best = 0.0;
 		transfer_model_best = 0.0;
+		for (cand = 0; cand < candidates.n; cand++)
+			if (cand_workerid[cand] == (unsigned) best && cand_impl[cand] == (unsigned) selected_impl)
+				break;
+		if (cand == candidates.n)
+		{
+			/* forced_impl may have been found on another worker,
+			 * use an implementation of the forced worker */
+			for (cand = 0; cand < candidates.n; cand++)
+				if (cand_workerid[cand] == (unsigned) best)
+					break;
+			STARPU_ASSERT(cand < candidates.n);
+			selected_impl = cand_impl[cand];
+		}
 	}
 	else if (task->bundle)
 	{
@@ -759,9 +904,9 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 	}
 	else
 	{
-		model_best = local_task_length[best_in_ctx][selected_impl];
+		model_best = cand_length[cand];
 		if (da)
-			transfer_model_best = local_data_penalty[best_in_ctx][selected_impl];
+			transfer_model_best = cand_penalty[cand];
 	}
 
 	//_STARPU_DEBUG("Scheduler dmda: kernel (%u)\n", selected_impl);
@@ -775,7 +920,7 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 	}
 	else
 	{
-		return exp_end[best_in_ctx][selected_impl] ;
+		return cand_exp_end[cand];
 	}
 }
 
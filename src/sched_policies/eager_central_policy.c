@@ -67,9 +67,7 @@ static int push_task_eager_policy(struct starpu_task *task)
 	starpu_worker_relax_on();
 	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
 	starpu_worker_relax_off();
-	starpu_task_list_push_back(&data->fifo.taskq,task);
-	data->fifo.ntasks++;
-	data->fifo.nprocessed++;
+	_starpu_fifo_taskq_append_task(&data->fifo, task);
 
 	if (_starpu_get_nsched_ctxs() > 1)
 	{
@@ -133,6 +131,88 @@ static int push_task_eager_policy(struct starpu_task *task)
 	return 0;
 }
 
+static int push_tasks_eager_policy(struct starpu_task **tasks, unsigned ntasks)
+{
+	unsigned sched_ctx_id = tasks[0]->sched_ctx;
+	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+#ifndef STARPU_NON_BLOCKING_DRIVERS
+	char dowake[STARPU_NMAXWORKERS] = { 0 };
+#endif
+	unsigned i;
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
+	starpu_worker_relax_off();
+
+	for (i = 0; i < ntasks; i++)
+		_starpu_fifo_taskq_append_task(&data->fifo, tasks[i]);
+
+	if (_starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		for (i = 0; i < ntasks; i++)
+			starpu_sched_ctx_list_task_counters_increment_all_ctx_locked(tasks[i], sched_ctx_id);
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = tasks[i];
+
+		starpu_push_task_end(task);
+
+		/* wake people waiting for a task, up to one per task */
+		workers->init_iterator_for_parallel_tasks(workers, &it, task);
+		while(workers->has_next(workers, &it))
+		{
+			unsigned worker = workers->get_next(workers, &it);
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+			if (!starpu_bitmap_get(&data->waiters, worker))
+				/* This worker is not waiting for a task */
+				continue;
+#else
+			if (dowake[worker])
+				/* Already a candidate */
+				continue;
+#endif
+
+			if (starpu_worker_can_execute_task_first_impl(worker, task, NULL))
+			{
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+				starpu_bitmap_unset(&data->waiters, worker);
+				break;
+#else
+				dowake[worker] = 1;
+#endif
+			}
+		}
+	}
+	/* Let the tasks free */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&data->policy_mutex);
+
+#if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
+	/* Now that we have a list of potential workers, try to wake as many as
+	 * there are tasks. We can not look at the tasks any more, they may
+	 * already be gone */
+	unsigned nwoken = 0;
+	workers->init_iterator(workers, &it);
+	while(nwoken < ntasks && workers->has_next(workers, &it))
+	{
+		unsigned worker = workers->get_next(workers, &it);
+		if (dowake[worker])
+			if (starpu_wake_worker_relax_light(worker))
+				nwoken++;
+	}
+#endif
+
+	return 0;
+}
+
 static struct starpu_task *pop_every_task_eager_policy(unsigned sched_ctx_id)
 {
 	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
@@ -214,6 +294,7 @@ struct starpu_sched_policy _starpu_sched_eager_policy =
 	.add_workers = eager_add_workers,
 	.remove_workers = NULL,
 	.push_task = push_task_eager_policy,
+	.push_tasks = push_tasks_eager_policy,
 	.pop_task = pop_task_eager_policy,
 	.pre_exec_hook = NULL,
 	.post_exec_hook = NULL,
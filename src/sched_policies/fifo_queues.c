@@ -27,6 +27,7 @@
 #include <sched_policies/fifo_queues.h>
 
 #include <limits.h>
+#include <math.h>
 
 /*
 static int is_sorted_task_list(struct starpu_task * task)
@@ -47,6 +48,132 @@ static int is_sorted_task_list(struct starpu_task * task)
 }
 */
 
+/* Bucket of the tasks of a given priority in a sorted fifo */
+struct _starpu_fifo_prio_bucket
+{
+	struct starpu_rbtree_node node; /* Keep this first so node_to_bucket can work */
+	int prio;
+	/* number of tasks of this priority */
+	unsigned ntasks;
+	/* number of tasks of this priority which do not have a prediction */
+	unsigned nunknown;
+	/* sum of the predicted length of the tasks of this priority */
+	double exp_len;
+	/* last task of this priority in the queue */
+	struct starpu_task *last;
+};
+
+static struct _starpu_fifo_prio_bucket *node_to_bucket(struct starpu_rbtree_node *node)
+{
+	return (struct _starpu_fifo_prio_bucket *) node;
+}
+
+static int prio_bucket_cmp_fn(int prio, const struct starpu_rbtree_node *node)
+{
+	/* Sort by decreasing order */
+	const struct _starpu_fifo_prio_bucket *bucket = (const struct _starpu_fifo_prio_bucket *) node;
+	if (bucket->prio < prio)
+		return -1;
+	if (bucket->prio == prio)
+		return 0;
+	return 1;
+}
+
+/* Return the bucket of the lowest priority which is greater than or equal to
+ * prio, i.e. the bucket after which a task of priority prio is to be
+ * inserted */
+static struct _starpu_fifo_prio_bucket *prio_index_lookup(struct starpu_st_fifo_taskq *fifo_queue, int prio)
+{
+	struct starpu_rbtree_node *node = starpu_rbtree_lookup_nearest(&fifo_queue->prio_index, prio, prio_bucket_cmp_fn, STARPU_RBTREE_LEFT);
+	return node ? node_to_bucket(node) : NULL;
+}
+
+/* Account the task, which was inserted in the queue, in the index. at_back
+ * tells whether the task was inserted after all the other tasks of the same
+ * priority */
+static void prio_index_add(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task, int at_back)
+{
+	uintptr_t slot;
+	struct starpu_rbtree_node *node;
+	struct _starpu_fifo_prio_bucket *bucket;
+
+	node = starpu_rbtree_lookup_slot(&fifo_queue->prio_index, task->priority, prio_bucket_cmp_fn, slot);
+	if (node)
+		bucket = node_to_bucket(node);
+	else
+	{
+		_STARPU_CALLOC(bucket, 1, sizeof(*bucket));
+		starpu_rbtree_node_init0(&bucket->node);
+		bucket->prio = task->priority;
+		starpu_rbtree_insert_slot(&fifo_queue->prio_index, slot, &bucket->node);
+		at_back = 1;
+	}
+
+	bucket->ntasks++;
+	if (isnan(task->predicted))
+		bucket->nunknown++;
+	else
+		bucket->exp_len += task->predicted;
+	if (at_back)
+		bucket->last = task;
+}
+
+/* Remove the task from the index, must be called before removing it from
+ * the queue */
+static void prio_index_remove(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task)
+{
+	if (!fifo_queue->sorted)
+		return;
+
+	struct starpu_rbtree_node *node = starpu_rbtree_lookup(&fifo_queue->prio_index, task->priority, prio_bucket_cmp_fn);
+	STARPU_ASSERT(node);
+	struct _starpu_fifo_prio_bucket *bucket = node_to_bucket(node);
+
+	if (--bucket->ntasks == 0)
+	{
+		starpu_rbtree_remove(&fifo_queue->prio_index, &bucket->node);
+		free(bucket);
+		return;
+	}
+
+	if (isnan(task->predicted))
+		bucket->nunknown--;
+	else
+		bucket->exp_len -= task->predicted;
+	if (bucket->last == task)
+	{
+		/* The queue is sorted, so the previous task has the same priority */
+		STARPU_ASSERT(task->prev && task->prev->priority == task->priority);
+		bucket->last = task->prev;
+	}
+}
+
+static void prio_index_clear(struct starpu_st_fifo_taskq *fifo_queue)
+{
+	struct starpu_rbtree_node *node, *tmp;
+
+	starpu_rbtree_for_each_remove(&fifo_queue->prio_index, node, tmp)
+		free(node_to_bucket(node));
+	starpu_rbtree_init(&fifo_queue->prio_index);
+}
+
+/* The queue is not sorted any more, we have to fall back to walking it */
+static void prio_index_drop(struct starpu_st_fifo_taskq *fifo_queue)
+{
+	if (!fifo_queue->sorted)
+		return;
+	prio_index_clear(fifo_queue);
+	fifo_queue->sorted = 0;
+}
+
+/* To be called after removing tasks from the queue */
+static void check_sorted(struct starpu_st_fifo_taskq *fifo_queue)
+{
+	if (!fifo_queue->sorted && starpu_task_list_empty(&fifo_queue->taskq))
+		/* Empty again, thus sorted */
+		fifo_queue->sorted = 1;
+}
+
 void starpu_st_fifo_taskq_init(struct starpu_st_fifo_taskq *fifo)
 {
 	/* note that not all mechanisms (eg. the semaphore) have to be used */
@@ -63,6 +190,8 @@ void starpu_st_fifo_taskq_init(struct starpu_st_fifo_taskq *fifo)
 	fifo->exp_end = fifo->exp_start;
 	fifo->exp_len_per_priority = NULL;
 	fifo->pipeline_len = 0.0;
+	fifo->sorted = 1;
+	starpu_rbtree_init(&fifo->prio_index);
 	STARPU_HG_DISABLE_CHECKING(fifo->exp_start);
 	STARPU_HG_DISABLE_CHECKING(fifo->exp_len);
 	STARPU_HG_DISABLE_CHECKING(fifo->exp_end);
@@ -80,6 +209,7 @@ struct starpu_st_fifo_taskq *starpu_st_fifo_taskq_create(void)
 
 void starpu_st_fifo_taskq_destroy(struct starpu_st_fifo_taskq *fifo)
 {
+	prio_index_clear(fifo);
 	free(fifo);
 }
 
@@ -171,75 +301,127 @@ void starpu_st_fifo_pipeline_len_inc(struct starpu_st_fifo_taskq *fifo, double p
 double starpu_st_fifo_taskq_get_exp_len_prev_task_list(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task, int workerid, int nimpl, int *fifo_ntasks)
 {
 	struct starpu_task_list *list = &fifo_queue->taskq;
-	struct starpu_perfmodel_arch* perf_arch = starpu_worker_get_perf_archtype(workerid, task->sched_ctx);
 	double exp_len = 0.0;
 
-	if (list->_head != NULL)
-	{
-		struct starpu_task *current = list->_head;
-		struct starpu_task *prev = NULL;
+	if (list->_head == NULL)
+		return exp_len;
 
-		if (list->_head->priority == task->priority &&
-		    list->_head->priority == list->_tail->priority)
+	if (fifo_queue->sorted)
+	{
+		if (list->_tail->priority >= task->priority)
 		{
-			/* They all have the same priority, the task's place is at the end */
-			prev = list->_tail;
-			current = NULL;
+			/* the task's place is at the _tail of the list */
+			exp_len = fifo_queue->exp_len;
+			*fifo_ntasks = fifo_queue->ntasks;
 		}
 		else
-		while (current)
 		{
-			if (current->priority < task->priority)
-				break;
-
-			prev = current;
-			current = current->next;
+			/* Sum the buckets of the tasks which are before the
+			 * task's place, using the lengths that were predicted
+			 * when they were pushed */
+			struct _starpu_fifo_prio_bucket *last = prio_index_lookup(fifo_queue, task->priority);
+			struct starpu_rbtree_node *node;
+
+			if (last)
+			for (node = starpu_rbtree_first(&fifo_queue->prio_index); ; node = starpu_rbtree_next(node))
+			{
+				struct _starpu_fifo_prio_bucket *bucket = node_to_bucket(node);
+				exp_len += bucket->nunknown ? NAN : bucket->exp_len;
+				(*fifo_ntasks) += bucket->ntasks;
+				if (bucket == last)
+					break;
+			}
 		}
+		return exp_len;
+	}
+
+	/* Not sorted, we have to walk the list */
+	struct starpu_perfmodel_arch* perf_arch = starpu_worker_get_perf_archtype(workerid, task->sched_ctx);
+	struct starpu_task *current = list->_head;
+	struct starpu_task *prev = NULL;
+
+	if (list->_head->priority == task->priority &&
+	    list->_head->priority == list->_tail->priority)
+	{
+		/* They all have the same priority, the task's place is at the end */
+		prev = list->_tail;
+		current = NULL;
+	}
+	else
+	while (current)
+	{
+		if (current->priority < task->priority)
+			break;
+
+		prev = current;
+		current = current->next;
+	}
 
-		if (prev != NULL)
+	if (prev != NULL)
+	{
+		if (current)
 		{
-			if (current)
-			{
-				/* the task's place is between prev and current */
-				struct starpu_task *it;
-				for(it = list->_head; it != current; it = it->next)
-				{
-					exp_len += starpu_task_expected_length(it, perf_arch, nimpl);
-					(*fifo_ntasks) ++;
-				}
-			}
-			else
+			/* the task's place is between prev and current */
+			struct starpu_task *it;
+			for(it = list->_head; it != current; it = it->next)
 			{
-				/* the task's place is at the _tail of the list */
-				exp_len = fifo_queue->exp_len;
-				*fifo_ntasks = fifo_queue->ntasks;
+				exp_len += starpu_task_expected_length(it, perf_arch, nimpl);
+				(*fifo_ntasks) ++;
 			}
 		}
+		else
+		{
+			/* the task's place is at the _tail of the list */
+			exp_len = fifo_queue->exp_len;
+			*fifo_ntasks = fifo_queue->ntasks;
+		}
 	}
 
-
 	return exp_len;
 }
 
+/* Insert the task between prev and current, prev being NULL for the head
+ * and current being NULL for the tail */
+static void insert_between(struct starpu_task_list *list, struct starpu_task *prev, struct starpu_task *task, struct starpu_task *current)
+{
+	task->prev = prev;
+	task->next = current;
+	if (prev)
+		prev->next = task;
+	else
+		list->_head = task;
+	if (current)
+		current->prev = task;
+	else
+		list->_tail = task;
+}
+
 int starpu_st_fifo_taskq_push_sorted_task(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task)
 {
 	struct starpu_task_list *list = &fifo_queue->taskq;
 
 	if (list->_head == NULL)
 	{
-		list->_head = task;
-		list->_tail = task;
-		task->prev = NULL;
-		task->next = NULL;
+		insert_between(list, NULL, task, NULL);
+	}
+	else if (fifo_queue->sorted)
+	{
+		/* Put after the last task of higher or equal priority */
+		struct starpu_task *prev;
+		if (list->_tail->priority >= task->priority)
+			prev = list->_tail;
+		else
+		{
+			struct _starpu_fifo_prio_bucket *bucket = prio_index_lookup(fifo_queue, task->priority);
+			prev = bucket ? bucket->last : NULL;
+		}
+		insert_between(list, prev, task, prev ? prev->next : list->_head);
 	}
 	else if (list->_head->priority == task->priority &&
 		 list->_head->priority == list->_tail->priority)
 	{
 		/* They all have the same priority, just put at the end */
-		list->_tail->next = task;
-		task->next = NULL;
-		task->prev = list->_tail;
-		list->_tail = task;
+		insert_between(list, list->_tail, task, NULL);
 	}
 	else
 	{
@@ -255,41 +437,32 @@ int starpu_st_fifo_taskq_push_sorted_task(struct starpu_st_fifo_taskq *fifo_queu
 			current = current->next;
 		}
 
-		if (prev == NULL)
-		{
-			/* Insert at the front of the list */
-			list->_head->prev = task;
-			task->prev = NULL;
-			task->next = list->_head;
-			list->_head = task;
-		}
-		else
-		{
-			if (current)
-			{
-				/* Insert between prev and current */
-				task->prev = prev;
-				prev->next = task;
-				task->next = current;
-				current->prev = task;
-			}
-			else
-			{
-				/* Insert at the _tail of the list */
-				list->_tail->next = task;
-				task->next = NULL;
-				task->prev = list->_tail;
-				list->_tail = task;
-			}
-		}
+		insert_between(list, prev, task, current);
 	}
 
+	if (fifo_queue->sorted)
+		prio_index_add(fifo_queue, task, 1);
+
 	fifo_queue->ntasks++;
 	fifo_queue->nprocessed++;
 
 	return 0;
 }
 
+void _starpu_fifo_taskq_append_task(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task)
+{
+	struct starpu_task_list *list = &fifo_queue->taskq;
+
+	if (list->_tail && list->_tail->priority < task->priority)
+		prio_index_drop(fifo_queue);
+	starpu_task_list_push_back(list, task);
+	if (fifo_queue->sorted)
+		prio_index_add(fifo_queue, task, 1);
+
+	fifo_queue->ntasks++;
+	fifo_queue->nprocessed++;
+}
+
 int starpu_st_fifo_taskq_push_task(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task)
 {
 	if (task->priority > 0)
@@ -298,10 +471,7 @@ int starpu_st_fifo_taskq_push_task(struct starpu_st_fifo_taskq *fifo_queue, stru
 	}
 	else
 	{
-		starpu_task_list_push_back(&fifo_queue->taskq, task);
-
-		fifo_queue->ntasks++;
-		fifo_queue->nprocessed++;
+		_starpu_fifo_taskq_append_task(fifo_queue, task);
 	}
 	return 0;
 }
@@ -314,7 +484,13 @@ int starpu_st_fifo_taskq_push_back_task(struct starpu_st_fifo_taskq *fifo_queue,
 	}
 	else
 	{
-		starpu_task_list_push_front(&fifo_queue->taskq, task);
+		struct starpu_task_list *list = &fifo_queue->taskq;
+
+		if (list->_head && list->_head->priority > task->priority)
+			prio_index_drop(fifo_queue);
+		starpu_task_list_push_front(list, task);
+		if (fifo_queue->sorted)
+			prio_index_add(fifo_queue, task, 0);
 
 		fifo_queue->ntasks++;
 	}
@@ -332,7 +508,9 @@ int starpu_st_fifo_taskq_pop_this_task(struct starpu_st_fifo_taskq *fifo_queue,
 	if (workerid < 0 || starpu_worker_can_execute_task_first_impl(workerid, task, &nimpl))
 	{
 		starpu_task_set_implementation(task, nimpl);
+		prio_index_remove(fifo_queue, task);
 		starpu_task_list_erase(&fifo_queue->taskq, task);
+		check_sorted(fifo_queue);
 		fifo_queue->ntasks--;
 		return 1;
 	}
@@ -361,7 +539,9 @@ struct starpu_task *starpu_st_fifo_taskq_pop_local_task(struct starpu_st_fifo_ta
 
 	if (!starpu_task_list_empty(&fifo_queue->taskq))
 	{
+		prio_index_remove(fifo_queue, starpu_task_list_front(&fifo_queue->taskq));
 		task = starpu_task_list_pop_front(&fifo_queue->taskq);
+		check_sorted(fifo_queue);
 		fifo_queue->ntasks--;
 	}
 
@@ -393,6 +573,7 @@ struct starpu_task *starpu_st_fifo_taskq_pop_every_task(struct starpu_st_fifo_ta
 				/* this elements can be moved into the new list */
 				new_list_size++;
 
+				prio_index_remove(fifo_queue, task);
 				starpu_task_list_erase(old_list, task);
 
 				if (new_list_tail)
@@ -416,6 +597,7 @@ struct starpu_task *starpu_st_fifo_taskq_pop_every_task(struct starpu_st_fifo_ta
 		}
 
 		fifo_queue->ntasks -= new_list_size;
+		check_sorted(fifo_queue);
 	}
 
 	return new_list;
@@ -556,7 +738,9 @@ struct starpu_task *starpu_st_fifo_taskq_pop_first_ready_task(struct starpu_st_f
 				fifo_queue->ntasks_per_priority[i]--;
 		}
 
+		prio_index_remove(fifo_queue, task);
 		starpu_task_list_erase(&fifo_queue->taskq, task);
+		check_sorted(fifo_queue);
 	}
 
 	return task;
@@ -19,6 +19,7 @@
 #define __FIFO_QUEUES_H__
 
 #include <core/task.h>
+#include <common/rbtree.h>
 
 /** @file */
 
@@ -44,7 +45,18 @@ struct starpu_st_fifo_taskq
 	double exp_len; /** Expected duration of the set of tasks in the queue */
 	double *exp_len_per_priority; /** Expected duration of the set of tasks in the queue corresponding to each priority */
 	double pipeline_len; /** the expected duration of what is already pushed to the worker */
+
+	/** whether taskq is sorted by decreasing priority, in which case
+	 * prio_index is maintained */
+	unsigned sorted;
+	/** per-priority buckets of the tasks of taskq, sorted by decreasing
+	 * priority, which give in O(log p) where a task of a given priority
+	 * is to be inserted, p being the number of distinct priorities */
+	struct starpu_rbtree prio_index;
 };
 
+/** Append the task at the end of the queue, regardless of its priority */
+void _starpu_fifo_taskq_append_task(struct starpu_st_fifo_taskq *fifo_queue, struct starpu_task *task);
+
 
 #endif /* __FIFO_QUEUES_H__ */
@@ -17,7 +17,7 @@
 /*
  *	This is just a test policy for using task graph information
  *
- *	We keep tasks in the fifo queue, and store the graph of tasks, until we
+ *	We keep tasks in a bag, and store the graph of tasks, until we
  *	get the do_schedule call from the application, which tells us all tasks
  *	were queued, and we can now compute task depths or descendants and let a simple
  *	central-queue greedy algorithm proceed.
@@ -37,7 +37,7 @@
 
 struct _starpu_graph_test_policy_data
 {
-	struct starpu_st_fifo_taskq fifo;	/* Bag of tasks which are ready before do_schedule is called */
+	struct starpu_task_list bag;	/* Bag of tasks which are ready before do_schedule is called */
 	struct starpu_st_prio_deque prio_cpu;
 	struct starpu_st_prio_deque prio_gpu;
 	starpu_pthread_mutex_t policy_mutex;
@@ -52,7 +52,7 @@ static void initialize_graph_test_policy(unsigned sched_ctx_id)
 	_STARPU_MALLOC(data, sizeof(struct _starpu_graph_test_policy_data));
 
 	/* there is only a single queue in that trivial design */
-	starpu_st_fifo_taskq_init(&data->fifo);
+	starpu_task_list_init(&data->bag);
 	 starpu_st_prio_deque_init(&data->prio_cpu);
 	 starpu_st_prio_deque_init(&data->prio_gpu);
 	starpu_bitmap_init(&data->waiters);
@@ -68,9 +68,7 @@ static void initialize_graph_test_policy(unsigned sched_ctx_id)
 static void deinitialize_graph_test_policy(unsigned sched_ctx_id)
 {
 	struct _starpu_graph_test_policy_data *data = (struct _starpu_graph_test_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
-	struct starpu_st_fifo_taskq *fifo = &data->fifo;
-
-	STARPU_ASSERT(starpu_task_list_empty(&fifo->taskq));
+	STARPU_ASSERT(starpu_task_list_empty(&data->bag));
 
 	/* deallocate the job queue */
 	 starpu_st_prio_deque_destroy(&data->prio_cpu);
@@ -174,9 +172,7 @@ static void do_schedule_graph_test_policy(unsigned sched_ctx_id)
 	starpu_worker_relax_on();
 	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
 	starpu_worker_relax_off();
-	if (data->descendants)
-		_starpu_graph_compute_descendants();
-	else
+	if (!data->descendants)
 		_starpu_graph_compute_depths();
 	if (data->computed == 0)
 	{
@@ -189,9 +185,11 @@ static void do_schedule_graph_test_policy(unsigned sched_ctx_id)
 	}
 
 	/* Now that we have priorities, move tasks from bag to priority queue */
-	while(!starpu_st_fifo_taskq_empty(&data->fifo))
+	/* The priorities of the tasks of the bag may have changed, so it is
+	 * not a fifo sorted by priority */
+	while(!starpu_task_list_empty(&data->bag))
 	{
-		struct starpu_task *task = starpu_st_fifo_taskq_pop_task(&data->fifo, -1);
+		struct starpu_task *task = starpu_task_list_pop_front(&data->bag);
 		struct starpu_st_prio_deque *prio = select_prio(sched_ctx_id, data, task);
 		starpu_st_prio_deque_push_back_task(prio, task);
 	}
@@ -232,9 +230,7 @@ static int push_task_graph_test_policy(struct starpu_task *task)
 	if (!data->computed)
 	{
 		/* Priorities are not computed, leave the task in the bag for now */
-		starpu_task_list_push_back(&data->fifo.taskq,task);
-		data->fifo.ntasks++;
-		data->fifo.nprocessed++;
+		starpu_task_list_push_back(&data->bag, task);
 		starpu_push_task_end(task);
 		STARPU_PTHREAD_MUTEX_UNLOCK(&data->policy_mutex);
 		return 0;
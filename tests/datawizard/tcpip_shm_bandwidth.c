@@ -0,0 +1,99 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <debug/starpu_debug_helpers.h>
+#include "../helper.h"
+
+/*
+ * Measure the bandwidth of a ping-pong of a vector between the host and a
+ * TCP/IP master-slave sink, for various sizes. When the sink runs on the same
+ * host, transfers go through shared memory, unless
+ * STARPU_TCPIP_USE_SHARED_MEMORY is 0, in which case they go through the
+ * loopback sockets. Run it both ways to compare them, e.g.
+ *
+ *   starpu_tcpipexec -np 2 ./tcpip_shm_bandwidth
+ *   STARPU_TCPIP_USE_SHARED_MEMORY=0 starpu_tcpipexec -np 2 ./tcpip_shm_bandwidth
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NITER 4
+#define MAXSIZE (4*1024*1024)
+#else
+#define NITER 20
+#define MAXSIZE (64*1024*1024)
+#endif
+#define MINSIZE (1024*1024)
+
+#ifndef STARPU_USE_TCPIP_MASTER_SLAVE
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+int main(void)
+{
+	starpu_data_handle_t handle;
+	int workers[STARPU_NMAXWORKERS];
+	unsigned nworkers, node;
+	size_t size;
+	char *v;
+	int ret;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	nworkers = starpu_worker_get_ids_by_type(STARPU_TCPIP_MS_WORKER, workers, STARPU_NMAXWORKERS);
+	if (nworkers == 0)
+	{
+		FPRINTF(stderr, "This test requires TCP/IP master-slave workers\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	node = starpu_worker_get_memory_node(workers[0]);
+
+	ret = starpu_malloc((void **) &v, MAXSIZE);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_malloc");
+	memset(v, 0, MAXSIZE);
+
+	FPRINTF(stdout, "# shared memory %d\n", starpu_getenv_number_default("STARPU_TCPIP_USE_SHARED_MEMORY", 1));
+	FPRINTF(stdout, "# size (B)\tbandwidth (MB/s)\n");
+	for (size = MINSIZE; size <= MAXSIZE; size *= 4)
+	{
+		double start, timing;
+
+		starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) v, size, 1);
+
+		/* warm up, and allocate the buffer on the sink */
+		_starpu_benchmark_ping_pong(handle, STARPU_MAIN_RAM, node, 1);
+
+		start = starpu_timing_now();
+		_starpu_benchmark_ping_pong(handle, STARPU_MAIN_RAM, node, NITER);
+		timing = starpu_timing_now() - start;
+
+		FPRINTF(stdout, "%lu\t%f\n", (unsigned long) size, 2. * NITER * size / timing);
+
+		starpu_data_unregister(handle);
+	}
+
+	starpu_free_noflag(v, MAXSIZE);
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
+#endif
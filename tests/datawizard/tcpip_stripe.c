@@ -0,0 +1,157 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <math.h>
+#include "../helper.h"
+
+/*
+ * Stripe the asynchronous TCP/IP master-slave transfers over several sockets,
+ * recalibrate the bus through them, and move a vector back and forth between
+ * the TCP/IP slaves, checking its content.
+ */
+
+#define NSTREAMS "4"
+#define STRIPE_THRESHOLD "65536"
+#ifdef STARPU_QUICK_CHECK
+#define NX (256*1024)
+#define NITER 4
+#else
+#define NX (4*1024*1024)
+#define NITER 16
+#endif
+
+void increment_func(void *descr[], void *arg)
+{
+	int *x = (int *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+	(void)arg;
+
+	for (i = 0; i < n; i++)
+		x[i]++;
+}
+
+static struct starpu_codelet increment_cl =
+{
+	.where = STARPU_TCPIP_MS,
+	.cpu_funcs = {increment_func},
+	.cpu_funcs_name = {"increment_func"},
+	.nbuffers = 1,
+	.modes = {STARPU_RW}
+};
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_TCPIP_MASTER_SLAVE)
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static int *x;
+
+int main(void)
+{
+	starpu_data_handle_t handle;
+	struct starpu_conf conf;
+	int workers[STARPU_NMAXWORKERS];
+	unsigned nworkers, i, iter;
+	int ret;
+
+	/* This is read by all the processes, before they connect */
+	setenv("STARPU_TCPIP_MS_NSTREAMS", NSTREAMS, 1);
+	setenv("STARPU_TCPIP_MS_STRIPE_THRESHOLD", STRIPE_THRESHOLD, 1);
+	/* Make data transfers go through the sockets even with local slaves */
+	setenv("STARPU_TCPIP_USE_SHARED_MEMORY", "0", 1);
+
+	starpu_conf_init(&conf);
+	/* Measure the bus through the striped sockets */
+	conf.bus_calibrate = 1;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	nworkers = starpu_worker_get_ids_by_type(STARPU_TCPIP_MS_WORKER, workers, STARPU_NMAXWORKERS);
+	if (nworkers == 0)
+	{
+		FPRINTF(stderr, "This test requires TCP/IP master-slave workers\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < nworkers; i++)
+	{
+		unsigned node = starpu_worker_get_memory_node(workers[i]);
+		double to = starpu_transfer_bandwidth(STARPU_MAIN_RAM, node);
+		double from = starpu_transfer_bandwidth(node, STARPU_MAIN_RAM);
+
+		FPRINTF(stderr, "node %u: %f MB/s from main RAM, %f MB/s to main RAM, %f us latency\n", node, to, from, starpu_transfer_latency(STARPU_MAIN_RAM, node));
+		if (!(to > 0.) || !(from > 0.) || isinf(to) || isinf(from) || isnan(starpu_transfer_latency(STARPU_MAIN_RAM, node)))
+		{
+			FPRINTF(stderr, "The bus to the TCP/IP master-slave node %u was not calibrated\n", node);
+			starpu_shutdown();
+			return EXIT_FAILURE;
+		}
+	}
+
+	starpu_malloc((void **) &x, NX * sizeof(*x));
+	for (i = 0; i < NX; i++)
+		x[i] = i;
+	starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) x, NX, sizeof(*x));
+
+	for (iter = 0; iter < NITER; iter++)
+	{
+		for (i = 0; i < nworkers; i++)
+		{
+			ret = starpu_task_insert(&increment_cl,
+						 STARPU_RW, handle,
+						 STARPU_EXECUTE_ON_WORKER, workers[i],
+						 0);
+			if (ret == -ENODEV) goto enodev;
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		}
+		/* Bring it back to the master from time to time */
+		if (iter % 2)
+		{
+			ret = starpu_data_acquire(handle, STARPU_R);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+			starpu_data_release(handle);
+		}
+	}
+
+	starpu_data_unregister(handle);
+
+	ret = EXIT_SUCCESS;
+	for (i = 0; i < NX; i++)
+		if (x[i] != (int) (i + NITER * nworkers))
+		{
+			FPRINTF(stderr, "x[%u] is %d instead of %u\n", i, x[i], i + NITER * nworkers);
+			ret = EXIT_FAILURE;
+			break;
+		}
+	starpu_free_noflag(x, NX * sizeof(*x));
+	starpu_shutdown();
+
+	return ret;
+
+enodev:
+	starpu_data_unregister(handle);
+	starpu_free_noflag(x, NX * sizeof(*x));
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+#endif
@@ -0,0 +1,154 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of allocating, writing, reading and freeing a lot of small
+ * data on disk, with the unistd backend which creates one file per
+ * allocation, and with the unistd_slab backend which allocates within a few
+ * big files.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NOBJS 256
+#else
+#  define NOBJS 4096
+#endif
+#define SIZE (16*1024)
+
+#if STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static void *objs[NOBJS];
+
+static int dotest(struct starpu_disk_ops *ops, const char *name, char *base)
+{
+	struct starpu_conf conf;
+	double start, alloc_time, write_time, read_time, free_time;
+	char *buf;
+	unsigned i;
+	int ret;
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.ncuda = 0;
+	conf.nopencl = 0;
+	conf.nmpi_ms = 0;
+	conf.ntcpip_ms = 0;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	int dd = starpu_disk_register(ops, (void *) base, 4 * (starpu_ssize_t) NOBJS * SIZE);
+	if (dd < 0)
+	{
+		FPRINTF(stderr, "Could not register disk: %d\n", dd);
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_malloc((void **) &buf, SIZE);
+
+	start = starpu_timing_now();
+	for (i = 0; i < NOBJS; i++)
+	{
+		objs[i] = (void *) starpu_malloc_on_node(dd, SIZE);
+		STARPU_ASSERT(objs[i]);
+	}
+	alloc_time = starpu_timing_now() - start;
+
+	start = starpu_timing_now();
+	for (i = 0; i < NOBJS; i++)
+	{
+		memset(buf, i, SIZE);
+		ret = starpu_interface_copy((uintptr_t) buf, 0, STARPU_MAIN_RAM, (uintptr_t) objs[i], 0, dd, SIZE, NULL);
+		STARPU_ASSERT(ret == 0);
+	}
+	write_time = starpu_timing_now() - start;
+
+	start = starpu_timing_now();
+	for (i = 0; i < NOBJS; i++)
+	{
+		ret = starpu_interface_copy((uintptr_t) objs[i], 0, dd, (uintptr_t) buf, 0, STARPU_MAIN_RAM, SIZE, NULL);
+		STARPU_ASSERT(ret == 0);
+		STARPU_ASSERT_MSG(buf[0] == (char) i && buf[SIZE-1] == (char) i, "object %u has wrong content", i);
+	}
+	read_time = starpu_timing_now() - start;
+
+	start = starpu_timing_now();
+	for (i = 0; i < NOBJS; i++)
+		starpu_free_on_node(dd, (uintptr_t) objs[i], SIZE);
+	free_time = starpu_timing_now() - start;
+
+	starpu_free_noflag(buf, SIZE);
+	starpu_shutdown();
+
+	printf("%s\t%.2f\t%.2f\t%.2f\t%.2f\n", name, alloc_time / NOBJS, write_time / NOBJS, read_time / NOBJS, free_time / NOBJS);
+
+	return EXIT_SUCCESS;
+}
+
+static int merge_result(int old, int new)
+{
+	if (new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (old == 0)
+		return 0;
+	return new;
+}
+
+int main(void)
+{
+	int ret = STARPU_TEST_SKIPPED;
+	char s[128];
+	char *ptr;
+
+#ifdef STARPU_HAVE_SETENV
+	/* Do not spend time calibrating the disk */
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+#endif
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	printf("# %d objects of %d bytes, times in us per object\n", NOBJS, SIZE);
+	printf("# backend\talloc\twrite\tread\tfree\n");
+	ret = merge_result(ret, dotest(&starpu_disk_unistd_ops, "unistd", s));
+	ret = merge_result(ret, dotest(&starpu_disk_unistd_slab_ops, "unistd_slab", s));
+
+	if (rmdir(s) < 0)
+		FPRINTF(stderr, "Could not remove directory '%s': %s\n", s, strerror(errno));
+
+	return ret;
+}
+#endif
@@ -0,0 +1,278 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Run a tiled GEMM whose tiles do not fit in the main memory, so that data
+ * gets evicted to disk, with the different eviction policies, check the
+ * result, and check and report the amount of data transferred between the
+ * main memory and the disk for each of them.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NT 4
+#else
+#  define NT 6
+#endif
+#define TILE 128
+#define MEMSIZE_STR "1"
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static void fill(void *buffers[], void *args)
+{
+	float *tile = (float *) STARPU_MATRIX_GET_PTR(buffers[0]);
+	unsigned nx = STARPU_MATRIX_GET_NX(buffers[0]);
+	unsigned ny = STARPU_MATRIX_GET_NY(buffers[0]);
+	unsigned ld = STARPU_MATRIX_GET_LD(buffers[0]);
+	float val;
+	unsigned i, j;
+
+	starpu_codelet_unpack_args(args, &val);
+	for (j = 0; j < ny; j++)
+		for (i = 0; i < nx; i++)
+			tile[j*ld+i] = val;
+}
+
+static void gemm(void *buffers[], void *args)
+{
+	(void)args;
+	float *a = (float *) STARPU_MATRIX_GET_PTR(buffers[0]);
+	float *b = (float *) STARPU_MATRIX_GET_PTR(buffers[1]);
+	float *c = (float *) STARPU_MATRIX_GET_PTR(buffers[2]);
+	unsigned lda = STARPU_MATRIX_GET_LD(buffers[0]);
+	unsigned ldb = STARPU_MATRIX_GET_LD(buffers[1]);
+	unsigned ldc = STARPU_MATRIX_GET_LD(buffers[2]);
+	unsigned i, j, k;
+
+	for (j = 0; j < TILE; j++)
+		for (k = 0; k < TILE; k++)
+		{
+			float bkj = b[j*ldb+k];
+			for (i = 0; i < TILE; i++)
+				c[j*ldc+i] += a[k*lda+i] * bkj;
+		}
+}
+
+static struct starpu_codelet fill_cl =
+{
+	.cpu_funcs = { fill },
+	.nbuffers = 1,
+	.modes = { STARPU_W },
+};
+
+static struct starpu_codelet gemm_cl =
+{
+	.cpu_funcs = { gemm },
+	.nbuffers = 3,
+	.modes = { STARPU_R, STARPU_R, STARPU_RW },
+};
+
+static starpu_data_handle_t A[NT][NT], B[NT][NT], C[NT][NT];
+
+static int check_tile(starpu_data_handle_t tile)
+{
+	unsigned ld, i, j;
+	float *ptr;
+	int ret = EXIT_SUCCESS;
+
+	int ret2 = starpu_data_acquire(tile, STARPU_R);
+	STARPU_CHECK_RETURN_VALUE(ret2, "starpu_data_acquire");
+	ptr = (float *) starpu_matrix_get_local_ptr(tile);
+	ld = starpu_matrix_get_local_ld(tile);
+	for (j = 0; j < TILE && ret == EXIT_SUCCESS; j++)
+		for (i = 0; i < TILE; i++)
+			if (ptr[j*ld+i] != NT*TILE)
+			{
+				FPRINTF(stderr, "Incorrect value %f at (%u,%u), should be %d\n", ptr[j*ld+i], i, j, NT*TILE);
+				ret = EXIT_FAILURE;
+				break;
+			}
+	starpu_data_release(tile);
+	return ret;
+}
+
+static int fill_tiles(starpu_data_handle_t tiles[NT][NT], float val)
+{
+	unsigned i, j;
+	int ret;
+
+	for (i = 0; i < NT; i++)
+		for (j = 0; j < NT; j++)
+		{
+			starpu_matrix_data_register(&tiles[i][j], -1, 0, TILE, TILE, TILE, sizeof(float));
+			ret = starpu_task_insert(&fill_cl, STARPU_W, tiles[i][j], STARPU_VALUE, &val, sizeof(val), 0);
+			if (ret == -ENODEV)
+				return ret;
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		}
+	return 0;
+}
+
+static int dotest(const char *policy, char *base)
+{
+	unsigned i, j, k;
+	int busid;
+	long long transferred = 0;
+	/* A, B, and C together do not fit in the main memory, so at least
+	 * the part which does not fit has to go to the disk, and each task can
+	 * not need more than fetching its three tiles and writing back C */
+	const long long tile_size = TILE*TILE*sizeof(float);
+	const long long min_transferred = 3*NT*NT*tile_size - atoi(MEMSIZE_STR)*1024*1024;
+	const long long max_transferred = NT*NT*NT*4*tile_size;
+	int result = EXIT_SUCCESS;
+
+	if (starpu_getenv_number_default("STARPU_DIDUSE_BARRIER", 0))
+		/* This would hang */
+		return STARPU_TEST_SKIPPED;
+
+	setenv("STARPU_EVICTION_POLICY", policy, 1);
+
+	struct starpu_conf conf;
+	int ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 2;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+
+	int dd = starpu_disk_register(&starpu_disk_unistd_ops, (void *) base, STARPU_DISK_SIZE_MIN);
+	if (dd < 0)
+	{
+		FPRINTF(stderr, "Could not register disk: %d\n", dd);
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+
+	if (fill_tiles(A, 1.) || fill_tiles(B, 1.) || fill_tiles(C, 0.))
+		goto enodev;
+
+	/* Do not count the initialization */
+	starpu_task_wait_for_all();
+	for (busid = 0; busid < starpu_bus_get_count(); busid++)
+		starpu_bus_get_profiling_info(busid, NULL);
+
+	for (i = 0; i < NT; i++)
+		for (j = 0; j < NT; j++)
+			for (k = 0; k < NT; k++)
+			{
+				ret = starpu_task_insert(&gemm_cl, STARPU_R, A[i][k], STARPU_R, B[k][j], STARPU_RW, C[i][j], 0);
+				if (ret == -ENODEV) goto enodev;
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			}
+	starpu_task_wait_for_all();
+
+	for (busid = 0; busid < starpu_bus_get_count(); busid++)
+	{
+		struct starpu_profiling_bus_info bus_info;
+		starpu_bus_get_profiling_info(busid, &bus_info);
+		transferred += bus_info.transferred_bytes;
+	}
+
+	for (i = 0; i < NT; i++)
+		for (j = 0; j < NT; j++)
+			if (result == EXIT_SUCCESS)
+				result = check_tile(C[i][j]);
+
+	for (i = 0; i < NT; i++)
+		for (j = 0; j < NT; j++)
+		{
+			starpu_data_unregister(A[i][j]);
+			starpu_data_unregister(B[i][j]);
+			starpu_data_unregister(C[i][j]);
+		}
+
+	starpu_shutdown();
+
+	FPRINTF(stdout, "%s\t%lld\n", policy, transferred);
+
+	if (transferred < min_transferred || transferred > max_transferred)
+	{
+		FPRINTF(stderr, "%s: %lld bytes transferred, should be between %lld and %lld\n", policy, transferred, min_transferred, max_transferred);
+		result = EXIT_FAILURE;
+	}
+
+	return result;
+
+enodev:
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+static int merge_result(int old, int new)
+{
+	if (old == EXIT_FAILURE || new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	return new;
+}
+
+int main(void)
+{
+	static const char *policies[] = { "lru", "arc", "nextuse" };
+	int ret = 0;
+	int ret2;
+	unsigned i;
+	char s[128];
+	char *ptr;
+
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	setenv("STARPU_LIMIT_CPU_MEM", MEMSIZE_STR, 1);
+
+	FPRINTF(stdout, "# %dx%d tiles of %dx%d floats, %s MiB of main memory\n", NT, NT, TILE, TILE, MEMSIZE_STR);
+	FPRINTF(stdout, "# policy\tbytes transferred\n");
+	for (i = 0; i < sizeof(policies)/sizeof(policies[0]); i++)
+	{
+		ret = merge_result(ret, dotest(policies[i], s));
+		if (ret == STARPU_TEST_SKIPPED)
+			break;
+	}
+
+	ret2 = rmdir(s);
+	STARPU_CHECK_RETURN_VALUE(ret2, "rmdir '%s'\n", s);
+
+	return ret;
+}
+#endif
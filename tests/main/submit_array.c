@@ -0,0 +1,101 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Submit arrays of tasks which depend on each other through data, with a
+ * synchronous task and a task without codelet in the middle, and check that
+ * they were all executed in order.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 64
+#else
+#define NTASKS 1024
+#endif
+
+#define NLOOPS 4
+
+static void increment(void *descr[], void *arg)
+{
+	(void)arg;
+	unsigned *var = (unsigned *) STARPU_VARIABLE_GET_PTR(descr[0]);
+	(*var)++;
+}
+
+static struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = { increment },
+	.cpu_funcs_name = { "increment" },
+	.nbuffers = 1,
+	.modes = { STARPU_RW },
+};
+
+int main(void)
+{
+	struct starpu_task *tasks[NTASKS];
+	starpu_data_handle_t handle;
+	unsigned var = 0, expected = 0;
+	unsigned i, loop;
+	int ret;
+
+	ret = starpu_initialize(NULL, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) &var, sizeof(var));
+
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		for (i = 0; i < NTASKS; i++)
+		{
+			tasks[i] = starpu_task_create();
+			if (i == NTASKS / 4)
+				/* A control task */
+				continue;
+			tasks[i]->cl = &increment_cl;
+			tasks[i]->handles[0] = handle;
+			expected++;
+		}
+		/* The tasks before this one have to be pushed for it to complete */
+		tasks[NTASKS / 2]->synchronous = 1;
+
+		ret = starpu_task_submit_array(tasks, NTASKS);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit_array");
+	}
+
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+
+	if (var != expected)
+	{
+		FPRINTF(stderr, "Got %u instead of %u\n", var, expected);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
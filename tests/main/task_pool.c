@@ -0,0 +1,92 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Check that task structures can be recycled across starpu_init /
+ * starpu_shutdown, and that tasks created before starpu_init are properly
+ * handled.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 256
+#define NLOOPS 2
+#else
+#define NTASKS 65536
+#define NLOOPS 4
+#endif
+
+int main(void)
+{
+	int ret;
+	unsigned loop, i;
+
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		/* Created before starpu_init */
+		struct starpu_task *early = starpu_task_create();
+		early->cl = &starpu_codelet_nop;
+		early->detach = 0;
+		early->destroy = 0;
+
+		ret = starpu_init(NULL);
+		if (ret == -ENODEV)
+		{
+			starpu_task_destroy(early);
+			return STARPU_TEST_SKIPPED;
+		}
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+		for (i = 0; i < NTASKS; i++)
+		{
+			struct starpu_task *task = starpu_task_create();
+			task->cl = &starpu_codelet_nop;
+			ret = starpu_task_submit(task);
+			if (ret == -ENODEV)
+				goto enodev;
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		}
+
+		/* Synchronous tasks are destroyed by the submitting thread */
+		for (i = 0; i < NTASKS / 16; i++)
+		{
+			struct starpu_task *task = starpu_task_create();
+			task->cl = &starpu_codelet_nop;
+			task->synchronous = 1;
+			ret = starpu_task_submit(task);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		}
+
+		ret = starpu_task_submit(early);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		ret = starpu_task_wait(early);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait");
+		starpu_task_destroy(early);
+
+		starpu_task_wait_for_all();
+		starpu_shutdown();
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_task_wait_for_all();
+	starpu_shutdown();
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
@@ -0,0 +1,130 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <math.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of the worker selection of the dm/dmda-like schedulers for
+ * a task with a known performance model and some data, i.e. the cost of
+ * evaluating the expected end, transfer time and fitness on each worker.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 1024
+#else
+#define NTASKS 16384
+#endif
+
+#define NBUFFERS 3
+
+static void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static double cost_function(struct starpu_task *task, unsigned nimpl)
+{
+	(void)task;
+	(void)nimpl;
+	return 100.;
+}
+
+static struct starpu_perfmodel model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = cost_function,
+	.symbol = "dmda_push",
+};
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = { func, func },
+	.nbuffers = NBUFFERS,
+	.modes = { STARPU_R, STARPU_R, STARPU_RW },
+	.model = &model,
+};
+
+static starpu_data_handle_t handles[NBUFFERS];
+static unsigned values[NBUFFERS];
+
+static int dotest(const char *sched)
+{
+	struct starpu_conf conf;
+	struct starpu_sched_policy *policy;
+	struct starpu_task *task;
+	double start, push_time, expected_end = 0.;
+	unsigned i, nworkers;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = sched;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NBUFFERS; i++)
+		starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t) &values[i], sizeof(values[i]));
+
+	policy = starpu_sched_ctx_get_sched_policy(0);
+	STARPU_ASSERT(policy->simulate_push_task);
+
+	task = starpu_task_create();
+	task->cl = &cl;
+	task->sched_ctx = 0;
+	for (i = 0; i < NBUFFERS; i++)
+		task->handles[i] = handles[i];
+	task->destroy = 0;
+
+	/* Only measure the evaluation of the workers, not the submission
+	 * and execution of the task, and keep the workers quiet meanwhile */
+	starpu_pause();
+	start = starpu_timing_now();
+	for (i = 0; i < NTASKS; i++)
+		expected_end += policy->simulate_push_task(task);
+	push_time = starpu_timing_now() - start;
+	starpu_resume();
+	STARPU_ASSERT(!isnan(expected_end));
+	nworkers = starpu_worker_get_count();
+
+	starpu_task_destroy(task);
+	for (i = 0; i < NBUFFERS; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+
+	FPRINTF(stdout, "%s\t%u\t%f\n", sched, nworkers, push_time / NTASKS);
+
+	return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+	static const char *scheds[] = { "dm", "dmda", "dmdas" };
+	unsigned i;
+	int ret = EXIT_SUCCESS;
+
+	FPRINTF(stdout, "# sched\tworkers\tpush evaluation (us)\n");
+	for (i = 0; i < sizeof(scheds)/sizeof(scheds[0]); i++)
+	{
+		ret = dotest(scheds[i]);
+		if (ret != EXIT_SUCCESS)
+			break;
+	}
+
+	return ret;
+}
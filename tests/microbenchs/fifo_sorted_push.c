@@ -0,0 +1,100 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <math.h>
+#include <starpu.h>
+#include <starpu_scheduler.h>
+#include <schedulers/starpu_scheduler_toolbox.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of sorted pushes into a worker fifo, as used by the
+ * dmdas-like schedulers, depending on the depth of the queue, and check that
+ * the queue is kept sorted.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define MAXDEPTH 1024
+#else
+#define MAXDEPTH 65536
+#endif
+
+#define NPRIOS 32
+
+static struct starpu_task tasks[MAXDEPTH];
+
+int main(void)
+{
+	int ret;
+	unsigned depth, i;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	starpu_srand48(0);
+
+	FPRINTF(stdout, "# depth\tpush (us)\texp_len (us)\n");
+	for (depth = 16; depth <= MAXDEPTH; depth *= 4)
+	{
+		starpu_st_fifo_taskq_t fifo = starpu_st_fifo_taskq_create();
+		double start, push_time, exp_len_time;
+
+		for (i = 0; i < depth; i++)
+		{
+			starpu_task_init(&tasks[i]);
+			tasks[i].priority = starpu_lrand48() % NPRIOS;
+			tasks[i].predicted = 1.;
+		}
+
+		start = starpu_timing_now();
+		for (i = 0; i < depth; i++)
+			starpu_st_fifo_taskq_push_sorted_task(fifo, &tasks[i]);
+		push_time = starpu_timing_now() - start;
+
+		start = starpu_timing_now();
+		for (i = 0; i < depth; i++)
+		{
+			int ntasks = 0;
+			double exp_len = starpu_st_fifo_taskq_get_exp_len_prev_task_list(fifo, &tasks[i], 0, 0, &ntasks);
+			STARPU_ASSERT(ntasks <= (int) depth);
+			STARPU_ASSERT(isnan(exp_len) || exp_len <= depth);
+		}
+		exp_len_time = starpu_timing_now() - start;
+
+		FPRINTF(stdout, "%u\t%f\t%f\n", depth, push_time / depth, exp_len_time / depth);
+
+		/* Check that tasks come out by decreasing priority, and in
+		 * submission order for the same priority */
+		struct starpu_task *prev = NULL, *task;
+		for (i = 0; i < depth; i++)
+		{
+			task = starpu_st_fifo_taskq_pop_local_task(fifo);
+			STARPU_ASSERT(task);
+			if (prev)
+				STARPU_ASSERT(prev->priority > task->priority ||
+					      (prev->priority == task->priority && prev < task));
+			prev = task;
+		}
+		STARPU_ASSERT(starpu_st_fifo_taskq_empty(fifo));
+
+		starpu_st_fifo_taskq_destroy(fifo);
+	}
+
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#!/bin/sh -x
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+# Generate a trace made of several files, as several MPI ranks would, convert
+# it with starpu_fxt_tool with and without background decoding threads, check
+# that the outputs are the same, and print how long each conversion took.
+# Set NTASKS and NFILES to benchmark on a larger trace.
+
+# Testing another specific scheduler, no need to run this
+[ -z "$STARPU_SCHED" -o "$STARPU_SCHED" = eager ] || exit 77
+
+set -e
+
+PREFIX=$(dirname $0)
+TRACES=$PREFIX/fxt_tool_nthreads.traces
+rm -rf $TRACES
+mkdir -p $TRACES
+
+test -x $PREFIX/../../tools/starpu_fxt_tool || exit 77
+
+NFILES=${NFILES:-4}
+NTASKS=${NTASKS:-10000}
+
+# One trace file per process, all processes running at the same time
+export STARPU_FXT_PREFIX=$TRACES
+INPUTS=
+pids=
+i=0
+while [ $i -lt $NFILES ]
+do
+	STARPU_FXT_TRACE=1 STARPU_FXT_SUFFIX=rank$i STARPU_SCHED=eager $STARPU_LAUNCH $PREFIX/tasks_overhead -i $NTASKS > /dev/null &
+	pids="$pids $!"
+	INPUTS="$INPUTS -i $TRACES/rank${i}_0"
+	i=$(($i + 1))
+done
+for pid in $pids
+do
+	wait $pid
+done
+
+now()
+{
+	date +%s.%N
+}
+
+convert()
+{
+	mkdir -p $TRACES/$1
+	start=$(now)
+	$STARPU_LAUNCH $PREFIX/../../tools/starpu_fxt_tool -d $TRACES/$1 -nthreads $2 $INPUTS
+	end=$(now)
+	echo "$NFILES files of $NTASKS tasks, -nthreads $2: $(echo $start $end | awk '{ print $2 - $1 }') s"
+}
+
+convert seq 1
+convert par 4
+
+for file in paje.trace dag.dot tasks.rec
+do
+	cmp $TRACES/seq/$file $TRACES/par/$file
+done
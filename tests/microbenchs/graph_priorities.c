@@ -0,0 +1,140 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of recording the task graph and computing the depths and
+ * numbers of descendants of the tasks with the graph_test scheduler, depending
+ * on the number of tasks in the graph, and check the resulting priorities.
+ *
+ * Task i depends on tasks i-1 and (i-1)/2, so that the first task has all
+ * other tasks as descendants, and a depth of ntasks-1.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define MAXTASKS 4096
+#else
+#define MAXTASKS 65536
+#endif
+
+static void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static double cost_function(struct starpu_task *task, unsigned nimpl)
+{
+	(void)task;
+	(void)nimpl;
+	return 1.;
+}
+
+static struct starpu_perfmodel model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = cost_function,
+	.symbol = "graph_priorities",
+};
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = { func },
+	.nbuffers = 0,
+	.model = &model,
+};
+
+static struct starpu_task *tasks[MAXTASKS];
+
+static int dotest(int descendants, unsigned ntasks)
+{
+	struct starpu_conf conf;
+	double start, submit_time, schedule_time;
+	unsigned i;
+	int ret, priority;
+
+	setenv("STARPU_SCHED_GRAPH_TEST_DESCENDANTS", descendants ? "1" : "0", 1);
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = "graph_test";
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	start = starpu_timing_now();
+	for (i = 0; i < ntasks; i++)
+	{
+		tasks[i] = starpu_task_create();
+		tasks[i]->cl = &cl;
+		tasks[i]->detach = 0;
+		tasks[i]->destroy = 0;
+		if (i == 1)
+			starpu_task_declare_deps(tasks[i], 1, tasks[0]);
+		else if (i > 1)
+			starpu_task_declare_deps(tasks[i], 2, tasks[i-1], tasks[(i-1)/2]);
+		ret = starpu_task_submit(tasks[i]);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	submit_time = starpu_timing_now() - start;
+
+	/* This computes the priorities of all tasks, and lets them run */
+	start = starpu_timing_now();
+	starpu_do_schedule();
+	schedule_time = starpu_timing_now() - start;
+
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+
+	FPRINTF(stdout, "%s\t%u\t%f\t%f\n", descendants ? "descendants" : "depth", ntasks, submit_time / ntasks, schedule_time / ntasks);
+
+	/* The depth is exact, the number of descendants is only estimated */
+	priority = tasks[0]->priority;
+	if (descendants)
+		STARPU_ASSERT_MSG(priority >= (int) ntasks / 4 && priority <= 4 * (int) ntasks, "task 0 has an estimated %d descendants instead of %u\n", priority, ntasks - 1);
+	else
+		STARPU_ASSERT_MSG(priority == (int) ntasks - 1, "task 0 has depth %d instead of %u\n", priority, ntasks - 1);
+	STARPU_ASSERT(tasks[ntasks-1]->priority == 0);
+
+	for (i = 0; i < ntasks; i++)
+		starpu_task_destroy(tasks[i]);
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+	unsigned ntasks;
+	int descendants;
+	int ret = EXIT_SUCCESS;
+
+	FPRINTF(stdout, "# priority\ttasks\tsubmission (us)\tscheduling (us)\n");
+	for (descendants = 0; descendants <= 1; descendants++)
+		for (ntasks = 16; ntasks <= MAXTASKS; ntasks *= 4)
+		{
+			ret = dotest(descendants, ntasks);
+			if (ret != EXIT_SUCCESS)
+				return ret;
+		}
+
+	return ret;
+}
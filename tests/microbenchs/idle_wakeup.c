@@ -0,0 +1,137 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the latency of getting an empty task executed by idle workers,
+ * depending on the time they have been idle, and the throughput of empty
+ * tasks, for different values of STARPU_IDLE_SPIN_MAX.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NLATENCY 64
+#define NTHROUGHPUT 1024
+#else
+#define NLATENCY 1024
+#define NTHROUGHPUT 65536
+#endif
+
+static void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet dummy_codelet =
+{
+	.cpu_funcs = {dummy_func},
+	.cpu_funcs_name = {"dummy_func"},
+	.model = NULL,
+	.nbuffers = 0,
+};
+
+static int submit(unsigned synchronous)
+{
+	struct starpu_task *task = starpu_task_create();
+	task->cl = &dummy_codelet;
+	task->synchronous = synchronous;
+	return starpu_task_submit(task);
+}
+
+/* Average time to run a synchronous task after idling for gap us */
+static int latency(unsigned gap, double *result)
+{
+	double total = 0.;
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < NLATENCY; i++)
+	{
+		double start;
+
+		if (gap)
+			starpu_usleep(gap);
+		start = starpu_timing_now();
+		ret = submit(1);
+		if (ret)
+			return ret;
+		total += starpu_timing_now() - start;
+	}
+	*result = total / NLATENCY;
+	return 0;
+}
+
+static int dotest(unsigned spin_max)
+{
+	static const unsigned gaps[] = { 0, 10, 100, 1000 };
+	struct starpu_conf conf;
+	double start, timing, result;
+	unsigned i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.driver_idle_spin_max = spin_max;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < sizeof(gaps) / sizeof(gaps[0]); i++)
+	{
+		ret = latency(gaps[i], &result);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		FPRINTF(stdout, "%u\tlatency\t%u\t%f\n", spin_max, gaps[i], result);
+	}
+
+	start = starpu_timing_now();
+	for (i = 0; i < NTHROUGHPUT; i++)
+	{
+		ret = submit(0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+	timing = starpu_timing_now() - start;
+	FPRINTF(stdout, "%u\tthroughput\t-\t%f\n", spin_max, NTHROUGHPUT / timing);
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+
+enodev:
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+int main(void)
+{
+	static const unsigned spin_max[] = { 0, 20, 100 };
+	unsigned i;
+	int ret;
+
+	FPRINTF(stdout, "# spin max (us)\tmeasure\tidle gap (us)\tlatency (us) or throughput (tasks/us)\n");
+	for (i = 0; i < sizeof(spin_max) / sizeof(spin_max[0]); i++)
+	{
+		ret = dotest(spin_max[i]);
+		if (ret != EXIT_SUCCESS)
+			return ret;
+	}
+
+	return EXIT_SUCCESS;
+}
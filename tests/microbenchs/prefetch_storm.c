@@ -0,0 +1,120 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Prefetch many small pieces of data to the memory node of the first
+ * non-main-RAM worker (GPU, NUMA node, master-slave device), and measure how
+ * close to the bus bandwidth this gets. In the middle of the prefetches, fetch
+ * another piece on demand, and measure how long it takes to get through.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NPIECES 1024
+#else
+#define NPIECES 16384
+#endif
+#define PIECE_SIZE 4096
+
+static starpu_data_handle_t handles[NPIECES];
+static starpu_data_handle_t demand_handle;
+
+static unsigned find_node(void)
+{
+	unsigned worker;
+
+	for (worker = 0; worker < starpu_worker_get_count(); worker++)
+	{
+		unsigned node = starpu_worker_get_memory_node(worker);
+		if (node != STARPU_MAIN_RAM)
+			return node;
+	}
+	return STARPU_MAIN_RAM;
+}
+
+/* Number of pieces which have actually arrived on node */
+static unsigned count_on_node(unsigned node)
+{
+	unsigned i, n = 0;
+
+	for (i = 0; i < NPIECES; i++)
+	{
+		int is_valid;
+		starpu_data_query_status(handles[i], node, NULL, &is_valid, NULL);
+		n += is_valid;
+	}
+	return n;
+}
+
+int main(void)
+{
+	static char pieces[NPIECES][PIECE_SIZE];
+	static char demand[PIECE_SIZE];
+	double start, demand_start, demand_time, storm_time;
+	double bandwidth, latency;
+	unsigned node, i, before_demand;
+	int ret;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	node = find_node();
+	if (node == STARPU_MAIN_RAM)
+	{
+		FPRINTF(stderr, "This test requires a worker with its own memory node\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	bandwidth = starpu_transfer_bandwidth(STARPU_MAIN_RAM, node);
+	latency = starpu_transfer_latency(STARPU_MAIN_RAM, node);
+
+	for (i = 0; i < NPIECES; i++)
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t) pieces[i], PIECE_SIZE, 1);
+	starpu_vector_data_register(&demand_handle, STARPU_MAIN_RAM, (uintptr_t) demand, PIECE_SIZE, 1);
+
+	start = starpu_timing_now();
+	for (i = 0; i < NPIECES; i++)
+	{
+		ret = starpu_data_prefetch_on_node(handles[i], node, 1);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_prefetch_on_node");
+	}
+
+	/* A task needs some data right now */
+	before_demand = count_on_node(node);
+	demand_start = starpu_timing_now();
+	ret = starpu_data_fetch_on_node(demand_handle, node, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_fetch_on_node");
+	demand_time = starpu_timing_now() - demand_start;
+	FPRINTF(stdout, "demand fetch took %f us, with %u/%u pieces prefetched before and %u after\n", demand_time, before_demand, NPIECES, count_on_node(node));
+
+	/* Wait for the prefetches without turning them into fetches */
+	while (count_on_node(node) < NPIECES)
+		starpu_usleep(100);
+	storm_time = starpu_timing_now() - start;
+
+	FPRINTF(stdout, "prefetched %u pieces of %u bytes in %f us, i.e. %f MB/s\n", NPIECES, PIECE_SIZE, storm_time, (double) NPIECES * PIECE_SIZE / storm_time);
+	FPRINTF(stdout, "bus model: %f MB/s, %f us latency\n", bandwidth, latency);
+
+	for (i = 0; i < NPIECES; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_data_unregister(demand_handle);
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of a dot product accumulated in a STARPU_REDUX variable,
+ * which makes StarPU reduce the per-worker replicates at each acquisition,
+ * and check the result.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NBLOCKS 16
+#define BLOCK 1024
+#define NITER 4
+#else
+#define NBLOCKS 256
+#define BLOCK 16384
+#define NITER 32
+#endif
+
+static void dot_cpu(void *descr[], void *arg)
+{
+	const double *x = (const double *) STARPU_VECTOR_GET_PTR(descr[0]);
+	const double *y = (const double *) STARPU_VECTOR_GET_PTR(descr[1]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	double *dot = (double *) STARPU_VARIABLE_GET_PTR(descr[2]);
+	double local = 0.;
+	unsigned i;
+	(void)arg;
+
+	for (i = 0; i < n; i++)
+		local += x[i] * y[i];
+	*dot += local;
+}
+
+static struct starpu_codelet dot_cl =
+{
+	.cpu_funcs = { dot_cpu },
+	.cpu_funcs_name = { "dot_cpu" },
+	.nbuffers = 3,
+	.modes = { STARPU_R, STARPU_R, STARPU_REDUX },
+	.name = "dot",
+};
+
+static void redux_cpu(void *descr[], void *arg)
+{
+	double *dst = (double *) STARPU_VARIABLE_GET_PTR(descr[0]);
+	double *src = (double *) STARPU_VARIABLE_GET_PTR(descr[1]);
+	(void)arg;
+
+	*dst += *src;
+}
+
+static struct starpu_codelet redux_cl =
+{
+	.cpu_funcs = { redux_cpu },
+	.cpu_funcs_name = { "redux_cpu" },
+	.nbuffers = 2,
+	.modes = { STARPU_RW|STARPU_COMMUTE, STARPU_R },
+	.name = "redux",
+};
+
+static void neutral_cpu(void *descr[], void *arg)
+{
+	double *dot = (double *) STARPU_VARIABLE_GET_PTR(descr[0]);
+	(void)arg;
+
+	*dot = 0.;
+}
+
+static struct starpu_codelet neutral_cl =
+{
+	.cpu_funcs = { neutral_cpu },
+	.cpu_funcs_name = { "neutral_cpu" },
+	.nbuffers = 1,
+	.modes = { STARPU_W },
+	.name = "neutral",
+};
+
+static double x[NBLOCKS * BLOCK];
+static double y[NBLOCKS * BLOCK];
+
+int main(void)
+{
+	starpu_data_handle_t x_handle, y_handle, dot_handle;
+	struct starpu_data_filter f =
+	{
+		.filter_func = starpu_vector_filter_block,
+		.nchildren = NBLOCKS,
+	};
+	double dot = 0., start, timing;
+	unsigned i, iter;
+	int ret;
+
+	/* Not supported yet */
+	if (starpu_getenv_number_default("STARPU_GLOBAL_ARBITER", 0) > 0)
+		return STARPU_TEST_SKIPPED;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	/* Small integers, so that the sums are exact whatever the order */
+	for (i = 0; i < NBLOCKS * BLOCK; i++)
+	{
+		x[i] = i % 4;
+		y[i] = i % 3;
+	}
+
+	starpu_vector_data_register(&x_handle, STARPU_MAIN_RAM, (uintptr_t) x, NBLOCKS * BLOCK, sizeof(x[0]));
+	starpu_vector_data_register(&y_handle, STARPU_MAIN_RAM, (uintptr_t) y, NBLOCKS * BLOCK, sizeof(y[0]));
+	starpu_variable_data_register(&dot_handle, STARPU_MAIN_RAM, (uintptr_t) &dot, sizeof(dot));
+	starpu_data_set_reduction_methods(dot_handle, &redux_cl, &neutral_cl);
+	starpu_data_partition(x_handle, &f);
+	starpu_data_partition(y_handle, &f);
+
+	start = starpu_timing_now();
+	for (iter = 0; iter < NITER; iter++)
+	{
+		for (i = 0; i < NBLOCKS; i++)
+		{
+			ret = starpu_task_insert(&dot_cl,
+						 STARPU_R, starpu_data_get_sub_data(x_handle, 1, i),
+						 STARPU_R, starpu_data_get_sub_data(y_handle, 1, i),
+						 STARPU_REDUX, dot_handle,
+						 0);
+			if (ret == -ENODEV) goto enodev;
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		}
+
+		/* This triggers the reduction of the replicates */
+		ret = starpu_data_acquire(dot_handle, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		starpu_data_release(dot_handle);
+	}
+	timing = starpu_timing_now() - start;
+
+	starpu_data_unpartition(x_handle, STARPU_MAIN_RAM);
+	starpu_data_unpartition(y_handle, STARPU_MAIN_RAM);
+	starpu_data_unregister(x_handle);
+	starpu_data_unregister(y_handle);
+	starpu_data_unregister(dot_handle);
+
+	FPRINTF(stdout, "%u workers\t%u blocks\t%f us per dot product\n", starpu_worker_get_count(), NBLOCKS, timing / NITER);
+
+	starpu_shutdown();
+
+	/* Sum of (i%4)*(i%3) over one period of 12 is 18 */
+	double expected = (double) NITER * (NBLOCKS * BLOCK / 12) * 18;
+	for (i = (NBLOCKS * BLOCK / 12) * 12; i < NBLOCKS * BLOCK; i++)
+		expected += NITER * (double) ((i % 4) * (i % 3));
+	if (dot != expected)
+	{
+		FPRINTF(stderr, "Dot product %f != expected %f\n", dot, expected);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_data_unpartition(x_handle, STARPU_MAIN_RAM);
+	starpu_data_unpartition(y_handle, STARPU_MAIN_RAM);
+	starpu_data_unregister(x_handle);
+	starpu_data_unregister(y_handle);
+	starpu_data_unregister(dot_handle);
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
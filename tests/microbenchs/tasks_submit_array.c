@@ -0,0 +1,142 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the submission rate of empty tasks, when submitting them one by one
+ * with starpu_task_submit, and by batches with starpu_task_submit_array
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 1024
+#else
+#define NTASKS 65536
+#endif
+
+#define BATCH 64
+
+static void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = { func },
+	.cpu_funcs_name = { "func" },
+	.nbuffers = 0,
+};
+
+static struct starpu_task tasks[NTASKS];
+static struct starpu_task *ptasks[NTASKS];
+
+static int submit(unsigned batch, double *submit_time, double *total_time)
+{
+	double start, end_submit;
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		starpu_task_init(&tasks[i]);
+		tasks[i].cl = &cl;
+		ptasks[i] = &tasks[i];
+	}
+
+	/* Only measure the submission, keep the workers quiet meanwhile */
+	starpu_pause();
+	start = starpu_timing_now();
+	for (i = 0; i < NTASKS; i += batch)
+	{
+		if (batch == 1)
+			ret = starpu_task_submit(ptasks[i]);
+		else
+			ret = starpu_task_submit_array(&ptasks[i], STARPU_MIN(batch, NTASKS - i));
+		if (ret == -ENODEV)
+		{
+			starpu_resume();
+			starpu_task_wait_for_all();
+			return ret;
+		}
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit_array");
+	}
+	end_submit = starpu_timing_now();
+	starpu_resume();
+	starpu_task_wait_for_all();
+
+	*submit_time = end_submit - start;
+	*total_time = starpu_timing_now() - start;
+
+	for (i = 0; i < NTASKS; i++)
+		starpu_task_clean(&tasks[i]);
+
+	return 0;
+}
+
+static int dotest(const char *sched)
+{
+	struct starpu_conf conf;
+	double submit_time, total_time;
+	unsigned batches[] = { 1, BATCH };
+	unsigned i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = sched;
+	conf.ncpus = 2;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	/* Warm up */
+	ret = submit(1, &submit_time, &total_time);
+	if (ret == -ENODEV)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < sizeof(batches)/sizeof(batches[0]); i++)
+	{
+		ret = submit(batches[i], &submit_time, &total_time);
+		STARPU_ASSERT(ret == 0);
+		FPRINTF(stdout, "%s\t%u\t%.0f\t%.0f\n", sched, batches[i],
+			NTASKS / (submit_time / 1000000.), NTASKS / (total_time / 1000000.));
+	}
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+	static const char *scheds[] = { "eager", "lws" };
+	unsigned i;
+	int ret = EXIT_SUCCESS;
+
+	FPRINTF(stdout, "# sched\tbatch\tsubmitted tasks/s\texecuted tasks/s\n");
+	for (i = 0; i < sizeof(scheds)/sizeof(scheds[0]); i++)
+	{
+		ret = dotest(scheds[i]);
+		if (ret != EXIT_SUCCESS)
+			break;
+	}
+
+	return ret;
+}
@@ -0,0 +1,192 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <math.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Record a chain of tasks with starpu_bound_start() and with
+ * starpu_bound_start_stream(), and check that lp_solve accepts both linear
+ * programming problems and finds the same bound for them. Tasks of a chain
+ * can never overlap, so the worker loads of the streamed problem do not make
+ * it any looser.
+ */
+
+#define NTASKS 16
+/* us */
+#define DURATION 1000.
+
+static void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_perfmodel model =
+{
+	.type = STARPU_HISTORY_BASED,
+	.symbol = "bound_stream"
+};
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = { dummy_func },
+	.cpu_funcs_name = { "dummy_func" },
+	.model = &model,
+	.nbuffers = 1,
+	.modes = { STARPU_RW },
+};
+
+#if defined(STARPU_HAVE_WINDOWS)
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static starpu_data_handle_t handle;
+
+/* Make the model give DURATION for our tasks on all workers */
+static void feed_model(void)
+{
+	struct starpu_task task;
+	unsigned w;
+
+	starpu_task_init(&task);
+	task.cl = &cl;
+	task.handles[0] = handle;
+	for (w = 0; w < starpu_worker_get_count(); w++)
+		starpu_perfmodel_update_history_n(&model, &task, starpu_worker_get_perf_archtype(w, STARPU_NMAX_SCHED_CTXS), w, 0, DURATION, 10);
+	starpu_task_clean(&task);
+}
+
+static int submit_chain(void)
+{
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&cl, STARPU_RW, handle, 0);
+		if (ret == -ENODEV)
+			return ret;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	return starpu_task_wait_for_all();
+}
+
+/* Run lp_solve on filename, and get the value of the objective function */
+static int solve(const char *filename, double *value)
+{
+	char cmd[256], line[256];
+	FILE *f;
+	int found = 0;
+
+	snprintf(cmd, sizeof(cmd), "lp_solve -S3 %s", filename);
+	f = popen(cmd, "r");
+	if (!f)
+	{
+		FPRINTF(stderr, "Could not run '%s'\n", cmd);
+		return EXIT_FAILURE;
+	}
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "Value of objective function: %lf", value) == 1)
+			found = 1;
+	if (pclose(f) != 0 || !found)
+	{
+		FPRINTF(stderr, "lp_solve could not solve %s\n", filename);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+	char lp[] = "bound_lp_XXXXXX";
+	char lp_stream[] = "bound_stream_XXXXXX";
+	double bound, bound_stream;
+	FILE *f;
+	int fd, ret;
+	unsigned variable = 0;
+
+	if (system("lp_solve -S1 < /dev/null > /dev/null 2>&1") != 0)
+	{
+		FPRINTF(stderr, "lp_solve is not available, skipping\n");
+		return STARPU_TEST_SKIPPED;
+	}
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) &variable, sizeof(variable));
+	feed_model();
+
+	/* Whole problem, kept in memory */
+	starpu_bound_start(1, 0);
+	ret = submit_chain();
+	if (ret == -ENODEV) goto enodev;
+	starpu_bound_stop();
+
+	fd = mkstemp(lp);
+	STARPU_ASSERT_MSG(fd >= 0, "Error when creating temp file\n");
+	f = fdopen(fd, "w");
+	starpu_bound_print_lp(f);
+	fclose(f);
+
+	/* Streamed problem */
+	fd = mkstemp(lp_stream);
+	STARPU_ASSERT_MSG(fd >= 0, "Error when creating temp file\n");
+	f = fdopen(fd, "w");
+	starpu_bound_start_stream(f);
+	ret = submit_chain();
+	if (ret == -ENODEV) goto enodev;
+	starpu_bound_stop();
+	fclose(f);
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+
+	ret = solve(lp, &bound);
+	if (ret == EXIT_SUCCESS)
+		ret = solve(lp_stream, &bound_stream);
+	if (ret == EXIT_SUCCESS)
+	{
+		FPRINTF(stdout, "bound %f ms, streamed bound %f ms\n", bound, bound_stream);
+		if (fabs(bound - NTASKS * DURATION / 1000.) > 1e-3 || fabs(bound_stream - bound) > 1e-3)
+		{
+			FPRINTF(stderr, "Bounds %f and %f ms should be %f ms\n", bound, bound_stream, NTASKS * DURATION / 1000.);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	unlink(lp);
+	unlink(lp_stream);
+	return ret;
+
+enodev:
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+#endif
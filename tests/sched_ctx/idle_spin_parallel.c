@@ -0,0 +1,110 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Block the workers in parallel while they are spinning before going to
+ * sleep. The block request only sets a flag and broadcasts sched_cond, the
+ * spinning workers must still notice it, otherwise this hangs.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NLOOPS 8
+#else
+#define NLOOPS 32
+#endif
+/* Tasks per worker between two parallel regions, to make workers learn that
+ * tasks come quickly, and thus spin again */
+#define NTASKS 16
+/* us, long enough for the block request to happen during the spin */
+#define SPIN_MAX 20000
+
+static void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet dummy_codelet =
+{
+	.cpu_funcs = {dummy_func},
+	.cpu_funcs_name = {"dummy_func"},
+	.model = NULL,
+	.nbuffers = 0,
+};
+
+static unsigned nparallel;
+
+static void *parallel_code(void *arg)
+{
+	(void)arg;
+	nparallel++;
+	return NULL;
+}
+
+int main(void)
+{
+	struct starpu_conf conf;
+	int procs[STARPU_NMAXWORKERS];
+	unsigned ncpus, sched_ctx, loop, i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.driver_idle_spin_max = SPIN_MAX;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	/* starpu_sched_ctx_exec_parallel_code() requires a CPU worker as parallel region master */
+	ncpus = starpu_worker_get_ids_by_type(STARPU_CPU_WORKER, procs, STARPU_NMAXWORKERS);
+	if (ncpus == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	sched_ctx = starpu_sched_ctx_create(procs, ncpus, "ctx", STARPU_SCHED_CTX_POLICY_NAME, "eager", 0);
+
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		for (i = 0; i < NTASKS * ncpus; i++)
+		{
+			ret = starpu_task_insert(&dummy_codelet,
+						 STARPU_SCHED_CTX, sched_ctx,
+						 STARPU_EXECUTE_ON_WORKER, procs[i % ncpus],
+						 STARPU_TASK_SYNCHRONOUS, 1,
+						 0);
+			if (ret == -ENODEV) goto enodev;
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		}
+		/* Let the workers become idle, and start spinning */
+		starpu_usleep(100);
+		starpu_sched_ctx_exec_parallel_code(parallel_code, NULL, sched_ctx);
+	}
+
+	starpu_sched_ctx_delete(sched_ctx);
+	starpu_shutdown();
+
+	STARPU_CHECK_RETURN_VALUE_IS((int) nparallel, NLOOPS, "starpu_sched_ctx_exec_parallel_code");
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_sched_ctx_delete(sched_ctx);
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
@@ -47,6 +47,7 @@ static void usage()
 	fprintf(stderr, "   -memory-states	show detailed memory states of handles\n");
 	fprintf(stderr, "   -internal		show StarPU-internal tasks in DAG\n");
 	fprintf(stderr, "   -number-events	generate a file counting FxT events by type\n");
+	fprintf(stderr, "   -nthreads <n>	use <n> threads, 1 to decode the input files without background threads\n");
 	fprintf(stderr, "   -h, --help		display this help and exit\n");
 	fprintf(stderr, "   -v, --version	output version information and exit\n\n");
 	fprintf(stderr, "Report bugs to <%s>.", PACKAGE_BUGREPORT);
@@ -82,6 +83,11 @@ static int parse_args(int argc, char **argv)
 			options.dir = argv[++i];
 			reading_input_filenames = 0;
 		}
+		else if (strcmp(argv[i], "-nthreads") == 0)
+		{
+			options.nthreads = atoi(argv[++i]);
+			reading_input_filenames = 0;
+		}
 		else if (strcmp(argv[i], "-i") == 0)
 		{
 			if (options.ninputfiles >= STARPU_FXT_MAX_FILES)
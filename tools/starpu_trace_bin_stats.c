@@ -0,0 +1,498 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2022       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#include <debug/traces/starpu_trace_bin.h>
+
+#define PROGNAME "starpu_trace_bin_stats"
+
+/*
+ * This program reads the trace.bin file generated by starpu_fxt_tool, and
+ * reports the number and the duration of the states, like
+ * starpu_trace_state_stats.py does from trace.rec.
+ */
+
+struct event
+{
+	double time;
+	uint32_t name;
+	uint32_t category;
+	uint8_t type;
+};
+
+struct state_stat
+{
+	uint32_t name;
+	uint32_t category;
+	unsigned long count;
+	double duration;
+};
+
+struct stats
+{
+	struct state_stat *stats;
+	unsigned nstats;
+	/* Index of the stat of each string, -1 if none */
+	int *index;
+};
+
+struct worker
+{
+	int id;
+	struct stats stats;
+
+	struct event *stack;
+	unsigned stack_size;
+	unsigned stack_allocated;
+	struct event current;
+	int has_current;
+
+	/* Previous event */
+	struct event last;
+	int has_last;
+	/* Whether the Deinitializing state was reached */
+	int finished;
+};
+
+static const char **strings;
+static uint32_t nstrings;
+static struct _starpu_trace_bin_events *blocks;
+static unsigned nblocks;
+
+static double *start_profiling;
+static double *stop_profiling;
+static unsigned nstart_profiling;
+static unsigned nstop_profiling;
+
+static struct worker *workers;
+static unsigned nworkers;
+
+static void *xrealloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (!ptr)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+static uint32_t find_string(const char *str)
+{
+	uint32_t i;
+	for (i = 1; i <= nstrings; i++)
+		if (!strcmp(strings[i], str))
+			return i;
+	return 0;
+}
+
+static const char *get_string(uint32_t id)
+{
+	return id ? strings[id] : NULL;
+}
+
+/* Map the file in memory, and collect its strings and events records */
+static void read_file(const char *path)
+{
+	struct _starpu_trace_bin_header *header;
+	struct stat st;
+	char *data, *p, *end;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0)
+	{
+		fprintf(stderr, "Failed to open '%s' (err %s)\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if ((size_t) st.st_size < sizeof(*header))
+	{
+		fprintf(stderr, "'%s' is not a StarPU binary trace\n", path);
+		exit(EXIT_FAILURE);
+	}
+#ifdef HAVE_MMAP
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map '%s' (err %s)\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+#else
+	{
+		size_t done = 0;
+		data = xrealloc(NULL, st.st_size);
+		while (done < (size_t) st.st_size)
+		{
+			ssize_t ret = read(fd, data + done, st.st_size - done);
+			if (ret <= 0)
+			{
+				fprintf(stderr, "Failed to read '%s' (err %s)\n", path, strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			done += ret;
+		}
+	}
+#endif
+	close(fd);
+
+	header = (struct _starpu_trace_bin_header *) data;
+	if (memcmp(header->magic, _STARPU_TRACE_BIN_MAGIC, sizeof(header->magic)))
+	{
+		fprintf(stderr, "'%s' is not a StarPU binary trace\n", path);
+		exit(EXIT_FAILURE);
+	}
+	if (header->one != 1 || header->version != _STARPU_TRACE_BIN_VERSION)
+	{
+		fprintf(stderr, "'%s' was written by an incompatible version or machine\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	strings = xrealloc(NULL, sizeof(*strings));
+	strings[0] = NULL;
+
+	p = data + sizeof(*header);
+	end = data + st.st_size;
+	while (p < end)
+	{
+		struct _starpu_trace_bin_record *record = (struct _starpu_trace_bin_record *) p;
+		char *payload = p + sizeof(*record);
+
+		if ((size_t) (end - p) < sizeof(*record) || record->size > (uint64_t) (end - payload))
+		{
+			fprintf(stderr, "'%s' is truncated\n", path);
+			exit(EXIT_FAILURE);
+		}
+
+		switch (record->type)
+		{
+			case _STARPU_TRACE_BIN_STRING:
+				if (record->n == 0 || record->n > record->size || payload[record->n - 1])
+				{
+					fprintf(stderr, "'%s' contains an invalid string\n", path);
+					exit(EXIT_FAILURE);
+				}
+				strings = xrealloc(strings, (nstrings + 2) * sizeof(*strings));
+				strings[++nstrings] = payload;
+				break;
+			case _STARPU_TRACE_BIN_EVENTS:
+				if (record->size < _starpu_trace_bin_events_size(record->n))
+				{
+					fprintf(stderr, "'%s' contains an invalid events record\n", path);
+					exit(EXIT_FAILURE);
+				}
+				blocks = xrealloc(blocks, (nblocks + 1) * sizeof(*blocks));
+				_starpu_trace_bin_get_events(&blocks[nblocks++], payload, record->n);
+				break;
+			default:
+				/* Unknown record, skip it */
+				break;
+		}
+		p = payload + record->size;
+	}
+}
+
+static struct state_stat *get_stat(struct stats *stats, uint32_t name, uint32_t category)
+{
+	int i = stats->index[name];
+	if (i < 0)
+	{
+		i = stats->nstats++;
+		stats->index[name] = i;
+		stats->stats = xrealloc(stats->stats, stats->nstats * sizeof(*stats->stats));
+		stats->stats[i].name = name;
+		stats->stats[i].category = category;
+		stats->stats[i].count = 0;
+		stats->stats[i].duration = 0.;
+	}
+	return &stats->stats[i];
+}
+
+static void init_stats(struct stats *stats)
+{
+	uint32_t i;
+	stats->stats = NULL;
+	stats->nstats = 0;
+	stats->index = xrealloc(NULL, (nstrings + 1) * sizeof(*stats->index));
+	for (i = 0; i <= nstrings; i++)
+		stats->index[i] = -1;
+}
+
+static struct worker *get_worker(int id)
+{
+	/* Consecutive events often belong to the same worker */
+	static unsigned last_worker;
+	unsigned i;
+	struct worker *worker;
+
+	if (last_worker < nworkers && workers[last_worker].id == id)
+		return &workers[last_worker];
+	for (i = 0; i < nworkers; i++)
+		if (workers[i].id == id)
+		{
+			last_worker = i;
+			return &workers[i];
+		}
+
+	workers = xrealloc(workers, (nworkers + 1) * sizeof(*workers));
+	worker = &workers[nworkers++];
+	memset(worker, 0, sizeof(*worker));
+	worker->id = id;
+	init_stats(&worker->stats);
+	return worker;
+}
+
+/* Account the state ended by the given event */
+static void add_event_to_stats(struct worker *worker, const struct event *event)
+{
+	struct event start;
+	struct state_stat *stat;
+
+	switch (event->type)
+	{
+		case _STARPU_TRACE_BIN_PUSH_STATE:
+			/* Will be accounted on the corresponding PopState */
+			if (worker->stack_size == worker->stack_allocated)
+			{
+				worker->stack_allocated = worker->stack_allocated ? 2 * worker->stack_allocated : 16;
+				worker->stack = xrealloc(worker->stack, worker->stack_allocated * sizeof(*worker->stack));
+			}
+			worker->stack[worker->stack_size++] = *event;
+			return;
+		case _STARPU_TRACE_BIN_POP_STATE:
+			if (!worker->stack_size)
+			{
+				fprintf(stderr, "warning: PopState without a PushState, probably a trace with start/stop profiling\n");
+				worker->has_current = 0;
+				return;
+			}
+			start = worker->stack[--worker->stack_size];
+			break;
+		case _STARPU_TRACE_BIN_SET_STATE:
+			if (!worker->has_current)
+			{
+				worker->current = *event;
+				worker->has_current = 1;
+				return;
+			}
+			start = worker->current;
+			worker->current = *event;
+			break;
+		default:
+			fprintf(stderr, "Invalid event type %u\n", event->type);
+			exit(EXIT_FAILURE);
+	}
+
+	stat = get_stat(&worker->stats, start.name, start.category);
+	stat->count++;
+	stat->duration += event->time - start.time;
+}
+
+/* Return the index of the profiling period containing the given time, -1 if none */
+static int find_profiling_period(double time)
+{
+	unsigned i;
+	for (i = 0; i < nstart_profiling; i++)
+		if (time > start_profiling[i] && time < stop_profiling[i])
+			return i;
+	return -1;
+}
+
+static void compute_stats(void)
+{
+	uint32_t program = find_string("Program");
+	uint32_t start_name = find_string("start_profiling");
+	uint32_t stop_name = find_string("stop_profiling");
+	uint32_t deinit_name = find_string("Deinitializing");
+	unsigned b, i;
+
+	/* Find the periods between start/stop profiling events */
+	for (b = 0; b < nblocks; b++)
+	{
+		struct _starpu_trace_bin_events *events = &blocks[b];
+		for (i = 0; i < events->n; i++)
+		{
+			if (!program || events->category[i] != program)
+				continue;
+			if (start_name && events->name[i] == start_name)
+			{
+				start_profiling = xrealloc(start_profiling, (nstart_profiling + 1) * sizeof(*start_profiling));
+				start_profiling[nstart_profiling++] = events->time[i];
+			}
+			if (stop_name && events->name[i] == stop_name)
+			{
+				stop_profiling = xrealloc(stop_profiling, (nstop_profiling + 1) * sizeof(*stop_profiling));
+				stop_profiling[nstop_profiling++] = events->time[i];
+			}
+		}
+	}
+	if (nstart_profiling != nstop_profiling)
+	{
+		fprintf(stderr, "Mismatch number of start/stop profiling events!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (b = 0; b < nblocks; b++)
+	{
+		struct _starpu_trace_bin_events *events = &blocks[b];
+		for (i = 0; i < events->n; i++)
+		{
+			struct event event =
+			{
+				.time = events->time[i],
+				.name = events->name[i],
+				.category = events->category[i],
+				.type = events->type[i],
+			};
+			struct worker *worker;
+
+			/* Program events do not belong to workers */
+			if (program && event.category == program)
+				continue;
+
+			worker = get_worker(events->worker[i]);
+
+			/* Drop the events after the Deinitializing state, they do not make sense */
+			if (worker->has_last && deinit_name && worker->last.name == deinit_name)
+				worker->finished = 1;
+			worker->last = event;
+			worker->has_last = 1;
+			if (worker->finished)
+				continue;
+
+			if (!nstart_profiling || find_profiling_period(event.time) >= 0)
+				add_event_to_stats(worker, &event);
+		}
+	}
+
+	if (!nstart_profiling)
+		return;
+
+	/* A last SetState event needs a next one for computing its duration,
+	 * terminate it at the end of its profiling period */
+	for (i = 0; i < nworkers; i++)
+	{
+		struct worker *worker = &workers[i];
+		if (worker->has_last && worker->last.type == _STARPU_TRACE_BIN_SET_STATE)
+		{
+			struct event event = worker->last;
+			int period = find_profiling_period(event.time);
+			if (period >= 0)
+				event.time = stop_profiling[period];
+			add_event_to_stats(worker, &event);
+		}
+	}
+}
+
+static void print_stat(FILE *output, const char *prefix, const struct state_stat *stat)
+{
+	const char *name = get_string(stat->name);
+	const char *category = get_string(stat->category);
+	if (name && category)
+		fprintf(output, "%s\"%s\",%lu,\"%s\",%f\n", prefix, name, stat->count, category, stat->duration);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Print statistics about the states of a StarPU binary trace\n\n");
+	fprintf(stderr, "Usage: %s [ options ] <trace.bin>\n", PROGNAME);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "   -w			print statistics for each worker\n");
+	fprintf(stderr, "   -h, --help		display this help and exit\n");
+	fprintf(stderr, "   -v, --version	output version information and exit\n\n");
+	fprintf(stderr, "Report bugs to <%s>.", PACKAGE_BUGREPORT);
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	int per_worker = 0;
+	struct stats stats;
+	unsigned i, j;
+	int arg;
+
+	for (arg = 1; arg < argc; arg++)
+	{
+		if (strcmp(argv[arg], "-w") == 0)
+			per_worker = 1;
+		else if (strcmp(argv[arg], "-h") == 0 || strcmp(argv[arg], "--help") == 0)
+		{
+			usage();
+			return EXIT_SUCCESS;
+		}
+		else if (strcmp(argv[arg], "-v") == 0 || strcmp(argv[arg], "--version") == 0)
+		{
+			fputs(PROGNAME " (" PACKAGE_NAME ") " PACKAGE_VERSION "\n", stderr);
+			return EXIT_SUCCESS;
+		}
+		else
+			path = argv[arg];
+	}
+
+	if (!path)
+	{
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	read_file(path);
+	compute_stats();
+
+	if (per_worker)
+	{
+		printf("\"Worker\",\"Name\",\"Count\",\"Type\",\"Duration\"\n");
+		for (i = 0; i < nworkers; i++)
+		{
+			char prefix[32];
+			snprintf(prefix, sizeof(prefix), "%d,", workers[i].id);
+			for (j = 0; j < workers[i].stats.nstats; j++)
+				print_stat(stdout, prefix, &workers[i].stats.stats[j]);
+		}
+		return EXIT_SUCCESS;
+	}
+
+	/* Sum the statistics of all workers */
+	init_stats(&stats);
+	for (i = 0; i < nworkers; i++)
+		for (j = 0; j < workers[i].stats.nstats; j++)
+		{
+			struct state_stat *worker_stat = &workers[i].stats.stats[j];
+			struct state_stat *stat = get_stat(&stats, worker_stat->name, worker_stat->category);
+			stat->count += worker_stat->count;
+			stat->duration += worker_stat->duration;
+		}
+
+	printf("\"Name\",\"Count\",\"Type\",\"Duration\"\n");
+	for (j = 0; j < stats.nstats; j++)
+		print_stat(stdout, "", &stats.stats[j]);
+
+	return EXIT_SUCCESS;
+}